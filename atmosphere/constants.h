@@ -29,8 +29,13 @@
 
 /*<h2>atmosphere/constants.h</h2>
 
-<p>This file defines the size of the precomputed texures used in our atmosphere
-model. It also provides tabulated values of the <a href=
+<p>This file defines the default size of the precomputed texures used in our
+atmosphere model, and a structure to specify other sizes at runtime (e.g. to
+use smaller textures on mobile devices, or larger ones for offline rendering).
+It also defines the default numerical integration rule and sample counts used
+to precompute these textures, and a structure to select other ones at runtime
+(to trade precision for precomputation speed). Finally, it provides tabulated
+values of the <a href=
 "https://en.wikipedia.org/wiki/CIE_1931_color_space#Color_matching_functions"
 >CIE color matching functions</a> and the conversion matrix from the <a href=
 "https://en.wikipedia.org/wiki/CIE_1931_color_space">XYZ</a> to the
@@ -60,6 +65,156 @@ constexpr int SCATTERING_TEXTURE_DEPTH = SCATTERING_TEXTURE_R_SIZE;
 constexpr int IRRADIANCE_TEXTURE_WIDTH = 64;
 constexpr int IRRADIANCE_TEXTURE_HEIGHT = 16;
 
+// The size of the precomputed textures. Each size must be at least 2, and
+// scattering_mu_size must be even (half of the texture is used for the view
+// rays which intersect the ground, and the other half for the other rays).
+struct TextureResolution {
+  TextureResolution()
+      : transmittance_width(TRANSMITTANCE_TEXTURE_WIDTH),
+        transmittance_height(TRANSMITTANCE_TEXTURE_HEIGHT),
+        scattering_r_size(SCATTERING_TEXTURE_R_SIZE),
+        scattering_mu_size(SCATTERING_TEXTURE_MU_SIZE),
+        scattering_mu_s_size(SCATTERING_TEXTURE_MU_S_SIZE),
+        scattering_nu_size(SCATTERING_TEXTURE_NU_SIZE),
+        irradiance_width(IRRADIANCE_TEXTURE_WIDTH),
+        irradiance_height(IRRADIANCE_TEXTURE_HEIGHT) {}
+
+  // Returns whether the above constraints are satisfied.
+  bool IsValid() const {
+    return transmittance_width >= 2 && transmittance_height >= 2 &&
+        scattering_r_size >= 2 && scattering_mu_size >= 2 &&
+        scattering_mu_size % 2 == 0 && scattering_mu_s_size >= 2 &&
+        scattering_nu_size >= 2 && irradiance_width >= 2 &&
+        irradiance_height >= 2;
+  }
+
+  // The size of the 3D scattering textures, which store the 4D scattering
+  // function (see GetScatteringTextureUvwzFromRMuMuSNu in functions.glsl).
+  int scattering_width() const {
+    return scattering_nu_size * scattering_mu_s_size;
+  }
+  int scattering_height() const { return scattering_mu_size; }
+  int scattering_depth() const { return scattering_r_size; }
+
+  int transmittance_width;
+  int transmittance_height;
+  int scattering_r_size;
+  int scattering_mu_size;
+  int scattering_mu_s_size;
+  int scattering_nu_size;
+  int irradiance_width;
+  int irradiance_height;
+};
+
+constexpr int TRANSMITTANCE_SAMPLE_COUNT = 500;
+constexpr int SINGLE_SCATTERING_SAMPLE_COUNT = 50;
+constexpr int MULTIPLE_SCATTERING_SAMPLE_COUNT = 50;
+
+// The numerical integration rules which can be used to compute the integrals
+// along the view rays (see ComputeOpticalLengthToTopAtmosphereBoundary,
+// ComputeSingleScattering and ComputeMultipleScattering in functions.glsl).
+// The meaning of the sample count N depends on the rule:
+enum QuadratureRule {
+  // The trapezoidal rule, with N intervals (i.e. N+1 samples).
+  TRAPEZOIDAL_RULE = 0,
+  // The composite 4-point Gauss-Legendre rule, with N samples (rounded up to
+  // a multiple of 4).
+  GAUSS_LEGENDRE_RULE = 1,
+  // The adaptive Simpson rule, with at most N samples (but at least 5, and at
+  // most 129) for the optical length integrals. The other integrals, whose
+  // integrands are spectra, use the composite Simpson rule with N intervals
+  // (rounded up to an even number) instead.
+  ADAPTIVE_SIMPSON_RULE = 2
+};
+
+constexpr int SCATTERING_DENSITY_SAMPLE_COUNT = 512;
+constexpr int INDIRECT_IRRADIANCE_SAMPLE_COUNT = 1024;
+
+// The numerical integration rules which can be used to compute the integrals
+// over the incident directions (see ComputeScatteringDensity, over the whole
+// sphere, and ComputeIndirectIrradiance, over the upper hemisphere, in
+// functions.glsl). The meaning of the sample count N depends on the rule:
+enum SphericalQuadratureRule {
+  // The midpoint rule on a latitude-longitude grid with s rows and 2s columns
+  // for the sphere (resp. 4s columns for the hemisphere), where s is the
+  // largest value such that the grid has at most N directions. The default
+  // counts give the 16x32 and 16x64 grids of the original implementation.
+  LATITUDE_LONGITUDE_RULE = 0,
+  // N directions on a Fibonacci spiral, with equal weights.
+  FIBONACCI_RULE = 1,
+  // The Lebedev rule with N directions, N being one of LEBEDEV_SAMPLE_COUNTS
+  // (for the hemisphere, the directions below the horizon are ignored).
+  LEBEDEV_RULE = 2,
+  // For the sphere, N/2 Fibonacci directions plus N/2 directions distributed
+  // like the Mie phase function around the view direction, combined with the
+  // balance heuristic. For the hemisphere, N cosine distributed directions.
+  IMPORTANCE_SAMPLING_RULE = 3
+};
+
+constexpr int LEBEDEV_SAMPLE_COUNTS[] = {6, 14, 26, 38, 50, 74, 86, 110};
+
+// The sample directions and weights of the spherical quadrature rules are
+// stored in a texture with one row per integral (see GetSphericalSample in
+// functions.glsl).
+constexpr int SCATTERING_DENSITY_SAMPLES_ROW = 0;
+constexpr int INDIRECT_IRRADIANCE_SAMPLES_ROW = 1;
+constexpr int SPHERICAL_SAMPLES_TEXTURE_HEIGHT = 2;
+
+// The numerical integration rules and the sample counts used to precompute the
+// transmittance, single scattering, multiple scattering, scattering density
+// and indirect irradiance textures. Each sample count must be at least 1,
+// except for the scattering density and the indirect irradiance, which need at
+// least 2 and 4 directions, respectively (or exactly one of
+// LEBEDEV_SAMPLE_COUNTS with the Lebedev rule).
+struct Quadrature {
+  Quadrature()
+      : rule(TRAPEZOIDAL_RULE),
+        transmittance_sample_count(TRANSMITTANCE_SAMPLE_COUNT),
+        single_scattering_sample_count(SINGLE_SCATTERING_SAMPLE_COUNT),
+        multiple_scattering_sample_count(MULTIPLE_SCATTERING_SAMPLE_COUNT),
+        spherical_rule(LATITUDE_LONGITUDE_RULE),
+        scattering_density_sample_count(SCATTERING_DENSITY_SAMPLE_COUNT),
+        indirect_irradiance_sample_count(INDIRECT_IRRADIANCE_SAMPLE_COUNT) {}
+
+  // Returns whether the rules are valid and the above constraints are
+  // satisfied.
+  bool IsValid() const {
+    return rule >= TRAPEZOIDAL_RULE && rule <= ADAPTIVE_SIMPSON_RULE &&
+        transmittance_sample_count >= 1 &&
+        single_scattering_sample_count >= 1 &&
+        multiple_scattering_sample_count >= 1 &&
+        spherical_rule >= LATITUDE_LONGITUDE_RULE &&
+        spherical_rule <= IMPORTANCE_SAMPLING_RULE &&
+        IsValidSphericalSampleCount(scattering_density_sample_count, 2) &&
+        IsValidSphericalSampleCount(indirect_irradiance_sample_count, 4);
+  }
+
+  // A QuadratureRule value (stored as an int, as in the GLSL version of this
+  // structure).
+  int rule;
+  int transmittance_sample_count;
+  int single_scattering_sample_count;
+  int multiple_scattering_sample_count;
+  // A SphericalQuadratureRule value.
+  int spherical_rule;
+  int scattering_density_sample_count;
+  int indirect_irradiance_sample_count;
+
+ private:
+  bool IsValidSphericalSampleCount(int sample_count,
+      int min_sample_count) const {
+    if (spherical_rule != LEBEDEV_RULE) {
+      return sample_count >= min_sample_count;
+    }
+    for (int lebedev_sample_count : LEBEDEV_SAMPLE_COUNTS) {
+      if (sample_count == lebedev_sample_count) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
 // The conversion factor between watts and lumens.
 constexpr double MAX_LUMINOUS_EFFICACY = 683.0;
 
@@ -131,6 +131,9 @@ macros. The full definitions are given in the
 #define ScatteringTexture sampler3D
 #define ScatteringDensityTexture sampler3D
 #define IrradianceTexture sampler2D
+// A table of sample directions (x,y,z) and solid angles in steradians (w), one
+// per texel (see GetSphericalSample in functions.glsl).
+#define SphericalSamplesTexture sampler2D
 
 /*
 <h3>Physical units</h3>
@@ -198,6 +201,53 @@ struct DensityProfile {
   DensityProfileLayer layers[2];
 };
 
+/*
+<p>The atmosphere parameters also include the size of the precomputed textures,
+which is needed to convert between texture coordinates and physical parameters
+(see <a href="constants.h.html">constants.h</a> for the default values and the
+constraints on these sizes):
+*/
+
+struct TextureResolution {
+  int transmittance_width;
+  int transmittance_height;
+  int scattering_r_size;
+  int scattering_mu_size;
+  int scattering_mu_s_size;
+  int scattering_nu_size;
+  int irradiance_width;
+  int irradiance_height;
+};
+
+/*
+<p>as well as the numerical integration rules and the number of samples used to
+compute the integrals along the view rays, and over the incident directions (see
+<a href="constants.h.html">constants.h</a> for the meaning of these values):
+*/
+
+const int TRAPEZOIDAL_RULE = 0;
+const int GAUSS_LEGENDRE_RULE = 1;
+const int ADAPTIVE_SIMPSON_RULE = 2;
+
+const int LATITUDE_LONGITUDE_RULE = 0;
+const int FIBONACCI_RULE = 1;
+const int LEBEDEV_RULE = 2;
+const int IMPORTANCE_SAMPLING_RULE = 3;
+
+const int SCATTERING_DENSITY_SAMPLES_ROW = 0;
+const int INDIRECT_IRRADIANCE_SAMPLES_ROW = 1;
+const int SPHERICAL_SAMPLES_TEXTURE_HEIGHT = 2;
+
+struct Quadrature {
+  int rule;
+  int transmittance_sample_count;
+  int single_scattering_sample_count;
+  int multiple_scattering_sample_count;
+  int spherical_rule;
+  int scattering_density_sample_count;
+  int indirect_irradiance_sample_count;
+};
+
 /*
 The atmosphere parameters are then defined by the following struct:
 */
@@ -252,4 +302,8 @@ struct AtmosphereParameters {
   // angle yielding negligible sky light radiance values. For instance, for the
   // Earth case, 102 degrees is a good choice - yielding mu_s_min = -0.2).
   Number mu_s_min;
+  // The size of the precomputed textures.
+  TextureResolution texture_resolution;
+  // The numerical integration rule and sample counts.
+  Quadrature quadrature;
 };
@@ -185,7 +185,7 @@ is done in the following method. It starts with the creation of an atmosphere
 atmosphere:
 */
 
-void Demo::InitModel() {
+void Demo::InitModel(bool only_solar_irradiance_changed) {
   // Values from "Reference Solar Spectral Irradiance: ASTM G-173", ETR column
   // (see http://rredc.nrel.gov/solar/spectra/am1.5/ASTMG173/ASTMG173.html),
   // summed and averaged in each bin (e.g. the value for 360nm is the average
@@ -275,13 +275,21 @@ void Demo::InitModel() {
     ground_albedo.push_back(kGroundAlbedo);
   }
 
-  model_.reset(new Model(wavelengths, solar_irradiance, kSunAngularRadius,
-      kBottomRadius, kTopRadius, {rayleigh_layer}, rayleigh_scattering,
-      {mie_layer}, mie_scattering, mie_extinction, kMiePhaseFunctionG,
-      ozone_density, absorption_extinction, ground_albedo, max_sun_zenith_angle,
-      kLengthUnitInMeters, use_luminance_ == PRECOMPUTED ? 15 : 3,
-      use_combined_textures_, use_half_precision_));
-  model_->Init();
+  // If only the solar spectrum changed, the existing model can simply update
+  // its precomputed textures, which is much faster than a new precomputation
+  // (at least when precomputing irradiance values).
+  if (only_solar_irradiance_changed && model_) {
+    model_->SetSolarIrradiance(solar_irradiance);
+  } else {
+    model_.reset(new Model(wavelengths, solar_irradiance, kSunAngularRadius,
+        kBottomRadius, kTopRadius, {rayleigh_layer}, rayleigh_scattering,
+        {mie_layer}, mie_scattering, mie_extinction, kMiePhaseFunctionG,
+        ozone_density, absorption_extinction, ground_albedo,
+        max_sun_zenith_angle, kLengthUnitInMeters,
+        use_luminance_ == PRECOMPUTED ? 15 : 3, use_combined_textures_,
+        use_half_precision_));
+    model_->Init();
+  }
 
 /*
 <p>Then, it creates and compiles the vertex and fragment shaders used to render
@@ -487,7 +495,9 @@ void Demo::HandleKeyboardEvent(unsigned char key) {
   } else if (key == '9') {
     SetView(1.2e7, 0.0, 0.0, 0.93, -2.0, 10.0);
   }
-  if (key == 's' || key == 'o' || key == 't' || key == 'p' || key == 'l' ||
+  if (key == 's') {
+    InitModel(true /* only_solar_irradiance_changed */);
+  } else if (key == 'o' || key == 't' || key == 'p' || key == 'l' ||
       key == 'w') {
     InitModel();
   }
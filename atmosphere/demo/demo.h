@@ -76,7 +76,7 @@ class Demo {
     PRECOMPUTED
   };
 
-  void InitModel();
+  void InitModel(bool only_solar_irradiance_changed = false);
   void HandleRedisplayEvent() const;
   void HandleReshapeEvent(int viewport_width, int viewport_height);
   void HandleKeyboardEvent(unsigned char key);
@@ -36,18 +36,10 @@ textures and shaders from the network (those are precomputed with
 <a href="precompute.cc.html">precompute.cc</a>).
 
 <p>The following constants must have the same values as in
-<a href="../../constants.h.html">constants.h</a> and
-<a href="../demo.cc.html">demo.cc</a>:
+<a href="../demo.cc.html">demo.cc</a> (the texture sizes, on the other hand,
+are loaded with the textures - see below):
 */
 
-const TRANSMITTANCE_TEXTURE_WIDTH = 256;
-const TRANSMITTANCE_TEXTURE_HEIGHT = 64;
-const SCATTERING_TEXTURE_WIDTH = 256;
-const SCATTERING_TEXTURE_HEIGHT = 128;
-const SCATTERING_TEXTURE_DEPTH = 32;
-const IRRADIANCE_TEXTURE_WIDTH = 64;
-const IRRADIANCE_TEXTURE_HEIGHT = 16;
-
 const kSunAngularRadius = 0.00935 / 2;
 const kSunSolidAngle = Math.PI * kSunAngularRadius * kSunAngularRadius;
 const kLengthUnitInMeters = 1000;
@@ -103,7 +95,9 @@ class Demo {
 /*
 <p>The init method creates a vertex buffer for a full screen quad, and loads the
 precomputed textures and the shaders for the demo (using utility methods defined
-in the <code>Utils</code> class below):
+in the <code>Utils</code> class below). The size of each texture is read from
+the <code>textures.json</code> file saved with the textures, which is loaded
+first:
 */
 
   init() {
@@ -113,27 +107,30 @@ in the <code>Utils</code> class below):
     gl.bufferData(gl.ARRAY_BUFFER,
        new Float32Array([-1, -1, +1, -1, -1, +1, +1, +1]), gl.STATIC_DRAW);
 
-    Utils.loadTextureData('transmittance.dat', (data) => {
-      this.transmittanceTexture =
-          Utils.createTexture(gl, gl.TEXTURE0, gl.TEXTURE_2D);
-      gl.texImage2D(gl.TEXTURE_2D, 0,
-          gl.getExtension('OES_texture_float_linear') ? gl.RGBA32F : gl.RGBA16F,
-          TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT, 0, gl.RGBA,
-          gl.FLOAT, data);
-    });
-    Utils.loadTextureData('scattering.dat', (data) => {
-      this.scatteringTexture =
-          Utils.createTexture(gl, gl.TEXTURE1, gl.TEXTURE_3D);
-      gl.texParameteri(gl.TEXTURE_3D, gl.TEXTURE_WRAP_R, gl.CLAMP_TO_EDGE);
-      gl.texImage3D(gl.TEXTURE_3D, 0, gl.RGBA16F, SCATTERING_TEXTURE_WIDTH,
-          SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH, 0, gl.RGBA,
-          gl.FLOAT, data);
-    });
-    Utils.loadTextureData('irradiance.dat', (data) => {
-      this.irradianceTexture =
-          Utils.createTexture(gl, gl.TEXTURE2, gl.TEXTURE_2D);
-      gl.texImage2D(gl.TEXTURE_2D, 0, gl.RGBA16F, IRRADIANCE_TEXTURE_WIDTH,
-          IRRADIANCE_TEXTURE_HEIGHT, 0, gl.RGBA, gl.FLOAT, data);
+    Utils.loadJson('textures.json', (sizes) => {
+      Utils.loadTextureData('transmittance.dat', (data) => {
+        this.transmittanceTexture =
+            Utils.createTexture(gl, gl.TEXTURE0, gl.TEXTURE_2D);
+        gl.texImage2D(gl.TEXTURE_2D, 0,
+            gl.getExtension('OES_texture_float_linear') ?
+                gl.RGBA32F : gl.RGBA16F,
+            sizes.transmittance[0], sizes.transmittance[1], 0, gl.RGBA,
+            gl.FLOAT, data);
+      });
+      Utils.loadTextureData('scattering.dat', (data) => {
+        this.scatteringTexture =
+            Utils.createTexture(gl, gl.TEXTURE1, gl.TEXTURE_3D);
+        gl.texParameteri(gl.TEXTURE_3D, gl.TEXTURE_WRAP_R, gl.CLAMP_TO_EDGE);
+        gl.texImage3D(gl.TEXTURE_3D, 0, gl.RGBA16F, sizes.scattering[0],
+            sizes.scattering[1], sizes.scattering[2], 0, gl.RGBA, gl.FLOAT,
+            data);
+      });
+      Utils.loadTextureData('irradiance.dat', (data) => {
+        this.irradianceTexture =
+            Utils.createTexture(gl, gl.TEXTURE2, gl.TEXTURE_2D);
+        gl.texImage2D(gl.TEXTURE_2D, 0, gl.RGBA16F, sizes.irradiance[0],
+            sizes.irradiance[1], 0, gl.RGBA, gl.FLOAT, data);
+      });
     });
 
     Utils.loadShaderSource('vertex_shader.txt', (source) => {
@@ -354,6 +351,14 @@ class Utils {
     xhr.send();
   }
 
+  static loadJson(fileName, callback) {
+    const xhr = new XMLHttpRequest();
+    xhr.open('GET', fileName);
+    xhr.responseType = 'json';
+    xhr.onload = (event) => callback(xhr.response);
+    xhr.send();
+  }
+
   static createShader(gl, type, source) {
     const shader = gl.createShader(type);
     gl.shaderSource(shader, source);
@@ -33,7 +33,11 @@
 saves to disk the shaders necessary for the demo. For this a C++
 <a href="../demo.h.html">Demo</a> instance is created (which precomputes the
 textures and creates the shaders), its shaders and textures are read back using
-the OpenGL API, and are saved to disk:
+the OpenGL API, and are saved to disk (see also the
+<a href="../../reference/precompute_main.cc.html">CPU precompute tool</a>, which
+does not need OpenGL). The texture sizes, which depend on the
+<code>TextureResolution</code> of the model, are saved in a small JSON file, so
+that the WebGL demo can allocate its textures accordingly:
 */
 
 #include <glad/glad.h>
@@ -41,6 +45,7 @@ the OpenGL API, and are saved to disk:
 
 #include <memory>
 #include <fstream>
+#include <iostream>
 
 #include "atmosphere/demo/demo.h"
 #include "atmosphere/constants.h"
@@ -72,7 +77,26 @@ void SaveTexture(const GLenum texture_unit, const GLenum texture_target,
   output_stream.close();
 }
 
+void SaveTextureSizes(const atmosphere::TextureResolution& resolution,
+    const std::string& filename) {
+  std::ofstream output_stream(filename, std::ofstream::out);
+  output_stream << "{\n"
+      << "  \"transmittance\": [" << resolution.transmittance_width << ", "
+      << resolution.transmittance_height << "],\n"
+      << "  \"scattering\": [" << resolution.scattering_width() << ", "
+      << resolution.scattering_height() << ", "
+      << resolution.scattering_depth() << "],\n"
+      << "  \"irradiance\": [" << resolution.irradiance_width << ", "
+      << resolution.irradiance_height << "]\n"
+      << "}\n";
+  output_stream.close();
+}
+
 int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: precompute output_directory/" << std::endl;
+    return 1;
+  }
   glutInitContextVersion(3, 3);
   glutInitContextProfile(GLUT_CORE_PROFILE);
   glutInit(&argc, argv);
@@ -85,25 +109,25 @@ int main(int argc, char** argv) {
   SaveShader(demo->model().shader(), output_dir + "atmosphere_shader.txt");
   SaveShader(demo->vertex_shader(), output_dir + "vertex_shader.txt");
   SaveShader(demo->fragment_shader(), output_dir + "fragment_shader.txt");
+  const atmosphere::TextureResolution& resolution =
+      demo->model().texture_resolution();
   SaveTexture(
       GL_TEXTURE0,
       GL_TEXTURE_2D,
-      atmosphere::TRANSMITTANCE_TEXTURE_WIDTH *
-          atmosphere::TRANSMITTANCE_TEXTURE_HEIGHT,
+      resolution.transmittance_width * resolution.transmittance_height,
       output_dir + "transmittance.dat");
   SaveTexture(
       GL_TEXTURE1,
       GL_TEXTURE_3D,
-      atmosphere::SCATTERING_TEXTURE_WIDTH *
-          atmosphere::SCATTERING_TEXTURE_HEIGHT *
-          atmosphere::SCATTERING_TEXTURE_DEPTH,
+      resolution.scattering_width() * resolution.scattering_height() *
+          resolution.scattering_depth(),
       output_dir + "scattering.dat");
   SaveTexture(
       GL_TEXTURE2,
       GL_TEXTURE_2D,
-      atmosphere::IRRADIANCE_TEXTURE_WIDTH *
-          atmosphere::IRRADIANCE_TEXTURE_HEIGHT,
+      resolution.irradiance_width * resolution.irradiance_height,
       output_dir + "irradiance.dat");
+  SaveTextureSizes(resolution, output_dir + "textures.json");
 
   return 0;
 }
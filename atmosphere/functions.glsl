@@ -256,8 +256,7 @@ segment $[\bp,\bi]$, as well as the integral of the number density of aerosols
 and the integral of the number density of air molecules that absorb light
 (e.g. ozone) - along the same segment. These 3 integrals have the same form and,
 when the segment $[\bp,\bi]$ does not intersect the ground, they can be computed
-numerically with the help of the following auxilliary function (using the <a
-href="https://en.wikipedia.org/wiki/Trapezoidal_rule">trapezoidal rule</a>):
+numerically with the help of the following auxilliary functions:
 */
 
 Number GetLayerDensity(IN(DensityProfileLayer) layer, Length altitude) {
@@ -272,30 +271,318 @@ Number GetProfileDensity(IN(DensityProfile) profile, Length altitude) {
       GetLayerDensity(profile.layers[1], altitude);
 }
 
+Number GetOpticalLengthIntegrand(IN(AtmosphereParameters) atmosphere,
+    IN(DensityProfile) profile, Length r, Number mu, Length d) {
+  // Distance between the current sample point and the planet center.
+  Length r_d = sqrt(d * d + 2.0 * r * mu * d + r * r);
+  // Number density at the current sample point (divided by the number density
+  // at the bottom of the atmosphere, yielding a dimensionless number).
+  return GetProfileDensity(profile, r_d - atmosphere.bottom_radius);
+}
+
+/*
+<p>The numerical integration rule, and the number of samples, are specified by
+the <code>quadrature</code> field of the atmosphere parameters (see
+<a href="constants.h.html">constants.h</a>). With the <a href=
+"https://en.wikipedia.org/wiki/Trapezoidal_rule">trapezoidal rule</a> and the
+<a href="https://en.wikipedia.org/wiki/Gaussian_quadrature">Gauss-Legendre</a>
+rule, the samples of an integral over $[0,L]$ are at fixed positions $x_iL$,
+with fixed weights $w_iL$, which are given by the following functions (the
+composite <a href="https://en.wikipedia.org/wiki/Simpson%27s_rule">Simpson
+rule</a> is used for the spectral integrals when the adaptive Simpson rule is
+selected):
+*/
+
+int GetQuadratureSampleCount(int rule, int sample_count) {
+  if (rule == GAUSS_LEGENDRE_RULE) {
+    return 4 * ((sample_count + 3) / 4);
+  } else if (rule == ADAPTIVE_SIMPSON_RULE) {
+    return 2 * ((sample_count + 1) / 2) + 1;
+  } else {
+    return sample_count + 1;
+  }
+}
+
+void GetQuadratureSample(int rule, int sample_count, int i,
+    OUT(Number) x_i, OUT(Number) weight_i) {
+  if (rule == GAUSS_LEGENDRE_RULE) {
+    // The i-th sample is the k-th node of the 4-point rule on the p-th panel.
+    int panel_count = (sample_count + 3) / 4;
+    int p = i / 4;
+    int k = i - 4 * p;
+    bool outer_node = k == 0 || k == 3;
+    Number t_k = (k < 2 ? -1.0 : 1.0) *
+        (outer_node ? 0.8611363115940526 : 0.3399810435848563);
+    Number w_k = outer_node ? 0.3478548451374538 : 0.6521451548625461;
+    x_i = (Number(p) + 0.5 + 0.5 * t_k) / Number(panel_count);
+    weight_i = 0.5 * w_k / Number(panel_count);
+  } else if (rule == ADAPTIVE_SIMPSON_RULE) {
+    int interval_count = 2 * ((sample_count + 1) / 2);
+    Number w_i = i == 0 || i == interval_count ? 1.0 :
+        (i - 2 * (i / 2) == 1 ? 4.0 : 2.0);
+    x_i = Number(i) / Number(interval_count);
+    weight_i = w_i / (3.0 * Number(interval_count));
+  } else {
+    Number w_i = i == 0 || i == sample_count ? 0.5 : 1.0;
+    x_i = Number(i) / Number(sample_count);
+    weight_i = w_i / Number(sample_count);
+  }
+}
+
+/*
+<p>With the adaptive Simpson rule, the samples are placed where they are most
+needed, i.e. where the integrand is not well approximated by a parabola (e.g.
+near the boundaries of the ozone layer). For this the integration interval is
+split in sub-intervals, each sampled with 5 points, which give a Simpson
+estimate of its integral with 3 points and another one with 5 points, whose
+difference estimates the integration error. The sub-interval with the largest
+error is then split in two, until this error becomes negligible, or until the
+sample budget is exhausted (since GLSL does not support recursion, nor dynamic
+arrays, the sub-intervals are stored in arrays of fixed size, which limits the
+number of samples to 5 + 4 * 31):
+*/
+
+Number GetSimpsonError(Number h, Number f0, Number f1, Number f2, Number f3,
+    Number f4) {
+  Number coarse = h / 6.0 * (f0 + 4.0 * f2 + f4);
+  Number fine = h / 12.0 * (f0 + 4.0 * f1 + 2.0 * f2 + 4.0 * f3 + f4);
+  // The Richardson extrapolation of the error of the fine estimate.
+  return (fine - coarse) / 15.0;
+}
+
+Length ComputeOpticalLengthWithAdaptiveSimpsonRule(
+    IN(AtmosphereParameters) atmosphere, IN(DensityProfile) profile,
+    Length r, Number mu, Length length, int max_sample_count) {
+  const int MAX_INTERVAL_COUNT = 32;
+  // The maximum integration error, relative to the length of the integration
+  // interval.
+  const Number TOLERANCE = 1e-7;
+  // The bounds of each sub-interval, and the integrand values at 5 evenly
+  // spaced points in each sub-interval.
+  Number x0[MAX_INTERVAL_COUNT];
+  Number x1[MAX_INTERVAL_COUNT];
+  Number f0[MAX_INTERVAL_COUNT];
+  Number f1[MAX_INTERVAL_COUNT];
+  Number f2[MAX_INTERVAL_COUNT];
+  Number f3[MAX_INTERVAL_COUNT];
+  Number f4[MAX_INTERVAL_COUNT];
+  x0[0] = 0.0;
+  x1[0] = 1.0;
+  f0[0] = GetOpticalLengthIntegrand(atmosphere, profile, r, mu, 0.0 * length);
+  f1[0] = GetOpticalLengthIntegrand(atmosphere, profile, r, mu, 0.25 * length);
+  f2[0] = GetOpticalLengthIntegrand(atmosphere, profile, r, mu, 0.5 * length);
+  f3[0] = GetOpticalLengthIntegrand(atmosphere, profile, r, mu, 0.75 * length);
+  f4[0] = GetOpticalLengthIntegrand(atmosphere, profile, r, mu, length);
+  int interval_count = 1;
+  int sample_count = 5;
+  while (sample_count + 4 <= max_sample_count &&
+      interval_count < MAX_INTERVAL_COUNT) {
+    // Find the sub-interval with the largest error.
+    int j = 0;
+    Number max_error = -1.0;
+    for (int i = 0; i < interval_count; ++i) {
+      Number error = GetSimpsonError(
+          x1[i] - x0[i], f0[i], f1[i], f2[i], f3[i], f4[i]);
+      error = max(error, -error);
+      if (error > max_error) {
+        j = i;
+        max_error = error;
+      }
+    }
+    if (max_error <= TOLERANCE) {
+      break;
+    }
+    // Split it in two halves, stored at index j and interval_count, and
+    // sample the integrand at the 1/4 and 3/4 points of each half.
+    Number h = x1[j] - x0[j];
+    x0[interval_count] = x0[j] + 0.5 * h;
+    x1[interval_count] = x1[j];
+    f0[interval_count] = f2[j];
+    f1[interval_count] = GetOpticalLengthIntegrand(
+        atmosphere, profile, r, mu, (x0[j] + 0.625 * h) * length);
+    f2[interval_count] = f3[j];
+    f3[interval_count] = GetOpticalLengthIntegrand(
+        atmosphere, profile, r, mu, (x0[j] + 0.875 * h) * length);
+    f4[interval_count] = f4[j];
+    x1[j] = x0[j] + 0.5 * h;
+    f4[j] = f2[j];
+    f2[j] = f1[j];
+    f1[j] = GetOpticalLengthIntegrand(
+        atmosphere, profile, r, mu, (x0[j] + 0.125 * h) * length);
+    f3[j] = GetOpticalLengthIntegrand(
+        atmosphere, profile, r, mu, (x0[j] + 0.375 * h) * length);
+    interval_count += 1;
+    sample_count += 4;
+  }
+  Number result = 0.0;
+  for (int i = 0; i < interval_count; ++i) {
+    Number h = x1[i] - x0[i];
+    result += h / 12.0 * (f0[i] + 4.0 * f1[i] + 2.0 * f2[i] + 4.0 * f3[i] +
+        f4[i]) + GetSimpsonError(h, f0[i], f1[i], f2[i], f3[i], f4[i]);
+  }
+  return result * length;
+}
+
+/*
+<p>Most atmospheres, however, use a single exponential layer for the air
+molecules and for the aerosols, i.e. a density $\rho(h)=a\exp(-h/K)$, where
+$K$ is the scale height. In this case the optical length does not need to be
+integrated numerically: the optical length from $\bp$ to infinity, along a ray
+which does not go below $\bp$ ($\mu\ge 0$), is
+$aK\exp(-(r-r_\mathrm{bottom})/K)\mathrm{Ch}(r/K,\mu)$, where
+$$
+\mathrm{Ch}(x,\mu)=\int_0^\infty
+  \exp\left(x-\sqrt{x^2+2x\mu t+t^2}\right)\mathrm{d}t
+$$
+is the <a href="https://en.wikipedia.org/wiki/Chapman_function">Chapman
+function</a>. It does not have a closed form expression, but for large values
+of $x$ (about 800 for the air molecules on Earth, and 5000 for the aerosols), it
+has an accurate asymptotic expansion. Indeed, with the altitude gain $s=
+\sqrt{x^2+2x\mu t+t^2}-x$ as integration variable, and with $y=\mu\sqrt{x/2}$,
+we get
+$$
+\mathrm{Ch}(x,\mu)=\int_0^\infty\frac{(x+s)e^{-s}}{\sqrt{x^2\mu^2+2xs+s^2}}
+  \mathrm{d}s=\sqrt{\frac{x}{2}}\int_0^\infty\frac{e^{-s}}{\sqrt{y^2+s}}
+  \left(1+\frac{s}{x}-\frac{s^2}{4x(y^2+s)}+O(x^{-2})\right)\mathrm{d}s
+$$
+whose terms can be integrated by parts, giving
+$\mathrm{Ch}(x,\mu)\approx\sqrt{x/2}\left[F(y)+G(y)/x\right]$, with
+$F(y)=\sqrt{\pi}\exp(y^2)\mathrm{erfc}(y)$ and $G(y)=3y/4+3F/8-y^2F/2-y^3/2+
+y^4F/2$. The relative error of this approximation is less than $2\times
+10^{-5}$ for $x\ge 100$, and less than $3\times 10^{-7}$ for $x\ge 800$. GLSL
+does not provide the <code>erfc</code> function, so we compute $F$ ourselves,
+with its Taylor series for small values, and with its continued fraction
+expansion otherwise (both truncated so that the relative error is less than
+$10^{-8}$):
+*/
+
+Number ScaledComplementaryErrorFunction(Number y) {
+  assert(y >= 0.0);
+  if (y < 1.5) {
+    // sqrt(pi) exp(y^2) erfc(y) = sqrt(pi) exp(y^2) - 2 sum_n 2^n y^(2n+1) /
+    // (1.3.5...(2n+1)).
+    Number term = y;
+    Number sum = y;
+    for (int n = 1; n < 32; ++n) {
+      term = term * 2.0 * y * y / Number(2 * n + 1);
+      sum += term;
+    }
+    return sqrt(PI) * exp(y * y) - 2.0 * sum;
+  }
+  // 1 / (y + (1/2) / (y + 1 / (y + (3/2) / (y + 2 / ...)))).
+  Number f = y;
+  for (int k = 32; k >= 1; --k) {
+    f = y + 0.5 * Number(k) / f;
+  }
+  return 1.0 / f;
+}
+
+Number ChapmanFunction(Number x, Number mu) {
+  assert(mu >= 0.0 && mu <= 1.0);
+  Number y = mu * sqrt(0.5 * x);
+  Number G;
+  if (y < 4.0) {
+    Number F = ScaledComplementaryErrorFunction(y);
+    Number y2 = y * y;
+    G = 0.75 * y - 0.5 * y * y2 + F * (0.375 - 0.5 * y2 + 0.5 * y2 * y2);
+    return sqrt(0.5 * x) * (F + G / x);
+  }
+  // For large y, the above expression of G suffers from cancellation errors,
+  // and is replaced with its asymptotic expansion.
+  Number z = 1.0 / (y * y);
+  G = (1.0 - z * (1.5 - z * (4.5 - z * 18.75))) / y;
+  return sqrt(0.5 * x) * (ScaledComplementaryErrorFunction(y) + G / x);
+}
+
+/*
+<p>The optical length to the top atmosphere boundary is then the optical length
+to infinity, minus the optical length to infinity from the exit point $\bi$,
+where $r_\bi=r_\mathrm{top}$ and $\mu_\bi=\sqrt{1-(r/r_\mathrm{top})^2(1-
+\mu^2)}$ (which follows from the conservation of $r\sqrt{1-\mu^2}$ along a
+ray). For a ray going below $\bp$ ($\mu<0$), the optical length to infinity
+is twice the optical length from the point of the ray closest to the planet
+center, at radius $r_0=r\sqrt{1-\mu^2}$, minus the optical length to infinity
+from $\bp$ in the opposite direction. Note that this analytic expression is
+only used when the asymptotic expansion is accurate, i.e. when the planet
+radius is at least 100 times the scale height, and when the same exponential
+layer is used at all altitudes. The numerical integration is used otherwise
+(e.g. for the ozone layer, or for linear density profiles):
+*/
+
+bool GetExponentialProfileLayer(IN(AtmosphereParameters) atmosphere,
+    IN(DensityProfile) profile, OUT(DensityProfileLayer) layer) {
+  const Number MIN_RADIUS_TO_SCALE_HEIGHT_RATIO = 100.0;
+  if (profile.layers[0].width <= 0.0 * m) {
+    layer = profile.layers[1];
+  } else if (profile.layers[0].width >=
+      atmosphere.top_radius - atmosphere.bottom_radius) {
+    layer = profile.layers[0];
+  } else {
+    return false;
+  }
+  return layer.exp_term >= 0.0 && layer.exp_term <= 1.0 &&
+      layer.linear_term == 0.0 / m && layer.constant_term == 0.0 &&
+      -layer.exp_scale * atmosphere.bottom_radius >=
+          MIN_RADIUS_TO_SCALE_HEIGHT_RATIO;
+}
+
+Length ComputeOpticalLengthToInfinity(IN(AtmosphereParameters) atmosphere,
+    Length scale_height, Length r, Number mu) {
+  return scale_height * exp(-(r - atmosphere.bottom_radius) / scale_height) *
+      ChapmanFunction(r / scale_height, mu);
+}
+
+Length ComputeOpticalLengthToTopAtmosphereBoundaryWithChapmanFunction(
+    IN(AtmosphereParameters) atmosphere, IN(DensityProfileLayer) layer,
+    Length r, Number mu) {
+  Length scale_height = -1.0 / layer.exp_scale;
+  Number mu_top = sqrt(max(1.0 - (r / atmosphere.top_radius) *
+      (r / atmosphere.top_radius) * (1.0 - mu * mu), Number(0.0)));
+  Length result = -ComputeOpticalLengthToInfinity(
+      atmosphere, scale_height, atmosphere.top_radius, mu_top);
+  if (mu >= 0.0) {
+    result += ComputeOpticalLengthToInfinity(atmosphere, scale_height, r, mu);
+  } else {
+    Length r_0 = r * sqrt(max(1.0 - mu * mu, Number(0.0)));
+    result += 2.0 * ComputeOpticalLengthToInfinity(
+        atmosphere, scale_height, r_0, 0.0) -
+        ComputeOpticalLengthToInfinity(atmosphere, scale_height, r, -mu);
+  }
+  return layer.exp_term * max(result, 0.0 * m);
+}
+
+/*
+<p>The optical length is then computed as follows:
+*/
+
 Length ComputeOpticalLengthToTopAtmosphereBoundary(
     IN(AtmosphereParameters) atmosphere, IN(DensityProfile) profile,
     Length r, Number mu) {
   assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
   assert(mu >= -1.0 && mu <= 1.0);
-  // Number of intervals for the numerical integration.
-  const int SAMPLE_COUNT = 500;
-  // The integration step, i.e. the length of each integration interval.
-  Length dx =
-      DistanceToTopAtmosphereBoundary(atmosphere, r, mu) / Number(SAMPLE_COUNT);
+  DensityProfileLayer layer;
+  if (GetExponentialProfileLayer(atmosphere, profile, layer)) {
+    return ComputeOpticalLengthToTopAtmosphereBoundaryWithChapmanFunction(
+        atmosphere, layer, r, mu);
+  }
+  int rule = atmosphere.quadrature.rule;
+  int sample_count = atmosphere.quadrature.transmittance_sample_count;
+  Length length = DistanceToTopAtmosphereBoundary(atmosphere, r, mu);
+  if (rule == ADAPTIVE_SIMPSON_RULE) {
+    return ComputeOpticalLengthWithAdaptiveSimpsonRule(
+        atmosphere, profile, r, mu, length, sample_count);
+  }
   // Integration loop.
-  Length result = 0.0 * m;
-  for (int i = 0; i <= SAMPLE_COUNT; ++i) {
-    Length d_i = Number(i) * dx;
-    // Distance between the current sample point and the planet center.
-    Length r_i = sqrt(d_i * d_i + 2.0 * r * mu * d_i + r * r);
-    // Number density at the current sample point (divided by the number density
-    // at the bottom of the atmosphere, yielding a dimensionless number).
-    Number y_i = GetProfileDensity(profile, r_i - atmosphere.bottom_radius);
-    // Sample weight (from the trapezoidal rule).
-    Number weight_i = i == 0 || i == SAMPLE_COUNT ? 0.5 : 1.0;
-    result += y_i * weight_i * dx;
+  Number result = 0.0;
+  int quadrature_sample_count = GetQuadratureSampleCount(rule, sample_count);
+  for (int i = 0; i < quadrature_sample_count; ++i) {
+    Number x_i;
+    Number weight_i;
+    GetQuadratureSample(rule, sample_count, i, x_i, weight_i);
+    result += GetOpticalLengthIntegrand(
+        atmosphere, profile, r, mu, x_i * length) * weight_i;
   }
-  return result;
+  return result * length;
 }
 
 /*
@@ -416,8 +703,11 @@ vec2 GetTransmittanceTextureUvFromRMu(IN(AtmosphereParameters) atmosphere,
   Length d_max = rho + H;
   Number x_mu = (d - d_min) / (d_max - d_min);
   Number x_r = rho / H;
-  return vec2(GetTextureCoordFromUnitRange(x_mu, TRANSMITTANCE_TEXTURE_WIDTH),
-              GetTextureCoordFromUnitRange(x_r, TRANSMITTANCE_TEXTURE_HEIGHT));
+  return vec2(
+      GetTextureCoordFromUnitRange(
+          x_mu, atmosphere.texture_resolution.transmittance_width),
+      GetTextureCoordFromUnitRange(
+          x_r, atmosphere.texture_resolution.transmittance_height));
 }
 
 /*
@@ -428,8 +718,10 @@ void GetRMuFromTransmittanceTextureUv(IN(AtmosphereParameters) atmosphere,
     IN(vec2) uv, OUT(Length) r, OUT(Number) mu) {
   assert(uv.x >= 0.0 && uv.x <= 1.0);
   assert(uv.y >= 0.0 && uv.y <= 1.0);
-  Number x_mu = GetUnitRangeFromTextureCoord(uv.x, TRANSMITTANCE_TEXTURE_WIDTH);
-  Number x_r = GetUnitRangeFromTextureCoord(uv.y, TRANSMITTANCE_TEXTURE_HEIGHT);
+  Number x_mu = GetUnitRangeFromTextureCoord(
+      uv.x, atmosphere.texture_resolution.transmittance_width);
+  Number x_r = GetUnitRangeFromTextureCoord(
+      uv.y, atmosphere.texture_resolution.transmittance_height);
   // Distance to top atmosphere boundary for a horizontal ray at ground level.
   Length H = sqrt(atmosphere.top_radius * atmosphere.top_radius -
       atmosphere.bottom_radius * atmosphere.bottom_radius);
@@ -454,7 +746,8 @@ the transmittance texture:
 DimensionlessSpectrum ComputeTransmittanceToTopAtmosphereBoundaryTexture(
     IN(AtmosphereParameters) atmosphere, IN(vec2) frag_coord) {
   const vec2 TRANSMITTANCE_TEXTURE_SIZE =
-      vec2(TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+      vec2(atmosphere.texture_resolution.transmittance_width,
+          atmosphere.texture_resolution.transmittance_height);
   Length r;
   Number mu;
   GetRMuFromTransmittanceTextureUv(
@@ -688,8 +981,8 @@ Length DistanceToNearestAtmosphereBoundary(IN(AtmosphereParameters) atmosphere,
 
 /*
 <p>The single scattering integral can then be computed as follows (using
-the <a href="https://en.wikipedia.org/wiki/Trapezoidal_rule">trapezoidal
-rule</a>):
+the numerical integration rule specified in the atmosphere parameters - see
+<code>GetQuadratureSample</code>):
 */
 
 void ComputeSingleScattering(
@@ -703,30 +996,33 @@ void ComputeSingleScattering(
   assert(mu_s >= -1.0 && mu_s <= 1.0);
   assert(nu >= -1.0 && nu <= 1.0);
 
-  // Number of intervals for the numerical integration.
-  const int SAMPLE_COUNT = 50;
-  // The integration step, i.e. the length of each integration interval.
-  Length dx =
-      DistanceToNearestAtmosphereBoundary(atmosphere, r, mu,
-          ray_r_mu_intersects_ground) / Number(SAMPLE_COUNT);
+  // The numerical integration rule and number of samples.
+  int rule = atmosphere.quadrature.rule;
+  int sample_count = atmosphere.quadrature.single_scattering_sample_count;
+  // The length of the integration interval.
+  Length length = DistanceToNearestAtmosphereBoundary(atmosphere, r, mu,
+      ray_r_mu_intersects_ground);
   // Integration loop.
   DimensionlessSpectrum rayleigh_sum = DimensionlessSpectrum(0.0);
   DimensionlessSpectrum mie_sum = DimensionlessSpectrum(0.0);
-  for (int i = 0; i <= SAMPLE_COUNT; ++i) {
-    Length d_i = Number(i) * dx;
+  int quadrature_sample_count = GetQuadratureSampleCount(rule, sample_count);
+  for (int i = 0; i < quadrature_sample_count; ++i) {
+    Number x_i;
+    Number weight_i;
+    GetQuadratureSample(rule, sample_count, i, x_i, weight_i);
+    Length d_i = x_i * length;
     // The Rayleigh and Mie single scattering at the current sample point.
     DimensionlessSpectrum rayleigh_i;
     DimensionlessSpectrum mie_i;
     ComputeSingleScatteringIntegrand(atmosphere, transmittance_texture,
         r, mu, mu_s, nu, d_i, ray_r_mu_intersects_ground, rayleigh_i, mie_i);
-    // Sample weight (from the trapezoidal rule).
-    Number weight_i = (i == 0 || i == SAMPLE_COUNT) ? 0.5 : 1.0;
     rayleigh_sum += rayleigh_i * weight_i;
     mie_sum += mie_i * weight_i;
   }
-  rayleigh = rayleigh_sum * dx * atmosphere.solar_irradiance *
+  rayleigh = rayleigh_sum * length * atmosphere.solar_irradiance *
       atmosphere.rayleigh_scattering;
-  mie = mie_sum * dx * atmosphere.solar_irradiance * atmosphere.mie_scattering;
+  mie = mie_sum * length * atmosphere.solar_irradiance *
+      atmosphere.mie_scattering;
 }
 
 /*
@@ -784,7 +1080,8 @@ vec4 GetScatteringTextureUvwzFromRMuMuSNu(IN(AtmosphereParameters) atmosphere,
   // Distance to the horizon.
   Length rho =
       SafeSqrt(r * r - atmosphere.bottom_radius * atmosphere.bottom_radius);
-  Number u_r = GetTextureCoordFromUnitRange(rho / H, SCATTERING_TEXTURE_R_SIZE);
+  Number u_r = GetTextureCoordFromUnitRange(
+      rho / H, atmosphere.texture_resolution.scattering_r_size);
 
   // Discriminant of the quadratic equation for the intersections of the ray
   // (r,mu) with the ground (see RayIntersectsGround).
@@ -799,7 +1096,8 @@ vec4 GetScatteringTextureUvwzFromRMuMuSNu(IN(AtmosphereParameters) atmosphere,
     Length d_min = r - atmosphere.bottom_radius;
     Length d_max = rho;
     u_mu = 0.5 - 0.5 * GetTextureCoordFromUnitRange(d_max == d_min ? 0.0 :
-        (d - d_min) / (d_max - d_min), SCATTERING_TEXTURE_MU_SIZE / 2);
+        (d - d_min) / (d_max - d_min),
+        atmosphere.texture_resolution.scattering_mu_size / 2);
   } else {
     // Distance to the top atmosphere boundary for the ray (r,mu), and its
     // minimum and maximum values over all mu - obtained for (r,1) and
@@ -808,7 +1106,8 @@ vec4 GetScatteringTextureUvwzFromRMuMuSNu(IN(AtmosphereParameters) atmosphere,
     Length d_min = atmosphere.top_radius - r;
     Length d_max = rho + H;
     u_mu = 0.5 + 0.5 * GetTextureCoordFromUnitRange(
-        (d - d_min) / (d_max - d_min), SCATTERING_TEXTURE_MU_SIZE / 2);
+        (d - d_min) / (d_max - d_min),
+        atmosphere.texture_resolution.scattering_mu_size / 2);
   }
 
   Length d = DistanceToTopAtmosphereBoundary(
@@ -824,7 +1123,8 @@ vec4 GetScatteringTextureUvwzFromRMuMuSNu(IN(AtmosphereParameters) atmosphere,
   // a = 0), and with a large slope around mu_s = 0, to get more texture 
   // samples near the horizon.
   Number u_mu_s = GetTextureCoordFromUnitRange(
-      max(1.0 - a / A, 0.0) / (1.0 + a), SCATTERING_TEXTURE_MU_S_SIZE);
+      max(1.0 - a / A, 0.0) / (1.0 + a),
+      atmosphere.texture_resolution.scattering_mu_s_size);
 
   Number u_nu = (nu + 1.0) / 2.0;
   return vec4(u_nu, u_mu_s, u_mu, u_r);
@@ -846,8 +1146,8 @@ void GetRMuMuSNuFromScatteringTextureUvwz(IN(AtmosphereParameters) atmosphere,
   Length H = sqrt(atmosphere.top_radius * atmosphere.top_radius -
       atmosphere.bottom_radius * atmosphere.bottom_radius);
   // Distance to the horizon.
-  Length rho =
-      H * GetUnitRangeFromTextureCoord(uvwz.w, SCATTERING_TEXTURE_R_SIZE);
+  Length rho = H * GetUnitRangeFromTextureCoord(
+      uvwz.w, atmosphere.texture_resolution.scattering_r_size);
   r = sqrt(rho * rho + atmosphere.bottom_radius * atmosphere.bottom_radius);
 
   if (uvwz.z < 0.5) {
@@ -857,7 +1157,8 @@ void GetRMuMuSNuFromScatteringTextureUvwz(IN(AtmosphereParameters) atmosphere,
     Length d_min = r - atmosphere.bottom_radius;
     Length d_max = rho;
     Length d = d_min + (d_max - d_min) * GetUnitRangeFromTextureCoord(
-        1.0 - 2.0 * uvwz.z, SCATTERING_TEXTURE_MU_SIZE / 2);
+        1.0 - 2.0 * uvwz.z,
+        atmosphere.texture_resolution.scattering_mu_size / 2);
     mu = d == 0.0 * m ? Number(-1.0) :
         ClampCosine(-(rho * rho + d * d) / (2.0 * r * d));
     ray_r_mu_intersects_ground = true;
@@ -868,14 +1169,15 @@ void GetRMuMuSNuFromScatteringTextureUvwz(IN(AtmosphereParameters) atmosphere,
     Length d_min = atmosphere.top_radius - r;
     Length d_max = rho + H;
     Length d = d_min + (d_max - d_min) * GetUnitRangeFromTextureCoord(
-        2.0 * uvwz.z - 1.0, SCATTERING_TEXTURE_MU_SIZE / 2);
+        2.0 * uvwz.z - 1.0,
+        atmosphere.texture_resolution.scattering_mu_size / 2);
     mu = d == 0.0 * m ? Number(1.0) :
         ClampCosine((H * H - rho * rho - d * d) / (2.0 * r * d));
     ray_r_mu_intersects_ground = false;
   }
 
-  Number x_mu_s =
-      GetUnitRangeFromTextureCoord(uvwz.y, SCATTERING_TEXTURE_MU_S_SIZE);
+  Number x_mu_s = GetUnitRangeFromTextureCoord(
+      uvwz.y, atmosphere.texture_resolution.scattering_mu_s_size);
   Length d_min = atmosphere.top_radius - atmosphere.bottom_radius;
   Length d_max = H;
   Length D = DistanceToTopAtmosphereBoundary(
@@ -907,14 +1209,14 @@ void GetRMuMuSNuFromScatteringTextureFragCoord(
     OUT(Length) r, OUT(Number) mu, OUT(Number) mu_s, OUT(Number) nu,
     OUT(bool) ray_r_mu_intersects_ground) {
   const vec4 SCATTERING_TEXTURE_SIZE = vec4(
-      SCATTERING_TEXTURE_NU_SIZE - 1,
-      SCATTERING_TEXTURE_MU_S_SIZE,
-      SCATTERING_TEXTURE_MU_SIZE,
-      SCATTERING_TEXTURE_R_SIZE);
-  Number frag_coord_nu =
-      floor(frag_coord.x / Number(SCATTERING_TEXTURE_MU_S_SIZE));
-  Number frag_coord_mu_s =
-      mod(frag_coord.x, Number(SCATTERING_TEXTURE_MU_S_SIZE));
+      atmosphere.texture_resolution.scattering_nu_size - 1,
+      atmosphere.texture_resolution.scattering_mu_s_size,
+      atmosphere.texture_resolution.scattering_mu_size,
+      atmosphere.texture_resolution.scattering_r_size);
+  Number frag_coord_nu = floor(frag_coord.x /
+      Number(atmosphere.texture_resolution.scattering_mu_s_size));
+  Number frag_coord_mu_s = mod(frag_coord.x,
+      Number(atmosphere.texture_resolution.scattering_mu_s_size));
   vec4 uvwz =
       vec4(frag_coord_nu, frag_coord_mu_s, frag_coord.y, frag_coord.z) /
           SCATTERING_TEXTURE_SIZE;
@@ -964,13 +1266,12 @@ AbstractSpectrum GetScattering(
     bool ray_r_mu_intersects_ground) {
   vec4 uvwz = GetScatteringTextureUvwzFromRMuMuSNu(
       atmosphere, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
-  Number tex_coord_x = uvwz.x * Number(SCATTERING_TEXTURE_NU_SIZE - 1);
+  Number nu_size = Number(atmosphere.texture_resolution.scattering_nu_size);
+  Number tex_coord_x = uvwz.x * (nu_size - 1.0);
   Number tex_x = floor(tex_coord_x);
   Number lerp = tex_coord_x - tex_x;
-  vec3 uvw0 = vec3((tex_x + uvwz.y) / Number(SCATTERING_TEXTURE_NU_SIZE),
-      uvwz.z, uvwz.w);
-  vec3 uvw1 = vec3((tex_x + 1.0 + uvwz.y) / Number(SCATTERING_TEXTURE_NU_SIZE),
-      uvwz.z, uvwz.w);
+  vec3 uvw0 = vec3((tex_x + uvwz.y) / nu_size, uvwz.z, uvwz.w);
+  vec3 uvw1 = vec3((tex_x + 1.0 + uvwz.y) / nu_size, uvwz.z, uvwz.w);
   return AbstractSpectrum(texture(scattering_texture, uvw0) * (1.0 - lerp) +
       texture(scattering_texture, uvw1) * lerp);
 }
@@ -1153,11 +1454,133 @@ IrradianceSpectrum GetIrradiance(
 <li>the scattering coefficient at $\bq$,</li>
 <li>the scattering phase function for the directions $\bw$ and $\bw_i$</li>
 </ul>
-This leads to the following implementation (where
+The contribution of an incident direction $\bw_i$, of solid angle
+$\mathrm{d}\omega_i$, is thus given by the following function (where
 <code>multiple_scattering_texture</code> is supposed to contain the $(n-1)$-th
 order of scattering, if $n>2$, <code>irradiance_texture</code> is the irradiance
 received on the ground after $n-2$ bounces, and <code>scattering_order</code> is
-equal to $n$):</li>
+equal to $n$). The ground related arguments only depend on $\omega_{i,z}$, and
+are computed with the function which follows:
+*/
+
+RadianceDensitySpectrum ComputeScatteringDensitySample(
+    IN(AtmosphereParameters) atmosphere,
+    IN(ReducedScatteringTexture) single_rayleigh_scattering_texture,
+    IN(ReducedScatteringTexture) single_mie_scattering_texture,
+    IN(ScatteringTexture) multiple_scattering_texture,
+    IN(IrradianceTexture) irradiance_texture,
+    Length r, Number mu_s, IN(Direction) omega, IN(Direction) omega_s,
+    IN(Direction) omega_i, SolidAngle domega_i,
+    bool ray_r_theta_intersects_ground, Length distance_to_ground,
+    IN(DimensionlessSpectrum) transmittance_to_ground,
+    IN(DimensionlessSpectrum) ground_albedo, int scattering_order) {
+  // The radiance L_i arriving from direction omega_i after n-1 bounces is
+  // the sum of a term given by the precomputed scattering texture for the
+  // (n-1)-th order:
+  Number nu1 = ClampCosine(dot(omega_s, omega_i));
+  RadianceSpectrum incident_radiance = GetScattering(atmosphere,
+      single_rayleigh_scattering_texture, single_mie_scattering_texture,
+      multiple_scattering_texture, r, ClampCosine(omega_i.z), mu_s, nu1,
+      ray_r_theta_intersects_ground, scattering_order - 1);
+
+  // and of the contribution from the light paths with n-1 bounces and whose
+  // last bounce is on the ground. This contribution is the product of the
+  // transmittance to the ground, the ground albedo, the ground BRDF, and
+  // the irradiance received on the ground after n-2 bounces.
+  vec3 zenith_direction = vec3(0.0, 0.0, 1.0);
+  vec3 ground_normal =
+      normalize(zenith_direction * r + omega_i * distance_to_ground);
+  IrradianceSpectrum ground_irradiance = GetIrradiance(
+      atmosphere, irradiance_texture, atmosphere.bottom_radius,
+      dot(ground_normal, omega_s));
+  incident_radiance += transmittance_to_ground *
+      ground_albedo * (1.0 / (PI * sr)) * ground_irradiance;
+
+  // The radiance finally scattered from direction omega_i towards direction
+  // -omega is the product of the incident radiance, the scattering
+  // coefficient, and the phase function for directions omega and omega_i
+  // (all this summed over all particle types, i.e. Rayleigh and Mie).
+  Number nu2 = dot(omega, omega_i);
+  Number rayleigh_density = GetProfileDensity(
+      atmosphere.rayleigh_density, r - atmosphere.bottom_radius);
+  Number mie_density = GetProfileDensity(
+      atmosphere.mie_density, r - atmosphere.bottom_radius);
+  return incident_radiance * (
+      atmosphere.rayleigh_scattering * rayleigh_density *
+          RayleighPhaseFunction(nu2) +
+      atmosphere.mie_scattering * mie_density *
+          MiePhaseFunction(atmosphere.mie_phase_function_g, nu2)) *
+      domega_i;
+}
+
+void ComputeGroundTransmittance(
+    IN(AtmosphereParameters) atmosphere,
+    IN(TransmittanceTexture) transmittance_texture,
+    Length r, Number cos_theta, OUT(bool) ray_r_theta_intersects_ground,
+    OUT(Length) distance_to_ground,
+    OUT(DimensionlessSpectrum) transmittance_to_ground,
+    OUT(DimensionlessSpectrum) ground_albedo) {
+  ray_r_theta_intersects_ground = RayIntersectsGround(atmosphere, r, cos_theta);
+  distance_to_ground = 0.0 * m;
+  transmittance_to_ground = DimensionlessSpectrum(0.0);
+  ground_albedo = DimensionlessSpectrum(0.0);
+  if (ray_r_theta_intersects_ground) {
+    distance_to_ground =
+        DistanceToBottomAtmosphereBoundary(atmosphere, r, cos_theta);
+    transmittance_to_ground =
+        GetTransmittance(atmosphere, transmittance_texture, r, cos_theta,
+            distance_to_ground, true /* ray_intersects_ground */);
+    ground_albedo = atmosphere.ground_albedo;
+  }
+}
+
+/*
+<p>The scattering density is then the integral of these contributions over all
+the incident directions, which we compute with the spherical quadrature rule
+specified in the atmosphere parameters (see
+<a href="constants.h.html">constants.h</a>). The latitude-longitude rule, which
+is the default, is evaluated procedurally, as in our original implementation,
+with $s$ rows of $2s$ samples (where $s$ is the largest value such that there
+are at most $N$ samples) and with the following function to compute $s$:
+*/
+
+int GetLatitudeLongitudeRowCount(int sample_count, int columns_per_row) {
+  int row_count = 1;
+  while (columns_per_row * (row_count + 1) * (row_count + 1) <= sample_count) {
+    ++row_count;
+  }
+  return row_count;
+}
+
+/*
+<p>The other rules use precomputed sample directions and weights, which are
+stored in a texture with one row per integral, and one sample per texel (see
+<a href="spherical_quadrature.h.html">spherical_quadrature.h</a>). They can be
+read with the following function (the texture must use a "nearest" filtering):
+*/
+
+int GetSphericalSamplesTextureWidth(IN(AtmosphereParameters) atmosphere) {
+  return max(atmosphere.quadrature.scattering_density_sample_count,
+      atmosphere.quadrature.indirect_irradiance_sample_count);
+}
+
+void GetSphericalSample(IN(AtmosphereParameters) atmosphere,
+    IN(SphericalSamplesTexture) spherical_samples_texture, int row, int i,
+    OUT(Direction) omega_i, OUT(SolidAngle) domega_i) {
+  vec2 uv = vec2(
+      (Number(i) + 0.5) / Number(GetSphericalSamplesTextureWidth(atmosphere)),
+      (Number(row) + 0.5) / Number(SPHERICAL_SAMPLES_TEXTURE_HEIGHT));
+  vec4 spherical_sample = texture(spherical_samples_texture, uv);
+  omega_i = Direction(spherical_sample.x, spherical_sample.y,
+      spherical_sample.z);
+  domega_i = spherical_sample.w * sr;
+}
+
+/*
+<p>The sample directions of the scattering density are defined in a frame whose
+$z$ axis is the view direction $\bw$ (so that the importance sampling rule can
+concentrate its samples in the forward scattering peak of the Mie phase
+function). This leads to the following implementation:
 */
 
 RadianceDensitySpectrum ComputeScatteringDensity(
@@ -1167,6 +1590,7 @@ RadianceDensitySpectrum ComputeScatteringDensity(
     IN(ReducedScatteringTexture) single_mie_scattering_texture,
     IN(ScatteringTexture) multiple_scattering_texture,
     IN(IrradianceTexture) irradiance_texture,
+    IN(SphericalSamplesTexture) spherical_samples_texture,
     Length r, Number mu, Number mu_s, Number nu, int scattering_order) {
   assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
   assert(mu >= -1.0 && mu <= 1.0);
@@ -1174,87 +1598,78 @@ RadianceDensitySpectrum ComputeScatteringDensity(
   assert(nu >= -1.0 && nu <= 1.0);
   assert(scattering_order >= 2);
 
-  // Compute unit direction vectors for the zenith, the view direction omega and
-  // and the sun direction omega_s, such that the cosine of the view-zenith
-  // angle is mu, the cosine of the sun-zenith angle is mu_s, and the cosine of
-  // the view-sun angle is nu. The goal is to simplify computations below.
-  vec3 zenith_direction = vec3(0.0, 0.0, 1.0);
+  // Compute unit direction vectors for the view direction omega and the sun
+  // direction omega_s, such that the cosine of the view-zenith angle is mu,
+  // the cosine of the sun-zenith angle is mu_s, and the cosine of the view-sun
+  // angle is nu. The goal is to simplify computations below.
   vec3 omega = vec3(sqrt(1.0 - mu * mu), 0.0, mu);
   Number sun_dir_x = omega.x == 0.0 ? 0.0 : (nu - mu * mu_s) / omega.x;
   Number sun_dir_y = sqrt(max(1.0 - sun_dir_x * sun_dir_x - mu_s * mu_s, 0.0));
   vec3 omega_s = vec3(sun_dir_x, sun_dir_y, mu_s);
 
-  const int SAMPLE_COUNT = 16;
-  const Angle dphi = pi / Number(SAMPLE_COUNT);
-  const Angle dtheta = pi / Number(SAMPLE_COUNT);
+  int sample_count = atmosphere.quadrature.scattering_density_sample_count;
   RadianceDensitySpectrum rayleigh_mie =
       RadianceDensitySpectrum(0.0 * watt_per_cubic_meter_per_sr_per_nm);
-
-  // Nested loops for the integral over all the incident directions omega_i.
-  for (int l = 0; l < SAMPLE_COUNT; ++l) {
-    Angle theta = (Number(l) + 0.5) * dtheta;
-    Number cos_theta = cos(theta);
-    Number sin_theta = sin(theta);
-    bool ray_r_theta_intersects_ground =
-        RayIntersectsGround(atmosphere, r, cos_theta);
-
-    // The distance and transmittance to the ground only depend on theta, so we
-    // can compute them in the outer loop for efficiency.
-    Length distance_to_ground = 0.0 * m;
-    DimensionlessSpectrum transmittance_to_ground = DimensionlessSpectrum(0.0);
-    DimensionlessSpectrum ground_albedo = DimensionlessSpectrum(0.0);
-    if (ray_r_theta_intersects_ground) {
-      distance_to_ground =
-          DistanceToBottomAtmosphereBoundary(atmosphere, r, cos_theta);
-      transmittance_to_ground =
-          GetTransmittance(atmosphere, transmittance_texture, r, cos_theta,
-              distance_to_ground, true /* ray_intersects_ground */);
-      ground_albedo = atmosphere.ground_albedo;
+  bool ray_r_theta_intersects_ground;
+  Length distance_to_ground;
+  DimensionlessSpectrum transmittance_to_ground;
+  DimensionlessSpectrum ground_albedo;
+
+  if (atmosphere.quadrature.spherical_rule == LATITUDE_LONGITUDE_RULE) {
+    int row_count = GetLatitudeLongitudeRowCount(sample_count, 2);
+    Angle dphi = pi / Number(row_count);
+    Angle dtheta = pi / Number(row_count);
+
+    // Nested loops for the integral over all the incident directions omega_i.
+    for (int l = 0; l < row_count; ++l) {
+      Angle theta = (Number(l) + 0.5) * dtheta;
+      Number cos_theta = cos(theta);
+      Number sin_theta = sin(theta);
+
+      // The distance and transmittance to the ground only depend on theta, so
+      // we can compute them in the outer loop for efficiency.
+      ComputeGroundTransmittance(atmosphere, transmittance_texture, r,
+          cos_theta, ray_r_theta_intersects_ground, distance_to_ground,
+          transmittance_to_ground, ground_albedo);
+
+      for (int k = 0; k < 2 * row_count; ++k) {
+        Angle phi = (Number(k) + 0.5) * dphi;
+        vec3 omega_i =
+            vec3(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta);
+        SolidAngle domega_i = (dtheta / rad) * (dphi / rad) * sin(theta) * sr;
+        rayleigh_mie += ComputeScatteringDensitySample(atmosphere,
+            single_rayleigh_scattering_texture, single_mie_scattering_texture,
+            multiple_scattering_texture, irradiance_texture, r, mu_s, omega,
+            omega_s, omega_i, domega_i, ray_r_theta_intersects_ground,
+            distance_to_ground, transmittance_to_ground, ground_albedo,
+            scattering_order);
+      }
     }
+    return rayleigh_mie;
+  }
 
-    for (int m = 0; m < 2 * SAMPLE_COUNT; ++m) {
-      Angle phi = (Number(m) + 0.5) * dphi;
-      vec3 omega_i =
-          vec3(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta);
-      SolidAngle domega_i = (dtheta / rad) * (dphi / rad) * sin(theta) * sr;
-
-      // The radiance L_i arriving from direction omega_i after n-1 bounces is
-      // the sum of a term given by the precomputed scattering texture for the
-      // (n-1)-th order:
-      Number nu1 = dot(omega_s, omega_i);
-      RadianceSpectrum incident_radiance = GetScattering(atmosphere,
-          single_rayleigh_scattering_texture, single_mie_scattering_texture,
-          multiple_scattering_texture, r, omega_i.z, mu_s, nu1,
-          ray_r_theta_intersects_ground, scattering_order - 1);
-
-      // and of the contribution from the light paths with n-1 bounces and whose
-      // last bounce is on the ground. This contribution is the product of the
-      // transmittance to the ground, the ground albedo, the ground BRDF, and
-      // the irradiance received on the ground after n-2 bounces.
-      vec3 ground_normal =
-          normalize(zenith_direction * r + omega_i * distance_to_ground);
-      IrradianceSpectrum ground_irradiance = GetIrradiance(
-          atmosphere, irradiance_texture, atmosphere.bottom_radius,
-          dot(ground_normal, omega_s));
-      incident_radiance += transmittance_to_ground *
-          ground_albedo * (1.0 / (PI * sr)) * ground_irradiance;
-
-      // The radiance finally scattered from direction omega_i towards direction
-      // -omega is the product of the incident radiance, the scattering
-      // coefficient, and the phase function for directions omega and omega_i
-      // (all this summed over all particle types, i.e. Rayleigh and Mie).
-      Number nu2 = dot(omega, omega_i);
-      Number rayleigh_density = GetProfileDensity(
-          atmosphere.rayleigh_density, r - atmosphere.bottom_radius);
-      Number mie_density = GetProfileDensity(
-          atmosphere.mie_density, r - atmosphere.bottom_radius);
-      rayleigh_mie += incident_radiance * (
-          atmosphere.rayleigh_scattering * rayleigh_density *
-              RayleighPhaseFunction(nu2) +
-          atmosphere.mie_scattering * mie_density *
-              MiePhaseFunction(atmosphere.mie_phase_function_g, nu2)) *
-          domega_i;
+  // An orthonormal frame whose z axis is the view direction omega.
+  vec3 omega_x = vec3(mu, 0.0, -omega.x);
+  vec3 omega_y = vec3(0.0, 1.0, 0.0);
+  for (int i = 0; i < sample_count; ++i) {
+    Direction omega_i_in_view_frame;
+    SolidAngle domega_i;
+    GetSphericalSample(atmosphere, spherical_samples_texture,
+        SCATTERING_DENSITY_SAMPLES_ROW, i, omega_i_in_view_frame, domega_i);
+    if (domega_i == 0.0 * sr) {
+      continue;
     }
+    vec3 omega_i = omega_x * omega_i_in_view_frame.x +
+        omega_y * omega_i_in_view_frame.y + omega * omega_i_in_view_frame.z;
+    ComputeGroundTransmittance(atmosphere, transmittance_texture, r,
+        ClampCosine(omega_i.z), ray_r_theta_intersects_ground,
+        distance_to_ground, transmittance_to_ground, ground_albedo);
+    rayleigh_mie += ComputeScatteringDensitySample(atmosphere,
+        single_rayleigh_scattering_texture, single_mie_scattering_texture,
+        multiple_scattering_texture, irradiance_texture, r, mu_s, omega,
+        omega_s, omega_i, domega_i, ray_r_theta_intersects_ground,
+        distance_to_ground, transmittance_to_ground, ground_albedo,
+        scattering_order);
   }
   return rayleigh_mie;
 }
@@ -1293,18 +1708,21 @@ RadianceSpectrum ComputeMultipleScattering(
   assert(mu_s >= -1.0 && mu_s <= 1.0);
   assert(nu >= -1.0 && nu <= 1.0);
 
-  // Number of intervals for the numerical integration.
-  const int SAMPLE_COUNT = 50;
-  // The integration step, i.e. the length of each integration interval.
-  Length dx =
-      DistanceToNearestAtmosphereBoundary(
-          atmosphere, r, mu, ray_r_mu_intersects_ground) /
-              Number(SAMPLE_COUNT);
+  // The numerical integration rule and number of samples.
+  int rule = atmosphere.quadrature.rule;
+  int sample_count = atmosphere.quadrature.multiple_scattering_sample_count;
+  // The length of the integration interval.
+  Length length = DistanceToNearestAtmosphereBoundary(
+      atmosphere, r, mu, ray_r_mu_intersects_ground);
   // Integration loop.
-  RadianceSpectrum rayleigh_mie_sum =
-      RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm);
-  for (int i = 0; i <= SAMPLE_COUNT; ++i) {
-    Length d_i = Number(i) * dx;
+  RadianceDensitySpectrum rayleigh_mie_sum =
+      RadianceDensitySpectrum(0.0 * watt_per_cubic_meter_per_sr_per_nm);
+  int quadrature_sample_count = GetQuadratureSampleCount(rule, sample_count);
+  for (int i = 0; i < quadrature_sample_count; ++i) {
+    Number x_i;
+    Number weight_i;
+    GetQuadratureSample(rule, sample_count, i, x_i, weight_i);
+    Length d_i = x_i * length;
 
     // The r, mu and mu_s parameters at the current integration point (see the
     // single scattering section for a detailed explanation).
@@ -1314,19 +1732,16 @@ RadianceSpectrum ComputeMultipleScattering(
     Number mu_s_i = ClampCosine((r * mu_s + d_i * nu) / r_i);
 
     // The Rayleigh and Mie multiple scattering at the current sample point.
-    RadianceSpectrum rayleigh_mie_i =
+    RadianceDensitySpectrum rayleigh_mie_i =
         GetScattering(
             atmosphere, scattering_density_texture, r_i, mu_i, mu_s_i, nu,
             ray_r_mu_intersects_ground) *
         GetTransmittance(
             atmosphere, transmittance_texture, r, mu, d_i,
-            ray_r_mu_intersects_ground) *
-        dx;
-    // Sample weight (from the trapezoidal rule).
-    Number weight_i = (i == 0 || i == SAMPLE_COUNT) ? 0.5 : 1.0;
+            ray_r_mu_intersects_ground);
     rayleigh_mie_sum += rayleigh_mie_i * weight_i;
   }
-  return rayleigh_mie_sum;
+  return rayleigh_mie_sum * length;
 }
 
 /*
@@ -1352,6 +1767,7 @@ RadianceDensitySpectrum ComputeScatteringDensityTexture(
     IN(ReducedScatteringTexture) single_mie_scattering_texture,
     IN(ScatteringTexture) multiple_scattering_texture,
     IN(IrradianceTexture) irradiance_texture,
+    IN(SphericalSamplesTexture) spherical_samples_texture,
     IN(vec3) frag_coord, int scattering_order) {
   Length r;
   Number mu;
@@ -1362,8 +1778,8 @@ RadianceDensitySpectrum ComputeScatteringDensityTexture(
       r, mu, mu_s, nu, ray_r_mu_intersects_ground);
   return ComputeScatteringDensity(atmosphere, transmittance_texture,
       single_rayleigh_scattering_texture, single_mie_scattering_texture,
-      multiple_scattering_texture, irradiance_texture, r, mu, mu_s, nu,
-      scattering_order);
+      multiple_scattering_texture, irradiance_texture,
+      spherical_samples_texture, r, mu, mu_s, nu, scattering_order);
 }
 
 RadianceSpectrum ComputeMultipleScatteringTexture(
@@ -1468,10 +1884,13 @@ the directions $\bw$ of the hemisphere, of the product of:
 <li>the radiance arriving from direction $\bw$ after $n$ bounces,
 <li>the cosine factor, i.e. $\omega_z$</li>
 </ul>
-This leads to the following implementation (where
-<code>multiple_scattering_texture</code> is supposed to contain the $n$-th
-order of scattering, if $n>1$, and <code>scattering_order</code> is equal to
-$n$):</li>
+As for the scattering density, this integral is computed with the spherical
+quadrature rule specified in the atmosphere parameters, either procedurally
+with $s$ rows of $4s$ samples for the latitude-longitude rule, or with the
+precomputed samples (in the zenith frame) for the other rules. This leads to the
+following implementation (where <code>multiple_scattering_texture</code> is
+supposed to contain the $n$-th order of scattering, if $n>1$, and
+<code>scattering_order</code> is equal to $n$):</li>
 */
 
 IrradianceSpectrum ComputeIndirectIrradiance(
@@ -1479,33 +1898,54 @@ IrradianceSpectrum ComputeIndirectIrradiance(
     IN(ReducedScatteringTexture) single_rayleigh_scattering_texture,
     IN(ReducedScatteringTexture) single_mie_scattering_texture,
     IN(ScatteringTexture) multiple_scattering_texture,
+    IN(SphericalSamplesTexture) spherical_samples_texture,
     Length r, Number mu_s, int scattering_order) {
   assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
   assert(mu_s >= -1.0 && mu_s <= 1.0);
   assert(scattering_order >= 1);
 
-  const int SAMPLE_COUNT = 32;
-  const Angle dphi = pi / Number(SAMPLE_COUNT);
-  const Angle dtheta = pi / Number(SAMPLE_COUNT);
-
+  int sample_count = atmosphere.quadrature.indirect_irradiance_sample_count;
   IrradianceSpectrum result =
       IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
   vec3 omega_s = vec3(sqrt(1.0 - mu_s * mu_s), 0.0, mu_s);
-  for (int j = 0; j < SAMPLE_COUNT / 2; ++j) {
-    Angle theta = (Number(j) + 0.5) * dtheta;
-    for (int i = 0; i < 2 * SAMPLE_COUNT; ++i) {
-      Angle phi = (Number(i) + 0.5) * dphi;
-      vec3 omega =
-          vec3(cos(phi) * sin(theta), sin(phi) * sin(theta), cos(theta));
-      SolidAngle domega = (dtheta / rad) * (dphi / rad) * sin(theta) * sr;
-
-      Number nu = dot(omega, omega_s);
-      result += GetScattering(atmosphere, single_rayleigh_scattering_texture,
-          single_mie_scattering_texture, multiple_scattering_texture,
-          r, omega.z, mu_s, nu, false /* ray_r_theta_intersects_ground */,
-          scattering_order) *
-              omega.z * domega;
+
+  if (atmosphere.quadrature.spherical_rule == LATITUDE_LONGITUDE_RULE) {
+    int row_count = GetLatitudeLongitudeRowCount(sample_count, 4);
+    Angle dphi = pi / Number(2 * row_count);
+    Angle dtheta = pi / Number(2 * row_count);
+    for (int j = 0; j < row_count; ++j) {
+      Angle theta = (Number(j) + 0.5) * dtheta;
+      for (int i = 0; i < 4 * row_count; ++i) {
+        Angle phi = (Number(i) + 0.5) * dphi;
+        vec3 omega =
+            vec3(cos(phi) * sin(theta), sin(phi) * sin(theta), cos(theta));
+        SolidAngle domega = (dtheta / rad) * (dphi / rad) * sin(theta) * sr;
+
+        Number nu = dot(omega, omega_s);
+        result += GetScattering(atmosphere, single_rayleigh_scattering_texture,
+            single_mie_scattering_texture, multiple_scattering_texture,
+            r, omega.z, mu_s, nu, false /* ray_r_theta_intersects_ground */,
+            scattering_order) *
+                omega.z * domega;
+      }
+    }
+    return result;
+  }
+
+  for (int i = 0; i < sample_count; ++i) {
+    Direction omega;
+    SolidAngle domega;
+    GetSphericalSample(atmosphere, spherical_samples_texture,
+        INDIRECT_IRRADIANCE_SAMPLES_ROW, i, omega, domega);
+    if (domega == 0.0 * sr) {
+      continue;
     }
+    Number nu = ClampCosine(dot(omega, omega_s));
+    result += GetScattering(atmosphere, single_rayleigh_scattering_texture,
+        single_mie_scattering_texture, multiple_scattering_texture,
+        r, ClampCosine(omega.z), mu_s, nu,
+        false /* ray_r_theta_intersects_ground */, scattering_order) *
+            omega.z * domega;
   }
   return result;
 }
@@ -1528,8 +1968,11 @@ vec2 GetIrradianceTextureUvFromRMuS(IN(AtmosphereParameters) atmosphere,
   Number x_r = (r - atmosphere.bottom_radius) /
       (atmosphere.top_radius - atmosphere.bottom_radius);
   Number x_mu_s = mu_s * 0.5 + 0.5;
-  return vec2(GetTextureCoordFromUnitRange(x_mu_s, IRRADIANCE_TEXTURE_WIDTH),
-              GetTextureCoordFromUnitRange(x_r, IRRADIANCE_TEXTURE_HEIGHT));
+  return vec2(
+      GetTextureCoordFromUnitRange(
+          x_mu_s, atmosphere.texture_resolution.irradiance_width),
+      GetTextureCoordFromUnitRange(
+          x_r, atmosphere.texture_resolution.irradiance_height));
 }
 
 /*
@@ -1540,8 +1983,10 @@ void GetRMuSFromIrradianceTextureUv(IN(AtmosphereParameters) atmosphere,
     IN(vec2) uv, OUT(Length) r, OUT(Number) mu_s) {
   assert(uv.x >= 0.0 && uv.x <= 1.0);
   assert(uv.y >= 0.0 && uv.y <= 1.0);
-  Number x_mu_s = GetUnitRangeFromTextureCoord(uv.x, IRRADIANCE_TEXTURE_WIDTH);
-  Number x_r = GetUnitRangeFromTextureCoord(uv.y, IRRADIANCE_TEXTURE_HEIGHT);
+  Number x_mu_s = GetUnitRangeFromTextureCoord(
+      uv.x, atmosphere.texture_resolution.irradiance_width);
+  Number x_r = GetUnitRangeFromTextureCoord(
+      uv.y, atmosphere.texture_resolution.irradiance_height);
   r = atmosphere.bottom_radius +
       x_r * (atmosphere.top_radius - atmosphere.bottom_radius);
   mu_s = ClampCosine(2.0 * x_mu_s - 1.0);
@@ -1552,8 +1997,10 @@ void GetRMuSFromIrradianceTextureUv(IN(AtmosphereParameters) atmosphere,
 the ground irradiance texture, for the direct irradiance:
 */
 
-const vec2 IRRADIANCE_TEXTURE_SIZE =
-    vec2(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
+vec2 GetIrradianceTextureSize(IN(AtmosphereParameters) atmosphere) {
+  return vec2(atmosphere.texture_resolution.irradiance_width,
+      atmosphere.texture_resolution.irradiance_height);
+}
 
 IrradianceSpectrum ComputeDirectIrradianceTexture(
     IN(AtmosphereParameters) atmosphere,
@@ -1561,8 +2008,8 @@ IrradianceSpectrum ComputeDirectIrradianceTexture(
     IN(vec2) frag_coord) {
   Length r;
   Number mu_s;
-  GetRMuSFromIrradianceTextureUv(
-      atmosphere, frag_coord / IRRADIANCE_TEXTURE_SIZE, r, mu_s);
+  GetRMuSFromIrradianceTextureUv(atmosphere,
+      frag_coord / GetIrradianceTextureSize(atmosphere), r, mu_s);
   return ComputeDirectIrradiance(atmosphere, transmittance_texture, r, mu_s);
 }
 
@@ -1575,14 +2022,16 @@ IrradianceSpectrum ComputeIndirectIrradianceTexture(
     IN(ReducedScatteringTexture) single_rayleigh_scattering_texture,
     IN(ReducedScatteringTexture) single_mie_scattering_texture,
     IN(ScatteringTexture) multiple_scattering_texture,
+    IN(SphericalSamplesTexture) spherical_samples_texture,
     IN(vec2) frag_coord, int scattering_order) {
   Length r;
   Number mu_s;
-  GetRMuSFromIrradianceTextureUv(
-      atmosphere, frag_coord / IRRADIANCE_TEXTURE_SIZE, r, mu_s);
+  GetRMuSFromIrradianceTextureUv(atmosphere,
+      frag_coord / GetIrradianceTextureSize(atmosphere), r, mu_s);
   return ComputeIndirectIrradiance(atmosphere,
       single_rayleigh_scattering_texture, single_mie_scattering_texture,
-      multiple_scattering_texture, r, mu_s, scattering_order);
+      multiple_scattering_texture, spherical_samples_texture, r, mu_s,
+      scattering_order);
 }
 
 /*
@@ -1664,13 +2113,12 @@ IrradianceSpectrum GetCombinedScattering(
     OUT(IrradianceSpectrum) single_mie_scattering) {
   vec4 uvwz = GetScatteringTextureUvwzFromRMuMuSNu(
       atmosphere, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
-  Number tex_coord_x = uvwz.x * Number(SCATTERING_TEXTURE_NU_SIZE - 1);
+  Number nu_size = Number(atmosphere.texture_resolution.scattering_nu_size);
+  Number tex_coord_x = uvwz.x * (nu_size - 1.0);
   Number tex_x = floor(tex_coord_x);
   Number lerp = tex_coord_x - tex_x;
-  vec3 uvw0 = vec3((tex_x + uvwz.y) / Number(SCATTERING_TEXTURE_NU_SIZE),
-      uvwz.z, uvwz.w);
-  vec3 uvw1 = vec3((tex_x + 1.0 + uvwz.y) / Number(SCATTERING_TEXTURE_NU_SIZE),
-      uvwz.z, uvwz.w);
+  vec3 uvw0 = vec3((tex_x + uvwz.y) / nu_size, uvwz.z, uvwz.w);
+  vec3 uvw1 = vec3((tex_x + 1.0 + uvwz.y) / nu_size, uvwz.z, uvwz.w);
 #ifdef COMBINED_SCATTERING_TEXTURES
   vec4 combined_scattering =
       texture(scattering_texture, uvw0) * (1.0 - lerp) +
@@ -45,12 +45,14 @@ of the following C++ code.
 
 #include <glad/glad.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
 #include <memory>
 
 #include "atmosphere/constants.h"
+#include "atmosphere/spherical_quadrature.h"
 
 /*
 <p>The rest of this file is organized in 3 parts:
@@ -163,14 +165,15 @@ const char kComputeScatteringDensityShader[] = R"(
     uniform sampler3D single_mie_scattering_texture;
     uniform sampler3D multiple_scattering_texture;
     uniform sampler2D irradiance_texture;
+    uniform sampler2D spherical_samples_texture;
     uniform int scattering_order;
     uniform int layer;
     void main() {
       scattering_density = ComputeScatteringDensityTexture(
           ATMOSPHERE, transmittance_texture, single_rayleigh_scattering_texture,
           single_mie_scattering_texture, multiple_scattering_texture,
-          irradiance_texture, vec3(gl_FragCoord.xy, layer + 0.5),
-          scattering_order);
+          irradiance_texture, spherical_samples_texture,
+          vec3(gl_FragCoord.xy, layer + 0.5), scattering_order);
     })";
 
 const char kComputeIndirectIrradianceShader[] = R"(
@@ -180,12 +183,13 @@ const char kComputeIndirectIrradianceShader[] = R"(
     uniform sampler3D single_rayleigh_scattering_texture;
     uniform sampler3D single_mie_scattering_texture;
     uniform sampler3D multiple_scattering_texture;
+    uniform sampler2D spherical_samples_texture;
     uniform int scattering_order;
     void main() {
       delta_irradiance = ComputeIndirectIrradianceTexture(
           ATMOSPHERE, single_rayleigh_scattering_texture,
           single_mie_scattering_texture, multiple_scattering_texture,
-          gl_FragCoord.xy, scattering_order);
+          spherical_samples_texture, gl_FragCoord.xy, scattering_order);
       irradiance = luminance_from_radiance * delta_irradiance;
     })";
 
@@ -207,6 +211,74 @@ const char kComputeMultipleScatteringShader[] = R"(
           0.0);
     })";
 
+/*
+<p>The scattering orders from the 2nd one can be computed with a lower
+resolution than the final textures (see
+<code>set_scattering_order_resolutions</code>). The following shaders
+resample a delta scattering or irradiance texture, whose resolution is given by
+a <code>SOURCE_TEXTURE_RESOLUTION</code> constant, at the resolution of the
+<code>ATMOSPHERE</code> constant. They also output the resampled values in the
+format of the final textures, to upsample a low resolution scattering order
+when it is accumulated in these textures:
+*/
+
+const char kResampleScatteringShader[] = R"(
+    layout(location = 0) out vec3 delta_scattering;
+    layout(location = 1) out vec4 scattering;
+    uniform mat3 luminance_from_radiance;
+    uniform sampler3D source_texture;
+    uniform int layer;
+    void main() {
+      AtmosphereParameters source_atmosphere = ATMOSPHERE;
+      source_atmosphere.texture_resolution = SOURCE_TEXTURE_RESOLUTION;
+      Length r;
+      Number mu;
+      Number mu_s;
+      Number nu;
+      bool ray_r_mu_intersects_ground;
+      GetRMuMuSNuFromScatteringTextureFragCoord(ATMOSPHERE,
+          vec3(gl_FragCoord.xy, layer + 0.5), r, mu, mu_s, nu,
+          ray_r_mu_intersects_ground);
+      delta_scattering = GetScattering(source_atmosphere, source_texture,
+          r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+      scattering = vec4(
+          luminance_from_radiance *
+              delta_scattering / RayleighPhaseFunction(nu),
+          0.0);
+    })";
+
+const char kResampleIrradianceShader[] = R"(
+    layout(location = 0) out vec3 delta_irradiance;
+    layout(location = 1) out vec3 irradiance;
+    uniform mat3 luminance_from_radiance;
+    uniform sampler2D source_texture;
+    void main() {
+      AtmosphereParameters source_atmosphere = ATMOSPHERE;
+      source_atmosphere.texture_resolution = SOURCE_TEXTURE_RESOLUTION;
+      Length r;
+      Number mu_s;
+      GetRMuSFromIrradianceTextureUv(ATMOSPHERE,
+          gl_FragCoord.xy / GetIrradianceTextureSize(ATMOSPHERE), r, mu_s);
+      delta_irradiance =
+          GetIrradiance(source_atmosphere, source_texture, r, mu_s);
+      irradiance = luminance_from_radiance * delta_irradiance;
+    })";
+
+/*
+<p>When the solar irradiance changes, the precomputed irradiance textures can be
+rescaled instead of recomputed (see <code>SetSolarIrradiance</code>). This is
+done with a blending function multiplying the current texel values with a
+constant color, and with the following fragment shader, which does not need the
+atmosphere functions:
+*/
+
+const char kRescaleShader[] = R"(
+    #version 330
+    layout(location = 0) out vec4 color;
+    void main() {
+      color = vec4(0.0);
+    })";
+
 /*
 <p>We finally need a shader implementing the GLSL functions exposed in our API,
 which can be done by calling the corresponding functions in
@@ -455,6 +527,48 @@ GLuint NewTexture3d(int width, int height, int depth, GLenum format,
   return texture;
 }
 
+/*
+<p>a function to allocate and fill the table of sample directions and weights
+of the spherical quadrature rules (see <code>GetSphericalSample</code> in
+<a href="functions.glsl.html">functions.glsl</a>), which must not be
+interpolated:
+*/
+
+GLuint NewSphericalSamplesTexture(const Quadrature& quadrature,
+    double mie_phase_function_g) {
+  const int width = GetSphericalSamplesTextureWidth(quadrature);
+  std::vector<GLfloat> pixels(4 * width * SPHERICAL_SAMPLES_TEXTURE_HEIGHT);
+  const int rows[2] =
+      {SCATTERING_DENSITY_SAMPLES_ROW, INDIRECT_IRRADIANCE_SAMPLES_ROW};
+  const int sample_counts[2] = {quadrature.scattering_density_sample_count,
+      quadrature.indirect_irradiance_sample_count};
+  for (int k = 0; k < 2; ++k) {
+    std::vector<SphericalSample> samples = ComputeSphericalSamples(
+        quadrature.spherical_rule, sample_counts[k],
+        rows[k] == INDIRECT_IRRADIANCE_SAMPLES_ROW /* hemisphere */,
+        mie_phase_function_g);
+    for (unsigned int i = 0; i < samples.size(); ++i) {
+      GLfloat* pixel = pixels.data() + 4 * (i + width * rows[k]);
+      pixel[0] = samples[i].x;
+      pixel[1] = samples[i].y;
+      pixel[2] = samples[i].z;
+      pixel[3] = samples[i].weight;
+    }
+  }
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width,
+      SPHERICAL_SAMPLES_TEXTURE_HEIGHT, 0, GL_RGBA, GL_FLOAT, pixels.data());
+  return texture;
+}
+
 /*
 <p>a function to test whether the RGB format is a supported renderbuffer color
 format (the OpenGL 3.3 Core Profile specification requires support for the RGBA
@@ -480,6 +594,99 @@ bool IsFramebufferRgbFormatSupported(bool half_precision) {
   return rgb_format_supported;
 }
 
+/*
+<p>two functions to compare the scattering and irradiance texture sizes of two
+resolutions, and to get the GLSL declaration of a resolution (used to compute
+some scattering orders with a lower resolution, see
+<code>set_scattering_order_resolutions</code>),
+*/
+
+bool HaveSameScatteringSizes(const TextureResolution& resolution1,
+    const TextureResolution& resolution2) {
+  return resolution1.scattering_r_size == resolution2.scattering_r_size &&
+      resolution1.scattering_mu_size == resolution2.scattering_mu_size &&
+      resolution1.scattering_mu_s_size == resolution2.scattering_mu_s_size &&
+      resolution1.scattering_nu_size == resolution2.scattering_nu_size &&
+      resolution1.irradiance_width == resolution2.irradiance_width &&
+      resolution1.irradiance_height == resolution2.irradiance_height;
+}
+
+std::string ToGlslString(const TextureResolution& resolution) {
+  return "TextureResolution(" +
+      std::to_string(resolution.transmittance_width) + "," +
+      std::to_string(resolution.transmittance_height) + "," +
+      std::to_string(resolution.scattering_r_size) + "," +
+      std::to_string(resolution.scattering_mu_size) + "," +
+      std::to_string(resolution.scattering_mu_s_size) + "," +
+      std::to_string(resolution.scattering_nu_size) + "," +
+      std::to_string(resolution.irradiance_width) + "," +
+      std::to_string(resolution.irradiance_height) + ")";
+}
+
+/*
+<p>a function to compute the sum of the RGB components of all the texels of a
+2D texture (used to measure the energy added by each scattering order, see
+<code>Init</code>):
+*/
+
+double GetTextureRgbSum(GLuint texture, int width, int height) {
+  std::vector<float> pixels(width * height * 4);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels.data());
+  double sum = 0.0;
+  for (int i = 0; i < width * height; ++i) {
+    sum += pixels[4 * i] + pixels[4 * i + 1] + pixels[4 * i + 2];
+  }
+  return sum;
+}
+
+/*
+<p>a class to record the precomputation phases in a
+<a href="precompute_profile.h.html">profile</a>, with their GPU time measured
+with OpenGL timer queries. The wall time of a phase only measures the time
+needed to submit its OpenGL commands, which can be much smaller than its GPU
+time since these commands are executed asynchronously. To avoid stalling the
+pipeline, the query results are only read when this object is destroyed, i.e.
+at the end of a sequence of phases:
+*/
+
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(PrecomputeProfile* profile) : profile_(profile) {}
+
+  ~PhaseTimer() {
+    for (unsigned int i = 0; i < phases_.size(); ++i) {
+      GLuint64 elapsed_time;
+      glGetQueryObjectui64v(queries_[i], GL_QUERY_RESULT, &elapsed_time);
+      phases_[i].gpu_time = elapsed_time * 1e-9;
+      profile_->AddPhase(phases_[i]);
+    }
+    glDeleteQueries(queries_.size(), queries_.data());
+  }
+
+  void Begin(const std::string& name, unsigned int scattering_order,
+      unsigned int num_texels) {
+    GLuint query;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    phases_.push_back(PrecomputePhase(name, scattering_order, num_texels));
+    queries_.push_back(query);
+    stopwatch_ = Stopwatch();
+  }
+
+  void End() {
+    glEndQuery(GL_TIME_ELAPSED);
+    phases_.back().wall_time = stopwatch_.GetElapsedTime();
+  }
+
+ private:
+  PrecomputeProfile* profile_;
+  std::vector<PrecomputePhase> phases_;
+  std::vector<GLuint> queries_;
+  Stopwatch stopwatch_;
+};
+
 /*
 <p>and a function to draw a full screen quad in an offscreen framebuffer (with
 blending separately enabled or disabled for each color attachment):
@@ -629,15 +836,25 @@ Model::Model(
     double length_unit_in_meters,
     unsigned int num_precomputed_wavelengths,
     bool combine_scattering_textures,
-    bool half_precision) :
+    bool half_precision,
+    const TextureResolution& texture_resolution,
+    const Quadrature& quadrature) :
+        wavelengths_(wavelengths),
+        solar_irradiance_(solar_irradiance),
         num_precomputed_wavelengths_(num_precomputed_wavelengths),
         half_precision_(half_precision),
+        texture_resolution_(texture_resolution),
+        num_scattering_orders_(0),
+        requested_num_scattering_orders_(0),
+        requested_convergence_tolerance_(0.0),
         rgb_format_supported_(IsFramebufferRgbFormatSupported(half_precision)) {
-  auto to_string = [&wavelengths](const std::vector<double>& v,
+  assert(texture_resolution.IsValid());
+  assert(quadrature.IsValid());
+  auto to_string = [this](const std::vector<double>& v,
       const vec3& lambdas, double scale) {
-    double r = Interpolate(wavelengths, v, lambdas[0]) * scale;
-    double g = Interpolate(wavelengths, v, lambdas[1]) * scale;
-    double b = Interpolate(wavelengths, v, lambdas[2]) * scale;
+    double r = Interpolate(wavelengths_, v, lambdas[0]) * scale;
+    double g = Interpolate(wavelengths_, v, lambdas[1]) * scale;
+    double b = Interpolate(wavelengths_, v, lambdas[2]) * scale;
     return "vec3(" + std::to_string(r) + "," + std::to_string(g) + "," +
         std::to_string(b) + ")";
   };
@@ -665,58 +882,47 @@ Model::Model(
         return result;
       };
 
-  // Compute the values for the SKY_RADIANCE_TO_LUMINANCE constant. In theory
-  // this should be 1 in precomputed illuminance mode (because the precomputed
-  // textures already contain illuminance values). In practice, however, storing
-  // true illuminance values in half precision textures yields artefacts
-  // (because the values are too large), so we store illuminance values divided
-  // by MAX_LUMINOUS_EFFICACY instead. This is why, in precomputed illuminance
-  // mode, we set SKY_RADIANCE_TO_LUMINANCE to MAX_LUMINOUS_EFFICACY.
-  bool precompute_illuminance = num_precomputed_wavelengths > 3;
-  double sky_k_r, sky_k_g, sky_k_b;
-  if (precompute_illuminance) {
-    sky_k_r = sky_k_g = sky_k_b = MAX_LUMINOUS_EFFICACY;
-  } else {
-    ComputeSpectralRadianceToLuminanceFactors(wavelengths, solar_irradiance,
-        -3 /* lambda_power */, &sky_k_r, &sky_k_g, &sky_k_b);
-  }
-  // Compute the values for the SUN_RADIANCE_TO_LUMINANCE constant.
-  double sun_k_r, sun_k_g, sun_k_b;
-  ComputeSpectralRadianceToLuminanceFactors(wavelengths, solar_irradiance,
-      0 /* lambda_power */, &sun_k_r, &sun_k_g, &sun_k_b);
-
   // A lambda that creates a GLSL header containing our atmosphere computation
-  // functions, specialized for the given atmosphere parameters and for the 3
-  // wavelengths in 'lambdas'.
-  glsl_header_factory_ = [=](const vec3& lambdas) {
+  // functions, specialized for the given atmosphere parameters, for the 3
+  // wavelengths in 'lambdas', and for the given texture resolution (which can
+  // differ from texture_resolution_ for some scattering orders, see
+  // set_scattering_order_resolutions). The solar irradiance is read from
+  // solar_irradiance_, which can change after the construction (see
+  // SetSolarIrradiance).
+  glsl_header_factory_ = [=](const vec3& lambdas,
+      const TextureResolution& resolution) {
+    // Compute the values for the SKY_RADIANCE_TO_LUMINANCE constant. In theory
+    // this should be 1 in precomputed illuminance mode (because the
+    // precomputed textures already contain illuminance values). In practice,
+    // however, storing true illuminance values in half precision textures
+    // yields artefacts (because the values are too large), so we store
+    // illuminance values divided by MAX_LUMINOUS_EFFICACY instead. This is
+    // why, in precomputed illuminance mode, we set SKY_RADIANCE_TO_LUMINANCE
+    // to MAX_LUMINOUS_EFFICACY.
+    double sky_k_r, sky_k_g, sky_k_b;
+    if (num_precomputed_wavelengths_ > 3) {
+      sky_k_r = sky_k_g = sky_k_b = MAX_LUMINOUS_EFFICACY;
+    } else {
+      ComputeSpectralRadianceToLuminanceFactors(wavelengths_,
+          solar_irradiance_, -3 /* lambda_power */, &sky_k_r, &sky_k_g,
+          &sky_k_b);
+    }
+    // Compute the values for the SUN_RADIANCE_TO_LUMINANCE constant.
+    double sun_k_r, sun_k_g, sun_k_b;
+    ComputeSpectralRadianceToLuminanceFactors(wavelengths_, solar_irradiance_,
+        0 /* lambda_power */, &sun_k_r, &sun_k_g, &sun_k_b);
     return
       "#version 330\n"
       "#define IN(x) const in x\n"
       "#define OUT(x) out x\n"
       "#define TEMPLATE(x)\n"
       "#define TEMPLATE_ARGUMENT(x)\n"
-      "#define assert(x)\n"
-      "const int TRANSMITTANCE_TEXTURE_WIDTH = " +
-          std::to_string(TRANSMITTANCE_TEXTURE_WIDTH) + ";\n" +
-      "const int TRANSMITTANCE_TEXTURE_HEIGHT = " +
-          std::to_string(TRANSMITTANCE_TEXTURE_HEIGHT) + ";\n" +
-      "const int SCATTERING_TEXTURE_R_SIZE = " +
-          std::to_string(SCATTERING_TEXTURE_R_SIZE) + ";\n" +
-      "const int SCATTERING_TEXTURE_MU_SIZE = " +
-          std::to_string(SCATTERING_TEXTURE_MU_SIZE) + ";\n" +
-      "const int SCATTERING_TEXTURE_MU_S_SIZE = " +
-          std::to_string(SCATTERING_TEXTURE_MU_S_SIZE) + ";\n" +
-      "const int SCATTERING_TEXTURE_NU_SIZE = " +
-          std::to_string(SCATTERING_TEXTURE_NU_SIZE) + ";\n" +
-      "const int IRRADIANCE_TEXTURE_WIDTH = " +
-          std::to_string(IRRADIANCE_TEXTURE_WIDTH) + ";\n" +
-      "const int IRRADIANCE_TEXTURE_HEIGHT = " +
-          std::to_string(IRRADIANCE_TEXTURE_HEIGHT) + ";\n" +
-      (combine_scattering_textures ?
+      "#define assert(x)\n" +
+      std::string(combine_scattering_textures ?
           "#define COMBINED_SCATTERING_TEXTURES\n" : "") +
       definitions_glsl +
       "const AtmosphereParameters ATMOSPHERE = AtmosphereParameters(\n" +
-          to_string(solar_irradiance, lambdas, 1.0) + ",\n" +
+          to_string(solar_irradiance_, lambdas, 1.0) + ",\n" +
           std::to_string(sun_angular_radius) + ",\n" +
           std::to_string(bottom_radius / length_unit_in_meters) + ",\n" +
           std::to_string(top_radius / length_unit_in_meters) + ",\n" +
@@ -731,7 +937,18 @@ Model::Model(
           to_string(
               absorption_extinction, lambdas, length_unit_in_meters) + ",\n" +
           to_string(ground_albedo, lambdas, 1.0) + ",\n" +
-          std::to_string(cos(max_sun_zenith_angle)) + ");\n" +
+          std::to_string(cos(max_sun_zenith_angle)) + ",\n" +
+          ToGlslString(resolution) + ",\n" +
+          "Quadrature(" +
+              std::to_string(quadrature.rule) + "," +
+              std::to_string(quadrature.transmittance_sample_count) + "," +
+              std::to_string(quadrature.single_scattering_sample_count) + "," +
+              std::to_string(quadrature.multiple_scattering_sample_count) +
+              "," + std::to_string(quadrature.spherical_rule) + "," +
+              std::to_string(quadrature.scattering_density_sample_count) +
+              "," +
+              std::to_string(quadrature.indirect_irradiance_sample_count) +
+              "));\n" +
       "const vec3 SKY_SPECTRAL_RADIANCE_TO_LUMINANCE = vec3(" +
           std::to_string(sky_k_r) + "," +
           std::to_string(sky_k_g) + "," +
@@ -745,35 +962,33 @@ Model::Model(
 
   // Allocate the precomputed textures, but don't precompute them yet.
   transmittance_texture_ = NewTexture2d(
-      TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+      texture_resolution_.transmittance_width,
+      texture_resolution_.transmittance_height);
   scattering_texture_ = NewTexture3d(
-      SCATTERING_TEXTURE_WIDTH,
-      SCATTERING_TEXTURE_HEIGHT,
-      SCATTERING_TEXTURE_DEPTH,
+      texture_resolution_.scattering_width(),
+      texture_resolution_.scattering_height(),
+      texture_resolution_.scattering_depth(),
       combine_scattering_textures || !rgb_format_supported_ ? GL_RGBA : GL_RGB,
       half_precision);
   if (combine_scattering_textures) {
     optional_single_mie_scattering_texture_ = 0;
   } else {
     optional_single_mie_scattering_texture_ = NewTexture3d(
-        SCATTERING_TEXTURE_WIDTH,
-        SCATTERING_TEXTURE_HEIGHT,
-        SCATTERING_TEXTURE_DEPTH,
+        texture_resolution_.scattering_width(),
+        texture_resolution_.scattering_height(),
+        texture_resolution_.scattering_depth(),
         rgb_format_supported_ ? GL_RGB : GL_RGBA,
         half_precision);
   }
   irradiance_texture_ = NewTexture2d(
-      IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
+      texture_resolution_.irradiance_width,
+      texture_resolution_.irradiance_height);
+  spherical_samples_texture_ =
+      NewSphericalSamplesTexture(quadrature, mie_phase_function_g);
 
   // Create and compile the shader providing our API.
-  std::string shader =
-      glsl_header_factory_({kLambdaR, kLambdaG, kLambdaB}) +
-      (precompute_illuminance ? "" : "#define RADIANCE_API_ENABLED\n") +
-      kAtmosphereShader;
-  const char* source = shader.c_str();
   atmosphere_shader_ = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(atmosphere_shader_, 1, &source, NULL);
-  glCompileShader(atmosphere_shader_);
+  CompileAtmosphereShader();
 
   // Create a full screen quad vertex array and vertex buffer objects.
   glGenVertexArrays(1, &full_screen_quad_vao_);
@@ -807,9 +1022,43 @@ Model::~Model() {
     glDeleteTextures(1, &optional_single_mie_scattering_texture_);
   }
   glDeleteTextures(1, &irradiance_texture_);
+  glDeleteTextures(1, &spherical_samples_texture_);
   glDeleteShader(atmosphere_shader_);
 }
 
+/*
+<p>The resolution of each scattering order is specified with the following
+method. Only the scattering and irradiance texture sizes can change with the
+scattering order (the transmittance texture is only computed once, with the
+resolution passed to the constructor):
+*/
+
+void Model::set_scattering_order_resolutions(
+    const std::vector<TextureResolution>& resolutions) {
+  assert(std::all_of(resolutions.begin(), resolutions.end(),
+      [](const TextureResolution& resolution) {
+        return resolution.IsValid();
+      }));
+  scattering_order_resolutions_ = resolutions;
+}
+
+TextureResolution Model::GetScatteringOrderResolution(
+    unsigned int scattering_order) const {
+  TextureResolution resolution = texture_resolution_;
+  if (scattering_order >= 2 && !scattering_order_resolutions_.empty()) {
+    const TextureResolution& order_resolution =
+        scattering_order_resolutions_[std::min<size_t>(scattering_order - 2,
+            scattering_order_resolutions_.size() - 1)];
+    resolution.scattering_r_size = order_resolution.scattering_r_size;
+    resolution.scattering_mu_size = order_resolution.scattering_mu_size;
+    resolution.scattering_mu_s_size = order_resolution.scattering_mu_s_size;
+    resolution.scattering_nu_size = order_resolution.scattering_nu_size;
+    resolution.irradiance_width = order_resolution.irradiance_width;
+    resolution.irradiance_height = order_resolution.irradiance_height;
+  }
+  return resolution;
+}
+
 /*
 <p>The Init method precomputes the atmosphere textures. It first allocates the
 temporary resources it needs, then calls <code>Precompute</code> to do the
@@ -860,33 +1109,46 @@ want to store precomputed irradiance or illuminance values:
   wavelengths (yielding a 3x3 matrix).</li>
 </ul>
 
+<p>Finally, if a <code>convergence_tolerance</code> is specified,
+<code>num_scattering_orders</code> is only a maximum number of scattering
+orders, and each call to <code>Precompute</code> stops as soon as an order adds
+a negligible energy (see below). The number of orders actually used (the
+maximum over all the <code>Precompute</code> calls) is then stored in
+<code>num_scattering_orders_</code>.
+
 <p>This yields the following implementation:
 */
 
-void Model::Init(unsigned int num_scattering_orders) {
+void Model::Init(unsigned int num_scattering_orders,
+    double convergence_tolerance) {
+  profile_.Clear();
+  requested_num_scattering_orders_ = num_scattering_orders;
+  requested_convergence_tolerance_ = convergence_tolerance;
+
   // The precomputations require temporary textures, in particular to store the
   // contribution of one scattering order, which is needed to compute the next
   // order of scattering (the final precomputed textures store the sum of all
   // the scattering orders). We allocate them here, and destroy them at the end
   // of this method.
   GLuint delta_irradiance_texture = NewTexture2d(
-      IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
+      texture_resolution_.irradiance_width,
+      texture_resolution_.irradiance_height);
   GLuint delta_rayleigh_scattering_texture = NewTexture3d(
-      SCATTERING_TEXTURE_WIDTH,
-      SCATTERING_TEXTURE_HEIGHT,
-      SCATTERING_TEXTURE_DEPTH,
+      texture_resolution_.scattering_width(),
+      texture_resolution_.scattering_height(),
+      texture_resolution_.scattering_depth(),
       rgb_format_supported_ ? GL_RGB : GL_RGBA,
       half_precision_);
   GLuint delta_mie_scattering_texture = NewTexture3d(
-      SCATTERING_TEXTURE_WIDTH,
-      SCATTERING_TEXTURE_HEIGHT,
-      SCATTERING_TEXTURE_DEPTH,
+      texture_resolution_.scattering_width(),
+      texture_resolution_.scattering_height(),
+      texture_resolution_.scattering_depth(),
       rgb_format_supported_ ? GL_RGB : GL_RGBA,
       half_precision_);
   GLuint delta_scattering_density_texture = NewTexture3d(
-      SCATTERING_TEXTURE_WIDTH,
-      SCATTERING_TEXTURE_HEIGHT,
-      SCATTERING_TEXTURE_DEPTH,
+      texture_resolution_.scattering_width(),
+      texture_resolution_.scattering_height(),
+      texture_resolution_.scattering_depth(),
       rgb_format_supported_ ? GL_RGB : GL_RGBA,
       half_precision_);
   // delta_multiple_scattering_texture is only needed to compute scattering
@@ -907,14 +1169,16 @@ void Model::Init(unsigned int num_scattering_orders) {
   if (num_precomputed_wavelengths_ <= 3) {
     vec3 lambdas{kLambdaR, kLambdaG, kLambdaB};
     mat3 luminance_from_radiance{1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
-    Precompute(fbo, delta_irradiance_texture, delta_rayleigh_scattering_texture,
-        delta_mie_scattering_texture, delta_scattering_density_texture,
-        delta_multiple_scattering_texture, lambdas, luminance_from_radiance,
-        false /* blend */, num_scattering_orders);
+    num_scattering_orders_ = Precompute(fbo, delta_irradiance_texture,
+        delta_rayleigh_scattering_texture, delta_mie_scattering_texture,
+        delta_scattering_density_texture, delta_multiple_scattering_texture,
+        lambdas, luminance_from_radiance, false /* blend */,
+        num_scattering_orders, convergence_tolerance);
   } else {
     constexpr double kLambdaMin = 360.0;
     constexpr double kLambdaMax = 830.0;
     int num_iterations = (num_precomputed_wavelengths_ + 2) / 3;
+    num_scattering_orders_ = 0;
     double dlambda = (kLambdaMax - kLambdaMin) / (3 * num_iterations);
     for (int i = 0; i < num_iterations; ++i) {
       vec3 lambdas{
@@ -941,26 +1205,35 @@ void Model::Init(unsigned int num_scattering_orders) {
         coeff(lambdas[0], 1), coeff(lambdas[1], 1), coeff(lambdas[2], 1),
         coeff(lambdas[0], 2), coeff(lambdas[1], 2), coeff(lambdas[2], 2)
       };
-      Precompute(fbo, delta_irradiance_texture,
-          delta_rayleigh_scattering_texture, delta_mie_scattering_texture,
-          delta_scattering_density_texture, delta_multiple_scattering_texture,
-          lambdas, luminance_from_radiance, i > 0 /* blend */,
-          num_scattering_orders);
+      num_scattering_orders_ = std::max(num_scattering_orders_,
+          Precompute(fbo, delta_irradiance_texture,
+              delta_rayleigh_scattering_texture, delta_mie_scattering_texture,
+              delta_scattering_density_texture,
+              delta_multiple_scattering_texture, lambdas,
+              luminance_from_radiance, i > 0 /* blend */,
+              num_scattering_orders, convergence_tolerance));
     }
 
     // After the above iterations, the transmittance texture contains the
     // transmittance for the 3 wavelengths used at the last iteration. But we
     // want the transmittance at kLambdaR, kLambdaG, kLambdaB instead, so we
     // must recompute it here for these 3 wavelengths:
-    std::string header = glsl_header_factory_({kLambdaR, kLambdaG, kLambdaB});
+    std::string header = glsl_header_factory_(
+        {kLambdaR, kLambdaG, kLambdaB}, texture_resolution_);
     Program compute_transmittance(
         kVertexShader, header + kComputeTransmittanceShader);
+    PhaseTimer timer(&profile_);
+    timer.Begin("transmittance", 0,
+        texture_resolution_.transmittance_width *
+            texture_resolution_.transmittance_height);
     glFramebufferTexture(
         GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, transmittance_texture_, 0);
     glDrawBuffer(GL_COLOR_ATTACHMENT0);
-    glViewport(0, 0, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+    glViewport(0, 0, texture_resolution_.transmittance_width,
+        texture_resolution_.transmittance_height);
     compute_transmittance.Use();
     DrawQuad({}, full_screen_quad_vao_);
+    timer.End();
   }
 
   // Delete the temporary resources allocated at the begining of this method.
@@ -974,6 +1247,116 @@ void Model::Init(unsigned int num_scattering_orders) {
   assert(glGetError() == 0);
 }
 
+/*
+<p>In precomputed irradiance mode, each channel of the precomputed textures is
+proportional to the solar irradiance at one of the 3 precomputed wavelengths
+(the transmittance texture does not depend on it). A change of the solar
+irradiance can thus be handled by rescaling these channels, which is much faster
+than a new precomputation. In precomputed illuminance mode, each channel
+integrates many wavelengths, each with its own scale factor, and the textures
+must thus be recomputed. In both cases, the shader constants which depend on
+the solar irradiance (its value at the 3 wavelengths, and the
+*<code>_RADIANCE_TO_LUMINANCE</code> constants) change too, and the shader
+providing our API is recompiled:
+*/
+
+void Model::SetSolarIrradiance(const std::vector<double>& solar_irradiance) {
+  assert(solar_irradiance.size() == wavelengths_.size());
+  const vec3 lambdas{kLambdaR, kLambdaG, kLambdaB};
+  vec3 scale;
+  bool can_rescale = num_precomputed_wavelengths_ <= 3;
+  for (int i = 0; i < 3; ++i) {
+    const double old_value =
+        Interpolate(wavelengths_, solar_irradiance_, lambdas[i]);
+    if (old_value == 0.0) {
+      can_rescale = false;
+    } else {
+      scale[i] =
+          Interpolate(wavelengths_, solar_irradiance, lambdas[i]) / old_value;
+    }
+  }
+  solar_irradiance_ = solar_irradiance;
+  if (requested_num_scattering_orders_ > 0) {
+    if (can_rescale) {
+      RescaleTextures(scale);
+    } else {
+      Init(requested_num_scattering_orders_, requested_convergence_tolerance_);
+    }
+  }
+  CompileAtmosphereShader();
+}
+
+/*
+<p>The rescaling itself is done on GPU, by rendering a full screen quad in each
+layer of the scattering textures, and in the irradiance texture, with a blending
+function multiplying the current texel values with the scale factors (the alpha
+channel of the combined scattering texture contains the red component of the
+single Mie scattering, and is thus scaled like the red channel):
+*/
+
+void Model::RescaleTextures(const vec3& scale) {
+  profile_.Clear();
+  Program rescale_2d(kVertexShader, kRescaleShader);
+  Program rescale_3d(kVertexShader, kGeometryShader, kRescaleShader);
+  GLuint fbo;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glDrawBuffer(GL_COLOR_ATTACHMENT0);
+  glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+  glBlendFuncSeparate(GL_ZERO, GL_CONSTANT_COLOR, GL_ZERO, GL_CONSTANT_ALPHA);
+  glBlendColor(scale[0], scale[1], scale[2], scale[0]);
+  {
+    const unsigned int kScatteringTextureSize =
+        texture_resolution_.scattering_width() *
+        texture_resolution_.scattering_height() *
+        texture_resolution_.scattering_depth();
+    PhaseTimer timer(&profile_);
+    timer.Begin("rescaling", 0,
+        kScatteringTextureSize *
+            (optional_single_mie_scattering_texture_ != 0 ? 2 : 1) +
+        texture_resolution_.irradiance_width *
+            texture_resolution_.irradiance_height);
+    rescale_3d.Use();
+    glViewport(0, 0, texture_resolution_.scattering_width(),
+        texture_resolution_.scattering_height());
+    for (GLuint texture :
+         {scattering_texture_, optional_single_mie_scattering_texture_}) {
+      if (texture == 0) {
+        continue;
+      }
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0);
+      for (int layer = 0; layer < texture_resolution_.scattering_depth();
+           ++layer) {
+        rescale_3d.BindInt("layer", layer);
+        DrawQuad({true}, full_screen_quad_vao_);
+      }
+    }
+    rescale_2d.Use();
+    glFramebufferTexture(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, irradiance_texture_, 0);
+    glViewport(0, 0, texture_resolution_.irradiance_width,
+        texture_resolution_.irradiance_height);
+    DrawQuad({true}, full_screen_quad_vao_);
+    timer.End();
+  }
+  glUseProgram(0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+  assert(glGetError() == 0);
+}
+
+void Model::CompileAtmosphereShader() {
+  std::string shader =
+      glsl_header_factory_(
+          {kLambdaR, kLambdaG, kLambdaB}, texture_resolution_) +
+      (num_precomputed_wavelengths_ > 3 ?
+          "" : "#define RADIANCE_API_ENABLED\n") +
+      kAtmosphereShader;
+  const char* source = shader.c_str();
+  glShaderSource(atmosphere_shader_, 1, &source, NULL);
+  glCompileShader(atmosphere_shader_);
+}
+
 /*
 <p>The <code>SetProgramUniforms</code> method is straightforward: it simply
 binds the precomputed textures to the specified texture units, and then sets
@@ -1043,9 +1426,14 @@ void Model::ConvertSpectrumToLinearSrgb(
 <p>Finally, we provide the actual implementation of the precomputation algorithm
 described in Algorithm 4.1 of
 <a href="https://hal.inria.fr/inria-00288758/en">our paper</a>. Each step is
-explained by the inline comments below.
+explained by the inline comments below. The scattering orders with a lower
+resolution than the final textures (see
+<code>set_scattering_order_resolutions</code>) are computed in low resolution
+delta textures, and are then upsampled when they are accumulated in the final
+textures. This method returns the number of scattering orders actually
+computed.
 */
-void Model::Precompute(
+unsigned int Model::Precompute(
     GLuint fbo,
     GLuint delta_irradiance_texture,
     GLuint delta_rayleigh_scattering_texture,
@@ -1055,23 +1443,25 @@ void Model::Precompute(
     const vec3& lambdas,
     const mat3& luminance_from_radiance,
     bool blend,
-    unsigned int num_scattering_orders) {
+    unsigned int num_scattering_orders,
+    double convergence_tolerance) {
   // The precomputations require specific GLSL programs, for each precomputation
   // step. We create and compile them here (they are automatically destroyed
-  // when this method returns, via the Program destructor).
-  std::string header = glsl_header_factory_(lambdas);
+  // when this method returns, via the Program destructor). The programs used
+  // for the scattering orders from the 2nd one depend on the resolution of
+  // these orders, and are recreated when it changes (see below).
+  std::string header = glsl_header_factory_(lambdas, texture_resolution_);
   Program compute_transmittance(
       kVertexShader, header + kComputeTransmittanceShader);
   Program compute_direct_irradiance(
       kVertexShader, header + kComputeDirectIrradianceShader);
   Program compute_single_scattering(kVertexShader, kGeometryShader,
       header + kComputeSingleScatteringShader);
-  Program compute_scattering_density(kVertexShader, kGeometryShader,
-      header + kComputeScatteringDensityShader);
-  Program compute_indirect_irradiance(
-      kVertexShader, header + kComputeIndirectIrradianceShader);
-  Program compute_multiple_scattering(kVertexShader, kGeometryShader,
-      header + kComputeMultipleScatteringShader);
+  std::unique_ptr<Program> compute_scattering_density;
+  std::unique_ptr<Program> compute_indirect_irradiance;
+  std::unique_ptr<Program> compute_multiple_scattering;
+  std::unique_ptr<Program> upsample_scattering;
+  std::unique_ptr<Program> upsample_irradiance;
 
   const GLuint kDrawBuffers[4] = {
     GL_COLOR_ATTACHMENT0,
@@ -1079,36 +1469,56 @@ void Model::Precompute(
     GL_COLOR_ATTACHMENT2,
     GL_COLOR_ATTACHMENT3
   };
+  const GLuint kUpsampleDrawBuffers[2] = {GL_NONE, GL_COLOR_ATTACHMENT1};
   glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
   glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 
+  // Each step is recorded in the profile, when this method returns.
+  const unsigned int kIrradianceTextureSize =
+      texture_resolution_.irradiance_width *
+      texture_resolution_.irradiance_height;
+  const unsigned int kScatteringTextureSize =
+      texture_resolution_.scattering_width() *
+      texture_resolution_.scattering_height() *
+      texture_resolution_.scattering_depth();
+  PhaseTimer timer(&profile_);
+
   // Compute the transmittance, and store it in transmittance_texture_.
+  timer.Begin("transmittance", 0,
+      texture_resolution_.transmittance_width *
+          texture_resolution_.transmittance_height);
   glFramebufferTexture(
       GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, transmittance_texture_, 0);
   glDrawBuffer(GL_COLOR_ATTACHMENT0);
-  glViewport(0, 0, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+  glViewport(0, 0, texture_resolution_.transmittance_width,
+      texture_resolution_.transmittance_height);
   compute_transmittance.Use();
   DrawQuad({}, full_screen_quad_vao_);
+  timer.End();
 
   // Compute the direct irradiance, store it in delta_irradiance_texture and,
   // depending on 'blend', either initialize irradiance_texture_ with zeros or
   // leave it unchanged (we don't want the direct irradiance in
   // irradiance_texture_, but only the irradiance from the sky).
+  timer.Begin("direct_irradiance", 0, kIrradianceTextureSize);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
       delta_irradiance_texture, 0);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
       irradiance_texture_, 0);
   glDrawBuffers(2, kDrawBuffers);
-  glViewport(0, 0, IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
+  glViewport(0, 0, texture_resolution_.irradiance_width,
+      texture_resolution_.irradiance_height);
   compute_direct_irradiance.Use();
   compute_direct_irradiance.BindTexture2d(
       "transmittance_texture", transmittance_texture_, 0);
   DrawQuad({false, blend}, full_screen_quad_vao_);
+  timer.End();
 
   // Compute the rayleigh and mie single scattering, store them in
   // delta_rayleigh_scattering_texture and delta_mie_scattering_texture, and
   // either store them or accumulate them in scattering_texture_ and
   // optional_single_mie_scattering_texture_.
+  timer.Begin("single_scattering", 1, kScatteringTextureSize);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
       delta_rayleigh_scattering_texture, 0);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
@@ -1122,96 +1532,318 @@ void Model::Precompute(
   } else {
     glDrawBuffers(3, kDrawBuffers);
   }
-  glViewport(0, 0, SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT);
+  glViewport(0, 0, texture_resolution_.scattering_width(),
+      texture_resolution_.scattering_height());
   compute_single_scattering.Use();
   compute_single_scattering.BindMat3(
       "luminance_from_radiance", luminance_from_radiance);
   compute_single_scattering.BindTexture2d(
       "transmittance_texture", transmittance_texture_, 0);
-  for (unsigned int layer = 0; layer < SCATTERING_TEXTURE_DEPTH; ++layer) {
+  for (int layer = 0; layer < texture_resolution_.scattering_depth(); ++layer) {
     compute_single_scattering.BindInt("layer", layer);
     DrawQuad({false, false, blend, blend}, full_screen_quad_vao_);
   }
+  timer.End();
+
+  // The delta textures passed to this method have the resolution of the final
+  // textures. When a scattering order has a different resolution than the
+  // previous one (see set_scattering_order_resolutions), the following
+  // function allocates new delta textures with this resolution (deleted at the
+  // end of this method), and resamples the delta textures read by this order
+  // (the delta irradiance, and the delta single scattering for the 2nd order
+  // or the delta multiple scattering for the other orders) into them. It also
+  // creates the programs for this resolution, including those to upsample
+  // the results of this order in the final textures, if needed.
+  TextureResolution delta_resolution = texture_resolution_;
+  std::vector<GLuint> order_delta_textures;
+  auto set_delta_resolution = [&](unsigned int scattering_order,
+      const TextureResolution& order_resolution) {
+    const std::string order_header =
+        glsl_header_factory_(lambdas, order_resolution);
+    compute_scattering_density.reset(new Program(kVertexShader,
+        kGeometryShader, order_header + kComputeScatteringDensityShader));
+    compute_indirect_irradiance.reset(new Program(
+        kVertexShader, order_header + kComputeIndirectIrradianceShader));
+    compute_multiple_scattering.reset(new Program(kVertexShader,
+        kGeometryShader, order_header + kComputeMultipleScatteringShader));
+    const bool full_resolution =
+        HaveSameScatteringSizes(order_resolution, texture_resolution_);
+    if (!full_resolution) {
+      const std::string source_resolution =
+          "const TextureResolution SOURCE_TEXTURE_RESOLUTION = " +
+          ToGlslString(order_resolution) + ";\n";
+      upsample_scattering.reset(new Program(kVertexShader, kGeometryShader,
+          header + source_resolution + kResampleScatteringShader));
+      upsample_irradiance.reset(new Program(kVertexShader,
+          header + source_resolution + kResampleIrradianceShader));
+    }
+    if (HaveSameScatteringSizes(order_resolution, delta_resolution)) {
+      return;
+    }
+
+    const GLuint order_delta_irradiance_texture = NewTexture2d(
+        order_resolution.irradiance_width,
+        order_resolution.irradiance_height);
+    const GLuint order_delta_rayleigh_scattering_texture = NewTexture3d(
+        order_resolution.scattering_width(),
+        order_resolution.scattering_height(),
+        order_resolution.scattering_depth(),
+        rgb_format_supported_ ? GL_RGB : GL_RGBA,
+        half_precision_);
+    const GLuint order_delta_mie_scattering_texture = NewTexture3d(
+        order_resolution.scattering_width(),
+        order_resolution.scattering_height(),
+        order_resolution.scattering_depth(),
+        rgb_format_supported_ ? GL_RGB : GL_RGBA,
+        half_precision_);
+    const GLuint order_delta_scattering_density_texture = NewTexture3d(
+        order_resolution.scattering_width(),
+        order_resolution.scattering_height(),
+        order_resolution.scattering_depth(),
+        rgb_format_supported_ ? GL_RGB : GL_RGBA,
+        half_precision_);
+    order_delta_textures.insert(order_delta_textures.end(), {
+        order_delta_irradiance_texture,
+        order_delta_rayleigh_scattering_texture,
+        order_delta_mie_scattering_texture,
+        order_delta_scattering_density_texture});
+
+    const std::string source_resolution =
+        "const TextureResolution SOURCE_TEXTURE_RESOLUTION = " +
+        ToGlslString(delta_resolution) + ";\n";
+    Program resample_scattering(kVertexShader, kGeometryShader,
+        order_header + source_resolution + kResampleScatteringShader);
+    Program resample_irradiance(kVertexShader,
+        order_header + source_resolution + kResampleIrradianceShader);
+    const unsigned int order_scattering_texture_size =
+        order_resolution.scattering_width() *
+        order_resolution.scattering_height() *
+        order_resolution.scattering_depth();
+    timer.Begin("resampling", scattering_order,
+        order_resolution.irradiance_width *
+            order_resolution.irradiance_height +
+        order_scattering_texture_size * (scattering_order == 2 ? 2 : 1));
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, 0, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, 0, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, 0, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        order_delta_irradiance_texture, 0);
+    glViewport(0, 0, order_resolution.irradiance_width,
+        order_resolution.irradiance_height);
+    resample_irradiance.Use();
+    resample_irradiance.BindTexture2d(
+        "source_texture", delta_irradiance_texture, 0);
+    DrawQuad({}, full_screen_quad_vao_);
+
+    std::vector<std::pair<GLuint, GLuint>> scattering_textures;
+    if (scattering_order == 2) {
+      scattering_textures.push_back({delta_rayleigh_scattering_texture,
+          order_delta_rayleigh_scattering_texture});
+      scattering_textures.push_back({delta_mie_scattering_texture,
+          order_delta_mie_scattering_texture});
+    } else {
+      scattering_textures.push_back({delta_multiple_scattering_texture,
+          order_delta_rayleigh_scattering_texture});
+    }
+    glViewport(0, 0, order_resolution.scattering_width(),
+        order_resolution.scattering_height());
+    resample_scattering.Use();
+    for (const auto& textures : scattering_textures) {
+      glFramebufferTexture(
+          GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures.second, 0);
+      resample_scattering.BindTexture3d("source_texture", textures.first, 0);
+      for (int layer = 0; layer < order_resolution.scattering_depth();
+           ++layer) {
+        resample_scattering.BindInt("layer", layer);
+        DrawQuad({}, full_screen_quad_vao_);
+      }
+    }
+    timer.End();
+
+    // As in Init, the delta multiple scattering (only needed from the 3rd
+    // order) is stored in the same texture as the delta Rayleigh scattering
+    // (only needed for the 2nd order).
+    delta_irradiance_texture = order_delta_irradiance_texture;
+    delta_rayleigh_scattering_texture = order_delta_rayleigh_scattering_texture;
+    delta_mie_scattering_texture = order_delta_mie_scattering_texture;
+    delta_scattering_density_texture = order_delta_scattering_density_texture;
+    delta_multiple_scattering_texture = order_delta_rayleigh_scattering_texture;
+    delta_resolution = order_resolution;
+  };
+
+  // Compute the 2nd, 3rd and 4th order of scattering, in sequence (or, if a
+  // convergence tolerance is specified, until the indirect irradiance added by
+  // the last order, relatively to the total indirect irradiance so far, is
+  // less than this tolerance - the first indirect irradiance order, computed
+  // with the 2nd scattering order, is not tested since its relative
+  // contribution is always 1). With a lower resolution for some orders, the
+  // indirect irradiance is measured with the average texel value, which does
+  // not depend on the resolution.
+  double indirect_irradiance_sum = 0.0;
+  unsigned int scattering_order = 2;
+  for (; scattering_order <= num_scattering_orders; ++scattering_order) {
+    const TextureResolution order_resolution =
+        GetScatteringOrderResolution(scattering_order);
+    if (!compute_scattering_density ||
+        !HaveSameScatteringSizes(order_resolution, delta_resolution)) {
+      set_delta_resolution(scattering_order, order_resolution);
+    }
+    // The final textures are directly updated by the programs computing the
+    // scattering orders, unless they have a lower resolution, in which case
+    // they must be upsampled after each order.
+    const bool full_resolution =
+        HaveSameScatteringSizes(order_resolution, texture_resolution_);
+    const GLuint irradiance_texture = full_resolution ? irradiance_texture_ : 0;
+    const GLuint scattering_texture = full_resolution ? scattering_texture_ : 0;
+    const unsigned int order_irradiance_texture_size =
+        order_resolution.irradiance_width * order_resolution.irradiance_height;
+    const unsigned int order_scattering_texture_size =
+        order_resolution.scattering_width() *
+        order_resolution.scattering_height() *
+        order_resolution.scattering_depth();
 
-  // Compute the 2nd, 3rd and 4th order of scattering, in sequence.
-  for (unsigned int scattering_order = 2;
-       scattering_order <= num_scattering_orders;
-       ++scattering_order) {
     // Compute the scattering density, and store it in
     // delta_scattering_density_texture.
+    timer.Begin("scattering_density", scattering_order,
+        order_scattering_texture_size);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
         delta_scattering_density_texture, 0);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, 0, 0);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, 0, 0);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, 0, 0);
     glDrawBuffer(GL_COLOR_ATTACHMENT0);
-    glViewport(0, 0, SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT);
-    compute_scattering_density.Use();
-    compute_scattering_density.BindTexture2d(
+    glViewport(0, 0, order_resolution.scattering_width(),
+        order_resolution.scattering_height());
+    compute_scattering_density->Use();
+    compute_scattering_density->BindTexture2d(
         "transmittance_texture", transmittance_texture_, 0);
-    compute_scattering_density.BindTexture3d(
+    compute_scattering_density->BindTexture3d(
         "single_rayleigh_scattering_texture",
         delta_rayleigh_scattering_texture,
         1);
-    compute_scattering_density.BindTexture3d(
+    compute_scattering_density->BindTexture3d(
         "single_mie_scattering_texture", delta_mie_scattering_texture, 2);
-    compute_scattering_density.BindTexture3d(
+    compute_scattering_density->BindTexture3d(
         "multiple_scattering_texture", delta_multiple_scattering_texture, 3);
-    compute_scattering_density.BindTexture2d(
+    compute_scattering_density->BindTexture2d(
         "irradiance_texture", delta_irradiance_texture, 4);
-    compute_scattering_density.BindInt("scattering_order", scattering_order);
-    for (unsigned int layer = 0; layer < SCATTERING_TEXTURE_DEPTH; ++layer) {
-      compute_scattering_density.BindInt("layer", layer);
+    compute_scattering_density->BindTexture2d(
+        "spherical_samples_texture", spherical_samples_texture_, 5);
+    compute_scattering_density->BindInt("scattering_order", scattering_order);
+    for (int layer = 0; layer < order_resolution.scattering_depth(); ++layer) {
+      compute_scattering_density->BindInt("layer", layer);
       DrawQuad({}, full_screen_quad_vao_);
     }
+    timer.End();
 
     // Compute the indirect irradiance, store it in delta_irradiance_texture and
     // accumulate it in irradiance_texture_.
+    timer.Begin("indirect_irradiance", scattering_order,
+        order_irradiance_texture_size);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
         delta_irradiance_texture, 0);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
-        irradiance_texture_, 0);
-    glDrawBuffers(2, kDrawBuffers);
-    glViewport(0, 0, IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
-    compute_indirect_irradiance.Use();
-    compute_indirect_irradiance.BindMat3(
+        irradiance_texture, 0);
+    glDrawBuffers(full_resolution ? 2 : 1, kDrawBuffers);
+    glViewport(0, 0, order_resolution.irradiance_width,
+        order_resolution.irradiance_height);
+    compute_indirect_irradiance->Use();
+    compute_indirect_irradiance->BindMat3(
         "luminance_from_radiance", luminance_from_radiance);
-    compute_indirect_irradiance.BindTexture3d(
+    compute_indirect_irradiance->BindTexture3d(
         "single_rayleigh_scattering_texture",
         delta_rayleigh_scattering_texture,
         0);
-    compute_indirect_irradiance.BindTexture3d(
+    compute_indirect_irradiance->BindTexture3d(
         "single_mie_scattering_texture", delta_mie_scattering_texture, 1);
-    compute_indirect_irradiance.BindTexture3d(
+    compute_indirect_irradiance->BindTexture3d(
         "multiple_scattering_texture", delta_multiple_scattering_texture, 2);
-    compute_indirect_irradiance.BindInt("scattering_order",
+    compute_indirect_irradiance->BindTexture2d(
+        "spherical_samples_texture", spherical_samples_texture_, 3);
+    compute_indirect_irradiance->BindInt("scattering_order",
         scattering_order - 1);
-    DrawQuad({false, true}, full_screen_quad_vao_);
+    DrawQuad({false, full_resolution}, full_screen_quad_vao_);
+    timer.End();
 
     // Compute the multiple scattering, store it in
     // delta_multiple_scattering_texture, and accumulate it in
     // scattering_texture_.
+    timer.Begin("multiple_scattering", scattering_order,
+        order_scattering_texture_size);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
         delta_multiple_scattering_texture, 0);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
-        scattering_texture_, 0);
-    glDrawBuffers(2, kDrawBuffers);
-    glViewport(0, 0, SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT);
-    compute_multiple_scattering.Use();
-    compute_multiple_scattering.BindMat3(
+        scattering_texture, 0);
+    glDrawBuffers(full_resolution ? 2 : 1, kDrawBuffers);
+    glViewport(0, 0, order_resolution.scattering_width(),
+        order_resolution.scattering_height());
+    compute_multiple_scattering->Use();
+    compute_multiple_scattering->BindMat3(
         "luminance_from_radiance", luminance_from_radiance);
-    compute_multiple_scattering.BindTexture2d(
+    compute_multiple_scattering->BindTexture2d(
         "transmittance_texture", transmittance_texture_, 0);
-    compute_multiple_scattering.BindTexture3d(
+    compute_multiple_scattering->BindTexture3d(
         "scattering_density_texture", delta_scattering_density_texture, 1);
-    for (unsigned int layer = 0; layer < SCATTERING_TEXTURE_DEPTH; ++layer) {
-      compute_multiple_scattering.BindInt("layer", layer);
+    for (int layer = 0; layer < order_resolution.scattering_depth(); ++layer) {
+      compute_multiple_scattering->BindInt("layer", layer);
+      DrawQuad({false, full_resolution}, full_screen_quad_vao_);
+    }
+    timer.End();
+
+    // Upsample the indirect irradiance and the multiple scattering of this
+    // order, if needed, and accumulate them in the final textures.
+    if (!full_resolution) {
+      timer.Begin("upsampling", scattering_order,
+          kIrradianceTextureSize + kScatteringTextureSize);
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0);
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+          irradiance_texture_, 0);
+      glDrawBuffers(2, kUpsampleDrawBuffers);
+      glViewport(0, 0, texture_resolution_.irradiance_width,
+          texture_resolution_.irradiance_height);
+      upsample_irradiance->Use();
+      upsample_irradiance->BindMat3(
+          "luminance_from_radiance", luminance_from_radiance);
+      upsample_irradiance->BindTexture2d(
+          "source_texture", delta_irradiance_texture, 0);
       DrawQuad({false, true}, full_screen_quad_vao_);
+
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+          scattering_texture_, 0);
+      glViewport(0, 0, texture_resolution_.scattering_width(),
+          texture_resolution_.scattering_height());
+      upsample_scattering->Use();
+      upsample_scattering->BindMat3(
+          "luminance_from_radiance", luminance_from_radiance);
+      upsample_scattering->BindTexture3d(
+          "source_texture", delta_multiple_scattering_texture, 0);
+      for (int layer = 0; layer < texture_resolution_.scattering_depth();
+           ++layer) {
+        upsample_scattering->BindInt("layer", layer);
+        DrawQuad({false, true}, full_screen_quad_vao_);
+      }
+      timer.End();
+    }
+
+    // Measure the indirect irradiance added by this order, if needed. This
+    // only requires reading back a small texture.
+    if (convergence_tolerance > 0.0) {
+      double delta_indirect_irradiance = GetTextureRgbSum(
+          delta_irradiance_texture, order_resolution.irradiance_width,
+          order_resolution.irradiance_height) / order_irradiance_texture_size;
+      indirect_irradiance_sum += delta_indirect_irradiance;
+      if (scattering_order > 2 && delta_indirect_irradiance <=
+          convergence_tolerance * indirect_irradiance_sum) {
+        break;
+      }
     }
   }
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, 0, 0);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, 0, 0);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, 0, 0);
+  glDeleteTextures(order_delta_textures.size(), order_delta_textures.data());
+  return std::min(scattering_order, num_scattering_orders);
 }
 
 }  // namespace atmosphere
@@ -155,6 +155,9 @@ parameter):
 #include <string>
 #include <vector>
 
+#include "atmosphere/constants.h"
+#include "atmosphere/precompute_profile.h"
+
 namespace atmosphere {
 
 // An atmosphere layer of width 'width' (in m), and whose density is defined as
@@ -278,11 +281,64 @@ class Model {
     // Whether to use half precision floats (16 bits) or single precision floats
     // (32 bits) for the precomputed textures. Half precision is sufficient for
     // most cases, except for very high exposure values.
-    bool half_precision);
+    bool half_precision,
+    // The resolution of the precomputed textures. Larger textures are more
+    // precise, but need more GPU memory and a longer precomputation time (see
+    // constants.h). The resolution must be valid (see TextureResolution).
+    const TextureResolution& texture_resolution = TextureResolution(),
+    // The numerical integration rules and sample counts used to precompute the
+    // transmittance, single and multiple scattering textures, and to integrate
+    // over the incident directions. Fewer samples give a faster
+    // precomputation, but a larger error (see Quadrature in constants.h). The
+    // quadrature must be valid.
+    const Quadrature& quadrature = Quadrature());
 
   ~Model();
 
-  void Init(unsigned int num_scattering_orders = 4);
+  // The resolutions of the scattering and irradiance textures used to compute
+  // the scattering orders from the 2nd one: the i-th resolution is used for
+  // the (i+2)-th order, and the last one for all the subsequent orders (their
+  // transmittance sizes are ignored). Since the higher orders are very smooth,
+  // they can be computed with a lower resolution, which is much faster, and
+  // then upsampled in the final textures with a small error. The
+  // transmittance, the single scattering and the final textures always use
+  // the resolution passed to the constructor, which is also the default for
+  // all the orders. Must be called before Init.
+  void set_scattering_order_resolutions(
+      const std::vector<TextureResolution>& resolutions);
+
+  // If 'convergence_tolerance' is positive, 'num_scattering_orders' is a
+  // maximum, and the precomputation stops as soon as the indirect irradiance
+  // added by a scattering order, relatively to the total indirect irradiance,
+  // is less than this tolerance.
+  void Init(unsigned int num_scattering_orders = 4,
+      double convergence_tolerance = 0.0);
+
+  // Changes the solar irradiance (sampled at the wavelengths passed to the
+  // constructor), and updates the precomputed textures accordingly, if Init
+  // has been called. With precomputed irradiance values (see
+  // num_precomputed_wavelengths), these textures are linear in the solar
+  // irradiance at kLambdaR, kLambdaG and kLambdaB, and are simply rescaled on
+  // GPU (unless the previous solar irradiance is 0 at one of these
+  // wavelengths). With precomputed illuminance values, each texture channel
+  // integrates many wavelengths, and Init is called again instead (with the
+  // arguments of its last call). In both cases the shader is recompiled with
+  // the new solar irradiance, and the programs linked with it must thus be
+  // linked again.
+  void SetSolarIrradiance(const std::vector<double>& solar_irradiance);
+
+  // The number of scattering orders computed by the last call to Init.
+  unsigned int num_scattering_orders() const { return num_scattering_orders_; }
+
+  // The duration of each phase of the last call to Init. The GPU time of each
+  // phase is measured with OpenGL timer queries, while its wall time only
+  // measures the time needed to submit its OpenGL commands.
+  const PrecomputeProfile& profile() const { return profile_; }
+
+  // The resolution of the precomputed textures.
+  const TextureResolution& texture_resolution() const {
+    return texture_resolution_;
+  }
 
   GLuint shader() const { return atmosphere_shader_; }
 
@@ -311,7 +367,7 @@ class Model {
   typedef std::array<double, 3> vec3;
   typedef std::array<float, 9> mat3;
 
-  void Precompute(
+  unsigned int Precompute(
       GLuint fbo,
       GLuint delta_irradiance_texture,
       GLuint delta_rayleigh_scattering_texture,
@@ -321,16 +377,33 @@ class Model {
       const vec3& lambdas,
       const mat3& luminance_from_radiance,
       bool blend,
-      unsigned int num_scattering_orders);
+      unsigned int num_scattering_orders,
+      double convergence_tolerance);
+
+  TextureResolution GetScatteringOrderResolution(
+      unsigned int scattering_order) const;
+  void RescaleTextures(const vec3& scale);
+  void CompileAtmosphereShader();
 
+  std::vector<double> wavelengths_;
+  std::vector<double> solar_irradiance_;
   unsigned int num_precomputed_wavelengths_;
   bool half_precision_;
+  TextureResolution texture_resolution_;
+  std::vector<TextureResolution> scattering_order_resolutions_;
+  unsigned int num_scattering_orders_;
+  // The arguments of the last call to Init.
+  unsigned int requested_num_scattering_orders_;
+  double requested_convergence_tolerance_;
+  PrecomputeProfile profile_;
   bool rgb_format_supported_;
-  std::function<std::string(const vec3&)> glsl_header_factory_;
+  std::function<std::string(const vec3&, const TextureResolution&)>
+      glsl_header_factory_;
   GLuint transmittance_texture_;
   GLuint scattering_texture_;
   GLuint optional_single_mie_scattering_texture_;
   GLuint irradiance_texture_;
+  GLuint spherical_samples_texture_;
   GLuint atmosphere_shader_;
   GLuint full_screen_quad_vao_;
   GLuint full_screen_quad_vbo_;
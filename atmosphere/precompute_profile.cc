@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/precompute_profile.cc</h2>
+
+<p>This file implements the precomputation profile defined in
+<a href="precompute_profile.h.html">precompute_profile.h</a>. The JSON output
+has the following structure (all times are in seconds, the GPU times are only
+present for the GPU model, and the thread utilization values - the fraction of
+the wall time spent by each worker thread in the phase - for the CPU model). The
+scheduling overhead of a phase is the part of its wall time which is not spent
+by its busiest thread, i.e. the time needed to start and stop the workers, and
+to distribute the tiles):
+<pre>
+{
+  "total_wall_time": 12.5,
+  "total_gpu_time": 11.9,
+  "total_scheduling_overhead": 0.002,
+  "phases": [
+    {"name": "transmittance", "scattering_order": 0, "num_texels": 16384,
+     "wall_time": 0.01, "gpu_time": 0.009, "thread_utilization": [...],
+     "scheduling_overhead": 0.0001},
+    ...
+  ],
+  "scattering_orders": [
+    {"scattering_order": 1, "wall_time": 0.8, "gpu_time": 0.7},
+    ...
+  ]
+}
+</pre>
+*/
+
+#include "atmosphere/precompute_profile.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace atmosphere {
+
+namespace {
+
+struct OrderTimes {
+  OrderTimes() : wall_time(0.0), gpu_time(0.0) {}
+  double wall_time;
+  double gpu_time;
+};
+
+std::string ToJsonString(const std::string& s) {
+  std::string result = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result + "\"";
+}
+
+double GetSchedulingOverhead(const PrecomputePhase& phase) {
+  if (phase.thread_busy_times.empty()) {
+    return 0.0;
+  }
+  return std::max(phase.wall_time - *std::max_element(
+      phase.thread_busy_times.begin(), phase.thread_busy_times.end()), 0.0);
+}
+
+}  // anonymous namespace
+
+double PrecomputeProfile::GetTotalWallTime() const {
+  double total = 0.0;
+  for (const PrecomputePhase& phase : phases_) {
+    total += phase.wall_time;
+  }
+  return total;
+}
+
+double PrecomputeProfile::GetTotalGpuTime() const {
+  double total = 0.0;
+  for (const PrecomputePhase& phase : phases_) {
+    total += std::max(phase.gpu_time, 0.0);
+  }
+  return total;
+}
+
+std::string PrecomputeProfile::ToJson() const {
+  bool has_gpu_times = false;
+  bool has_thread_busy_times = false;
+  double total_scheduling_overhead = 0.0;
+  std::map<unsigned int, OrderTimes> order_times;
+  for (const PrecomputePhase& phase : phases_) {
+    has_gpu_times |= phase.gpu_time >= 0.0;
+    has_thread_busy_times |= !phase.thread_busy_times.empty();
+    total_scheduling_overhead += GetSchedulingOverhead(phase);
+    if (phase.scattering_order > 0) {
+      OrderTimes& times = order_times[phase.scattering_order];
+      times.wall_time += phase.wall_time;
+      times.gpu_time += std::max(phase.gpu_time, 0.0);
+    }
+  }
+
+  std::ostringstream json;
+  json.precision(6);
+  json << "{\n  \"total_wall_time\": " << GetTotalWallTime() << ",\n";
+  if (has_gpu_times) {
+    json << "  \"total_gpu_time\": " << GetTotalGpuTime() << ",\n";
+  }
+  if (has_thread_busy_times) {
+    json << "  \"total_scheduling_overhead\": " << total_scheduling_overhead
+         << ",\n";
+  }
+  json << "  \"phases\": [";
+  for (unsigned int i = 0; i < phases_.size(); ++i) {
+    const PrecomputePhase& phase = phases_[i];
+    json << (i == 0 ? "\n" : ",\n") << "    {\"name\": "
+         << ToJsonString(phase.name) << ", \"scattering_order\": "
+         << phase.scattering_order << ", \"num_texels\": " << phase.num_texels
+         << ", \"wall_time\": " << phase.wall_time;
+    if (phase.gpu_time >= 0.0) {
+      json << ", \"gpu_time\": " << phase.gpu_time;
+    }
+    if (!phase.thread_busy_times.empty()) {
+      json << ", \"thread_utilization\": [";
+      for (unsigned int j = 0; j < phase.thread_busy_times.size(); ++j) {
+        json << (j == 0 ? "" : ", ") << (phase.wall_time > 0.0 ?
+            phase.thread_busy_times[j] / phase.wall_time : 0.0);
+      }
+      json << "], \"scheduling_overhead\": " << GetSchedulingOverhead(phase);
+    }
+    json << "}";
+  }
+  json << "\n  ],\n  \"scattering_orders\": [";
+  bool first = true;
+  for (const auto& entry : order_times) {
+    json << (first ? "\n" : ",\n") << "    {\"scattering_order\": "
+         << entry.first << ", \"wall_time\": " << entry.second.wall_time;
+    if (has_gpu_times) {
+      json << ", \"gpu_time\": " << entry.second.gpu_time;
+    }
+    json << "}";
+    first = false;
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+}  // namespace atmosphere
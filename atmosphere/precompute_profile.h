@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/precompute_profile.h</h2>
+
+<p>This file defines a simple profile of the precomputations done by the
+<a href="model.h.html">GPU model</a> and by the
+<a href="reference/model.h.html">CPU model</a>. It records, for each
+precomputation phase (e.g. the computation of the scattering density for a given
+scattering order):
+<ul>
+<li>its wall time,</li>
+<li>its GPU time (measured with OpenGL timer queries, for the GPU model
+only),</li>
+<li>the number of texels it computes,</li>
+<li>the time spent by each worker thread in this phase (for the CPU model only).
+</li>
+</ul>
+A profile can be converted to JSON, with a summary per scattering order, to
+track the precomputation cost over time (e.g. in continuous integration).
+*/
+
+#ifndef ATMOSPHERE_PRECOMPUTE_PROFILE_H_
+#define ATMOSPHERE_PRECOMPUTE_PROFILE_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace atmosphere {
+
+struct PrecomputePhase {
+  PrecomputePhase(const std::string& name, unsigned int scattering_order,
+      unsigned int num_texels)
+      : name(name), scattering_order(scattering_order),
+        num_texels(num_texels), wall_time(0.0), gpu_time(-1.0) {}
+
+  std::string name;
+  // The scattering order computed by this phase, or 0 if not applicable.
+  unsigned int scattering_order;
+  unsigned int num_texels;
+  // In seconds.
+  double wall_time;
+  // In seconds, or a negative value if not measured.
+  double gpu_time;
+  // The time spent in this phase by each worker thread, in seconds.
+  std::vector<double> thread_busy_times;
+};
+
+class PrecomputeProfile {
+ public:
+  void Clear() { phases_.clear(); }
+  void AddPhase(const PrecomputePhase& phase) { phases_.push_back(phase); }
+
+  const std::vector<PrecomputePhase>& phases() const { return phases_; }
+  PrecomputePhase& last_phase() { return phases_.back(); }
+
+  // The sum of the phase wall times. Note that the CPU model runs some phases
+  // concurrently, in which case this sum is larger than the elapsed time.
+  double GetTotalWallTime() const;
+  double GetTotalGpuTime() const;
+
+  std::string ToJson() const;
+
+ private:
+  std::vector<PrecomputePhase> phases_;
+};
+
+// A simple stopwatch, to measure the wall time of the precomputation phases.
+class Stopwatch {
+ public:
+  Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+
+  // Returns the elapsed time since the construction of this object, in
+  // seconds.
+  double GetElapsedTime() const {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_PRECOMPUTE_PROFILE_H_
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/precompute_profile_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="precompute_profile.h.html">
+precomputation profile</a> of the GPU and CPU models.
+*/
+
+#include "atmosphere/precompute_profile.h"
+
+#include <string>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+
+class PrecomputeProfileTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  PrecomputeProfileTest(const std::string& name, T test)
+      : TestCase("PrecomputeProfileTest " + name, static_cast<Test>(test)) {}
+
+  void TestTotals() {
+    PrecomputeProfile profile;
+    AddPhase(&profile, "transmittance", 0, 1.0, -1.0);
+    AddPhase(&profile, "single_scattering", 1, 2.0, 1.5);
+    AddPhase(&profile, "scattering_density", 2, 4.0, 3.5);
+    ExpectNear(7.0, profile.GetTotalWallTime(), 1e-12);
+    ExpectNear(5.0, profile.GetTotalGpuTime(), 1e-12);
+    profile.Clear();
+    ExpectEquals(0, profile.phases().size());
+  }
+
+  void TestToJson() {
+    PrecomputeProfile profile;
+    AddPhase(&profile, "scattering_density", 2, 4.0, -1.0);
+    AddPhase(&profile, "multiple_scattering", 2, 0.5, -1.0);
+    profile.last_phase().thread_busy_times = {0.5, 0.25};
+    const std::string json = profile.ToJson();
+    ExpectTrue(json.find("\"total_wall_time\": 4.5") != std::string::npos);
+    ExpectTrue(json.find("\"name\": \"scattering_density\"") !=
+        std::string::npos);
+    ExpectTrue(json.find("\"thread_utilization\": [1, 0.5]") !=
+        std::string::npos);
+    // The busiest thread is busy during the whole phase.
+    ExpectTrue(json.find("\"total_scheduling_overhead\": 0,") !=
+        std::string::npos);
+    ExpectTrue(json.find(
+        "{\"scattering_order\": 2, \"wall_time\": 4.5}") != std::string::npos);
+    // No GPU times were measured.
+    ExpectTrue(json.find("gpu_time") == std::string::npos);
+  }
+
+ private:
+  void AddPhase(PrecomputeProfile* profile, const std::string& name,
+      unsigned int scattering_order, double wall_time, double gpu_time) {
+    PrecomputePhase phase(name, scattering_order, 100);
+    phase.wall_time = wall_time;
+    phase.gpu_time = gpu_time;
+    profile->AddPhase(phase);
+  }
+};
+
+namespace {
+
+PrecomputeProfileTest totals(
+    "Totals",
+    &PrecomputeProfileTest::TestTotals);
+PrecomputeProfileTest to_json(
+    "ToJson",
+    &PrecomputeProfileTest::TestToJson);
+
+}  // anonymous namespace
+
+}  // namespace atmosphere
@@ -0,0 +1,410 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/atmosphere_config.cc</h2>
+
+<p>This file implements the config file format defined in
+<a href="atmosphere_config.h.html">atmosphere_config.h</a>.
+*/
+
+#include "atmosphere/reference/atmosphere_config.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+// The wavelength range of the following input spectra, in nanometers, which
+// are given every 10 nanometers (and which are resampled to the wavelengths of
+// the model in GetAtmosphereParameters).
+constexpr int kInputLambdaMin = 360;
+constexpr int kInputLambdaMax = 830;
+
+// Values from "Reference Solar Spectral Irradiance: ASTM G-173", ETR column
+// (see http://rredc.nrel.gov/solar/spectra/am1.5/ASTMG173/ASTMG173.html),
+// summed and averaged in each bin (e.g. the value for 360nm is the average
+// of the ASTM G-173 values for all wavelengths between 360 and 370nm).
+// Values in W.m^-2.
+constexpr double kSolarIrradiance[48] = {
+  1.11776, 1.14259, 1.01249, 1.14716, 1.72765, 1.73054, 1.6887, 1.61253,
+  1.91198, 2.03474, 2.02042, 2.02212, 1.93377, 1.95809, 1.91686, 1.8298,
+  1.8685, 1.8931, 1.85149, 1.8504, 1.8341, 1.8345, 1.8147, 1.78158, 1.7533,
+  1.6965, 1.68194, 1.64654, 1.6048, 1.52143, 1.55622, 1.5113, 1.474, 1.4482,
+  1.41018, 1.36775, 1.34188, 1.31429, 1.28303, 1.26758, 1.2367, 1.2082,
+  1.18737, 1.14683, 1.12362, 1.1058, 1.07124, 1.04992
+};
+
+// Values from http://www.iup.uni-bremen.de/gruppen/molspec/databases/
+// referencespectra/o3spectra2011/index.html for 233K, summed and averaged
+// in each bin (e.g. the value for 360nm is the average of the original
+// values for all wavelengths between 360 and 370nm). Values in m^2.
+constexpr double kOzoneCrossSection[48] = {
+  1.18e-27, 2.182e-28, 2.818e-28, 6.636e-28, 1.527e-27, 2.763e-27, 5.52e-27,
+  8.451e-27, 1.582e-26, 2.316e-26, 3.669e-26, 4.924e-26, 7.752e-26,
+  9.016e-26, 1.48e-25, 1.602e-25, 2.139e-25, 2.755e-25, 3.091e-25, 3.5e-25,
+  4.266e-25, 4.672e-25, 4.398e-25, 4.701e-25, 5.019e-25, 4.305e-25,
+  3.74e-25, 3.215e-25, 2.662e-25, 2.238e-25, 1.852e-25, 1.473e-25,
+  1.209e-25, 9.423e-26, 7.455e-26, 6.566e-26, 5.105e-26, 4.15e-26,
+  4.228e-26, 3.237e-26, 2.451e-26, 2.801e-26, 2.534e-26, 1.624e-26,
+  1.465e-26, 2.078e-26, 1.383e-26, 7.105e-27
+};
+
+// From https://en.wikipedia.org/wiki/Dobson_unit, in molecules.m^-2.
+constexpr dimensional::Scalar<-2, 0, 0, 0, 0> kDobsonUnit = 2.687e20 / m2;
+
+// Maximum number density of ozone molecules, in m^-3 (computed so at to get
+// 300 Dobson units of ozone - for this we divide 300 DU by the integral of
+// the ozone density profile defined below, which is equal to 15km).
+constexpr NumberDensity kMaxOzoneNumberDensity =
+    300.0 * kDobsonUnit / (15.0 * km);
+
+std::string Trim(const std::string& s) {
+  const char* kWhitespaces = " \t\r\n";
+  size_t begin = s.find_first_not_of(kWhitespaces);
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = s.find_last_not_of(kWhitespaces);
+  return s.substr(begin, end - begin + 1);
+}
+
+bool ParseDouble(const std::string& value, double* result) {
+  char* end;
+  *result = std::strtod(value.c_str(), &end);
+  return !value.empty() && *end == '\0' && std::isfinite(*result);
+}
+
+bool ParseUnsignedInt(const std::string& value, unsigned int* result) {
+  char* end;
+  long int_value = std::strtol(value.c_str(), &end, 10);
+  *result = static_cast<unsigned int>(int_value);
+  return !value.empty() && *end == '\0' && int_value >= 1 &&
+      int_value <= 1000;
+}
+
+// Parses a list of space separated integers (e.g. texture sizes).
+bool ParseIntegers(const std::string& value,
+    std::initializer_list<int*> results) {
+  std::istringstream input(value);
+  for (int* result : results) {
+    std::string size;
+    unsigned int int_size;
+    if (!(input >> size) || !ParseUnsignedInt(size, &int_size)) {
+      return false;
+    }
+    *result = static_cast<int>(int_size);
+  }
+  std::string extra;
+  return !(input >> extra);
+}
+
+bool ParseQuadratureRule(const std::string& value, int* result) {
+  if (value == "trapezoidal") {
+    *result = TRAPEZOIDAL_RULE;
+  } else if (value == "gauss_legendre") {
+    *result = GAUSS_LEGENDRE_RULE;
+  } else if (value == "adaptive_simpson") {
+    *result = ADAPTIVE_SIMPSON_RULE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseSphericalQuadratureRule(const std::string& value, int* result) {
+  if (value == "latitude_longitude") {
+    *result = LATITUDE_LONGITUDE_RULE;
+  } else if (value == "fibonacci") {
+    *result = FIBONACCI_RULE;
+  } else if (value == "lebedev") {
+    *result = LEBEDEV_RULE;
+  } else if (value == "importance_sampling") {
+    *result = IMPORTANCE_SAMPLING_RULE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseBool(const std::string& value, bool* result) {
+  *result = value == "true";
+  return value == "true" || value == "false";
+}
+
+bool ParsePrecision(const std::string& value, TexturePrecision* result) {
+  if (value == "float64") {
+    *result = FLOAT64;
+  } else if (value == "float32") {
+    *result = FLOAT32;
+  } else if (value == "float16") {
+    *result = FLOAT16;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseWavelengths(const std::string& value, std::vector<int>* result) {
+  if (value == "all") {
+    result->clear();
+  } else if (value == "rgb") {
+    // The indices of the 680, 550 and 440 nm wavelengths.
+    *result = {GetNearestWavelengthIndex(680.0),
+        GetNearestWavelengthIndex(550.0), GetNearestWavelengthIndex(440.0)};
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+AtmosphereConfig::AtmosphereConfig()
+    : sun_angular_radius(0.2678),
+      bottom_radius(6360.0),
+      top_radius(6420.0),
+      rayleigh(1.24062e-6),
+      rayleigh_scale_height(8000.0),
+      mie_scale_height(1200.0),
+      mie_angstrom_alpha(0.0),
+      mie_angstrom_beta(5.328e-3),
+      mie_single_scattering_albedo(0.9),
+      mie_phase_function_g(0.8),
+      use_ozone(true),
+      ground_albedo(0.1),
+      max_sun_zenith_angle(102.0),
+      num_scattering_orders(4),
+      convergence_tolerance(0.0) {}
+
+bool ParseAtmosphereConfig(std::istream& input, AtmosphereConfig* config,
+    std::string* error) {
+  typedef std::function<bool(const std::string&)> Parser;
+  TextureResolution* resolution = &config->texture_resolution;
+  Quadrature* quadrature = &config->quadrature;
+  auto number = [](double* field) {
+    return Parser([field](const std::string& v) {
+      return ParseDouble(v, field);
+    });
+  };
+  const std::map<std::string, Parser> parsers = {
+    {"sun_angular_radius", number(&config->sun_angular_radius)},
+    {"bottom_radius", number(&config->bottom_radius)},
+    {"top_radius", number(&config->top_radius)},
+    {"rayleigh", number(&config->rayleigh)},
+    {"rayleigh_scale_height", number(&config->rayleigh_scale_height)},
+    {"mie_scale_height", number(&config->mie_scale_height)},
+    {"mie_angstrom_alpha", number(&config->mie_angstrom_alpha)},
+    {"mie_angstrom_beta", number(&config->mie_angstrom_beta)},
+    {"mie_single_scattering_albedo",
+        number(&config->mie_single_scattering_albedo)},
+    {"mie_phase_function_g", number(&config->mie_phase_function_g)},
+    {"use_ozone", [config](const std::string& v) {
+      return ParseBool(v, &config->use_ozone);
+    }},
+    {"ground_albedo", number(&config->ground_albedo)},
+    {"max_sun_zenith_angle", number(&config->max_sun_zenith_angle)},
+    {"num_scattering_orders", [config](const std::string& v) {
+      return ParseUnsignedInt(v, &config->num_scattering_orders);
+    }},
+    {"convergence_tolerance", number(&config->convergence_tolerance)},
+    {"transmittance_texture_size", [resolution](const std::string& v) {
+      return ParseIntegers(v, {&resolution->transmittance_width,
+          &resolution->transmittance_height});
+    }},
+    {"scattering_texture_size", [resolution](const std::string& v) {
+      return ParseIntegers(v, {&resolution->scattering_r_size,
+          &resolution->scattering_mu_size, &resolution->scattering_mu_s_size,
+          &resolution->scattering_nu_size});
+    }},
+    {"irradiance_texture_size", [resolution](const std::string& v) {
+      return ParseIntegers(v, {&resolution->irradiance_width,
+          &resolution->irradiance_height});
+    }},
+    {"quadrature_rule", [quadrature](const std::string& v) {
+      return ParseQuadratureRule(v, &quadrature->rule);
+    }},
+    {"quadrature_sample_counts", [quadrature](const std::string& v) {
+      return ParseIntegers(v, {&quadrature->transmittance_sample_count,
+          &quadrature->single_scattering_sample_count,
+          &quadrature->multiple_scattering_sample_count});
+    }},
+    {"spherical_quadrature_rule", [quadrature](const std::string& v) {
+      return ParseSphericalQuadratureRule(v, &quadrature->spherical_rule);
+    }},
+    {"spherical_quadrature_sample_counts",
+        [quadrature](const std::string& v) {
+      return ParseIntegers(v, {&quadrature->scattering_density_sample_count,
+          &quadrature->indirect_irradiance_sample_count});
+    }},
+    {"output_directory", [config](const std::string& v) {
+      config->output_directory = v;
+      return !v.empty();
+    }},
+    {"precision", [config](const std::string& v) {
+      return ParsePrecision(v, &config->output_format.precision);
+    }},
+    {"wavelengths", [config](const std::string& v) {
+      return ParseWavelengths(v, &config->output_format.wavelengths);
+    }}
+  };
+
+  std::string line;
+  for (int line_number = 1; std::getline(input, line); ++line_number) {
+    line = Trim(line.substr(0, line.find('#')));
+    if (line.empty()) {
+      continue;
+    }
+    const size_t separator = line.find('=');
+    if (separator == std::string::npos) {
+      *error = "line " + std::to_string(line_number) + ": expected key = value";
+      return false;
+    }
+    const std::string key = Trim(line.substr(0, separator));
+    const std::string value = Trim(line.substr(separator + 1));
+    auto parser = parsers.find(key);
+    if (parser == parsers.end()) {
+      *error = "line " + std::to_string(line_number) + ": unknown key '" +
+          key + "'";
+      return false;
+    }
+    if (!parser->second(value)) {
+      *error = "line " + std::to_string(line_number) + ": invalid value '" +
+          value + "' for key '" + key + "'";
+      return false;
+    }
+  }
+  if (config->top_radius <= config->bottom_radius) {
+    *error = "top_radius must be larger than bottom_radius";
+    return false;
+  }
+  if (!resolution->IsValid()) {
+    *error = "texture sizes must be at least 2, and the scattering mu size "
+        "must be even";
+    return false;
+  }
+  if (!quadrature->IsValid()) {
+    *error = "spherical_quadrature_sample_counts must be at least 2 and 4, or "
+        "a Lebedev rule order with the lebedev rule";
+    return false;
+  }
+  return true;
+}
+
+bool ReadAtmosphereConfig(const std::string& filename,
+    AtmosphereConfig* config, std::string* error) {
+  std::ifstream input(filename);
+  if (!input) {
+    *error = filename + ": cannot open file";
+    return false;
+  }
+  if (!ParseAtmosphereConfig(input, config, error)) {
+    *error = filename + ": " + *error;
+    return false;
+  }
+  const size_t slash = filename.find_last_of('/');
+  const std::string directory =
+      slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+  std::string& output_directory = config->output_directory;
+  if (output_directory.empty() || output_directory[0] != '/') {
+    output_directory = directory + output_directory;
+  }
+  if (!output_directory.empty() && output_directory.back() != '/') {
+    output_directory += '/';
+  }
+  return true;
+}
+
+AtmosphereParameters GetAtmosphereParameters(const AtmosphereConfig& config) {
+  const ScatteringCoefficient rayleigh = config.rayleigh / m;
+  const Length rayleigh_scale_height = config.rayleigh_scale_height * m;
+  const Length mie_scale_height = config.mie_scale_height * m;
+
+  std::vector<SpectralIrradiance> solar_irradiance;
+  std::vector<ScatteringCoefficient> rayleigh_scattering;
+  std::vector<ScatteringCoefficient> mie_scattering;
+  std::vector<ScatteringCoefficient> mie_extinction;
+  std::vector<ScatteringCoefficient> absorption_extinction;
+  for (int l = kInputLambdaMin; l <= kInputLambdaMax; l += 10) {
+    double lambda = static_cast<double>(l) * 1e-3;  // micro-meters
+    ScatteringCoefficient mie = config.mie_angstrom_beta / mie_scale_height *
+        pow(lambda, -config.mie_angstrom_alpha);
+    solar_irradiance.push_back(kSolarIrradiance[(l - kInputLambdaMin) / 10] *
+        watt_per_square_meter_per_nm);
+    rayleigh_scattering.push_back(rayleigh * pow(lambda, -4));
+    mie_scattering.push_back(mie * config.mie_single_scattering_albedo);
+    mie_extinction.push_back(mie);
+    absorption_extinction.push_back(config.use_ozone ?
+        kMaxOzoneNumberDensity *
+            kOzoneCrossSection[(l - kInputLambdaMin) / 10] * m2 :
+        0.0 / m);
+  }
+
+  AtmosphereParameters atmosphere;
+  atmosphere.solar_irradiance = ResampleSpectrum<IrradianceSpectrum>(
+      kInputLambdaMin * nm, kInputLambdaMax * nm, solar_irradiance);
+  atmosphere.sun_angular_radius = config.sun_angular_radius * deg;
+  atmosphere.bottom_radius = config.bottom_radius * km;
+  atmosphere.top_radius = config.top_radius * km;
+  atmosphere.rayleigh_density.layers[1] = DensityProfileLayer(
+      0.0 * m, 1.0, -1.0 / rayleigh_scale_height, 0.0 / m, 0.0);
+  atmosphere.rayleigh_scattering = ResampleSpectrum<ScatteringSpectrum>(
+      kInputLambdaMin * nm, kInputLambdaMax * nm, rayleigh_scattering);
+  atmosphere.mie_density.layers[1] = DensityProfileLayer(
+      0.0 * m, 1.0, -1.0 / mie_scale_height, 0.0 / m, 0.0);
+  atmosphere.mie_scattering = ResampleSpectrum<ScatteringSpectrum>(
+      kInputLambdaMin * nm, kInputLambdaMax * nm, mie_scattering);
+  atmosphere.mie_extinction = ResampleSpectrum<ScatteringSpectrum>(
+      kInputLambdaMin * nm, kInputLambdaMax * nm, mie_extinction);
+  atmosphere.mie_phase_function_g = config.mie_phase_function_g;
+  // Density profile increasing linearly from 0 to 1 between 10 and 25km, and
+  // decreasing linearly from 1 to 0 between 25 and 40km.
+  atmosphere.absorption_density.layers[0] = DensityProfileLayer(
+      25.0 * km, 0.0, 0.0 / km, 1.0 / (15.0 * km), -2.0 / 3.0);
+  atmosphere.absorption_density.layers[1] = DensityProfileLayer(
+      0.0 * km, 0.0, 0.0 / km, -1.0 / (15.0 * km), 8.0 / 3.0);
+  atmosphere.absorption_extinction = ResampleSpectrum<ScatteringSpectrum>(
+      kInputLambdaMin * nm, kInputLambdaMax * nm, absorption_extinction);
+  atmosphere.ground_albedo = DimensionlessSpectrum(config.ground_albedo);
+  atmosphere.mu_s_min = cos(config.max_sun_zenith_angle * deg);
+  atmosphere.texture_resolution = config.texture_resolution;
+  atmosphere.quadrature = config.quadrature;
+  return atmosphere;
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/atmosphere_config.h</h2>
+
+<p>This file defines a simple text format to specify the parameters of the
+<a href="model.h.html">CPU model</a>, which is used by the
+<a href="precompute_main.cc.html">precompute tool</a>. A config file contains
+one <code>key = value</code> pair per line (empty lines and text after a
+<code>#</code> are ignored). The physical keys are the same as the parameters of
+the <a href="../demo/demo.h.html">demo</a>, and the atmosphere parameters are
+derived from them in the same way as in the <a href="model_test.cc.html">model
+tests</a>:
+<ul>
+<li><code>sun_angular_radius</code>, in degrees,</li>
+<li><code>bottom_radius</code> and <code>top_radius</code>, in kilometers,</li>
+<li><code>rayleigh</code> (the Rayleigh scattering coefficient at 1&mu;m, in
+m<sup>-1</sup>) and <code>rayleigh_scale_height</code> (in meters),</li>
+<li><code>mie_scale_height</code> (in meters), <code>mie_angstrom_alpha</code>,
+<code>mie_angstrom_beta</code>, <code>mie_single_scattering_albedo</code> and
+<code>mie_phase_function_g</code>,</li>
+<li><code>use_ozone</code> (<code>true</code> or <code>false</code>),</li>
+<li><code>ground_albedo</code>,</li>
+<li><code>max_sun_zenith_angle</code>, in degrees,</li>
+<li><code>num_scattering_orders</code>,</li>
+<li><code>convergence_tolerance</code> (if positive, the number of scattering
+orders is adapted to the atmosphere, up to <code>num_scattering_orders</code> -
+see <code>Model::Init</code>),</li>
+<li><code>transmittance_texture_size</code> (width and height),
+<code>scattering_texture_size</code> (r, mu, mu_s and nu sizes) and
+<code>irradiance_texture_size</code> (width and height), as space separated
+integers, e.g. <code>scattering_texture_size = 16 64 16 4</code> (see
+<code>TextureResolution</code> in
+<a href="../constants.h.html">constants.h</a>),</li>
+<li><code>quadrature_rule</code>, <code>trapezoidal</code>,
+<code>gauss_legendre</code> or <code>adaptive_simpson</code>, and
+<code>quadrature_sample_counts</code> (transmittance, single scattering and
+multiple scattering sample counts), as space separated integers,</li>
+<li><code>spherical_quadrature_rule</code>, <code>latitude_longitude</code>,
+<code>fibonacci</code>, <code>lebedev</code> or
+<code>importance_sampling</code>, and
+<code>spherical_quadrature_sample_counts</code> (scattering density and
+indirect irradiance direction counts), as space separated integers (see
+<code>Quadrature</code> in <a href="../constants.h.html">constants.h</a>).</li>
+</ul>
+The other keys specify where and how the precomputed textures are saved:
+<ul>
+<li><code>output_directory</code>, where the textures are saved, in the
+<a href="texture_cache.h.html">cache format</a> of the CPU model (relative
+paths are relative to the directory containing the config file),</li>
+<li><code>precision</code>, <code>float64</code>, <code>float32</code> or
+<code>float16</code>,</li>
+<li><code>wavelengths</code>, <code>all</code> or <code>rgb</code>.</li>
+</ul>
+All the keys are optional, and default to the values used in the demo.
+
+<p>The input spectra of the atmosphere parameters (solar irradiance, scattering
+and absorption coefficients) are given every 10 nanometers between 360 and 830
+nanometers, and are resampled to the wavelengths of the CPU model (see
+<a href="definitions.h.html">definitions.h</a>) with the following function.
+When the model wavelengths are less dense than the input samples, each model
+value is the average of the input spectrum over the interval covered by its
+wavelength, instead of a single interpolated value, so that narrow spectral
+features are not missed (or overweighted) with a small number of wavelengths.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_ATMOSPHERE_CONFIG_H_
+#define ATMOSPHERE_REFERENCE_ATMOSPHERE_CONFIG_H_
+
+#include <cmath>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/texture_cache.h"
+
+namespace atmosphere {
+namespace reference {
+
+struct AtmosphereConfig {
+  AtmosphereConfig();
+
+  double sun_angular_radius;
+  double bottom_radius;
+  double top_radius;
+  double rayleigh;
+  double rayleigh_scale_height;
+  double mie_scale_height;
+  double mie_angstrom_alpha;
+  double mie_angstrom_beta;
+  double mie_single_scattering_albedo;
+  double mie_phase_function_g;
+  bool use_ozone;
+  double ground_albedo;
+  double max_sun_zenith_angle;
+  unsigned int num_scattering_orders;
+  double convergence_tolerance;
+  TextureResolution texture_resolution;
+  Quadrature quadrature;
+
+  std::string output_directory;
+  TextureCacheFormat output_format;
+};
+
+// Parses the given config, and updates the corresponding fields of 'config'.
+// Returns false and sets 'error' if the config contains an unknown key or an
+// invalid value.
+bool ParseAtmosphereConfig(std::istream& input, AtmosphereConfig* config,
+    std::string* error);
+
+// Reads and parses the given config file. The output directory is resolved
+// relatively to the directory containing this file.
+bool ReadAtmosphereConfig(const std::string& filename,
+    AtmosphereConfig* config, std::string* error);
+
+// Returns the spectrum, at the wavelengths of the CPU model, corresponding to
+// the given samples, uniformly distributed between 'lambda_min' and
+// 'lambda_max' and linearly interpolated (see above).
+template<class S, class T>
+S ResampleSpectrum(Wavelength lambda_min, Wavelength lambda_max,
+    const std::vector<T>& samples) {
+  const double input_min = lambda_min.to(nm);
+  const double input_step =
+      (lambda_max.to(nm) - input_min) / (samples.size() - 1);
+  const double step =
+      static_cast<double>(kLambdaMax - kLambdaMin) / (kNumWavelengths - 1);
+  if (step <= input_step) {
+    return S(lambda_min, lambda_max, samples);
+  }
+  auto sample = [&](double lambda) {
+    const double x = (lambda - input_min) / input_step;
+    if (x <= 0.0) {
+      return samples.front();
+    } else if (x >= samples.size() - 1) {
+      return samples.back();
+    }
+    const int i = static_cast<int>(std::floor(x));
+    return samples[i] * (1.0 - (x - i)) + samples[i + 1] * (x - i);
+  };
+  constexpr int kNumSubSamples = 16;
+  S result;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    const double lambda = kLambdaMin + l * step;
+    T sum = samples.front() * 0.0;
+    for (int k = 0; k < kNumSubSamples; ++k) {
+      sum = sum + sample(lambda + step * ((k + 0.5) / kNumSubSamples - 0.5));
+    }
+    result[l] = sum * (1.0 / kNumSubSamples);
+  }
+  return result;
+}
+
+// Returns the CPU model parameters corresponding to the given config.
+AtmosphereParameters GetAtmosphereParameters(const AtmosphereConfig& config);
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_ATMOSPHERE_CONFIG_H_
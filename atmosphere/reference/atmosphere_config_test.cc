@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/atmosphere_config_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="atmosphere_config.h.html">
+config file format</a> of the CPU model parameters.
+*/
+
+#include "atmosphere/reference/atmosphere_config.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+class AtmosphereConfigTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  AtmosphereConfigTest(const std::string& name, T test)
+      : TestCase("AtmosphereConfigTest " + name, static_cast<Test>(test)) {}
+
+  void TestParse() {
+    std::istringstream input(
+        "# Mars-like atmosphere.\n"
+        "\n"
+        "bottom_radius = 3390  # km\n"
+        "top_radius=3490\n"
+        "  use_ozone = false\n"
+        "mie_phase_function_g = 0.7\n"
+        "num_scattering_orders = 6\n"
+        "convergence_tolerance = 1e-3\n"
+        "output_directory = mars\n"
+        "precision = float16\n"
+        "wavelengths = rgb\n"
+        "scattering_texture_size = 16 64 16 4\n"
+        "quadrature_rule = gauss_legendre\n"
+        "quadrature_sample_counts = 32 16 8\n"
+        "spherical_quadrature_rule = lebedev\n"
+        "spherical_quadrature_sample_counts = 110 50\n");
+    AtmosphereConfig config;
+    std::string error;
+    ExpectTrue(ParseAtmosphereConfig(input, &config, &error));
+    ExpectEquals(3390.0, config.bottom_radius);
+    ExpectEquals(3490.0, config.top_radius);
+    ExpectFalse(config.use_ozone);
+    ExpectEquals(0.7, config.mie_phase_function_g);
+    ExpectEquals(6, config.num_scattering_orders);
+    ExpectEquals(1e-3, config.convergence_tolerance);
+    ExpectTrue(config.output_directory == "mars");
+    ExpectTrue(config.output_format.precision == FLOAT16);
+    ExpectEquals(3, config.output_format.wavelengths.size());
+    ExpectEquals(16, config.texture_resolution.scattering_r_size);
+    ExpectEquals(64, config.texture_resolution.scattering_mu_size);
+    ExpectEquals(16, config.texture_resolution.scattering_mu_s_size);
+    ExpectEquals(4, config.texture_resolution.scattering_nu_size);
+    ExpectEquals(GAUSS_LEGENDRE_RULE, config.quadrature.rule);
+    ExpectEquals(32, config.quadrature.transmittance_sample_count);
+    ExpectEquals(16, config.quadrature.single_scattering_sample_count);
+    ExpectEquals(8, config.quadrature.multiple_scattering_sample_count);
+    ExpectEquals(LEBEDEV_RULE, config.quadrature.spherical_rule);
+    ExpectEquals(110, config.quadrature.scattering_density_sample_count);
+    ExpectEquals(50, config.quadrature.indirect_irradiance_sample_count);
+    // Unspecified keys keep their default value.
+    ExpectEquals(AtmosphereConfig().ground_albedo, config.ground_albedo);
+    ExpectEquals(TRANSMITTANCE_TEXTURE_WIDTH,
+        config.texture_resolution.transmittance_width);
+  }
+
+  void TestParseErrors() {
+    const char* kInvalidConfigs[] = {
+      "bottom_radius 6360\n",
+      "bottom_radiu = 6360\n",
+      "bottom_radius = 6360km\n",
+      "use_ozone = yes\n",
+      "num_scattering_orders = 0\n",
+      "precision = float8\n",
+      "top_radius = 6000\n",
+      "irradiance_texture_size = 64\n",
+      "irradiance_texture_size = 64 16 1\n",
+      "scattering_texture_size = 32 127 32 8\n",
+      "quadrature_rule = midpoint\n",
+      "quadrature_sample_counts = 32 0 8\n",
+      "spherical_quadrature_rule = gauss\n",
+      "spherical_quadrature_sample_counts = 512 3\n",
+      "spherical_quadrature_rule = lebedev\n"
+    };
+    for (const char* invalid_config : kInvalidConfigs) {
+      std::istringstream input(invalid_config);
+      AtmosphereConfig config;
+      std::string error;
+      ExpectFalse(ParseAtmosphereConfig(input, &config, &error));
+      ExpectFalse(error.empty());
+    }
+  }
+
+  void TestGetAtmosphereParameters() {
+    AtmosphereConfig config;
+    AtmosphereParameters atmosphere = GetAtmosphereParameters(config);
+    ExpectNear(6360.0, atmosphere.bottom_radius.to(km), 1e-9);
+    ExpectNear(6420.0, atmosphere.top_radius.to(km), 1e-9);
+    const int l = kNumWavelengths / 2;
+    ExpectNear(0.1, atmosphere.ground_albedo[l](), 1e-9);
+    ExpectTrue(atmosphere.absorption_extinction[l].to(1.0 / m) > 0.0);
+    // Rayleigh scattering is inversely proportional to the 4th power of the
+    // wavelength.
+    ExpectTrue(atmosphere.rayleigh_scattering[0].to(1.0 / m) >
+        atmosphere.rayleigh_scattering[kNumWavelengths - 1].to(1.0 / m));
+    ExpectEquals(SCATTERING_TEXTURE_WIDTH,
+        atmosphere.texture_resolution.scattering_width());
+
+    config.texture_resolution.irradiance_width = 32;
+    atmosphere = GetAtmosphereParameters(config);
+    ExpectEquals(32, atmosphere.texture_resolution.irradiance_width);
+
+    config.quadrature.rule = ADAPTIVE_SIMPSON_RULE;
+    atmosphere = GetAtmosphereParameters(config);
+    ExpectEquals(ADAPTIVE_SIMPSON_RULE, atmosphere.quadrature.rule);
+
+    config.use_ozone = false;
+    atmosphere = GetAtmosphereParameters(config);
+    ExpectEquals(0.0, atmosphere.absorption_extinction[l].to(1.0 / m));
+  }
+
+  // Checks that constant and linear input spectra, sampled more densely than
+  // the model wavelengths, are resampled to the same constant and linear
+  // functions (except at the ends, where the input spectra are extrapolated
+  // with constant values).
+  void TestResampleSpectrum() {
+    constexpr int kNumSamples = 471;
+    std::vector<SpectralIrradiance> constant_samples;
+    std::vector<SpectralIrradiance> linear_samples;
+    for (int i = 0; i < kNumSamples; ++i) {
+      constant_samples.push_back(1.5 * watt_per_square_meter_per_nm);
+      linear_samples.push_back((360.0 + i) * watt_per_square_meter_per_nm);
+    }
+    const IrradianceSpectrum constant =
+        ResampleSpectrum<IrradianceSpectrum>(360.0 * nm, 830.0 * nm,
+            constant_samples);
+    const IrradianceSpectrum linear =
+        ResampleSpectrum<IrradianceSpectrum>(360.0 * nm, 830.0 * nm,
+            linear_samples);
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      ExpectNear(1.5, constant[l].to(watt_per_square_meter_per_nm), 1e-9);
+      if (l > 0 && l < kNumWavelengths - 1) {
+        const double lambda = kLambdaMin +
+            (kLambdaMax - kLambdaMin) * l / (kNumWavelengths - 1.0);
+        ExpectNear(lambda, linear[l].to(watt_per_square_meter_per_nm), 1e-6);
+      }
+    }
+  }
+};
+
+namespace {
+
+AtmosphereConfigTest parse(
+    "Parse",
+    &AtmosphereConfigTest::TestParse);
+AtmosphereConfigTest parse_errors(
+    "ParseErrors",
+    &AtmosphereConfigTest::TestParseErrors);
+AtmosphereConfigTest get_atmosphere_parameters(
+    "GetAtmosphereParameters",
+    &AtmosphereConfigTest::TestGetAtmosphereParameters);
+AtmosphereConfigTest resample_spectrum(
+    "ResampleSpectrum",
+    &AtmosphereConfigTest::TestResampleSpectrum);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/benchmark_util.cc</h2>
+
+<p>This file implements the <a href="benchmark_util.h.html">helper functions</a>
+shared by the benchmarks of the CPU model.
+*/
+
+#include "atmosphere/reference/benchmark_util.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+int Scale(int size, double scale) {
+  return std::max(2, static_cast<int>(std::round(size * scale)));
+}
+
+}  // anonymous namespace
+
+bool ParseResolution(const std::string& value, bool scale_other_sizes,
+    TextureResolution* resolution) {
+  int sizes[4];
+  char separators[3];
+  char end;
+  if (std::sscanf(value.c_str(), "%d%c%d%c%d%c%d%c", &sizes[0], &separators[0],
+          &sizes[1], &separators[1], &sizes[2], &separators[2], &sizes[3],
+          &end) != 7 ||
+      separators[0] != 'x' || separators[1] != 'x' || separators[2] != 'x') {
+    return false;
+  }
+  *resolution = TextureResolution();
+  if (scale_other_sizes) {
+    const double scale =
+        static_cast<double>(sizes[0]) / SCATTERING_TEXTURE_R_SIZE;
+    resolution->transmittance_width =
+        Scale(resolution->transmittance_width, scale);
+    resolution->transmittance_height =
+        Scale(resolution->transmittance_height, scale);
+    resolution->irradiance_width = Scale(resolution->irradiance_width, scale);
+    resolution->irradiance_height =
+        Scale(resolution->irradiance_height, scale);
+  }
+  resolution->scattering_r_size = sizes[0];
+  resolution->scattering_mu_size = sizes[1];
+  resolution->scattering_mu_s_size = sizes[2];
+  resolution->scattering_nu_size = sizes[3];
+  return resolution->IsValid();
+}
+
+void Precompute(Model* model, unsigned int num_scattering_orders,
+    std::map<std::string, double>* phase_times) {
+  model->set_progress_sink(nullptr);
+  model->Init(num_scattering_orders);
+  for (const auto& phase : model->profile().phases()) {
+    if (phase.name.compare(0, 6, "cache_") != 0) {
+      (*phase_times)[phase.name] += phase.wall_time;
+      (*phase_times)[""] += phase.wall_time;
+    }
+  }
+}
+
+Direction RandomDirection(std::mt19937* generator) {
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+  double x, y, z, length_squared;
+  do {
+    x = distribution(*generator);
+    y = distribution(*generator);
+    z = distribution(*generator);
+    length_squared = x * x + y * y + z * z;
+  } while (length_squared > 1.0 || length_squared < 1e-6);
+  const double length = std::sqrt(length_squared);
+  return Direction(x / length, y / length, z / length);
+}
+
+void PrintDifference(const std::string& name,
+    const std::vector<double>& expected, const std::vector<double>& actual) {
+  double max_difference = 0.0;
+  double sum_squared_difference = 0.0;
+  double max_value = 0.0;
+  for (unsigned int i = 0; i < expected.size(); ++i) {
+    const double difference = std::abs(expected[i] - actual[i]);
+    max_difference = std::max(max_difference, difference);
+    sum_squared_difference += difference * difference;
+    max_value = std::max(max_value, std::abs(expected[i]));
+  }
+  std::cout << name << ": maximum relative difference "
+            << max_difference / max_value << ", rms relative difference "
+            << std::sqrt(sum_squared_difference / expected.size()) / max_value
+            << std::endl;
+}
+
+double RemoveDirectory(const std::string& directory) {
+  double total_size = 0.0;
+  DIR* dir = opendir(directory.c_str());
+  if (dir != nullptr) {
+    while (struct dirent* entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name == "." || name == "..") {
+        continue;
+      }
+      const std::string filename = directory + name;
+      struct stat file_stat;
+      if (stat(filename.c_str(), &file_stat) == 0) {
+        total_size += file_stat.st_size;
+      }
+      std::remove(filename.c_str());
+    }
+    closedir(dir);
+  }
+  rmdir(directory.c_str());
+  return total_size;
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/benchmark_util.h</h2>
+
+<p>This file provides some helper functions which are shared by the benchmarks
+of the <a href="model.h.html">CPU model</a> (see for instance
+<a href="mixed_resolution_benchmark_main.cc.html">
+mixed_resolution_benchmark_main.cc</a>): to parse the texture resolutions given
+on the command line, to precompute a model while measuring the time of each
+phase, to generate random query directions, to compare the results of two
+models, and to remove the temporary cache directories.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_BENCHMARK_UTIL_H_
+#define ATMOSPHERE_REFERENCE_BENCHMARK_UTIL_H_
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/model.h"
+
+namespace atmosphere {
+namespace reference {
+
+// Parses the scattering texture sizes given in 'value', as
+// r_size x mu_size x mu_s_size x nu_size (e.g. 16x64x16x4), and stores in
+// 'resolution' the default resolution with these scattering sizes. If
+// 'scale_other_sizes' is true, the transmittance and irradiance texture sizes
+// are also scaled by the same factor as the r size, relatively to the default
+// resolution. Returns false if 'value' does not have the above form, or if the
+// resulting resolution is not valid.
+bool ParseResolution(const std::string& value, bool scale_other_sizes,
+    TextureResolution* resolution);
+
+// Precomputes the textures of the given model, without progress reporting, and
+// adds to 'phase_times' the wall time of each phase, summed over the scattering
+// orders (excluding the cache phases), as well as the total wall time (with the
+// empty name).
+void Precompute(Model* model, unsigned int num_scattering_orders,
+    std::map<std::string, double>* phase_times);
+
+// Returns a random direction, uniformly distributed on the unit sphere.
+Direction RandomDirection(std::mt19937* generator);
+
+// Prints the maximum and the root mean square difference between the given
+// values, relatively to the maximum expected value.
+void PrintDifference(const std::string& name,
+    const std::vector<double>& expected, const std::vector<double>& actual);
+
+// Returns the total size of the files in the given directory, in bytes, and
+// removes them, as well as the directory.
+double RemoveDirectory(const std::string& directory);
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_BENCHMARK_UTIL_H_
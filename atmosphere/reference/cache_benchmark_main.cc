@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/cache_benchmark_main.cc</h2>
+
+<p>This file provides a small benchmark comparing the
+<a href="texture_cache.h.html">cache</a> file formats of the precomputed
+textures of the CPU model. For each format, it saves and loads a scattering
+texture with the same size as in the <a href="model.h.html">CPU model</a>, and
+reports the size of the cache file, the save and load times, and the maximum
+relative error of the loaded values (for the stored wavelengths). The texture
+is filled with random values between 10<sup>-4</sup> and 1
+W.m<sup>-2</sup>.nm<sup>-1</sup>, which is roughly the range of the sky
+radiance values during the day. Note that the load times are measured with the
+cache file in the operating system page cache (since it has just been
+written).
+*/
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/texture_cache.h"
+
+namespace {
+
+using atmosphere::TextureResolution;
+using atmosphere::reference::FLOAT16;
+using atmosphere::reference::FLOAT32;
+using atmosphere::reference::FLOAT64;
+using atmosphere::reference::IrradianceSpectrum;
+using atmosphere::reference::ReducedScatteringTexture;
+using atmosphere::reference::TextureCache;
+using atmosphere::reference::TextureCacheFormat;
+using atmosphere::reference::TexturePrecision;
+using atmosphere::reference::kNumWavelengths;
+using atmosphere::reference::watt_per_square_meter_per_nm;
+
+// The Makefile runs the benchmark from the root directory, and puts the
+// benchmark binary in this directory.
+const char kCacheDirectory[] = "output/Release/";
+const char kCacheFile[] = "cache_benchmark.dat";
+
+// Returns the number of milliseconds taken by 'f'.
+template<class F>
+double Benchmark(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(-4.0, 0.0);
+
+  const TextureResolution resolution;
+  std::unique_ptr<ReducedScatteringTexture> texture(
+      new ReducedScatteringTexture(resolution.scattering_width(),
+          resolution.scattering_height(), resolution.scattering_depth()));
+  for (unsigned int k = 0; k < texture->size_z(); ++k) {
+    for (unsigned int j = 0; j < texture->size_y(); ++j) {
+      for (unsigned int i = 0; i < texture->size_x(); ++i) {
+        IrradianceSpectrum spectrum;
+        for (unsigned int l = 0; l < spectrum.size(); ++l) {
+          spectrum[l] = std::pow(10.0, distribution(generator)) *
+              watt_per_square_meter_per_nm;
+        }
+        texture->Set(i, j, k, spectrum);
+      }
+    }
+  }
+  std::unique_ptr<ReducedScatteringTexture> loaded_texture(
+      new ReducedScatteringTexture(texture->size_x(), texture->size_y(),
+          texture->size_z()));
+
+  const std::string filename = std::string(kCacheDirectory) + kCacheFile;
+  const std::vector<int> rgb_wavelengths = {31, 19, 8};
+  for (TexturePrecision precision : {FLOAT64, FLOAT32, FLOAT16}) {
+    for (bool rgb : {false, true}) {
+      const TextureCacheFormat format(
+          precision, rgb ? rgb_wavelengths : std::vector<int>());
+      const TextureCache cache(kCacheDirectory, 0, format);
+      const double save_ms =
+          Benchmark([&]() { cache.Save(kCacheFile, *texture); });
+      bool loaded = false;
+      const double load_ms = Benchmark([&]() {
+        loaded = cache.Load(kCacheFile, loaded_texture.get());
+      });
+      struct stat file_stat;
+      const double size_mb = stat(filename.c_str(), &file_stat) == 0 ?
+          file_stat.st_size / (1024.0 * 1024.0) : 0.0;
+      std::remove(filename.c_str());
+      if (!loaded) {
+        std::cerr << "Cannot load " << filename << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      double max_error = 0.0;
+      for (unsigned int k = 0; k < texture->size_z(); ++k) {
+        for (unsigned int j = 0; j < texture->size_y(); ++j) {
+          for (unsigned int i = 0; i < texture->size_x(); ++i) {
+            const IrradianceSpectrum& expected = texture->Get(i, j, k);
+            const IrradianceSpectrum& actual = loaded_texture->Get(i, j, k);
+            for (int l = 0; l < kNumWavelengths; ++l) {
+              if (rgb && l != 31 && l != 19 && l != 8) {
+                continue;
+              }
+              const double e = expected[l].to(watt_per_square_meter_per_nm);
+              const double a = actual[l].to(watt_per_square_meter_per_nm);
+              max_error = std::max(max_error, std::abs(a - e) / e);
+            }
+          }
+        }
+      }
+      const char* precision_name = precision == FLOAT64 ? "float64" :
+          precision == FLOAT32 ? "float32" : "float16";
+      std::cout << precision_name << (rgb ? ", RGB" : ", all wavelengths")
+                << ": " << size_mb << " MB, save " << save_ms << " ms, load "
+                << load_ms << " ms, max relative error " << max_error
+                << std::endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
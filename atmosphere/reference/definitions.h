@@ -50,11 +50,10 @@ and provided by the following included files:
 #define ATMOSPHERE_REFERENCE_DEFINITIONS_H_
 
 #include "atmosphere/constants.h"
+#include "atmosphere/reference/texture.h"
 #include "math/angle.h"
-#include "math/binary_function.h"
 #include "math/scalar.h"
 #include "math/scalar_function.h"
-#include "math/ternary_function.h"
 #include "math/vector.h"
 
 namespace atmosphere {
@@ -103,13 +102,48 @@ typedef dimensional::Scalar<-2, 0, 0, 0, 1> Illuminance;
 /*
 <p>We also need vectors of physical quantities, mostly to represent functions
 depending on the wavelength. In this case the vector elements correspond to
-values of a function at some predefined wavelengths. Here we use 47 predefined
-wavelengths, uniformly distributed between 360 and 830 nanometers:
+values of a function at some predefined wavelengths, uniformly distributed
+between <code>kLambdaMin</code> and <code>kLambdaMax</code>. Their number is a
+build parameter, <code>ATMOSPHERE_REFERENCE_NUM_WAVELENGTHS</code>, with three
+presets:
+<ul>
+<li>47 wavelengths between 360 and 830 nanometers (the default), for a full
+spectral model,</li>
+<li>16 wavelengths between 360 and 830 nanometers, for a faster but still
+spectral model,</li>
+<li>3 wavelengths between 440 and 680 nanometers, i.e. 440, 560 and 680
+nanometers, for an RGB model (close to the wavelengths used by the GPU model
+when it does not use luminance).</li>
+</ul>
+Every spectral value, and thus every texel, every texture lookup and every
+precomputation phase, stores or processes this number of values, so that the
+precomputation time and the memory usage of the CPU model are roughly
+proportional to it. The input spectra, such as the solar irradiance, are
+resampled to these wavelengths (see
+<a href="atmosphere_config.h.html">atmosphere_config.h</a>).
 */
 
+#ifndef ATMOSPHERE_REFERENCE_NUM_WAVELENGTHS
+#define ATMOSPHERE_REFERENCE_NUM_WAVELENGTHS 47
+#endif
+
+constexpr int kNumWavelengths = ATMOSPHERE_REFERENCE_NUM_WAVELENGTHS;
+static_assert(kNumWavelengths == 3 || kNumWavelengths == 16 ||
+    kNumWavelengths == 47, "the number of wavelengths must be 3, 16 or 47");
+constexpr int kLambdaMin = kNumWavelengths == 3 ? 440 : 360;
+constexpr int kLambdaMax = kNumWavelengths == 3 ? 680 : 830;
+
+// Returns the index of the wavelength nearest to 'lambda', in nanometers, which
+// must be between kLambdaMin and kLambdaMax.
+constexpr int GetNearestWavelengthIndex(double lambda) {
+  return static_cast<int>((lambda - kLambdaMin) / (kLambdaMax - kLambdaMin) *
+      (kNumWavelengths - 1) + 0.5);
+}
+
 template<int U1, int U2, int U3, int U4, int U5>
 using WavelengthFunction = dimensional::ScalarFunction<
-    0, 1, 0, 0, 0, U1, U2, U3, U4, U5, 47, 360, 830>;
+    0, 1, 0, 0, 0, U1, U2, U3, U4, U5,
+    kNumWavelengths, kLambdaMin, kLambdaMax>;
 
 // A function from Wavelength to Number.
 typedef WavelengthFunction<0, 0, 0, 0, 0> DimensionlessSpectrum;
@@ -135,21 +169,15 @@ typedef dimensional::Vector3<Illuminance> Illuminance3;
 
 /*
 <p>Finally, we also need precomputed textures containing physical quantities in
-each texel (the texture sizes are defined in
+each texel (the texture sizes are specified at runtime, with a
+<code>TextureResolution</code> - see
 <a href="../constants.h.html"><code>constants.h</code></a>):
 */
 
-typedef dimensional::BinaryFunction<
-    TRANSMITTANCE_TEXTURE_WIDTH,
-    TRANSMITTANCE_TEXTURE_HEIGHT,
-    DimensionlessSpectrum> TransmittanceTexture;
+typedef Texture2d<DimensionlessSpectrum> TransmittanceTexture;
 
 template<class T>
-using AbstractScatteringTexture = dimensional::TernaryFunction<
-    SCATTERING_TEXTURE_WIDTH,
-    SCATTERING_TEXTURE_HEIGHT,
-    SCATTERING_TEXTURE_DEPTH,
-    T>;
+using AbstractScatteringTexture = Texture3d<T>;
 
 typedef AbstractScatteringTexture<IrradianceSpectrum>
     ReducedScatteringTexture;
@@ -160,10 +188,11 @@ typedef AbstractScatteringTexture<RadianceSpectrum>
 typedef AbstractScatteringTexture<RadianceDensitySpectrum>
     ScatteringDensityTexture;
 
-typedef dimensional::BinaryFunction<
-    IRRADIANCE_TEXTURE_WIDTH,
-    IRRADIANCE_TEXTURE_HEIGHT,
-    IrradianceSpectrum> IrradianceTexture;
+typedef Texture2d<IrradianceSpectrum> IrradianceTexture;
+
+// A table of sample directions (x,y,z) and solid angles in steradians (w), one
+// per texel (see GetSphericalSample in functions.glsl).
+typedef Texture2d<dimensional::vec4> SphericalSamplesTexture;
 
 /*
 <h3>Physical units</h3>
@@ -287,6 +316,10 @@ struct AtmosphereParameters {
   // angle yielding negligible sky light radiance values. For instance, for the
   // Earth case, 102 degrees is a good choice - yielding mu_s_min = -0.2).
   Number mu_s_min;
+  // The size of the precomputed textures.
+  TextureResolution texture_resolution;
+  // The numerical integration rule and sample counts.
+  Quadrature quadrature;
 };
 
 }  // namespace reference
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/fast_benchmark_main.cc</h2>
+
+<p>This file provides a small benchmark comparing the
+<a href="model.h.html">CPU model</a> using the dimensional compilation of the
+GLSL functions (see <a href="functions.h.html">functions.h</a>) with the same
+model using their fast compilation (see
+<a href="fast_functions.h.html">fast_functions.h</a>). For the default
+atmosphere of the <a href="atmosphere_config.h.html">config files</a>, it
+reports
+<ul>
+<li>the wall time of each precomputation phase (summed over the scattering
+orders, 2 by default), and of the whole precomputation, with the two
+compilations, and the corresponding speedup,</li>
+<li>the time per <code>GetSkyRadiance</code> query, for random cameras, view
+rays and sun directions, with the two compilations, and the corresponding
+speedup,</li>
+<li>the maximum difference between the sky radiance values computed with the
+two models, relatively to the maximum sky radiance value.</li>
+</ul>
+Usage:
+<pre>
+atmosphere_fast_benchmark [num_scattering_orders]
+</pre>
+*/
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/atmosphere_config.h"
+#include "atmosphere/reference/benchmark_util.h"
+#include "atmosphere/reference/model.h"
+
+namespace {
+
+using atmosphere::reference::AtmosphereConfig;
+using atmosphere::reference::AtmosphereParameters;
+using atmosphere::reference::DimensionlessSpectrum;
+using atmosphere::reference::Direction;
+using atmosphere::reference::GetAtmosphereParameters;
+using atmosphere::reference::Length;
+using atmosphere::reference::Model;
+using atmosphere::reference::Position;
+using atmosphere::reference::Precompute;
+using atmosphere::reference::RadianceSpectrum;
+using atmosphere::reference::RandomDirection;
+using atmosphere::reference::RemoveDirectory;
+using atmosphere::reference::m;
+using atmosphere::reference::watt_per_square_meter_per_sr_per_nm;
+
+constexpr int kNumQueries = 1 << 14;
+
+// Returns the number of nanoseconds per GetSkyRadiance call of the given
+// model, and stores the results in 'radiance'.
+double BenchmarkQueries(const Model& model,
+    const std::vector<Position>& cameras,
+    const std::vector<Direction>& view_rays,
+    const std::vector<Direction>& sun_directions,
+    std::vector<RadianceSpectrum>* radiance) {
+  radiance->resize(cameras.size());
+  DimensionlessSpectrum transmittance;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < cameras.size(); ++i) {
+    (*radiance)[i] = model.GetSkyRadiance(cameras[i], view_rays[i], 0.0 * m,
+        sun_directions[i], &transmittance);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+      cameras.size();
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  const unsigned int num_scattering_orders =
+      argc > 1 ? std::atoi(argv[1]) : 2;
+  if (num_scattering_orders < 1) {
+    std::cerr << "Usage: " << argv[0] << " [num_scattering_orders]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Use a new cache directory, to make sure that the textures are computed.
+  char directory[] = "/tmp/atmosphere_fast_benchmark.XXXXXX";
+  if (mkdtemp(directory) == nullptr) {
+    std::cerr << "Cannot create a temporary directory" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const AtmosphereParameters atmosphere =
+      GetAtmosphereParameters(AtmosphereConfig());
+  Model dimensional_model(atmosphere, std::string(directory) + "/");
+  Model fast_model(atmosphere, std::string(directory) + "/");
+  fast_model.set_use_fast_functions(true);
+
+  std::map<std::string, double> dimensional_times;
+  std::map<std::string, double> fast_times;
+  Precompute(&dimensional_model, num_scattering_orders, &dimensional_times);
+  Precompute(&fast_model, num_scattering_orders, &fast_times);
+  RemoveDirectory(std::string(directory) + "/");
+  for (const auto& phase : dimensional_times) {
+    const double fast_time = fast_times[phase.first];
+    std::cout << (phase.first.empty() ? "total" : phase.first)
+              << ": dimensional " << phase.second
+              << " s, fast " << fast_time << " s, speedup "
+              << phase.second / fast_time << std::endl;
+  }
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  std::vector<Position> cameras;
+  std::vector<Direction> view_rays;
+  std::vector<Direction> sun_directions;
+  for (int i = 0; i < kNumQueries; ++i) {
+    const Length r = atmosphere.bottom_radius + distribution(generator) *
+        (atmosphere.top_radius - atmosphere.bottom_radius);
+    cameras.push_back(Position(0.0 * m, 0.0 * m, r));
+    view_rays.push_back(RandomDirection(&generator));
+    sun_directions.push_back(RandomDirection(&generator));
+  }
+  std::vector<RadianceSpectrum> dimensional_radiance;
+  std::vector<RadianceSpectrum> fast_radiance;
+  const double dimensional_ns = BenchmarkQueries(dimensional_model, cameras,
+      view_rays, sun_directions, &dimensional_radiance);
+  const double fast_ns = BenchmarkQueries(fast_model, cameras, view_rays,
+      sun_directions, &fast_radiance);
+  std::cout << "GetSkyRadiance: dimensional " << dimensional_ns
+            << " ns/query, fast " << fast_ns << " ns/query, speedup "
+            << dimensional_ns / fast_ns << std::endl;
+
+  double max_difference = 0.0;
+  double max_value = 0.0;
+  for (int i = 0; i < kNumQueries; ++i) {
+    for (unsigned int l = 0; l < dimensional_radiance[i].size(); ++l) {
+      const double expected = dimensional_radiance[i][l].to(
+          watt_per_square_meter_per_sr_per_nm);
+      const double actual =
+          fast_radiance[i][l].to(watt_per_square_meter_per_sr_per_nm);
+      max_difference = std::max(max_difference, std::abs(expected - actual));
+      max_value = std::max(max_value, std::abs(expected));
+    }
+  }
+  std::cout << "Maximum relative sky radiance difference: "
+            << max_difference / max_value << std::endl;
+  return EXIT_SUCCESS;
+}
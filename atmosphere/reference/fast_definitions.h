@@ -0,0 +1,594 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/fast_definitions.h</h2>
+
+<p>This C++ file defines the types and constants which are needed to compile the
+main GLSL <a href="../functions.glsl.html">functions</a> of our atmosphere
+model a second time, with plain floating point types instead of the physical
+types of <a href="definitions.h.html">definitions.h</a>. The dimensional build
+remains the one which checks the dimensional homogeneity of the GLSL code, but
+its physical types store double precision values. This second, "fast" build is
+instead similar to the GLSL build (see
+<a href="../definitions.glsl.html">definitions.glsl</a>): all the physical
+quantities have the same scalar type, all the spectra have the same vector type,
+and the units are 1 (all the values are thus expressed in the internal units of
+the dimensional types, i.e. in m, nm, sr, watt, lm and rad). The CPU
+<a href="model.h.html">model</a> can use it for its precomputations and queries
+(see <code>Model::set_use_fast_functions</code>).
+
+<p>The vector and spectrum types are templates parameterized by their scalar
+type, which is defined once below. We use single precision floats, like on GPU,
+which halves the memory bandwidth and doubles the SIMD width compared to double
+precision:
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_FAST_DEFINITIONS_H_
+#define ATMOSPHERE_REFERENCE_FAST_DEFINITIONS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "atmosphere/constants.h"
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/texture.h"
+
+namespace atmosphere {
+namespace reference {
+namespace fast {
+
+typedef float Real;
+
+/*
+<h3>Vectors and spectra</h3>
+
+<p>The vector types provide the subset of the GLSL vector API which is used in
+the GLSL functions, i.e. the <code>x</code>, <code>y</code>, <code>z</code> and
+<code>w</code> components, the component-wise arithmetic operators, and the
+<code>dot</code>, <code>cross</code>, <code>length</code> and
+<code>normalize</code> functions. The operators are defined as friend functions,
+so that they accept any argument convertible to the scalar type (e.g. double
+literals):
+*/
+
+template<class T>
+class Vector2 {
+ public:
+  Vector2() : x(0), y(0) {}
+  Vector2(T x, T y) : x(x), y(y) {}
+
+  friend Vector2 operator+(const Vector2& a, const Vector2& b) {
+    return Vector2(a.x + b.x, a.y + b.y);
+  }
+  friend Vector2 operator-(const Vector2& a, const Vector2& b) {
+    return Vector2(a.x - b.x, a.y - b.y);
+  }
+  friend Vector2 operator*(const Vector2& a, T b) {
+    return Vector2(a.x * b, a.y * b);
+  }
+  friend Vector2 operator*(T a, const Vector2& b) { return b * a; }
+  friend Vector2 operator/(const Vector2& a, T b) {
+    return Vector2(a.x / b, a.y / b);
+  }
+  friend Vector2 operator/(const Vector2& a, const Vector2& b) {
+    return Vector2(a.x / b.x, a.y / b.y);
+  }
+
+  T x;
+  T y;
+};
+
+template<class T>
+class Vector3 {
+ public:
+  Vector3() : x(0), y(0), z(0) {}
+  Vector3(T x, T y, T z) : x(x), y(y), z(z) {}
+
+  friend Vector3 operator+(const Vector3& a, const Vector3& b) {
+    return Vector3(a.x + b.x, a.y + b.y, a.z + b.z);
+  }
+  friend Vector3 operator-(const Vector3& a, const Vector3& b) {
+    return Vector3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+  friend Vector3 operator-(const Vector3& a) {
+    return Vector3(-a.x, -a.y, -a.z);
+  }
+  friend Vector3 operator*(const Vector3& a, T b) {
+    return Vector3(a.x * b, a.y * b, a.z * b);
+  }
+  friend Vector3 operator*(T a, const Vector3& b) { return b * a; }
+  friend Vector3 operator/(const Vector3& a, T b) {
+    return Vector3(a.x / b, a.y / b, a.z / b);
+  }
+  friend Vector3 operator/(const Vector3& a, const Vector3& b) {
+    return Vector3(a.x / b.x, a.y / b.y, a.z / b.z);
+  }
+  friend T dot(const Vector3& a, const Vector3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+  friend Vector3 cross(const Vector3& a, const Vector3& b) {
+    return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x);
+  }
+  friend T length(const Vector3& a) { return std::sqrt(dot(a, a)); }
+  friend Vector3 normalize(const Vector3& a) { return a / length(a); }
+
+  T x;
+  T y;
+  T z;
+};
+
+template<class T>
+class Vector4 {
+ public:
+  Vector4() : x(0), y(0), z(0), w(0) {}
+  Vector4(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+
+  friend Vector4 operator*(const Vector4& a, T b) {
+    return Vector4(a.x * b, a.y * b, a.z * b, a.w * b);
+  }
+  friend Vector4 operator/(const Vector4& a, const Vector4& b) {
+    return Vector4(a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w);
+  }
+
+  T x;
+  T y;
+  T z;
+  T w;
+};
+
+/*
+<p>A spectrum is a fixed size array of values, one per wavelength, with
+component-wise arithmetic operators (the equivalent of the GLSL vec3 type, used
+for RGB spectra on GPU). The loops over the wavelengths have a constant number
+of iterations, which lets the compiler vectorize them:
+*/
+
+template<class T, int N>
+class Spectrum {
+ public:
+  Spectrum() : Spectrum(T(0)) {}
+  explicit Spectrum(T value) { std::fill(value_, value_ + N, value); }
+
+  static constexpr unsigned int size() { return N; }
+  T operator[](int i) const { return value_[i]; }
+  T& operator[](int i) { return value_[i]; }
+
+  Spectrum& operator+=(const Spectrum& a) {
+    for (int i = 0; i < N; ++i) {
+      value_[i] += a.value_[i];
+    }
+    return *this;
+  }
+
+  friend Spectrum operator+(Spectrum a, const Spectrum& b) { return a += b; }
+  friend Spectrum operator-(const Spectrum& a, const Spectrum& b) {
+    return Apply(a, b, [](T x, T y) { return x - y; });
+  }
+  friend Spectrum operator-(const Spectrum& a) {
+    return Apply(a, [](T x) { return -x; });
+  }
+  friend Spectrum operator*(const Spectrum& a, const Spectrum& b) {
+    return Apply(a, b, [](T x, T y) { return x * y; });
+  }
+  friend Spectrum operator*(const Spectrum& a, T b) {
+    return Apply(a, [b](T x) { return x * b; });
+  }
+  friend Spectrum operator*(T a, const Spectrum& b) { return b * a; }
+  friend Spectrum operator/(const Spectrum& a, const Spectrum& b) {
+    return Apply(a, b, [](T x, T y) { return x / y; });
+  }
+  friend Spectrum operator/(const Spectrum& a, T b) {
+    return a * (T(1) / b);
+  }
+  friend Spectrum exp(const Spectrum& a) {
+    return Apply(a, [](T x) { return std::exp(x); });
+  }
+  friend Spectrum min(const Spectrum& a, const Spectrum& b) {
+    return Apply(a, b, [](T x, T y) { return x < y ? x : y; });
+  }
+  friend Spectrum max(const Spectrum& a, const Spectrum& b) {
+    return Apply(a, b, [](T x, T y) { return x > y ? x : y; });
+  }
+
+ private:
+  template<class F>
+  static Spectrum Apply(const Spectrum& a, F f) {
+    Spectrum result;
+    for (int i = 0; i < N; ++i) {
+      result.value_[i] = f(a.value_[i]);
+    }
+    return result;
+  }
+
+  template<class F>
+  static Spectrum Apply(const Spectrum& a, const Spectrum& b, F f) {
+    Spectrum result;
+    for (int i = 0; i < N; ++i) {
+      result.value_[i] = f(a.value_[i], b.value_[i]);
+    }
+    return result;
+  }
+
+  T value_[N];
+};
+
+/*
+<h3>Physical quantities and units</h3>
+
+<p>As in GLSL, all the physical quantities have the same type, all the vectors
+of physical quantities have the same type, and all the spectra have the same
+type:
+*/
+
+typedef Real Angle;
+typedef Real Length;
+typedef Real Wavelength;
+typedef Real SolidAngle;
+typedef Real Power;
+typedef Real LuminousPower;
+
+typedef Real Number;
+typedef Real InverseLength;
+typedef Real Area;
+typedef Real Volume;
+typedef Real Irradiance;
+typedef Real Radiance;
+typedef Real SpectralPower;
+typedef Real SpectralIrradiance;
+typedef Real SpectralRadiance;
+typedef Real SpectralRadianceDensity;
+typedef Real ScatteringCoefficient;
+typedef Real InverseSolidAngle;
+typedef Real NumberDensity;
+typedef Real LuminousIntensity;
+typedef Real Luminance;
+typedef Real Illuminance;
+
+typedef Vector2<Real> vec2;
+typedef Vector3<Real> vec3;
+typedef Vector4<Real> vec4;
+
+typedef Spectrum<Real, kNumWavelengths> DimensionlessSpectrum;
+typedef DimensionlessSpectrum PowerSpectrum;
+typedef DimensionlessSpectrum IrradianceSpectrum;
+typedef DimensionlessSpectrum RadianceSpectrum;
+typedef DimensionlessSpectrum RadianceDensitySpectrum;
+typedef DimensionlessSpectrum ScatteringSpectrum;
+
+typedef vec3 Position;
+typedef vec3 Direction;
+typedef vec3 Luminance3;
+typedef vec3 Illuminance3;
+
+constexpr Angle rad = 1.0;
+constexpr Length m = 1.0;
+constexpr Wavelength nm = 1.0;
+constexpr SolidAngle sr = 1.0;
+constexpr Power watt = 1.0;
+constexpr LuminousPower lm = 1.0;
+
+constexpr Real PI = 3.14159265358979323846;
+constexpr Angle pi = PI * rad;
+constexpr Angle deg = pi / 180.0;
+constexpr Length km = 1000.0 * m;
+constexpr Area m2 = m * m;
+constexpr Volume m3 = m * m * m;
+constexpr Irradiance watt_per_square_meter = watt / m2;
+constexpr Radiance watt_per_square_meter_per_sr = watt / (m2 * sr);
+constexpr SpectralIrradiance watt_per_square_meter_per_nm = watt / (m2 * nm);
+constexpr SpectralRadiance watt_per_square_meter_per_sr_per_nm =
+    watt / (m2 * sr * nm);
+constexpr SpectralRadianceDensity watt_per_cubic_meter_per_sr_per_nm =
+    watt / (m3 * sr * nm);
+constexpr LuminousIntensity cd = lm / sr;
+constexpr LuminousIntensity kcd = 1000.0 * cd;
+constexpr Luminance cd_per_square_meter = cd / m2;
+constexpr Luminance kcd_per_square_meter = kcd / m2;
+
+/*
+<p>The GLSL functions also use the following built-in GLSL functions on
+scalars. They are defined here with non-template functions (in addition to the
+template functions of the standard library), so that they accept arguments of
+different floating point types (e.g. a float and a double literal):
+*/
+
+using std::cos;
+using std::exp;
+using std::floor;
+using std::max;
+using std::min;
+using std::pow;
+using std::sin;
+using std::sqrt;
+
+inline Real max(Real a, Real b) { return a > b ? a : b; }
+
+inline Real min(Real a, Real b) { return a < b ? a : b; }
+
+inline Real clamp(Real x, Real min_value, Real max_value) {
+  return min(max(x, min_value), max_value);
+}
+
+inline Real mod(Real x, Real y) { return x - y * floor(x / y); }
+
+inline Real smoothstep(Real edge0, Real edge1, Real x) {
+  Real t = clamp((x - edge0) / (edge1 - edge0), 0.0, 1.0);
+  return t * t * (3.0 - 2.0 * t);
+}
+
+/*
+<h3>Conversions</h3>
+
+<p>The values of the dimensional types are converted to and from the above types
+by expressing them in the internal units of the dimensional types (these units
+are the same for all the physical quantities of a given type, so we use the
+<code>Unit()</code> of each type):
+*/
+
+template<class S>
+Real FromDimensional(S value) {
+  return static_cast<Real>(value.to(S::Unit()));
+}
+
+inline Real FromDimensional(reference::Angle value) {
+  return static_cast<Real>((value / reference::rad)());
+}
+
+template<class S>
+vec3 FromDimensional(const dimensional::Vector3<S>& value) {
+  return vec3(FromDimensional(value.x), FromDimensional(value.y),
+      FromDimensional(value.z));
+}
+
+template<class S>
+vec4 FromDimensional(const dimensional::Vector4<S>& value) {
+  return vec4(FromDimensional(value.x), FromDimensional(value.y),
+      FromDimensional(value.z), FromDimensional(value.w));
+}
+
+template<int U1, int U2, int U3, int U4, int U5>
+DimensionlessSpectrum FromDimensional(
+    const reference::WavelengthFunction<U1, U2, U3, U4, U5>& value) {
+  DimensionlessSpectrum result;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    result[l] = FromDimensional(value[l]);
+  }
+  return result;
+}
+
+// Converts a spectrum to the given dimensional spectrum type S.
+template<class S>
+S ToDimensional(const DimensionlessSpectrum& value) {
+  typedef typename std::decay<decltype(std::declval<S>()[0])>::type Scalar;
+  S result;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    result[l] = static_cast<double>(value[l]) * Scalar::Unit();
+  }
+  return result;
+}
+
+/*
+<h3>Textures</h3>
+
+<p>The textures are similar to those of <a href="texture.h.html">texture.h</a>,
+but store values of the above types. They can be created from a texture of the
+CPU model, in which case they contain a converted copy of its values (note
+that such a copy is much faster to read than converting the texel values on
+the fly, each texel being read many times). The <code>texture</code> functions
+are the equivalent of the GLSL functions, with a linear interpolation and a
+"clamp to edge" wrapping (and a nearest texel lookup for the tables of vec4
+values, see <a href="texture.h.html">texture.h</a>):
+*/
+
+template<class T>
+class Texture2d {
+ public:
+  Texture2d(unsigned int size_x, unsigned int size_y, const T& value = T())
+      : size_x_(size_x), size_y_(size_y), value_(new T[size_x * size_y]) {
+    std::fill(value_.get(), value_.get() + size_x * size_y, value);
+  }
+
+  template<class S>
+  explicit Texture2d(const reference::Texture2d<S>& texture)
+      : Texture2d(texture.size_x(), texture.size_y()) {
+    for (unsigned int j = 0; j < size_y_; ++j) {
+      for (unsigned int i = 0; i < size_x_; ++i) {
+        value_[i + size_x_ * j] = FromDimensional(texture.Get(i, j));
+      }
+    }
+  }
+
+  unsigned int size_x() const { return size_x_; }
+  unsigned int size_y() const { return size_y_; }
+
+  const T& Get(int i, int j) const { return value_[i + size_x_ * j]; }
+
+  void Set(int i, int j, const T& value) { value_[i + size_x_ * j] = value; }
+
+ private:
+  const unsigned int size_x_;
+  const unsigned int size_y_;
+  std::unique_ptr<T[]> value_;
+};
+
+template<class T>
+class Texture3d {
+ public:
+  Texture3d(unsigned int size_x, unsigned int size_y, unsigned int size_z,
+      const T& value = T())
+      : size_x_(size_x), size_y_(size_y), size_z_(size_z),
+        value_(new T[size_x * size_y * size_z]) {
+    std::fill(value_.get(), value_.get() + size_x * size_y * size_z, value);
+  }
+
+  template<class S>
+  explicit Texture3d(const reference::Texture3d<S>& texture)
+      : Texture3d(texture.size_x(), texture.size_y(), texture.size_z()) {
+    for (unsigned int k = 0; k < size_z_; ++k) {
+      for (unsigned int j = 0; j < size_y_; ++j) {
+        for (unsigned int i = 0; i < size_x_; ++i) {
+          value_[i + size_x_ * (j + size_y_ * k)] =
+              FromDimensional(texture.Get(i, j, k));
+        }
+      }
+    }
+  }
+
+  unsigned int size_x() const { return size_x_; }
+  unsigned int size_y() const { return size_y_; }
+  unsigned int size_z() const { return size_z_; }
+
+  const T& Get(int i, int j, int k) const {
+    return value_[i + size_x_ * (j + size_y_ * k)];
+  }
+
+  void Set(int i, int j, int k, const T& value) {
+    value_[i + size_x_ * (j + size_y_ * k)] = value;
+  }
+
+ private:
+  const unsigned int size_x_;
+  const unsigned int size_y_;
+  const unsigned int size_z_;
+  std::unique_ptr<T[]> value_;
+};
+
+template<class T>
+T texture(const Texture2d<T>& texture_2d, const vec2& uv) {
+  int i[2], j[2];
+  double wi[2], wj[2];
+  internal::GetLinearInterpolation(uv.x, texture_2d.size_x(), &i[0], &i[1],
+      &wi[0], &wi[1]);
+  internal::GetLinearInterpolation(uv.y, texture_2d.size_y(), &j[0], &j[1],
+      &wj[0], &wj[1]);
+  return texture_2d.Get(i[0], j[0]) * Real(wi[0] * wj[0]) +
+      texture_2d.Get(i[1], j[0]) * Real(wi[1] * wj[0]) +
+      texture_2d.Get(i[0], j[1]) * Real(wi[0] * wj[1]) +
+      texture_2d.Get(i[1], j[1]) * Real(wi[1] * wj[1]);
+}
+
+template<class T>
+T texture(const Texture3d<T>& texture_3d, const vec3& uvw) {
+  int i[2], j[2], k[2];
+  double wi[2], wj[2], wk[2];
+  internal::GetLinearInterpolation(uvw.x, texture_3d.size_x(), &i[0], &i[1],
+      &wi[0], &wi[1]);
+  internal::GetLinearInterpolation(uvw.y, texture_3d.size_y(), &j[0], &j[1],
+      &wj[0], &wj[1]);
+  internal::GetLinearInterpolation(uvw.z, texture_3d.size_z(), &k[0], &k[1],
+      &wk[0], &wk[1]);
+  T result = texture_3d.Get(i[0], j[0], k[0]) * Real(wi[0] * wj[0] * wk[0]);
+  for (int c = 1; c < 8; ++c) {
+    result += texture_3d.Get(i[c & 1], j[(c >> 1) & 1], k[c >> 2]) *
+        Real(wi[c & 1] * wj[(c >> 1) & 1] * wk[c >> 2]);
+  }
+  return result;
+}
+
+inline vec4 texture(const Texture2d<vec4>& texture_2d, const vec2& uv) {
+  const int max_i = static_cast<int>(texture_2d.size_x()) - 1;
+  const int max_j = static_cast<int>(texture_2d.size_y()) - 1;
+  const int i = static_cast<int>(std::floor(uv.x * texture_2d.size_x()));
+  const int j = static_cast<int>(std::floor(uv.y * texture_2d.size_y()));
+  return texture_2d.Get(std::max(0, std::min(i, max_i)),
+      std::max(0, std::min(j, max_j)));
+}
+
+typedef Texture2d<DimensionlessSpectrum> TransmittanceTexture;
+
+template<class T>
+using AbstractScatteringTexture = Texture3d<T>;
+
+typedef AbstractScatteringTexture<IrradianceSpectrum>
+    ReducedScatteringTexture;
+
+typedef AbstractScatteringTexture<RadianceSpectrum>
+    ScatteringTexture;
+
+typedef AbstractScatteringTexture<RadianceDensitySpectrum>
+    ScatteringDensityTexture;
+
+typedef Texture2d<IrradianceSpectrum> IrradianceTexture;
+
+typedef Texture2d<vec4> SphericalSamplesTexture;
+
+/*
+<h3>Atmosphere parameters</h3>
+
+<p>Finally, the atmosphere parameters have the same fields as in
+<a href="definitions.h.html">definitions.h</a>, with the above types, and can
+be converted from the dimensional ones (see
+<a href="fast_functions.cc.html">fast_functions.cc</a>):
+*/
+
+struct DensityProfileLayer {
+  Length width;
+  Number exp_term;
+  InverseLength exp_scale;
+  InverseLength linear_term;
+  Number constant_term;
+};
+
+struct DensityProfile {
+  DensityProfileLayer layers[2];
+};
+
+struct AtmosphereParameters {
+  IrradianceSpectrum solar_irradiance;
+  Angle sun_angular_radius;
+  Length bottom_radius;
+  Length top_radius;
+  DensityProfile rayleigh_density;
+  ScatteringSpectrum rayleigh_scattering;
+  DensityProfile mie_density;
+  ScatteringSpectrum mie_scattering;
+  ScatteringSpectrum mie_extinction;
+  Number mie_phase_function_g;
+  DensityProfile absorption_density;
+  ScatteringSpectrum absorption_extinction;
+  DimensionlessSpectrum ground_albedo;
+  Number mu_s_min;
+  TextureResolution texture_resolution;
+  Quadrature quadrature;
+};
+
+DensityProfile FromDimensional(const reference::DensityProfile& value);
+
+AtmosphereParameters FromDimensional(
+    const reference::AtmosphereParameters& value);
+
+}  // namespace fast
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_FAST_DEFINITIONS_H_
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/fast_functions.cc</h2>
+
+<p>This file compiles the <a href="../functions.glsl">GLSL functions</a> of our
+atmosphere model a second time, with the plain floating point types defined in
+<a href="fast_definitions.h.html">fast_definitions.h</a>, in the same way as
+<a href="functions.cc.html">functions.cc</a> does with the physical types. It
+also converts the atmosphere parameters to these types.
+*/
+
+#include "atmosphere/reference/fast_functions.h"
+
+#include <cassert>
+
+// The assertions of the GLSL functions check the domain of their arguments,
+// which is already done by the dimensional compilation. Here they can fail
+// because of single precision rounding errors (e.g. for a radius computed with
+// a square root, which can be slightly larger than the top radius), which are
+// harmless. We thus disable them, as in the GPU model (see model.cc).
+#undef assert
+#define assert(x)
+
+#define IN(x) const x&
+#define OUT(x) x&
+#define TEMPLATE(x) template<class x>
+#define TEMPLATE_ARGUMENT(x) <x>
+
+namespace atmosphere {
+namespace reference {
+namespace fast {
+
+#include "atmosphere/functions.glsl"
+
+DensityProfile FromDimensional(const reference::DensityProfile& value) {
+  DensityProfile result;
+  for (int i = 0; i < 2; ++i) {
+    const reference::DensityProfileLayer& layer = value.layers[i];
+    result.layers[i].width = FromDimensional(layer.width);
+    result.layers[i].exp_term = FromDimensional(layer.exp_term);
+    result.layers[i].exp_scale = FromDimensional(layer.exp_scale);
+    result.layers[i].linear_term = FromDimensional(layer.linear_term);
+    result.layers[i].constant_term = FromDimensional(layer.constant_term);
+  }
+  return result;
+}
+
+AtmosphereParameters FromDimensional(
+    const reference::AtmosphereParameters& value) {
+  AtmosphereParameters result;
+  result.solar_irradiance = FromDimensional(value.solar_irradiance);
+  result.sun_angular_radius = FromDimensional(value.sun_angular_radius);
+  result.bottom_radius = FromDimensional(value.bottom_radius);
+  result.top_radius = FromDimensional(value.top_radius);
+  result.rayleigh_density = FromDimensional(value.rayleigh_density);
+  result.rayleigh_scattering = FromDimensional(value.rayleigh_scattering);
+  result.mie_density = FromDimensional(value.mie_density);
+  result.mie_scattering = FromDimensional(value.mie_scattering);
+  result.mie_extinction = FromDimensional(value.mie_extinction);
+  result.mie_phase_function_g = FromDimensional(value.mie_phase_function_g);
+  result.absorption_density = FromDimensional(value.absorption_density);
+  result.absorption_extinction = FromDimensional(value.absorption_extinction);
+  result.ground_albedo = FromDimensional(value.ground_albedo);
+  result.mu_s_min = FromDimensional(value.mu_s_min);
+  result.texture_resolution = value.texture_resolution;
+  result.quadrature = value.quadrature;
+  return result;
+}
+
+}  // namespace fast
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/fast_functions.h</h2>
+
+<p>This file provides a C++ header for a second compilation of the
+<a href="../functions.glsl.html">GLSL functions</a> that implement our
+atmosphere model, with the plain floating point types defined in
+<a href="fast_definitions.h.html">fast_definitions.h</a> instead of the
+physical types of <a href="definitions.h.html">definitions.h</a>. The
+"implementation" is provided in <a href="fast_functions.cc.html">
+fast_functions.cc</a>, and the documentation in the GLSL file. Only the
+functions needed by the <a href="model.h.html">CPU model</a> are declared here.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_FAST_FUNCTIONS_H_
+#define ATMOSPHERE_REFERENCE_FAST_FUNCTIONS_H_
+
+#include "atmosphere/reference/fast_definitions.h"
+
+namespace atmosphere {
+namespace reference {
+namespace fast {
+
+// Transmittance.
+
+DimensionlessSpectrum ComputeTransmittanceToTopAtmosphereBoundary(
+    const AtmosphereParameters& atmosphere, Length r, Number mu);
+
+DimensionlessSpectrum ComputeTransmittanceToTopAtmosphereBoundaryTexture(
+    const AtmosphereParameters& atmosphere, const vec2& gl_frag_coord);
+
+// Single scattering.
+
+void ComputeSingleScattering(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    Length r, Number mu, Number mu_s, Number nu,
+    bool ray_r_mu_intersects_ground,
+    IrradianceSpectrum& rayleigh, IrradianceSpectrum& mie);
+
+InverseSolidAngle RayleighPhaseFunction(Number nu);
+
+void ComputeSingleScatteringTexture(const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const vec3& gl_frag_coord, IrradianceSpectrum& rayleigh,
+    IrradianceSpectrum& mie);
+
+// Multiple scattering.
+
+RadianceDensitySpectrum ComputeScatteringDensityTexture(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
+    const vec3& gl_frag_coord, int scattering_order);
+
+RadianceSpectrum ComputeMultipleScattering(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ScatteringDensityTexture& scattering_density_texture,
+    Length r, Number mu, Number mu_s, Number nu,
+    bool ray_r_mu_intersects_ground);
+
+RadianceSpectrum ComputeMultipleScatteringTexture(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ScatteringDensityTexture& scattering_density_texture,
+    const vec3& gl_frag_coord, Number& nu);
+
+// Ground irradiance.
+
+IrradianceSpectrum ComputeDirectIrradiance(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    Length r, Number mu_s);
+
+IrradianceSpectrum ComputeDirectIrradianceTexture(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const vec2& gl_frag_coord);
+
+IrradianceSpectrum ComputeIndirectIrradianceTexture(
+    const AtmosphereParameters& atmosphere,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
+    const vec2& gl_frag_coord, int scattering_order);
+
+// Rendering.
+
+RadianceSpectrum GetSkyRadiance(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    Position camera, const Direction& view_ray, Length shadow_length,
+    const Direction& sun_direction, DimensionlessSpectrum& transmittance);
+
+RadianceSpectrum GetSkyRadianceToPoint(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    Position camera, const Position& point, Length shadow_length,
+    const Direction& sun_direction, DimensionlessSpectrum& transmittance);
+
+IrradianceSpectrum GetSunAndSkyIrradiance(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const IrradianceTexture& irradiance_texture,
+    const Position& point, const Direction& normal,
+    const Direction& sun_direction, IrradianceSpectrum& sky_irradiance);
+
+}  // namespace fast
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_FAST_FUNCTIONS_H_
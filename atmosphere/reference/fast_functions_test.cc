@@ -0,0 +1,482 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/fast_functions_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="fast_functions.h.html">fast
+compilation</a> of the <a href="../functions.glsl.html">GLSL functions</a> that
+implement our atmosphere model. Since these functions are the same as in the
+dimensional compilation, which is tested in
+<a href="functions_test.cc.html">functions_test.cc</a>, we only check here that
+their results are close to those of the dimensional compilation, i.e. that the
+single precision floating point types do not add significant rounding errors.
+For this we use small textures, which can be fully precomputed, and the same
+(arbitrary) atmosphere parameters as in functions_test.cc:
+*/
+
+#include "atmosphere/reference/fast_functions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/functions.h"
+#include "atmosphere/spherical_quadrature.h"
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+constexpr SpectralIrradiance kSolarIrradiance =
+    123.0 * watt_per_square_meter_per_nm;
+constexpr Length kBottomRadius = 1000.0 * km;
+constexpr Length kTopRadius = 1500.0 * km;
+constexpr Length kRayleighScaleHeight = 60.0 * km;
+constexpr Length kMieScaleHeight = 30.0 * km;
+constexpr ScatteringCoefficient kRayleighScattering = 0.001 / km;
+constexpr ScatteringCoefficient kMieScattering = 0.0015 / km;
+constexpr ScatteringCoefficient kMieExtinction = 0.002 / km;
+constexpr Number kGroundAlbedo = 0.1;
+
+// The maximum relative difference between the results of the fast and of the
+// dimensional compilations of the GLSL functions.
+constexpr double kTolerance = 2e-4;
+
+// The maximum relative difference for the transmittance texture texels, which
+// is larger because some texels correspond to rays tangent to the ground, for
+// which the transmittance varies very quickly with the view zenith angle (and
+// is thus very sensitive to the single precision rounding errors in the
+// computation of this angle from the texture coordinates).
+constexpr double kHorizonTolerance = 1e-2;
+
+/*
+<p>We measure the difference between the fast and the dimensional results with
+the following helper class, which computes the maximum absolute difference
+between pairs of spectra, relatively to the maximum absolute value of the
+dimensional spectra (this avoids large relative differences for values which
+are almost 0, due to cancellation errors):
+*/
+
+class RelativeDifference {
+ public:
+  RelativeDifference() : max_difference_(0.0), max_value_(0.0) {}
+
+  template<class S>
+  void Add(const S& expected, const fast::DimensionlessSpectrum& actual) {
+    typedef typename std::decay<decltype(expected[0])>::type Scalar;
+    for (unsigned int l = 0; l < expected.size(); ++l) {
+      const double value = expected[l].to(Scalar::Unit());
+      max_difference_ = std::max(max_difference_,
+          std::abs(value - static_cast<double>(actual[l])));
+      max_value_ = std::max(max_value_, std::abs(value));
+    }
+  }
+
+  double Get() const {
+    return max_value_ > 0.0 ? max_difference_ / max_value_ : max_difference_;
+  }
+
+ private:
+  double max_difference_;
+  double max_value_;
+};
+
+}  // anonymous namespace
+
+/*
+<p>Each test is an instance of the following <code>TestCase</code> subclass,
+which has an <code>atmosphere_parameters_</code> field initialized from the
+above constants, with small textures and sample counts, and the corresponding
+<code>fast_atmosphere_parameters_</code>:
+*/
+
+class FastFunctionsTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  FastFunctionsTest(const std::string& name, T test)
+      : TestCase("FastFunctionsTest " + name, static_cast<Test>(test)) {
+    atmosphere_parameters_.solar_irradiance[0] = kSolarIrradiance;
+    atmosphere_parameters_.bottom_radius = kBottomRadius;
+    atmosphere_parameters_.top_radius = kTopRadius;
+    atmosphere_parameters_.rayleigh_density.layers[1] = DensityProfileLayer(
+        0.0 * m, 1.0, -1.0 / kRayleighScaleHeight, 0.0 / m, 0.0);
+    atmosphere_parameters_.rayleigh_scattering[0] = kRayleighScattering;
+    atmosphere_parameters_.mie_density.layers[1] = DensityProfileLayer(
+        0.0 * m, 1.0, -1.0 / kMieScaleHeight, 0.0 / m, 0.0);
+    atmosphere_parameters_.mie_scattering[0] = kMieScattering;
+    atmosphere_parameters_.mie_extinction[0] = kMieExtinction;
+    atmosphere_parameters_.ground_albedo[0] = kGroundAlbedo;
+    atmosphere_parameters_.mu_s_min = -1.0;
+    TextureResolution& resolution = atmosphere_parameters_.texture_resolution;
+    resolution.transmittance_width = 16;
+    resolution.transmittance_height = 8;
+    resolution.scattering_r_size = 4;
+    resolution.scattering_mu_size = 8;
+    resolution.scattering_mu_s_size = 4;
+    resolution.scattering_nu_size = 2;
+    resolution.irradiance_width = 8;
+    resolution.irradiance_height = 4;
+    Quadrature& quadrature = atmosphere_parameters_.quadrature;
+    quadrature.scattering_density_sample_count = 128;
+    quadrature.indirect_irradiance_sample_count = 128;
+    fast_atmosphere_parameters_ = fast::FromDimensional(atmosphere_parameters_);
+  }
+
+/*
+<p>The following method precomputes all the textures with the dimensional
+functions, for the first two scattering orders, in the same way as in the
+<a href="model.cc.html">CPU model</a>:
+*/
+
+  void PrecomputeTextures() {
+    const TextureResolution& resolution =
+        atmosphere_parameters_.texture_resolution;
+    const int width = resolution.scattering_width();
+    const int height = resolution.scattering_height();
+    const int depth = resolution.scattering_depth();
+    transmittance_texture_.reset(new TransmittanceTexture(
+        resolution.transmittance_width, resolution.transmittance_height));
+    direct_irradiance_texture_.reset(new IrradianceTexture(
+        resolution.irradiance_width, resolution.irradiance_height));
+    indirect_irradiance_texture_.reset(new IrradianceTexture(
+        resolution.irradiance_width, resolution.irradiance_height));
+    rayleigh_scattering_texture_.reset(
+        new ReducedScatteringTexture(width, height, depth));
+    mie_scattering_texture_.reset(
+        new ReducedScatteringTexture(width, height, depth));
+    scattering_density_texture_.reset(
+        new ScatteringDensityTexture(width, height, depth));
+    multiple_scattering_texture_.reset(
+        new ScatteringTexture(width, height, depth));
+    // This table is not used with the default, latitude-longitude rule.
+    spherical_samples_texture_.reset(new SphericalSamplesTexture(
+        GetSphericalSamplesTextureWidth(atmosphere_parameters_.quadrature),
+        SPHERICAL_SAMPLES_TEXTURE_HEIGHT, vec4(0.0, 0.0, 1.0, 0.0)));
+    const ScatteringTexture no_multiple_scattering(width, height, depth,
+        RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm));
+
+    for (int j = 0; j < resolution.transmittance_height; ++j) {
+      for (int i = 0; i < resolution.transmittance_width; ++i) {
+        transmittance_texture_->Set(i, j,
+            ComputeTransmittanceToTopAtmosphereBoundaryTexture(
+                atmosphere_parameters_, vec2(i + 0.5, j + 0.5)));
+      }
+    }
+    for (int k = 0; k < depth; ++k) {
+      for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+          IrradianceSpectrum rayleigh;
+          IrradianceSpectrum mie;
+          ComputeSingleScatteringTexture(atmosphere_parameters_,
+              *transmittance_texture_, vec3(i + 0.5, j + 0.5, k + 0.5),
+              rayleigh, mie);
+          rayleigh_scattering_texture_->Set(i, j, k, rayleigh);
+          mie_scattering_texture_->Set(i, j, k, mie);
+        }
+      }
+    }
+    for (int j = 0; j < resolution.irradiance_height; ++j) {
+      for (int i = 0; i < resolution.irradiance_width; ++i) {
+        direct_irradiance_texture_->Set(i, j, ComputeDirectIrradianceTexture(
+            atmosphere_parameters_, *transmittance_texture_,
+            vec2(i + 0.5, j + 0.5)));
+        indirect_irradiance_texture_->Set(i, j,
+            ComputeIndirectIrradianceTexture(atmosphere_parameters_,
+                *rayleigh_scattering_texture_, *mie_scattering_texture_,
+                no_multiple_scattering, *spherical_samples_texture_,
+                vec2(i + 0.5, j + 0.5), 1));
+      }
+    }
+    for (int k = 0; k < depth; ++k) {
+      for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+          scattering_density_texture_->Set(i, j, k,
+              ComputeScatteringDensityTexture(atmosphere_parameters_,
+                  *transmittance_texture_, *rayleigh_scattering_texture_,
+                  *mie_scattering_texture_, no_multiple_scattering,
+                  *direct_irradiance_texture_, *spherical_samples_texture_,
+                  vec3(i + 0.5, j + 0.5, k + 0.5), 2));
+        }
+      }
+    }
+    for (int k = 0; k < depth; ++k) {
+      for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+          Number nu;
+          multiple_scattering_texture_->Set(i, j, k,
+              ComputeMultipleScatteringTexture(atmosphere_parameters_,
+                  *transmittance_texture_, *scattering_density_texture_,
+                  vec3(i + 0.5, j + 0.5, k + 0.5), nu));
+        }
+      }
+    }
+  }
+
+/*
+<p><i>Transmittance</i>: check that the fast transmittance is close to the
+dimensional one, for each texel of the transmittance texture, and for some
+arbitrary rays (including rays almost tangent to the ground).
+*/
+
+  void TestTransmittance() {
+    const TextureResolution& resolution =
+        atmosphere_parameters_.texture_resolution;
+    RelativeDifference texture_difference;
+    for (int j = 0; j < resolution.transmittance_height; ++j) {
+      for (int i = 0; i < resolution.transmittance_width; ++i) {
+        texture_difference.Add(
+            ComputeTransmittanceToTopAtmosphereBoundaryTexture(
+                atmosphere_parameters_, vec2(i + 0.5, j + 0.5)),
+            fast::ComputeTransmittanceToTopAtmosphereBoundaryTexture(
+                fast_atmosphere_parameters_, fast::vec2(i + 0.5, j + 0.5)));
+      }
+    }
+    ExpectLess(texture_difference.Get(), kHorizonTolerance);
+
+    const Length kR[3] = {kBottomRadius, kBottomRadius * 0.9 + kTopRadius * 0.1,
+        kBottomRadius * 0.2 + kTopRadius * 0.8};
+    for (Length r : kR) {
+      const Number mu_horizon =
+          -sqrt(1.0 - (kBottomRadius / r) * (kBottomRadius / r));
+      const Number kMu[4] = {mu_horizon + 1e-3, 0.0, 0.5, 1.0};
+      for (Number mu : kMu) {
+        RelativeDifference difference;
+        difference.Add(
+            ComputeTransmittanceToTopAtmosphereBoundary(
+                atmosphere_parameters_, r, mu),
+            fast::ComputeTransmittanceToTopAtmosphereBoundary(
+                fast_atmosphere_parameters_, fast::FromDimensional(r),
+                fast::FromDimensional(mu)));
+        ExpectLess(difference.Get(), kTolerance);
+      }
+    }
+  }
+
+/*
+<p><i>Precomputations</i>: check that each texel computed with the fast
+functions, from the textures precomputed with the dimensional functions (and
+converted to float textures), is close to the corresponding dimensional texel.
+*/
+
+  void TestPrecomputations() {
+    PrecomputeTextures();
+    const TextureResolution& resolution =
+        atmosphere_parameters_.texture_resolution;
+    const fast::TransmittanceTexture fast_transmittance_texture(
+        *transmittance_texture_);
+    const fast::IrradianceTexture fast_direct_irradiance_texture(
+        *direct_irradiance_texture_);
+    const fast::ReducedScatteringTexture fast_rayleigh_scattering_texture(
+        *rayleigh_scattering_texture_);
+    const fast::ReducedScatteringTexture fast_mie_scattering_texture(
+        *mie_scattering_texture_);
+    const fast::ScatteringDensityTexture fast_scattering_density_texture(
+        *scattering_density_texture_);
+    const fast::SphericalSamplesTexture fast_spherical_samples_texture(
+        *spherical_samples_texture_);
+    const fast::ScatteringTexture fast_no_multiple_scattering(
+        resolution.scattering_width(), resolution.scattering_height(),
+        resolution.scattering_depth());
+
+    RelativeDifference direct_irradiance_difference;
+    RelativeDifference indirect_irradiance_difference;
+    for (int j = 0; j < resolution.irradiance_height; ++j) {
+      for (int i = 0; i < resolution.irradiance_width; ++i) {
+        direct_irradiance_difference.Add(
+            direct_irradiance_texture_->Get(i, j),
+            fast::ComputeDirectIrradianceTexture(fast_atmosphere_parameters_,
+                fast_transmittance_texture, fast::vec2(i + 0.5, j + 0.5)));
+        indirect_irradiance_difference.Add(
+            indirect_irradiance_texture_->Get(i, j),
+            fast::ComputeIndirectIrradianceTexture(
+                fast_atmosphere_parameters_, fast_rayleigh_scattering_texture,
+                fast_mie_scattering_texture, fast_no_multiple_scattering,
+                fast_spherical_samples_texture, fast::vec2(i + 0.5, j + 0.5),
+                1));
+      }
+    }
+    ExpectLess(direct_irradiance_difference.Get(), kTolerance);
+    ExpectLess(indirect_irradiance_difference.Get(), kTolerance);
+
+    RelativeDifference rayleigh_difference;
+    RelativeDifference mie_difference;
+    RelativeDifference scattering_density_difference;
+    RelativeDifference multiple_scattering_difference;
+    for (int k = 0; k < resolution.scattering_depth(); ++k) {
+      for (int j = 0; j < resolution.scattering_height(); ++j) {
+        for (int i = 0; i < resolution.scattering_width(); ++i) {
+          const fast::vec3 frag_coord(i + 0.5, j + 0.5, k + 0.5);
+          fast::IrradianceSpectrum rayleigh;
+          fast::IrradianceSpectrum mie;
+          fast::ComputeSingleScatteringTexture(fast_atmosphere_parameters_,
+              fast_transmittance_texture, frag_coord, rayleigh, mie);
+          rayleigh_difference.Add(
+              rayleigh_scattering_texture_->Get(i, j, k), rayleigh);
+          mie_difference.Add(mie_scattering_texture_->Get(i, j, k), mie);
+          scattering_density_difference.Add(
+              scattering_density_texture_->Get(i, j, k),
+              fast::ComputeScatteringDensityTexture(
+                  fast_atmosphere_parameters_, fast_transmittance_texture,
+                  fast_rayleigh_scattering_texture,
+                  fast_mie_scattering_texture, fast_no_multiple_scattering,
+                  fast_direct_irradiance_texture,
+                  fast_spherical_samples_texture, frag_coord, 2));
+          fast::Number nu;
+          multiple_scattering_difference.Add(
+              multiple_scattering_texture_->Get(i, j, k),
+              fast::ComputeMultipleScatteringTexture(
+                  fast_atmosphere_parameters_, fast_transmittance_texture,
+                  fast_scattering_density_texture, frag_coord, nu));
+        }
+      }
+    }
+    ExpectLess(rayleigh_difference.Get(), kTolerance);
+    ExpectLess(mie_difference.Get(), kTolerance);
+    ExpectLess(scattering_density_difference.Get(), kTolerance);
+    ExpectLess(multiple_scattering_difference.Get(), kTolerance);
+  }
+
+/*
+<p><i>Rendering</i>: check that the sky radiance, the sky radiance to a point,
+and the sun and sky irradiance computed with the fast functions are close to
+the dimensional ones, for some arbitrary camera, point and sun positions (using
+the single scattering and the direct irradiance as "precomputed" scattering
+and irradiance textures).
+*/
+
+  void TestRendering() {
+    PrecomputeTextures();
+    const fast::TransmittanceTexture fast_transmittance_texture(
+        *transmittance_texture_);
+    const fast::ReducedScatteringTexture fast_scattering_texture(
+        *rayleigh_scattering_texture_);
+    const fast::ReducedScatteringTexture fast_single_mie_scattering_texture(
+        *mie_scattering_texture_);
+    const fast::IrradianceTexture fast_irradiance_texture(
+        *direct_irradiance_texture_);
+
+    const Length h = 0.2 * (kTopRadius - kBottomRadius);
+    const Position kCameras[2] = {Position(0.0 * m, 0.0 * m, kBottomRadius + h),
+        Position(0.0 * m, 0.0 * m, kTopRadius - h)};
+    const Direction kViewRays[3] = {Direction(0.0, 0.0, 1.0),
+        normalize(Direction(1.0, 0.0, 0.3)),
+        normalize(Direction(1.0, 0.5, -0.1))};
+    const Direction sun_direction = normalize(Direction(0.0, 1.0, 1.0));
+    for (const Position& camera : kCameras) {
+      for (const Direction& view_ray : kViewRays) {
+        RelativeDifference radiance_difference;
+        RelativeDifference transmittance_difference;
+        DimensionlessSpectrum transmittance;
+        fast::DimensionlessSpectrum fast_transmittance;
+        radiance_difference.Add(
+            GetSkyRadiance(atmosphere_parameters_, *transmittance_texture_,
+                *rayleigh_scattering_texture_, *mie_scattering_texture_,
+                camera, view_ray, 0.0 * m, sun_direction, transmittance),
+            fast::GetSkyRadiance(fast_atmosphere_parameters_,
+                fast_transmittance_texture, fast_scattering_texture,
+                fast_single_mie_scattering_texture,
+                fast::FromDimensional(camera), fast::FromDimensional(view_ray),
+                0.0, fast::FromDimensional(sun_direction),
+                fast_transmittance));
+        transmittance_difference.Add(transmittance, fast_transmittance);
+
+        const Position point = camera + view_ray * (0.5 * h);
+        radiance_difference.Add(
+            GetSkyRadianceToPoint(atmosphere_parameters_,
+                *transmittance_texture_, *rayleigh_scattering_texture_,
+                *mie_scattering_texture_, camera, point, 0.0 * m,
+                sun_direction, transmittance),
+            fast::GetSkyRadianceToPoint(fast_atmosphere_parameters_,
+                fast_transmittance_texture, fast_scattering_texture,
+                fast_single_mie_scattering_texture,
+                fast::FromDimensional(camera), fast::FromDimensional(point),
+                0.0, fast::FromDimensional(sun_direction),
+                fast_transmittance));
+        transmittance_difference.Add(transmittance, fast_transmittance);
+        ExpectLess(radiance_difference.Get(), kTolerance);
+        ExpectLess(transmittance_difference.Get(), kTolerance);
+      }
+    }
+
+    const Position kPoints[2] = {Position(0.0 * m, 0.0 * m, kBottomRadius),
+        Position(0.0 * m, 0.0 * m, kBottomRadius + h)};
+    const Direction kNormals[2] = {Direction(0.0, 0.0, 1.0),
+        normalize(Direction(0.0, 1.0, 1.0))};
+    for (const Position& point : kPoints) {
+      for (const Direction& normal : kNormals) {
+        RelativeDifference sun_irradiance_difference;
+        RelativeDifference sky_irradiance_difference;
+        IrradianceSpectrum sky_irradiance;
+        fast::IrradianceSpectrum fast_sky_irradiance;
+        sun_irradiance_difference.Add(
+            GetSunAndSkyIrradiance(atmosphere_parameters_,
+                *transmittance_texture_, *direct_irradiance_texture_, point,
+                normal, sun_direction, sky_irradiance),
+            fast::GetSunAndSkyIrradiance(fast_atmosphere_parameters_,
+                fast_transmittance_texture, fast_irradiance_texture,
+                fast::FromDimensional(point), fast::FromDimensional(normal),
+                fast::FromDimensional(sun_direction), fast_sky_irradiance));
+        sky_irradiance_difference.Add(sky_irradiance, fast_sky_irradiance);
+        ExpectLess(sun_irradiance_difference.Get(), kTolerance);
+        ExpectLess(sky_irradiance_difference.Get(), kTolerance);
+      }
+    }
+  }
+
+ private:
+  AtmosphereParameters atmosphere_parameters_;
+  fast::AtmosphereParameters fast_atmosphere_parameters_;
+  std::unique_ptr<TransmittanceTexture> transmittance_texture_;
+  std::unique_ptr<IrradianceTexture> direct_irradiance_texture_;
+  std::unique_ptr<IrradianceTexture> indirect_irradiance_texture_;
+  std::unique_ptr<ReducedScatteringTexture> rayleigh_scattering_texture_;
+  std::unique_ptr<ReducedScatteringTexture> mie_scattering_texture_;
+  std::unique_ptr<ScatteringDensityTexture> scattering_density_texture_;
+  std::unique_ptr<ScatteringTexture> multiple_scattering_texture_;
+  std::unique_ptr<SphericalSamplesTexture> spherical_samples_texture_;
+};
+
+namespace {
+
+FastFunctionsTest transmittance(
+    "transmittance", &FastFunctionsTest::TestTransmittance);
+FastFunctionsTest precomputations(
+    "precomputations", &FastFunctionsTest::TestPrecomputations);
+FastFunctionsTest rendering(
+    "rendering", &FastFunctionsTest::TestRendering);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
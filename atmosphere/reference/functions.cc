@@ -53,5 +53,12 @@ using std::min;
 
 #include "atmosphere/functions.glsl"
 
+// The CPU model also uses the GetScattering template directly, to resample the
+// scattering textures (see Model::set_scattering_order_resolutions).
+template IrradianceSpectrum GetScattering(const AtmosphereParameters&,
+    const ReducedScatteringTexture&, Length, Number, Number, Number, bool);
+template RadianceSpectrum GetScattering(const AtmosphereParameters&,
+    const ScatteringTexture&, Length, Number, Number, Number, bool);
+
 }  // namespace reference
 }  // namespace atmosphere
@@ -48,6 +48,17 @@ typedef dimensional::vec2 vec2;
 typedef dimensional::vec3 vec3;
 typedef dimensional::vec4 vec4;
 
+// Utility functions.
+
+Number ClampCosine(Number mu);
+
+Length ClampRadius(const AtmosphereParameters& atmosphere, Length r);
+
+int GetQuadratureSampleCount(int rule, int sample_count);
+
+void GetQuadratureSample(int rule, int sample_count, int i,
+    Number& x_i, Number& weight_i);
+
 // Transmittance.
 
 Length DistanceToTopAtmosphereBoundary(
@@ -126,6 +137,11 @@ void GetRMuMuSNuFromScatteringTextureUvwz(
     Length& r, Number& mu, Number& mu_s, Number& nu,
     bool& ray_r_mu_intersects_ground);
 
+void GetRMuMuSNuFromScatteringTextureFragCoord(
+    const AtmosphereParameters& atmosphere, const vec3& gl_frag_coord,
+    Length& r, Number& mu, Number& mu_s, Number& nu,
+    bool& ray_r_mu_intersects_ground);
+
 void ComputeSingleScatteringTexture(const AtmosphereParameters& atmosphere,
     const TransmittanceTexture& transmittance_texture,
     const vec3& gl_frag_coord, IrradianceSpectrum& rayleigh,
@@ -149,6 +165,34 @@ RadianceSpectrum GetScattering(
 
 // Multiple scattering.
 
+RadianceDensitySpectrum ComputeScatteringDensitySample(
+    const AtmosphereParameters& atmosphere,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const IrradianceTexture& irradiance_texture,
+    Length r, Number mu_s, const Direction& omega, const Direction& omega_s,
+    const Direction& omega_i, SolidAngle domega_i,
+    bool ray_r_theta_intersects_ground, Length distance_to_ground,
+    const DimensionlessSpectrum& transmittance_to_ground,
+    const DimensionlessSpectrum& ground_albedo, int scattering_order);
+
+void ComputeGroundTransmittance(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    Length r, Number cos_theta, bool& ray_r_theta_intersects_ground,
+    Length& distance_to_ground,
+    DimensionlessSpectrum& transmittance_to_ground,
+    DimensionlessSpectrum& ground_albedo);
+
+int GetLatitudeLongitudeRowCount(int sample_count, int columns_per_row);
+
+int GetSphericalSamplesTextureWidth(const AtmosphereParameters& atmosphere);
+
+void GetSphericalSample(const AtmosphereParameters& atmosphere,
+    const SphericalSamplesTexture& spherical_samples_texture, int row, int i,
+    Direction& omega_i, SolidAngle& domega_i);
+
 RadianceDensitySpectrum ComputeScatteringDensity(
     const AtmosphereParameters& atmosphere,
     const TransmittanceTexture& transmittance_texture,
@@ -156,6 +200,7 @@ RadianceDensitySpectrum ComputeScatteringDensity(
     const ReducedScatteringTexture& single_mie_scattering_texture,
     const ScatteringTexture& multiple_scattering_texture,
     const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
     Length r, Number mu, Number mu_s, Number nu,
     int scattering_order);
 
@@ -173,6 +218,7 @@ RadianceDensitySpectrum ComputeScatteringDensityTexture(
     const ReducedScatteringTexture& single_mie_scattering_texture,
     const ScatteringTexture& multiple_scattering_texture,
     const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
     const vec3& gl_frag_coord, int scattering_order);
 
 RadianceSpectrum ComputeMultipleScatteringTexture(
@@ -193,6 +239,7 @@ IrradianceSpectrum ComputeIndirectIrradiance(
     const ReducedScatteringTexture& single_rayleigh_scattering_texture,
     const ReducedScatteringTexture& single_mie_scattering_texture,
     const ScatteringTexture& multiple_scattering_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
     Length r, Number mu_s, int scattering_order);
 
 vec2 GetIrradianceTextureUvFromRMuS(const AtmosphereParameters& atmosphere,
@@ -211,6 +258,7 @@ IrradianceSpectrum ComputeIndirectIrradianceTexture(
     const ReducedScatteringTexture& single_rayleigh_scattering_texture,
     const ReducedScatteringTexture& single_mie_scattering_texture,
     const ScatteringTexture& multiple_scattering_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
     const vec2& gl_frag_coord, int scattering_order);
 
 IrradianceSpectrum GetIrradiance(
@@ -36,11 +36,16 @@ of some (arbitrary) values for the atmosphere parameters:
 
 #include "atmosphere/reference/functions.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <string>
+#include <vector>
 
 #include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/scattering_density_simd.h"
 #include "atmosphere/constants.h"
+#include "atmosphere/spherical_quadrature.h"
 #include "test/test_case.h"
 
 namespace atmosphere {
@@ -80,18 +85,17 @@ is a lazy transmittance texture (negative values mean "not yet computed"):
 */
 
 class LazyTransmittanceTexture :
-    public dimensional::BinaryFunction<TRANSMITTANCE_TEXTURE_WIDTH,
-                                       TRANSMITTANCE_TEXTURE_HEIGHT,
-                                       DimensionlessSpectrum> {
+    public Texture2d<DimensionlessSpectrum> {
  public:
   explicit LazyTransmittanceTexture(
       const AtmosphereParameters& atmosphere_parameters)
-    : BinaryFunction(DimensionlessSpectrum(-1.0)),
+    : Texture2d(TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+          DimensionlessSpectrum(-1.0)),
       atmosphere_parameters_(atmosphere_parameters) {
   }
 
   virtual const DimensionlessSpectrum& Get(int i, int j) const {
-    int index = i + j * TRANSMITTANCE_TEXTURE_HEIGHT;
+    int index = i + j * size_x_;
     if (value_[index][0]() < 0.0) {
       value_[index] = ComputeTransmittanceToTopAtmosphereBoundaryTexture(
           atmosphere_parameters_, vec2(i + 0.5, j + 0.5));
@@ -100,8 +104,7 @@ class LazyTransmittanceTexture :
   }
 
   void Clear() {
-    constexpr unsigned int n =
-        TRANSMITTANCE_TEXTURE_WIDTH * TRANSMITTANCE_TEXTURE_HEIGHT;
+    const unsigned int n = size_x_ * size_y_;
     for (unsigned int i = 0; i < n; ++i) {
       value_[i] = DimensionlessSpectrum(-1.0);
     }
@@ -116,24 +119,22 @@ class LazyTransmittanceTexture :
 */
 
 class LazySingleScatteringTexture :
-    public dimensional::TernaryFunction<SCATTERING_TEXTURE_WIDTH,
-                                        SCATTERING_TEXTURE_HEIGHT,
-                                        SCATTERING_TEXTURE_DEPTH,
-                                        IrradianceSpectrum> {
+    public Texture3d<IrradianceSpectrum> {
  public:
   LazySingleScatteringTexture(
       const AtmosphereParameters& atmosphere_parameters,
       const TransmittanceTexture& transmittance_texture,
       bool rayleigh)
-      : TernaryFunction(IrradianceSpectrum(-watt_per_square_meter_per_nm)),
+      : Texture3d(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT,
+            SCATTERING_TEXTURE_DEPTH,
+            IrradianceSpectrum(-watt_per_square_meter_per_nm)),
         atmosphere_parameters_(atmosphere_parameters),
         transmittance_texture_(transmittance_texture),
         rayleigh_(rayleigh) {
   }
 
   virtual const IrradianceSpectrum& Get(int i, int j, int k) const {
-    int index =
-        i + SCATTERING_TEXTURE_WIDTH * (j + SCATTERING_TEXTURE_HEIGHT * k);
+    int index = i + size_x_ * (j + size_y_ * k);
     if (value_[index][0] < 0.0 * watt_per_square_meter_per_nm) {
       IrradianceSpectrum rayleigh;
       IrradianceSpectrum mie;
@@ -156,10 +157,7 @@ class LazySingleScatteringTexture :
 */
 
 class LazyScatteringDensityTexture :
-    public dimensional::TernaryFunction<SCATTERING_TEXTURE_WIDTH,
-                                        SCATTERING_TEXTURE_HEIGHT,
-                                        SCATTERING_TEXTURE_DEPTH,
-                                        RadianceDensitySpectrum> {
+    public Texture3d<RadianceDensitySpectrum> {
  public:
   LazyScatteringDensityTexture(
       const AtmosphereParameters& atmosphere_parameters,
@@ -168,8 +166,10 @@ class LazyScatteringDensityTexture :
       const ReducedScatteringTexture& single_mie_scattering_texture,
       const ScatteringTexture& multiple_scattering_texture,
       const IrradianceTexture& irradiance_texture,
+      const SphericalSamplesTexture& spherical_samples_texture,
       const int order)
-      : TernaryFunction(
+      : Texture3d(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT,
+            SCATTERING_TEXTURE_DEPTH,
             RadianceDensitySpectrum(-watt_per_cubic_meter_per_sr_per_nm)),
         atmosphere_parameters_(atmosphere_parameters),
         transmittance_texture_(transmittance_texture),
@@ -177,18 +177,19 @@ class LazyScatteringDensityTexture :
         single_mie_scattering_texture_(single_mie_scattering_texture),
         multiple_scattering_texture_(multiple_scattering_texture),
         irradiance_texture_(irradiance_texture),
+        spherical_samples_texture_(spherical_samples_texture),
         order_(order) {
   }
 
   virtual const RadianceDensitySpectrum& Get(int i, int j, int k) const {
-    int index =
-        i + SCATTERING_TEXTURE_WIDTH * (j + SCATTERING_TEXTURE_HEIGHT * k);
+    int index = i + size_x_ * (j + size_y_ * k);
     if (value_[index][0] < 0.0 * watt_per_cubic_meter_per_sr_per_nm) {
       value_[index] = ComputeScatteringDensityTexture(
           atmosphere_parameters_, transmittance_texture_,
           single_rayleigh_scattering_texture_, single_mie_scattering_texture_,
           multiple_scattering_texture_, irradiance_texture_,
-          vec3(i + 0.5, j + 0.5, k + 0.5), order_);
+          spherical_samples_texture_, vec3(i + 0.5, j + 0.5, k + 0.5),
+          order_);
     }
     return value_[index];
   }
@@ -200,6 +201,7 @@ class LazyScatteringDensityTexture :
   const ReducedScatteringTexture& single_mie_scattering_texture_;
   const ScatteringTexture& multiple_scattering_texture_;
   const IrradianceTexture& irradiance_texture_;
+  const SphericalSamplesTexture& spherical_samples_texture_;
   const int order_;
 };
 
@@ -209,24 +211,22 @@ class LazyScatteringDensityTexture :
 */
 
 class LazyMultipleScatteringTexture :
-    public dimensional::TernaryFunction<SCATTERING_TEXTURE_WIDTH,
-                                        SCATTERING_TEXTURE_HEIGHT,
-                                        SCATTERING_TEXTURE_DEPTH,
-                                        RadianceSpectrum> {
+    public Texture3d<RadianceSpectrum> {
  public:
   LazyMultipleScatteringTexture(
       const AtmosphereParameters& atmosphere_parameters,
       const TransmittanceTexture& transmittance_texture,
       const ScatteringDensityTexture& scattering_density_texture)
-      : TernaryFunction(RadianceSpectrum(-watt_per_square_meter_per_sr_per_nm)),
+      : Texture3d(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT,
+            SCATTERING_TEXTURE_DEPTH,
+            RadianceSpectrum(-watt_per_square_meter_per_sr_per_nm)),
         atmosphere_parameters_(atmosphere_parameters),
         transmittance_texture_(transmittance_texture),
         scattering_density_texture_(scattering_density_texture) {
   }
 
   virtual const RadianceSpectrum& Get(int i, int j, int k) const {
-    int index =
-        i + SCATTERING_TEXTURE_WIDTH * (j + SCATTERING_TEXTURE_HEIGHT * k);
+    int index = i + size_x_ * (j + size_y_ * k);
     if (value_[index][0] < 0.0 * watt_per_square_meter_per_sr_per_nm) {
       Number ignored;
       value_[index] = ComputeMultipleScatteringTexture(atmosphere_parameters_,
@@ -247,31 +247,33 @@ class LazyMultipleScatteringTexture :
 */
 
 class LazyIndirectIrradianceTexture :
-    public dimensional::BinaryFunction<IRRADIANCE_TEXTURE_WIDTH,
-                                       IRRADIANCE_TEXTURE_HEIGHT,
-                                       IrradianceSpectrum> {
+    public Texture2d<IrradianceSpectrum> {
  public:
   LazyIndirectIrradianceTexture(
       const AtmosphereParameters& atmosphere_parameters,
       const ReducedScatteringTexture& single_rayleigh_scattering_texture,
       const ReducedScatteringTexture& single_mie_scattering_texture,
       const ScatteringTexture& multiple_scattering_texture,
+      const SphericalSamplesTexture& spherical_samples_texture,
       int scattering_order)
-      : BinaryFunction(IrradianceSpectrum(-watt_per_square_meter_per_nm)),
+      : Texture2d(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT,
+            IrradianceSpectrum(-watt_per_square_meter_per_nm)),
         atmosphere_parameters_(atmosphere_parameters),
         single_rayleigh_scattering_texture_(single_rayleigh_scattering_texture),
         single_mie_scattering_texture_(single_mie_scattering_texture),
         multiple_scattering_texture_(multiple_scattering_texture),
+        spherical_samples_texture_(spherical_samples_texture),
         scattering_order_(scattering_order) {
   }
 
   virtual const IrradianceSpectrum& Get(int i, int j) const {
-    int index = i + j * IRRADIANCE_TEXTURE_HEIGHT;
+    int index = i + j * size_x_;
     if (value_[index][0] < 0.0 * watt_per_square_meter_per_nm) {
       value_[index] = ComputeIndirectIrradianceTexture(atmosphere_parameters_,
           single_rayleigh_scattering_texture_,
           single_mie_scattering_texture_,
           multiple_scattering_texture_,
+          spherical_samples_texture_,
           vec2(i + 0.5, j + 0.5),
           scattering_order_);
     }
@@ -283,9 +285,39 @@ class LazyIndirectIrradianceTexture :
   const ReducedScatteringTexture& single_rayleigh_scattering_texture_;
   const ReducedScatteringTexture& single_mie_scattering_texture_;
   const ScatteringTexture& multiple_scattering_texture_;
+  const SphericalSamplesTexture& spherical_samples_texture_;
   int scattering_order_;
 };
 
+/*
+<p>We also need the table of sample directions and weights of the spherical
+quadrature rule specified in the atmosphere parameters (this table is not used
+with the default, latitude-longitude rule):
+*/
+
+class SphericalSamples : public SphericalSamplesTexture {
+ public:
+  explicit SphericalSamples(const AtmosphereParameters& atmosphere_parameters)
+      : SphericalSamplesTexture(
+            GetSphericalSamplesTextureWidth(atmosphere_parameters.quadrature),
+            SPHERICAL_SAMPLES_TEXTURE_HEIGHT) {
+    const Quadrature& quadrature = atmosphere_parameters.quadrature;
+    for (int row = 0; row < SPHERICAL_SAMPLES_TEXTURE_HEIGHT; ++row) {
+      bool hemisphere = row == INDIRECT_IRRADIANCE_SAMPLES_ROW;
+      std::vector<SphericalSample> samples = ComputeSphericalSamples(
+          quadrature.spherical_rule, hemisphere ?
+              quadrature.indirect_irradiance_sample_count :
+              quadrature.scattering_density_sample_count,
+          hemisphere, atmosphere_parameters.mie_phase_function_g());
+      for (int i = 0; i < static_cast<int>(size_x_); ++i) {
+        const SphericalSample& sample = i < static_cast<int>(samples.size()) ?
+            samples[i] : SphericalSample{0.0, 0.0, 1.0, 0.0};
+        Set(i, row, vec4(sample.x, sample.y, sample.z, sample.weight));
+      }
+    }
+  }
+};
+
 /*
 <p>We can now define the unit tests themselves. Each test is an instance of the
 following <code>TestCase</code> subclass, which has an
@@ -387,6 +419,47 @@ top atmosphere boundary (using a horizontal ray).
         1.0 * m);
   }
 
+/*
+<p><i>Optical length with the Chapman function</i>: check that the analytic
+expression used in <code>ComputeOpticalLengthToTopAtmosphereBoundary</code> for
+a single exponential layer, with a scale height much smaller than the planet
+radius, gives the same result as the numerical integration. For this we compare
+it with the optical length for an equivalent profile, made of two identical
+exponential layers, which is computed with the numerical integration (with
+many Gauss-Legendre samples, to get an accurate reference value). We check this
+for several altitudes, and for view directions from the horizon to the zenith.
+*/
+
+  void TestComputeOpticalLengthWithChapmanFunction() {
+    constexpr Length kScaleHeight = kBottomRadius / 200.0;
+    const DensityProfileLayer layer(0.0 * m, 1.0, -1.0 / kScaleHeight,
+        0.0 / m, 0.0);
+    DensityProfile profile;
+    profile.layers[1] = layer;
+    DensityProfile equivalent_profile;
+    equivalent_profile.layers[0] = layer;
+    equivalent_profile.layers[0].width = 0.5 * (kTopRadius - kBottomRadius);
+    equivalent_profile.layers[1] = layer;
+    atmosphere_parameters_.quadrature.rule = GAUSS_LEGENDRE_RULE;
+    atmosphere_parameters_.quadrature.transmittance_sample_count = 4000;
+
+    const Length kAltitudes[3] = {0.0 * km, 10.0 * km, 100.0 * km};
+    for (Length altitude : kAltitudes) {
+      const Length r = kBottomRadius + altitude;
+      const Number mu_horizon = CosineOfHorizonZenithAngle(r);
+      for (int i = 0; i <= 10; ++i) {
+        const Number mu = mu_horizon + (1.0 - mu_horizon) * (i / 10.0);
+        const Length expected = ComputeOpticalLengthToTopAtmosphereBoundary(
+            atmosphere_parameters_, equivalent_profile, r, mu);
+        ExpectNear(
+            1.0,
+            (ComputeOpticalLengthToTopAtmosphereBoundary(
+                atmosphere_parameters_, profile, r, mu) / expected)(),
+            1e-5);
+      }
+    }
+  }
+
 /*
 <p><i>Atmosphere density profiles</i>: check that density profiles with
 exponentional, linear or constant density, and one or two layers, are correctly
@@ -857,6 +930,61 @@ $$
     ExpectNear(0.0, mie[0].to(watt_per_square_meter_per_nm), kEpsilon);
   }
 
+/*
+<p><i>Numerical integration rules</i>: check that the Gauss-Legendre and the
+adaptive Simpson rules give, with much fewer samples, the same transmittance and
+single scattering values as the trapezoidal rule with 500 samples (the default
+for the transmittance), for several view rays. The Gauss-Legendre rule is very
+precise with smooth integrands, but not with an ozone-like absorption profile,
+whose derivative is discontinuous. The adaptive Simpson rule, on the other hand,
+concentrates its samples around these discontinuities. In each case the maximum
+error is reported by the <code>ExpectNear</code> expectations.
+*/
+
+  void TestQuadratureRules() {
+    atmosphere_parameters_.quadrature.single_scattering_sample_count =
+        TRANSMITTANCE_SAMPLE_COUNT;
+    LazyTransmittanceTexture transmittance_texture(atmosphere_parameters_);
+
+    Quadrature trapezoidal;
+    trapezoidal.transmittance_sample_count = 16;
+    trapezoidal.single_scattering_sample_count = 16;
+    Quadrature gauss_legendre = trapezoidal;
+    gauss_legendre.rule = GAUSS_LEGENDRE_RULE;
+    Quadrature adaptive_simpson = trapezoidal;
+    adaptive_simpson.rule = ADAPTIVE_SIMPSON_RULE;
+    adaptive_simpson.transmittance_sample_count = 128;
+    adaptive_simpson.single_scattering_sample_count = 32;
+
+    // Without ozone, 16 Gauss-Legendre samples are as precise as 500
+    // trapezoidal samples (whose own error is about 6e-6), unlike 16
+    // trapezoidal samples.
+    ExpectTrue(GetTransmittanceError(trapezoidal) > 1e-3);
+    ExpectNear(0.0, GetTransmittanceError(gauss_legendre), 2e-5);
+    ExpectNear(0.0, GetTransmittanceError(adaptive_simpson), 2e-5);
+
+    // The default single scattering quadrature, with 50 trapezoidal samples,
+    // has a relative error of about 2e-3.
+    ExpectNear(0.0,
+        GetSingleScatteringError(gauss_legendre, transmittance_texture), 5e-4);
+    ExpectNear(0.0,
+        GetSingleScatteringError(adaptive_simpson, transmittance_texture),
+        5e-4);
+    ExpectTrue(GetSingleScatteringError(trapezoidal, transmittance_texture) >
+        1e-2);
+
+    // With ozone, Gauss-Legendre samples are not much better than trapezoidal
+    // ones, but 128 adaptive Simpson samples are still as precise as 500
+    // trapezoidal samples.
+    atmosphere_parameters_.absorption_density.layers[0] = DensityProfileLayer(
+        250.0 * km, 0.0, 0.0 / km, 1.0 / (150.0 * km), -2.0 / 3.0);
+    atmosphere_parameters_.absorption_density.layers[1] = DensityProfileLayer(
+        0.0 * km, 0.0, 0.0 / km, -1.0 / (150.0 * km), 8.0 / 3.0);
+    atmosphere_parameters_.absorption_extinction[0] = 0.002 / km;
+    ExpectTrue(GetTransmittanceError(gauss_legendre) > 1e-3);
+    ExpectNear(0.0, GetTransmittanceError(adaptive_simpson), 2e-5);
+  }
+
 /*
 <p><i>Rayleigh and Mie phase functions</i>: check that the integral of these
 phase functions over all solid angles gives $1$.
@@ -1154,17 +1282,22 @@ horizontal direction for the scattered radiance).</li>
 
   void TestComputeScatteringDensity() {
     RadianceSpectrum kRadiance(13.0 * watt_per_square_meter_per_sr_per_nm);
-    TransmittanceTexture full_transmittance(DimensionlessSpectrum(1.0));
-    ReducedScatteringTexture no_single_scattering(
+    TransmittanceTexture full_transmittance(TRANSMITTANCE_TEXTURE_WIDTH,
+        TRANSMITTANCE_TEXTURE_HEIGHT, DimensionlessSpectrum(1.0));
+    ReducedScatteringTexture no_single_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
         IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
-    ScatteringTexture uniform_multiple_scattering(kRadiance);
-    IrradianceTexture no_irradiance(
+    ScatteringTexture uniform_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH, kRadiance);
+    IrradianceTexture no_irradiance(IRRADIANCE_TEXTURE_WIDTH,
+        IRRADIANCE_TEXTURE_HEIGHT,
         IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+    SphericalSamples spherical_samples(atmosphere_parameters_);
 
     RadianceDensitySpectrum scattering_density = ComputeScatteringDensity(
         atmosphere_parameters_, full_transmittance,  no_single_scattering,
         no_single_scattering, uniform_multiple_scattering, no_irradiance,
-        kBottomRadius, 0.0, 0.0, 1.0, 3);
+        spherical_samples, kBottomRadius, 0.0, 0.0, 1.0, 3);
     SpectralRadianceDensity kExpectedScatteringDensity =
         (kRayleighScattering + kMieScattering) * kRadiance[0];
     ExpectNear(
@@ -1173,13 +1306,15 @@ horizontal direction for the scattered radiance).</li>
         2.0 * kEpsilon);
 
     IrradianceSpectrum kIrradiance(13.0 * watt_per_square_meter_per_nm);
-    IrradianceTexture uniform_irradiance(kIrradiance);
-    ScatteringTexture no_multiple_scattering(
+    IrradianceTexture uniform_irradiance(IRRADIANCE_TEXTURE_WIDTH,
+        IRRADIANCE_TEXTURE_HEIGHT, kIrradiance);
+    ScatteringTexture no_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
         RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm));
     scattering_density = ComputeScatteringDensity(
         atmosphere_parameters_, full_transmittance, no_single_scattering,
         no_single_scattering, no_multiple_scattering, uniform_irradiance,
-        kBottomRadius, 0.0, 0.0, 1.0, 3);
+        spherical_samples, kBottomRadius, 0.0, 0.0, 1.0, 3);
     kExpectedScatteringDensity = (kRayleighScattering + kMieScattering) *
         kGroundAlbedo / (2.0 * PI * sr) * kIrradiance[0];
     ExpectNear(
@@ -1202,8 +1337,11 @@ for a ray looking at the horizon.
   void TestComputeMultipleScattering() {
     RadianceDensitySpectrum kRadianceDensity(
         0.17 * watt_per_cubic_meter_per_sr_per_nm);
-    TransmittanceTexture full_transmittance(DimensionlessSpectrum(1.0));
-    ScatteringDensityTexture uniform_scattering_density(kRadianceDensity);
+    TransmittanceTexture full_transmittance(TRANSMITTANCE_TEXTURE_WIDTH,
+        TRANSMITTANCE_TEXTURE_HEIGHT, DimensionlessSpectrum(1.0));
+    ScatteringDensityTexture uniform_scattering_density(
+        SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT,
+        SCATTERING_TEXTURE_DEPTH, kRadianceDensity);
 
     // Vertical ray, looking bottom.
     Length r = kBottomRadius * 0.2 + kTopRadius * 0.8;
@@ -1236,15 +1374,20 @@ analytically.
 
   void TestComputeAndGetScatteringDensity() {
     RadianceSpectrum kRadiance(13.0 * watt_per_square_meter_per_sr_per_nm);
-    TransmittanceTexture full_transmittance(DimensionlessSpectrum(1.0));
-    ReducedScatteringTexture no_single_scattering(
+    TransmittanceTexture full_transmittance(TRANSMITTANCE_TEXTURE_WIDTH,
+        TRANSMITTANCE_TEXTURE_HEIGHT, DimensionlessSpectrum(1.0));
+    ReducedScatteringTexture no_single_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
         IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
-    ScatteringTexture uniform_multiple_scattering(kRadiance);
-    IrradianceTexture no_irradiance(
+    ScatteringTexture uniform_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH, kRadiance);
+    IrradianceTexture no_irradiance(IRRADIANCE_TEXTURE_WIDTH,
+        IRRADIANCE_TEXTURE_HEIGHT,
         IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+    SphericalSamples spherical_samples(atmosphere_parameters_);
     LazyScatteringDensityTexture multiple_scattering1(atmosphere_parameters_,
         full_transmittance, no_single_scattering, no_single_scattering,
-        uniform_multiple_scattering, no_irradiance, 3);
+        uniform_multiple_scattering, no_irradiance, spherical_samples, 3);
 
     RadianceDensitySpectrum scattering_density = GetScattering(
         atmosphere_parameters_, multiple_scattering1,
@@ -1257,13 +1400,15 @@ analytically.
         2.0 * kEpsilon);
 
     IrradianceSpectrum kIrradiance(13.0 * watt_per_square_meter_per_nm);
-    IrradianceTexture uniform_irradiance(kIrradiance);
-    ScatteringTexture no_multiple_scattering(
+    IrradianceTexture uniform_irradiance(IRRADIANCE_TEXTURE_WIDTH,
+        IRRADIANCE_TEXTURE_HEIGHT, kIrradiance);
+    ScatteringTexture no_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
         RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm));
 
     LazyScatteringDensityTexture multiple_scattering2(atmosphere_parameters_,
         full_transmittance, no_single_scattering, no_single_scattering,
-        no_multiple_scattering, uniform_irradiance, 3);
+        no_multiple_scattering, uniform_irradiance, spherical_samples, 3);
     scattering_density = GetScattering(
         atmosphere_parameters_, multiple_scattering2,
         kBottomRadius, 0.0, 0.0, 1.0, false);
@@ -1275,6 +1420,138 @@ analytically.
         2.0 * kEpsilon);
   }
 
+/*
+<p><i>Vectorized scattering density</i>: check that the
+<a href="scattering_density_simd.h.html">SIMD version</a> of
+<code>ComputeScatteringDensity</code> gives the same result as the original
+function, up to <code>kScatteringDensitySimdTolerance</code>, with each
+instruction set supported by the CPU. We check this for the second order (which
+uses the single scattering textures and the phase functions), and for the third
+order (which uses the multiple scattering texture), with and without ground
+contributions.
+*/
+
+  void TestComputeScatteringDensitySimd() {
+    LazyTransmittanceTexture transmittance_texture(atmosphere_parameters_);
+    LazySingleScatteringTexture single_rayleigh_scattering_texture(
+        atmosphere_parameters_, transmittance_texture, true);
+    LazySingleScatteringTexture single_mie_scattering_texture(
+        atmosphere_parameters_, transmittance_texture, false);
+    ScatteringTexture uniform_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
+        RadianceSpectrum(13.0 * watt_per_square_meter_per_sr_per_nm));
+    IrradianceTexture uniform_irradiance(IRRADIANCE_TEXTURE_WIDTH,
+        IRRADIANCE_TEXTURE_HEIGHT,
+        IrradianceSpectrum(7.0 * watt_per_square_meter_per_nm));
+    SphericalSamples spherical_samples(atmosphere_parameters_);
+
+    const Length r = kBottomRadius * 0.8 + kTopRadius * 0.2;
+    const Number kMu[3] = {-0.5, 0.1, 0.9};
+    for (int scattering_order = 2; scattering_order <= 3; ++scattering_order) {
+      for (Number mu : kMu) {
+        const Number mu_s = 0.3;
+        const Number nu = mu * mu_s + 0.5 * sqrt(1.0 - mu * mu) *
+            sqrt(1.0 - mu_s * mu_s);
+        RadianceDensitySpectrum expected = ComputeScatteringDensity(
+            atmosphere_parameters_, transmittance_texture,
+            single_rayleigh_scattering_texture, single_mie_scattering_texture,
+            uniform_multiple_scattering, uniform_irradiance,
+            spherical_samples, r, mu, mu_s, nu, scattering_order);
+        for (SimdInstructionSet instruction_set : {SCALAR, SSE2, AVX2}) {
+          if (!IsSimdInstructionSetSupported(instruction_set)) {
+            continue;
+          }
+          RadianceDensitySpectrum actual = ComputeScatteringDensitySimd(
+              atmosphere_parameters_, transmittance_texture,
+              single_rayleigh_scattering_texture,
+              single_mie_scattering_texture, uniform_multiple_scattering,
+              uniform_irradiance, spherical_samples, r, mu, mu_s, nu,
+              scattering_order, instruction_set);
+          for (unsigned int i = 0; i < expected.size(); ++i) {
+            ExpectNear(expected[i], actual[i],
+                expected[i] * kScatteringDensitySimdTolerance);
+          }
+        }
+      }
+    }
+  }
+
+/*
+<p><i>Spherical quadrature rules</i>: check that the scattering density and the
+indirect irradiance are computed correctly with each spherical quadrature rule
+(and not only with the default one, used in the above tests), by integrating a
+uniform multiple scattering radiance (which gives
+$(\beta_R+\beta_M)L$ and $\pi L$, respectively, since the phase functions are
+normalized). We also check that the SIMD version of
+<code>ComputeScatteringDensity</code> gives the same result as the original
+function with each rule.
+*/
+
+  void TestSphericalQuadratureRules() {
+    TransmittanceTexture full_transmittance(TRANSMITTANCE_TEXTURE_WIDTH,
+        TRANSMITTANCE_TEXTURE_HEIGHT, DimensionlessSpectrum(1.0));
+    ReducedScatteringTexture no_single_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
+        IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+    ScatteringTexture uniform_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
+        RadianceSpectrum(1.0 * watt_per_square_meter_per_sr_per_nm));
+    IrradianceTexture no_irradiance(IRRADIANCE_TEXTURE_WIDTH,
+        IRRADIANCE_TEXTURE_HEIGHT,
+        IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+    const SpectralRadianceDensity kExpectedScatteringDensity =
+        (kRayleighScattering + kMieScattering) *
+            (1.0 * watt_per_square_meter_per_sr_per_nm);
+
+    const int kRules[3] = {FIBONACCI_RULE, LEBEDEV_RULE,
+        IMPORTANCE_SAMPLING_RULE};
+    for (int rule : kRules) {
+      atmosphere_parameters_.quadrature.spherical_rule = rule;
+      if (rule == LEBEDEV_RULE) {
+        atmosphere_parameters_.quadrature.scattering_density_sample_count = 110;
+        atmosphere_parameters_.quadrature.indirect_irradiance_sample_count =
+            110;
+      }
+      SphericalSamples spherical_samples(atmosphere_parameters_);
+
+      const Length r = kBottomRadius;
+      const Number mu = 0.1;
+      const Number mu_s = 0.3;
+      const Number nu = mu * mu_s + 0.5 * sqrt(1.0 - mu * mu) *
+          sqrt(1.0 - mu_s * mu_s);
+      RadianceDensitySpectrum scattering_density = ComputeScatteringDensity(
+          atmosphere_parameters_, full_transmittance, no_single_scattering,
+          no_single_scattering, uniform_multiple_scattering, no_irradiance,
+          spherical_samples, r, mu, mu_s, nu, 3);
+      ExpectNear(
+          1.0,
+          (scattering_density[0] / kExpectedScatteringDensity)(),
+          1e-2);
+      for (SimdInstructionSet instruction_set : {SCALAR, SSE2, AVX2}) {
+        if (!IsSimdInstructionSetSupported(instruction_set)) {
+          continue;
+        }
+        RadianceDensitySpectrum actual = ComputeScatteringDensitySimd(
+            atmosphere_parameters_, full_transmittance, no_single_scattering,
+            no_single_scattering, uniform_multiple_scattering, no_irradiance,
+            spherical_samples, r, mu, mu_s, nu, 3, instruction_set);
+        for (unsigned int i = 0; i < scattering_density.size(); ++i) {
+          ExpectNear(scattering_density[i], actual[i],
+              scattering_density[i] * kScatteringDensitySimdTolerance);
+        }
+      }
+
+      IrradianceSpectrum irradiance = ComputeIndirectIrradiance(
+          atmosphere_parameters_, no_single_scattering, no_single_scattering,
+          uniform_multiple_scattering, spherical_samples, kBottomRadius, 1.0,
+          2);
+      ExpectNear(
+          PI,
+          irradiance[0].to(watt_per_square_meter_per_nm),
+          PI * 1e-2);
+    }
+  }
+
 /*
 <p><i>Multiple scattering texture, step 2</i>: check that we get the same result
 for the second step of the multiple scattering computation, whether we compute
@@ -1287,8 +1564,11 @@ analytically.
   void TestComputeAndGetMultipleScattering() {
     RadianceDensitySpectrum kRadianceDensity(
         0.17 * watt_per_cubic_meter_per_sr_per_nm);
-    TransmittanceTexture full_transmittance(DimensionlessSpectrum(1.0));
-    ScatteringDensityTexture uniform_scattering_density(kRadianceDensity);
+    TransmittanceTexture full_transmittance(TRANSMITTANCE_TEXTURE_WIDTH,
+        TRANSMITTANCE_TEXTURE_HEIGHT, DimensionlessSpectrum(1.0));
+    ScatteringDensityTexture uniform_scattering_density(
+        SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT,
+        SCATTERING_TEXTURE_DEPTH, kRadianceDensity);
     LazyMultipleScatteringTexture multiple_scattering(atmosphere_parameters_,
         full_transmittance, uniform_scattering_density);
 
@@ -1323,12 +1603,15 @@ $\int_0^{2\pi}\int_0^{\pi/2}\cos\theta\sin\theta\mathrm{d}\theta\mathrm{d}\phi=
 */
 
   void TestComputeIndirectIrradiance() {
-    ReducedScatteringTexture no_single_scattering;
-    ScatteringTexture uniform_multiple_scattering(
+    ReducedScatteringTexture no_single_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH);
+    ScatteringTexture uniform_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
         RadianceSpectrum(1.0 * watt_per_square_meter_per_sr_per_nm));
+    SphericalSamples spherical_samples(atmosphere_parameters_);
     IrradianceSpectrum irradiance = ComputeIndirectIrradiance(
         atmosphere_parameters_, no_single_scattering, no_single_scattering,
-        uniform_multiple_scattering, kBottomRadius, 1.0, 2);
+        uniform_multiple_scattering, spherical_samples, kBottomRadius, 1.0, 2);
     // The relative error is about 1% here.
     ExpectNear(
         PI,
@@ -1406,9 +1689,11 @@ in the precomputed ground irradiance texture.
 */
 
   void TestComputeAndGetIrradiance() {
-    ReducedScatteringTexture no_single_scattering(
+    ReducedScatteringTexture no_single_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH,
         IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
-    ScatteringTexture fake_multiple_scattering;
+    ScatteringTexture fake_multiple_scattering(SCATTERING_TEXTURE_WIDTH,
+        SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH);
     for (unsigned int x = 0; x < fake_multiple_scattering.size_x(); ++x) {
       for (unsigned int y = 0; y < fake_multiple_scattering.size_y(); ++y) {
         for (unsigned int z = 0; z < fake_multiple_scattering.size_z(); ++z) {
@@ -1423,22 +1708,25 @@ in the precomputed ground irradiance texture.
     Length r = kBottomRadius * 0.8 + kTopRadius * 0.2;
     Number mu_s = 0.25;
     int scattering_order = 2;
+    SphericalSamples spherical_samples(atmosphere_parameters_);
     LazyIndirectIrradianceTexture irradiance_texture(atmosphere_parameters_,
         no_single_scattering, no_single_scattering, fake_multiple_scattering,
-        scattering_order);
+        spherical_samples, scattering_order);
     ExpectNear(
         1.0,
         (GetIrradiance(atmosphere_parameters_, irradiance_texture, r, mu_s) /
             ComputeIndirectIrradiance(atmosphere_parameters_,
                 no_single_scattering, no_single_scattering,
-                fake_multiple_scattering, r, mu_s, scattering_order))[0](),
+                fake_multiple_scattering, spherical_samples, r, mu_s,
+                scattering_order))[0](),
         kEpsilon);
     ExpectNotNear(
         1.0,
         (GetIrradiance(atmosphere_parameters_, irradiance_texture, r, mu_s) /
             ComputeIndirectIrradiance(atmosphere_parameters_,
                 no_single_scattering, no_single_scattering,
-                fake_multiple_scattering, r, 0.5, scattering_order))[0](),
+                fake_multiple_scattering, spherical_samples, r, 0.5,
+                scattering_order))[0](),
         kEpsilon);
   }
 
@@ -1449,6 +1737,60 @@ to remove aerosols:
 */
 
  private:
+  // Returns the maximum absolute difference between the transmittances
+  // computed with the given quadrature and with the default one, for several
+  // view rays which do not intersect the ground.
+  double GetTransmittanceError(const Quadrature& quadrature) const {
+    AtmosphereParameters atmosphere_parameters = atmosphere_parameters_;
+    atmosphere_parameters.quadrature = quadrature;
+    double max_error = 0.0;
+    for (int i = 0; i < 5; ++i) {
+      Length r = kBottomRadius + (kTopRadius - kBottomRadius) * (i / 5.0);
+      for (int j = 0; j <= 8; ++j) {
+        Number mu = -1.0 + j / 4.0;
+        if (RayIntersectsGround(atmosphere_parameters_, r, mu)) {
+          continue;
+        }
+        Number error = ComputeTransmittanceToTopAtmosphereBoundary(
+            atmosphere_parameters, r, mu)[0] -
+            ComputeTransmittanceToTopAtmosphereBoundary(
+                atmosphere_parameters_, r, mu)[0];
+        max_error = std::max(max_error, std::abs(error()));
+      }
+    }
+    return max_error;
+  }
+
+  // Returns the maximum relative difference between the Rayleigh single
+  // scattering computed with the given quadrature and with the quadrature of
+  // atmosphere_parameters_, for several view rays.
+  double GetSingleScatteringError(const Quadrature& quadrature,
+      const TransmittanceTexture& transmittance_texture) const {
+    AtmosphereParameters atmosphere_parameters = atmosphere_parameters_;
+    atmosphere_parameters.quadrature = quadrature;
+    constexpr Number mu_s = 0.5;
+    double max_error = 0.0;
+    for (int i = 0; i < 5; ++i) {
+      Length r = kBottomRadius + (kTopRadius - kBottomRadius) * (i / 5.0);
+      for (int j = 0; j <= 8; ++j) {
+        Number mu = -1.0 + j / 4.0;
+        bool ray_r_mu_intersects_ground =
+            RayIntersectsGround(atmosphere_parameters_, r, mu);
+        IrradianceSpectrum rayleigh;
+        IrradianceSpectrum expected_rayleigh;
+        IrradianceSpectrum mie;
+        ComputeSingleScattering(atmosphere_parameters, transmittance_texture,
+            r, mu, mu_s, mu * mu_s, ray_r_mu_intersects_ground, rayleigh, mie);
+        ComputeSingleScattering(atmosphere_parameters_, transmittance_texture,
+            r, mu, mu_s, mu * mu_s, ray_r_mu_intersects_ground,
+            expected_rayleigh, mie);
+        Number error = rayleigh[0] / expected_rayleigh[0] - 1.0;
+        max_error = std::max(max_error, std::abs(error()));
+      }
+    }
+    return max_error;
+  }
+
   void SetUniformAtmosphere() {
     atmosphere_parameters_.rayleigh_density.layers[0] = DensityProfileLayer();
     atmosphere_parameters_.rayleigh_density.layers[1] =
@@ -1483,6 +1825,9 @@ FunctionsTest distance_to_top_atmosphere_boundary(
 FunctionsTest ray_intersects_ground(
     "RayIntersectsGround",
     &FunctionsTest::TestRayIntersectsGround);
+FunctionsTest compute_optical_length_with_chapman_function(
+    "ComputeOpticalLengthWithChapmanFunction",
+    &FunctionsTest::TestComputeOpticalLengthWithChapmanFunction);
 FunctionsTest get_profile_density(
     "GetProfileDensity",
     &FunctionsTest::TestGetProfileDensity);
@@ -1517,6 +1862,9 @@ FunctionsTest distance_to_nearest_atmosphere_boundary(
 FunctionsTest compute_single_scattering(
     "ComputeSingleScattering",
     &FunctionsTest::TestComputeSingleScattering);
+FunctionsTest quadrature_rules(
+    "QuadratureRules",
+    &FunctionsTest::TestQuadratureRules);
 FunctionsTest phase_functions(
     "PhaseFunctions",
     &FunctionsTest::TestPhaseFunctions);
@@ -1539,6 +1887,12 @@ FunctionsTest compute_multiple_scattering(
 FunctionsTest compute_and_get_scattering_density(
     "ComputeAndGetScatteringDensity",
     &FunctionsTest::TestComputeAndGetScatteringDensity);
+FunctionsTest compute_scattering_density_simd(
+    "ComputeScatteringDensitySimd",
+    &FunctionsTest::TestComputeScatteringDensitySimd);
+FunctionsTest spherical_quadrature_rules(
+    "SphericalQuadratureRules",
+    &FunctionsTest::TestSphericalQuadratureRules);
 FunctionsTest compute_and_get_multiple_scattering(
     "ComputeAndGetMultipleScattering",
     &FunctionsTest::TestComputeAndGetMultipleScattering);
@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/lookup_benchmark_main.cc</h2>
+
+<p>This file provides a small benchmark comparing the throughput of texture
+lookups in the precomputed scattering texture of the CPU model, stored either
+with one spectrum per texel (an "array of structures", see
+<a href="definitions.h.html">definitions.h</a>) or with one array per wavelength
+(a "structure of arrays", see <a href="spectral_texture.h.html">
+spectral_texture.h</a>). The texture has the
+same size as in the <a href="model.h.html">CPU model</a>, but is filled with
+random values, and is sampled at random texture coordinates (the lookup cost
+does not depend on the texel values).
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/spectral_texture.h"
+
+namespace {
+
+using atmosphere::TextureResolution;
+using atmosphere::reference::IrradianceSpectrum;
+using atmosphere::reference::ReducedScatteringTexture;
+using atmosphere::reference::SpectralTexture;
+using atmosphere::reference::kNumWavelengths;
+using atmosphere::reference::texture;
+using atmosphere::reference::watt_per_square_meter_per_nm;
+using dimensional::vec3;
+
+constexpr int kNumLookups = 1 << 20;
+
+// Returns the number of nanoseconds per call of 'lookup', for each of the
+// given texture coordinates.
+template<class F>
+double Benchmark(const std::vector<vec3>& uvws, F lookup) {
+  auto start = std::chrono::steady_clock::now();
+  for (const vec3& uvw : uvws) {
+    lookup(uvw);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+      uvws.size();
+}
+
+void Report(const std::string& name, double ns_per_lookup, double checksum) {
+  std::cout << name << ": " << ns_per_lookup << " ns/lookup (checksum "
+            << checksum << ")" << std::endl;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+  const TextureResolution resolution;
+  std::unique_ptr<ReducedScatteringTexture> aos_texture(
+      new ReducedScatteringTexture(resolution.scattering_width(),
+          resolution.scattering_height(), resolution.scattering_depth()));
+  for (unsigned int k = 0; k < aos_texture->size_z(); ++k) {
+    for (unsigned int j = 0; j < aos_texture->size_y(); ++j) {
+      for (unsigned int i = 0; i < aos_texture->size_x(); ++i) {
+        IrradianceSpectrum spectrum;
+        for (unsigned int l = 0; l < spectrum.size(); ++l) {
+          spectrum[l] = distribution(generator) * watt_per_square_meter_per_nm;
+        }
+        aos_texture->Set(i, j, k, spectrum);
+      }
+    }
+  }
+  std::unique_ptr<SpectralTexture> soa_texture(new SpectralTexture(
+      aos_texture->size_x(), aos_texture->size_y(), aos_texture->size_z(),
+      kNumWavelengths));
+  soa_texture->CopyFrom(*aos_texture);
+
+  std::vector<vec3> uvws;
+  for (int i = 0; i < kNumLookups; ++i) {
+    uvws.push_back(vec3(distribution(generator), distribution(generator),
+        distribution(generator)));
+  }
+
+  // The checksums prevent the compiler from optimizing the lookups away, and
+  // must be the same for the two texture layouts.
+  double checksum = 0.0;
+  double ns = Benchmark(uvws, [&](const vec3& uvw) {
+    IrradianceSpectrum spectrum = texture(*aos_texture, uvw);
+    checksum += spectrum[19].to(watt_per_square_meter_per_nm);
+  });
+  Report("Spectrum per texel, 1 wavelength", ns, checksum);
+
+  checksum = 0.0;
+  ns = Benchmark(uvws, [&](const vec3& uvw) {
+    IrradianceSpectrum spectrum = texture(*aos_texture, uvw);
+    checksum += spectrum[31].to(watt_per_square_meter_per_nm) +
+        spectrum[19].to(watt_per_square_meter_per_nm) +
+        spectrum[8].to(watt_per_square_meter_per_nm);
+  });
+  Report("Spectrum per texel, 3 wavelengths", ns, checksum);
+
+  for (const std::vector<int>& wavelengths :
+       {std::vector<int>{19}, std::vector<int>{31, 19, 8}}) {
+    checksum = 0.0;
+    ns = Benchmark(uvws, [&](const vec3& uvw) {
+      double values[kNumWavelengths];
+      soa_texture->Lookup(
+          uvw, wavelengths.data(), wavelengths.size(), values);
+      for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+        checksum += values[l];
+      }
+    });
+    Report("Array per wavelength, " + std::to_string(wavelengths.size()) +
+        (wavelengths.size() == 1 ? " wavelength" : " wavelengths"),
+        ns, checksum);
+  }
+
+  std::vector<int> all_wavelengths;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    all_wavelengths.push_back(l);
+  }
+  checksum = 0.0;
+  ns = Benchmark(uvws, [&](const vec3& uvw) {
+    IrradianceSpectrum spectrum = texture(*aos_texture, uvw);
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      checksum += spectrum[l].to(watt_per_square_meter_per_nm);
+    }
+  });
+  Report("Spectrum per texel, all wavelengths", ns, checksum);
+
+  checksum = 0.0;
+  ns = Benchmark(uvws, [&](const vec3& uvw) {
+    double values[kNumWavelengths];
+    soa_texture->Lookup(
+        uvw, all_wavelengths.data(), all_wavelengths.size(), values);
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      checksum += values[l];
+    }
+  });
+  Report("Array per wavelength, all wavelengths", ns, checksum);
+  return EXIT_SUCCESS;
+}
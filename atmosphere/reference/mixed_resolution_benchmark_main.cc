@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/mixed_resolution_benchmark_main.cc</h2>
+
+<p>This file provides a small benchmark comparing the
+<a href="model.h.html">CPU model</a> computing all the scattering orders with
+the full resolution, with the same model computing some orders with a lower
+resolution (see <code>Model::set_scattering_order_resolutions</code>). For the
+default atmosphere of the <a href="atmosphere_config.h.html">config files</a>,
+it reports
+<ul>
+<li>the wall time of each precomputation phase (summed over the scattering
+orders, 4 by default), and of the whole precomputation, with the two models,
+and the corresponding speedup,</li>
+<li>the maximum difference between the sky radiance values computed with the
+two models, for random cameras, view rays and sun directions, relatively to the
+maximum sky radiance value, as well as the root mean square of this relative
+difference,</li>
+<li>the same differences for the sky irradiance values, for random points,
+normals and sun directions.</li>
+</ul>
+The resolution of each scattering order, from the 2nd one, is specified with its
+scattering texture sizes, as
+<code>r_size</code>x<code>mu_size</code>x<code>mu_s_size</code>x<code>nu_size
+</code> (e.g. 16x64x16x4), or with <code>full</code> for the full resolution.
+The last resolution is used for all the subsequent orders, and the irradiance
+texture always has the full resolution. By default, the 2nd order uses the full
+resolution, and the other orders use half the full size in each dimension.
+Usage:
+<pre>
+atmosphere_mixed_resolution_benchmark [num_scattering_orders [resolution...]]
+</pre>
+*/
+
+#include <stdlib.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/atmosphere_config.h"
+#include "atmosphere/reference/benchmark_util.h"
+#include "atmosphere/reference/model.h"
+
+namespace {
+
+using atmosphere::TextureResolution;
+using atmosphere::reference::AtmosphereConfig;
+using atmosphere::reference::AtmosphereParameters;
+using atmosphere::reference::DimensionlessSpectrum;
+using atmosphere::reference::Direction;
+using atmosphere::reference::GetAtmosphereParameters;
+using atmosphere::reference::IrradianceSpectrum;
+using atmosphere::reference::Length;
+using atmosphere::reference::Model;
+using atmosphere::reference::ParseResolution;
+using atmosphere::reference::Position;
+using atmosphere::reference::Precompute;
+using atmosphere::reference::PrintDifference;
+using atmosphere::reference::RadianceSpectrum;
+using atmosphere::reference::RandomDirection;
+using atmosphere::reference::RemoveDirectory;
+using atmosphere::reference::m;
+using atmosphere::reference::watt_per_square_meter_per_nm;
+using atmosphere::reference::watt_per_square_meter_per_sr_per_nm;
+
+constexpr int kNumQueries = 1 << 14;
+
+const char* kDefaultResolutions[] = {"full", "16x64x16x4"};
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  const unsigned int num_scattering_orders =
+      argc > 1 ? std::atoi(argv[1]) : 4;
+  std::vector<std::string> resolution_names;
+  for (int i = 2; i < argc; ++i) {
+    resolution_names.push_back(argv[i]);
+  }
+  if (resolution_names.empty()) {
+    resolution_names.assign(std::begin(kDefaultResolutions),
+        std::end(kDefaultResolutions));
+  }
+  if (num_scattering_orders < 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [num_scattering_orders [resolution...]]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<TextureResolution> resolutions;
+  for (const std::string& resolution_name : resolution_names) {
+    TextureResolution resolution;
+    if (resolution_name != "full" &&
+        !ParseResolution(resolution_name, false, &resolution)) {
+      std::cerr << "Invalid resolution " << resolution_name << std::endl;
+      return EXIT_FAILURE;
+    }
+    resolutions.push_back(resolution);
+  }
+
+  // Use a separate, new cache directory for each model, to make sure that the
+  // textures are computed.
+  char full_directory[] = "/tmp/atmosphere_mixed_resolution_benchmark.XXXXXX";
+  char mixed_directory[] =
+      "/tmp/atmosphere_mixed_resolution_benchmark.XXXXXX";
+  if (mkdtemp(full_directory) == nullptr ||
+      mkdtemp(mixed_directory) == nullptr) {
+    std::cerr << "Cannot create a temporary directory" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const AtmosphereParameters atmosphere =
+      GetAtmosphereParameters(AtmosphereConfig());
+  Model full_model(atmosphere, std::string(full_directory) + "/");
+  Model mixed_model(atmosphere, std::string(mixed_directory) + "/");
+  mixed_model.set_scattering_order_resolutions(resolutions);
+
+  std::map<std::string, double> full_times;
+  std::map<std::string, double> mixed_times;
+  Precompute(&full_model, num_scattering_orders, &full_times);
+  Precompute(&mixed_model, num_scattering_orders, &mixed_times);
+  RemoveDirectory(std::string(full_directory) + "/");
+  RemoveDirectory(std::string(mixed_directory) + "/");
+  for (const auto& phase : mixed_times) {
+    full_times[phase.first];
+  }
+  for (const auto& phase : full_times) {
+    const double mixed_time = mixed_times[phase.first];
+    std::cout << (phase.first.empty() ? "total" : phase.first) << ": full "
+              << phase.second << " s, mixed " << mixed_time << " s, speedup "
+              << phase.second / mixed_time << std::endl;
+  }
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  std::vector<double> full_radiance;
+  std::vector<double> mixed_radiance;
+  std::vector<double> full_irradiance;
+  std::vector<double> mixed_irradiance;
+  for (int i = 0; i < kNumQueries; ++i) {
+    const Length r = atmosphere.bottom_radius + distribution(generator) *
+        (atmosphere.top_radius - atmosphere.bottom_radius);
+    const Position camera(0.0 * m, 0.0 * m, r);
+    const Direction view_ray = RandomDirection(&generator);
+    const Direction sun_direction = RandomDirection(&generator);
+    DimensionlessSpectrum transmittance;
+    const RadianceSpectrum full = full_model.GetSkyRadiance(camera, view_ray,
+        0.0 * m, sun_direction, &transmittance);
+    const RadianceSpectrum mixed = mixed_model.GetSkyRadiance(camera,
+        view_ray, 0.0 * m, sun_direction, &transmittance);
+    IrradianceSpectrum full_sky_irradiance;
+    IrradianceSpectrum mixed_sky_irradiance;
+    full_model.GetSunAndSkyIrradiance(camera, view_ray, sun_direction,
+        &full_sky_irradiance);
+    mixed_model.GetSunAndSkyIrradiance(camera, view_ray, sun_direction,
+        &mixed_sky_irradiance);
+    for (unsigned int l = 0; l < full.size(); ++l) {
+      full_radiance.push_back(full[l].to(watt_per_square_meter_per_sr_per_nm));
+      mixed_radiance.push_back(
+          mixed[l].to(watt_per_square_meter_per_sr_per_nm));
+      full_irradiance.push_back(
+          full_sky_irradiance[l].to(watt_per_square_meter_per_nm));
+      mixed_irradiance.push_back(
+          mixed_sky_irradiance[l].to(watt_per_square_meter_per_nm));
+    }
+  }
+  PrintDifference("Sky radiance", full_radiance, mixed_radiance);
+  PrintDifference("Sky irradiance", full_irradiance, mixed_irradiance);
+  return EXIT_SUCCESS;
+}
@@ -44,44 +44,500 @@ This is the role of the following code.
 
 #include "atmosphere/reference/model.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "atmosphere/reference/fast_functions.h"
 #include "atmosphere/reference/functions.h"
-#include "util/progress_bar.h"
+#include "atmosphere/reference/multiple_scattering_lut.h"
+#include "atmosphere/reference/pass_graph.h"
+#include "atmosphere/reference/scattering_density_simd.h"
+#include "atmosphere/reference/texture_cache.h"
+#include "atmosphere/spherical_quadrature.h"
 
 /*
 <p>The constructor of the <code>Model</code> class allocates the precomputed
-textures, but does not initialize them.
+textures, but does not initialize them. It also creates the schedulers used to
+precompute them in parallel, and to process batches of queries in parallel
+(using tiles of consecutive queries, large enough to amortize the scheduling
+cost, which is much larger than the cost of a single query). Both schedulers
+use the same <a href="thread_pool.h.html">thread pool</a>.
 */
 
 namespace atmosphere {
 namespace reference {
 
+namespace {
+
+constexpr unsigned int kQueriesPerTile = 256;
+
+double GetSpectrumSum(const IrradianceSpectrum& spectrum) {
+  double sum = 0.0;
+  for (unsigned int l = 0; l < spectrum.size(); ++l) {
+    sum += spectrum[l].to(watt_per_square_meter_per_nm);
+  }
+  return sum;
+}
+
+// Allocates a texture of the given type, with the resolution specified in
+// 'resolution' for this type of texture.
+TransmittanceTexture* NewTransmittanceTexture(
+    const TextureResolution& resolution) {
+  return new TransmittanceTexture(
+      resolution.transmittance_width, resolution.transmittance_height);
+}
+
+IrradianceTexture* NewIrradianceTexture(const TextureResolution& resolution) {
+  return new IrradianceTexture(
+      resolution.irradiance_width, resolution.irradiance_height);
+}
+
+template<class T>
+T* NewScatteringTexture(const TextureResolution& resolution) {
+  return new T(resolution.scattering_width(), resolution.scattering_height(),
+      resolution.scattering_depth());
+}
+
+// Returns whether the scattering and irradiance textures have the same size
+// with the two given resolutions.
+bool HaveSameScatteringSizes(const TextureResolution& resolution1,
+    const TextureResolution& resolution2) {
+  return resolution1.scattering_r_size == resolution2.scattering_r_size &&
+      resolution1.scattering_mu_size == resolution2.scattering_mu_size &&
+      resolution1.scattering_mu_s_size == resolution2.scattering_mu_s_size &&
+      resolution1.scattering_nu_size == resolution2.scattering_nu_size &&
+      resolution1.irradiance_width == resolution2.irradiance_width &&
+      resolution1.irradiance_height == resolution2.irradiance_height;
+}
+
+// Allocates and fills the table of sample directions and weights of the
+// spherical quadrature rule used in ComputeScatteringDensity and in
+// ComputeIndirectIrradiance (see GetSphericalSample in functions.glsl).
+SphericalSamplesTexture* NewSphericalSamplesTexture(
+    const AtmosphereParameters& atmosphere) {
+  const Quadrature& quadrature = atmosphere.quadrature;
+  SphericalSamplesTexture* texture = new SphericalSamplesTexture(
+      GetSphericalSamplesTextureWidth(quadrature),
+      SPHERICAL_SAMPLES_TEXTURE_HEIGHT, vec4(0.0, 0.0, 1.0, 0.0));
+  const int rows[2] =
+      {SCATTERING_DENSITY_SAMPLES_ROW, INDIRECT_IRRADIANCE_SAMPLES_ROW};
+  const int sample_counts[2] = {quadrature.scattering_density_sample_count,
+      quadrature.indirect_irradiance_sample_count};
+  for (int k = 0; k < 2; ++k) {
+    std::vector<SphericalSample> samples = ComputeSphericalSamples(
+        quadrature.spherical_rule, sample_counts[k],
+        rows[k] == INDIRECT_IRRADIANCE_SAMPLES_ROW /* hemisphere */,
+        atmosphere.mie_phase_function_g());
+    for (unsigned int i = 0; i < samples.size(); ++i) {
+      const SphericalSample& sample = samples[i];
+      texture->Set(i, rows[k],
+          vec4(sample.x, sample.y, sample.z, sample.weight));
+    }
+  }
+  return texture;
+}
+
+}  // anonymous namespace
+
+Model::Model(const AtmosphereParameters& atmosphere,
+             const std::string& cache_directory,
+             unsigned int num_threads,
+             const TileSize& tile_size,
+             const TextureCacheFormat& cache_format)
+    : Model(atmosphere, cache_directory, num_threads == 0 ?
+          ThreadPool::GetDefault() :
+          std::make_shared<ThreadPool>(ThreadPoolOptions(num_threads)),
+          tile_size, cache_format) {}
+
 Model::Model(const AtmosphereParameters& atmosphere,
-             const std::string& cache_directory)
+             const std::string& cache_directory,
+             std::shared_ptr<ThreadPool> thread_pool,
+             const TileSize& tile_size,
+             const TextureCacheFormat& cache_format)
     : atmosphere_(atmosphere),
-      cache_directory_(cache_directory) {
-  transmittance_texture_.reset(new TransmittanceTexture());
-  scattering_texture_.reset(new ReducedScatteringTexture());
-  single_mie_scattering_texture_.reset(new ReducedScatteringTexture());
-  irradiance_texture_.reset(new IrradianceTexture());
+      fast_atmosphere_(fast::FromDimensional(atmosphere)),
+      cache_directory_(cache_directory),
+      cache_format_(cache_format),
+      num_scattering_orders_(0),
+      requested_num_scattering_orders_(0),
+      requested_convergence_tolerance_(0.0),
+      progress_sink_(std::make_shared<TerminalProgressSink>()),
+      use_fast_functions_(false),
+      use_fast_functions_set_(false),
+      scattering_order_resolutions_set_(false),
+      use_multiple_scattering_lut_(false),
+      keep_single_scattering_(false),
+      share_precompute_stages_(false),
+      scheduler_(thread_pool, tile_size),
+      batch_scheduler_(thread_pool, TileSize(kQueriesPerTile, 1, 1)) {
+  const TextureResolution& resolution = atmosphere.texture_resolution;
+  assert(resolution.IsValid());
+  transmittance_texture_.reset(NewTransmittanceTexture(resolution));
+  scattering_texture_.reset(
+      NewScatteringTexture<ReducedScatteringTexture>(resolution));
+  single_mie_scattering_texture_.reset(
+      NewScatteringTexture<ReducedScatteringTexture>(resolution));
+  irradiance_texture_.reset(NewIrradianceTexture(resolution));
+}
+
+Model::~Model() {
+  if (init_thread_.joinable()) {
+    init_handle_->Cancel();
+    init_thread_.join();
+  }
+}
+
+/*
+<p>The resolution used to compute each scattering order is given by the
+following methods. Only the scattering and irradiance texture sizes of the
+atmosphere parameters can change with the scattering order, and the parameters
+hash only depends on these sizes if they are not all equal to those of the
+atmosphere parameters, so that a precomputation with the default resolution for
+all the orders can use the same cache files in all cases.
+*/
+
+void Model::set_scattering_order_resolutions(
+    const std::vector<TextureResolution>& resolutions) {
+  assert(std::all_of(resolutions.begin(), resolutions.end(),
+      [](const TextureResolution& resolution) {
+        return resolution.IsValid();
+      }));
+  scattering_order_resolutions_ = resolutions;
+  scattering_order_resolutions_set_ = true;
 }
 
 /*
-<p>The initialization is done in the following method, which first tries to load
-the textures from disk, if they have already been precomputed.
+<p>In the multiple scattering LUT mode the 2nd order is computed by default with
+half the resolution of the atmosphere parameters in each dimension (rounded to
+satisfy the <code>TextureResolution</code> constraints). Like the default use
+of the fast functions in this mode (see <code>UseFastFunctions</code>), this
+default is derived from the current options each time it is needed, instead of
+being stored in <code>scattering_order_resolutions_</code>, so that it does not
+depend on the order in which the options are set:
 */
 
-void Model::Init(unsigned int num_scattering_orders) {
-  std::ifstream file;
-  file.open(cache_directory_ + "transmittance.dat");
-  if (file.good()) {
-    file.close();
-    transmittance_texture_->Load(cache_directory_ + "transmittance.dat");
-    scattering_texture_->Load(cache_directory_ + "scattering.dat");
-    single_mie_scattering_texture_->Load(
-        cache_directory_ + "single_mie_scattering.dat");
-    irradiance_texture_->Load(cache_directory_ + "irradiance.dat");
+AtmosphereParameters Model::GetScatteringOrderAtmosphere(
+    unsigned int scattering_order) const {
+  AtmosphereParameters atmosphere = atmosphere_;
+  if (scattering_order < 2) {
+    return atmosphere;
+  }
+  TextureResolution& resolution = atmosphere.texture_resolution;
+  TextureResolution order_resolution = resolution;
+  if (!scattering_order_resolutions_.empty()) {
+    order_resolution =
+        scattering_order_resolutions_[std::min<size_t>(scattering_order - 2,
+            scattering_order_resolutions_.size() - 1)];
+  } else if (use_multiple_scattering_lut_ &&
+      !scattering_order_resolutions_set_) {
+    order_resolution.scattering_r_size =
+        std::max(2, resolution.scattering_r_size / 2);
+    order_resolution.scattering_mu_size =
+        std::max(2, resolution.scattering_mu_size / 4 * 2);
+    order_resolution.scattering_mu_s_size =
+        std::max(2, resolution.scattering_mu_s_size / 2);
+    order_resolution.scattering_nu_size =
+        std::max(2, resolution.scattering_nu_size / 2);
+    order_resolution.irradiance_width =
+        std::max(2, resolution.irradiance_width / 2);
+    order_resolution.irradiance_height =
+        std::max(2, resolution.irradiance_height / 2);
+  }
+  resolution.scattering_r_size = order_resolution.scattering_r_size;
+  resolution.scattering_mu_size = order_resolution.scattering_mu_size;
+  resolution.scattering_mu_s_size = order_resolution.scattering_mu_s_size;
+  resolution.scattering_nu_size = order_resolution.scattering_nu_size;
+  resolution.irradiance_width = order_resolution.irradiance_width;
+  resolution.irradiance_height = order_resolution.irradiance_height;
+  return atmosphere;
+}
+
+uint64_t Model::HashParameters(unsigned int num_scattering_orders,
+    double convergence_tolerance) const {
+  std::vector<TextureResolution> resolutions;
+  bool mixed_resolutions = false;
+  for (unsigned int scattering_order = 2;
+       scattering_order <= num_scattering_orders; ++scattering_order) {
+    resolutions.push_back(
+        GetScatteringOrderAtmosphere(scattering_order).texture_resolution);
+    mixed_resolutions |= !HaveSameScatteringSizes(resolutions.back(),
+        atmosphere_.texture_resolution);
+  }
+  return HashModelParameters(atmosphere_, num_scattering_orders,
+      convergence_tolerance,
+      mixed_resolutions ? resolutions : std::vector<TextureResolution>(),
+      UseFastFunctions(), use_multiple_scattering_lut_);
+}
+
+/*
+<p>The initialization can be done synchronously, or asynchronously in a new
+thread. In the second case, the returned handle is used to communicate with
+this thread: the initialization thread updates its progress, and checks its
+cancellation flag and its deadline, while the caller reads the progress,
+requests the cancellation and waits for the status, which is sent via a
+promise.
+*/
+
+Model::InitHandle::InitHandle(std::chrono::steady_clock::time_point deadline)
+    : deadline_(deadline), cancelled_(false),
+      status_(promise_.get_future().share()) {}
+
+Model::InitProgress Model::InitHandle::GetProgress() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return progress_;
+}
+
+void Model::Init(unsigned int num_scattering_orders, bool use_checkpoints,
+    double convergence_tolerance) {
+  DoInit(num_scattering_orders, use_checkpoints, convergence_tolerance,
+      nullptr);
+  InitFastTextures();
+}
+
+std::shared_ptr<Model::InitHandle> Model::InitAsync(
+    unsigned int num_scattering_orders, bool use_checkpoints,
+    double convergence_tolerance,
+    std::chrono::steady_clock::time_point deadline) {
+  if (init_thread_.joinable()) {
+    init_thread_.join();
+  }
+  std::shared_ptr<InitHandle> handle = std::make_shared<InitHandle>(deadline);
+  init_handle_ = handle;
+  init_thread_ = std::thread([=]() {
+    InitStatus status = DoInit(num_scattering_orders, use_checkpoints,
+        convergence_tolerance, handle.get());
+    InitFastTextures();
+    handle->promise_.set_value(status);
+  });
+  return handle;
+}
+
+void Model::InitFastTextures() {
+  if (!UseFastFunctions()) {
     return;
   }
+  fast_transmittance_texture_.reset(
+      new fast::TransmittanceTexture(*transmittance_texture_));
+  fast_scattering_texture_.reset(
+      new fast::ReducedScatteringTexture(*scattering_texture_));
+  fast_single_mie_scattering_texture_.reset(
+      new fast::ReducedScatteringTexture(*single_mie_scattering_texture_));
+  fast_irradiance_texture_.reset(
+      new fast::IrradianceTexture(*irradiance_texture_));
+}
+
+/*
+<p>All the precomputed textures, except the transmittance, are linear in the
+solar irradiance (at each wavelength), and the transmittance and the single
+scattering do not depend on the ground albedo. A change of these parameters can
+thus be handled much faster than with a new initialization: a change of the
+solar irradiance only requires a rescaling of the textures, and a change of the
+ground albedo only requires to recompute the scattering orders from the 2nd one
+(from the kept single scattering, rescaled if the solar irradiance changed too).
+The other parameters are compared via their hash, which includes all the
+parameters used to precompute the textures.
+*/
+
+Model::ParameterChange Model::ClassifyParameterChange(
+    const AtmosphereParameters& old_atmosphere,
+    const AtmosphereParameters& new_atmosphere) {
+  AtmosphereParameters atmosphere = new_atmosphere;
+  atmosphere.solar_irradiance = old_atmosphere.solar_irradiance;
+  atmosphere.ground_albedo = old_atmosphere.ground_albedo;
+  if (HashModelParameters(atmosphere, 1) !=
+      HashModelParameters(old_atmosphere, 1)) {
+    return OTHER_CHANGE;
+  }
+  bool solar_irradiance_changed = false;
+  bool ground_albedo_changed = false;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    const SpectralIrradiance old_value = old_atmosphere.solar_irradiance[l];
+    if (new_atmosphere.solar_irradiance[l] != old_value) {
+      if (old_value == 0.0 * watt_per_square_meter_per_nm) {
+        return OTHER_CHANGE;
+      }
+      solar_irradiance_changed = true;
+    }
+    if (new_atmosphere.ground_albedo[l] != old_atmosphere.ground_albedo[l]) {
+      ground_albedo_changed = true;
+    }
+  }
+  if (ground_albedo_changed) {
+    return GROUND_ALBEDO_CHANGE;
+  }
+  return solar_irradiance_changed ? SOLAR_IRRADIANCE_CHANGE : NO_CHANGE;
+}
+
+Model::ParameterChange Model::Update(const AtmosphereParameters& atmosphere) {
+  assert(requested_num_scattering_orders_ > 0);
+  if (init_thread_.joinable()) {
+    init_thread_.join();
+  }
+  ParameterChange change = ClassifyParameterChange(atmosphere_, atmosphere);
+  if (change == NO_CHANGE) {
+    return change;
+  }
+  // Without the kept single scattering, all the orders must be recomputed.
+  if (change == GROUND_ALBEDO_CHANGE && !single_rayleigh_scattering_texture_) {
+    change = OTHER_CHANGE;
+  }
+  if (change == OTHER_CHANGE) {
+    const TextureResolution& resolution = atmosphere.texture_resolution;
+    assert(resolution.IsValid());
+    if (!HaveSameScatteringSizes(resolution, atmosphere_.texture_resolution) ||
+        resolution.transmittance_width !=
+            atmosphere_.texture_resolution.transmittance_width ||
+        resolution.transmittance_height !=
+            atmosphere_.texture_resolution.transmittance_height) {
+      transmittance_texture_.reset(NewTransmittanceTexture(resolution));
+      scattering_texture_.reset(
+          NewScatteringTexture<ReducedScatteringTexture>(resolution));
+      single_mie_scattering_texture_.reset(
+          NewScatteringTexture<ReducedScatteringTexture>(resolution));
+      irradiance_texture_.reset(NewIrradianceTexture(resolution));
+    }
+    atmosphere_ = atmosphere;
+    fast_atmosphere_ = fast::FromDimensional(atmosphere);
+    texel_geometry_.reset();
+    DoInit(requested_num_scattering_orders_, false,
+        requested_convergence_tolerance_, nullptr);
+  } else {
+    DimensionlessSpectrum scale(1.0);
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      if (atmosphere.solar_irradiance[l] != atmosphere_.solar_irradiance[l]) {
+        scale[l] =
+            atmosphere.solar_irradiance[l] / atmosphere_.solar_irradiance[l];
+      }
+    }
+    atmosphere_ = atmosphere;
+    fast_atmosphere_ = fast::FromDimensional(atmosphere);
+    profile_.Clear();
+    PrecomputePhase phase("rescaling", 0, 0);
+    Stopwatch stopwatch;
+    *single_mie_scattering_texture_ *= scale;
+    if (single_rayleigh_scattering_texture_) {
+      *single_rayleigh_scattering_texture_ *= scale;
+      *direct_irradiance_texture_ *= scale;
+    }
+    if (change == SOLAR_IRRADIANCE_CHANGE) {
+      *scattering_texture_ *= scale;
+      *irradiance_texture_ *= scale;
+      phase.wall_time = stopwatch.GetElapsedTime();
+      profile_.AddPhase(phase);
+    } else {
+      DoInit(requested_num_scattering_orders_, false,
+          requested_convergence_tolerance_, nullptr, true);
+    }
+  }
+  InitFastTextures();
+  if (spectral_scattering_texture_) {
+    InitSpectralTextures();
+  }
+  return change;
+}
+
+/*
+<p>The initialization itself is done in the following method, which first tries
+to load the textures from disk, if they have already been precomputed with the
+same parameters (see <a href="texture_cache.h.html">texture_cache.h</a>). With a
+convergence tolerance, the number of scattering orders actually used is not
+known in advance, and is thus also saved in the cache.
+
+<p>Each phase of this method is recorded in a profile (see
+<a href="../precompute_profile.h.html">precompute_profile.h</a>), with the
+following helpers: <code>run_phase</code> computes a texture with the scheduler
+and records the time spent by each thread, while <code>time_phase</code> records
+the wall time of a sequential phase, such as loading or saving textures. With a
+handle, <code>run_phase</code> also updates its current phase, and skips the
+remaining tiles as soon as a stop is requested (by a cancellation or by the
+deadline). Stop requests are ignored when <code>can_stop</code> is false. Since
+some phases are run concurrently (see below), the profile is updated with a
+lock.
+*/
+
+Model::InitStatus Model::DoInit(unsigned int num_scattering_orders,
+    bool use_checkpoints, double convergence_tolerance, InitHandle* handle,
+    bool reuse_single_scattering) {
+  assert(!reuse_single_scattering || (!use_checkpoints &&
+      single_rayleigh_scattering_texture_ && direct_irradiance_texture_));
+  profile_.Clear();
+  requested_num_scattering_orders_ = num_scattering_orders;
+  requested_convergence_tolerance_ = convergence_tolerance;
+  const bool use_fast_functions = UseFastFunctions();
+  if (!reuse_single_scattering) {
+    single_rayleigh_scattering_texture_.reset();
+    direct_irradiance_texture_.reset();
+  }
+  stage_handles_.clear();
+  bool can_stop = handle != nullptr;
+  std::atomic<bool> stopped(false);
+  std::mutex profile_mutex;
+  // The progress is not updated after a stop, so that it still shows the phase
+  // which was stopped (and not the concurrent phases which are skipped, or the
+  // cache loads done to find a partial result).
+  auto set_phase = [&](const std::string& name, unsigned int scattering_order) {
+    if (handle != nullptr && !stopped) {
+      std::lock_guard<std::mutex> lock(handle->mutex_);
+      handle->progress_.phase = name;
+      handle->progress_.scattering_order = scattering_order;
+    }
+  };
+  auto run_phase = [&](const std::string& name, unsigned int scattering_order,
+      unsigned int width, unsigned int height, unsigned int depth,
+      const std::function<void(const Tile&)>& job) {
+    set_phase(name, scattering_order);
+    PrecomputePhase phase(name, scattering_order, width * height * depth);
+    Stopwatch stopwatch;
+    scheduler_.Run(width, height, depth, [&](const Tile& tile) {
+      if (can_stop && (stopped || handle->IsStopRequested())) {
+        stopped = true;
+        return;
+      }
+      job(tile);
+    }, &phase.thread_busy_times);
+    phase.wall_time = stopwatch.GetElapsedTime();
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    profile_.AddPhase(phase);
+  };
+  auto time_phase = [&](const std::string& name, unsigned int scattering_order,
+      const std::function<bool()>& function) {
+    set_phase(name, scattering_order);
+    PrecomputePhase phase(name, scattering_order, 0);
+    Stopwatch stopwatch;
+    const bool result = function();
+    phase.wall_time = stopwatch.GetElapsedTime();
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    profile_.AddPhase(phase);
+    return result;
+  };
+
+  // With the multiple scattering LUT, the 2nd "scattering order" includes all
+  // the higher orders (see set_use_multiple_scattering_lut).
+  if (use_multiple_scattering_lut_) {
+    num_scattering_orders = std::min(num_scattering_orders, 2u);
+    convergence_tolerance = 0.0;
+  }
+  const TextureCache cache(cache_directory_,
+      HashParameters(num_scattering_orders, convergence_tolerance),
+      cache_format_);
+  double cached_num_scattering_orders = num_scattering_orders;
+  if (time_phase("cache_load", 0, [&]() {
+        return cache.Load("transmittance.dat", transmittance_texture_.get()) &&
+            cache.Load("scattering.dat", scattering_texture_.get()) &&
+            cache.Load("single_mie_scattering.dat",
+                single_mie_scattering_texture_.get()) &&
+            cache.Load("irradiance.dat", irradiance_texture_.get()) &&
+            (convergence_tolerance <= 0.0 || cache.Load(
+                "scattering_orders.dat", &cached_num_scattering_orders));
+      })) {
+    num_scattering_orders_ = cached_num_scattering_orders;
+    return COMPLETED;
+  }
 
 /*
 <p>If they have not already been precomputed, we must compute them here. This
@@ -89,25 +545,303 @@ computation requires some temporary textures, in particular to store the
 contribution of one scattering order, which is needed to compute the next order
 of scattering (the final precomputed textures store the sum of all the
 scattering orders). We allocate these textures here (they are automatically
-destroyed at the end of this method).
+destroyed at the end of this method). The delta irradiance texture is double
+buffered, so that the indirect irradiance of an order can be computed while the
+scattering density of this order reads the delta irradiance of the previous
+order (see below). We also compute here the table of sample directions and
+weights used to integrate over the incident directions (see
+<a href="../spherical_quadrature.h.html">spherical_quadrature.h</a>), and, once
+per model, the parameters of each texel, which are used by all the phases and
+scattering orders (see <a href="texel_geometry.h.html">texel_geometry.h</a>).
 */
 
+  const TextureResolution& resolution = atmosphere_.texture_resolution;
+  std::unique_ptr<IrradianceTexture>
+      delta_irradiance_texture(NewIrradianceTexture(resolution));
   std::unique_ptr<IrradianceTexture>
-      delta_irradiance_texture(new IrradianceTexture());
-  std::unique_ptr<ReducedScatteringTexture>
-      delta_rayleigh_scattering_texture(new ReducedScatteringTexture());
+      next_delta_irradiance_texture(NewIrradianceTexture(resolution));
+  std::unique_ptr<ReducedScatteringTexture> delta_rayleigh_scattering_texture(
+      NewScatteringTexture<ReducedScatteringTexture>(resolution));
   ReducedScatteringTexture* delta_mie_scattering_texture =
       single_mie_scattering_texture_.get();
-  std::unique_ptr<ScatteringDensityTexture>
-      delta_scattering_density_texture(new ScatteringDensityTexture());
-  std::unique_ptr<ScatteringTexture>
-      delta_multiple_scattering_texture(new ScatteringTexture());
+  std::unique_ptr<ScatteringDensityTexture> delta_scattering_density_texture(
+      NewScatteringTexture<ScatteringDensityTexture>(resolution));
+  std::unique_ptr<ScatteringTexture> delta_multiple_scattering_texture(
+      NewScatteringTexture<ScatteringTexture>(resolution));
+  std::unique_ptr<SphericalSamplesTexture> spherical_samples_texture(
+      NewSphericalSamplesTexture(atmosphere_));
+  if (!texel_geometry_) {
+    time_phase("texel_geometry", 0, [&]() {
+      texel_geometry_.reset(new TexelGeometry(atmosphere_));
+      return true;
+    });
+  }
+  const TexelGeometry& geometry = *texel_geometry_;
+
+/*
+<p>The scattering orders from the 2nd one can be computed with a lower
+resolution than the final textures (see
+<code>set_scattering_order_resolutions</code>). For this, the above "delta"
+textures, as well as the atmosphere and texel parameters used to compute them,
+are changed to the resolution of each order with the following function. It
+also resamples the delta textures which are read by this order, from the
+resolution of the previous one: the delta irradiance, and the delta single
+scattering (for the 2nd order) or the delta multiple scattering (for the other
+orders). The other delta textures are only reallocated, and are not resampled
+at all if <code>resample</code> is false (when they are loaded from a checkpoint
+instead). At the end of each order, the delta textures are upsampled when they
+are accumulated in the final textures (see below).
+*/
+
+  AtmosphereParameters delta_atmosphere = atmosphere_;
+  std::unique_ptr<TexelGeometry> delta_texel_geometry;
+  const TexelGeometry* delta_geometry = &geometry;
+  std::unique_ptr<ReducedScatteringTexture> delta_mie_scattering_copy;
+  auto set_delta_resolution = [&](unsigned int scattering_order,
+      bool resample) {
+    const AtmosphereParameters order_atmosphere =
+        GetScatteringOrderAtmosphere(scattering_order);
+    const TextureResolution& order_resolution =
+        order_atmosphere.texture_resolution;
+    if (HaveSameScatteringSizes(order_resolution,
+            delta_atmosphere.texture_resolution)) {
+      return;
+    }
+    std::unique_ptr<TexelGeometry> order_texel_geometry;
+    if (!HaveSameScatteringSizes(order_resolution, resolution)) {
+      time_phase("texel_geometry", scattering_order, [&]() {
+        order_texel_geometry.reset(new TexelGeometry(order_atmosphere));
+        return true;
+      });
+    }
+    const TexelGeometry& order_geometry =
+        order_texel_geometry ? *order_texel_geometry : geometry;
+    std::unique_ptr<IrradianceTexture> order_delta_irradiance_texture(
+        NewIrradianceTexture(order_resolution));
+    std::unique_ptr<ReducedScatteringTexture>
+        order_delta_rayleigh_scattering_texture(
+            NewScatteringTexture<ReducedScatteringTexture>(order_resolution));
+    std::unique_ptr<ReducedScatteringTexture> order_delta_mie_scattering_copy(
+        order_texel_geometry ?
+            NewScatteringTexture<ReducedScatteringTexture>(order_resolution) :
+            nullptr);
+    std::unique_ptr<ScatteringTexture> order_delta_multiple_scattering_texture(
+        NewScatteringTexture<ScatteringTexture>(order_resolution));
+    if (resample) {
+      run_phase("resampling", scattering_order,
+          order_resolution.scattering_width(),
+          order_resolution.scattering_height(),
+          order_resolution.scattering_depth(), [&](const Tile& tile) {
+        for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+          for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+            for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+              const ScatteringTexelGeometry& texel =
+                  order_geometry.scattering(i, j, k);
+              if (scattering_order == 2) {
+                order_delta_rayleigh_scattering_texture->Set(i, j, k,
+                    GetScattering(delta_atmosphere,
+                        *delta_rayleigh_scattering_texture, texel.r,
+                        texel.mu, texel.mu_s, texel.nu,
+                        texel.ray_r_mu_intersects_ground));
+                if (order_delta_mie_scattering_copy) {
+                  order_delta_mie_scattering_copy->Set(i, j, k,
+                      GetScattering(delta_atmosphere,
+                          *delta_mie_scattering_texture, texel.r, texel.mu,
+                          texel.mu_s, texel.nu,
+                          texel.ray_r_mu_intersects_ground));
+                }
+              } else {
+                order_delta_multiple_scattering_texture->Set(i, j, k,
+                    GetScattering(delta_atmosphere,
+                        *delta_multiple_scattering_texture, texel.r,
+                        texel.mu, texel.mu_s, texel.nu,
+                        texel.ray_r_mu_intersects_ground));
+              }
+            }
+          }
+        }
+      });
+      run_phase("resampling", scattering_order,
+          order_resolution.irradiance_width,
+          order_resolution.irradiance_height, 1, [&](const Tile& tile) {
+        for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+          for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+            const IrradianceTexelGeometry& texel =
+                order_geometry.irradiance(i, j);
+            order_delta_irradiance_texture->Set(i, j,
+                GetIrradiance(delta_atmosphere, *delta_irradiance_texture,
+                    texel.r, texel.mu_s));
+          }
+        }
+      });
+    }
+    delta_irradiance_texture = std::move(order_delta_irradiance_texture);
+    next_delta_irradiance_texture.reset(
+        NewIrradianceTexture(order_resolution));
+    delta_rayleigh_scattering_texture =
+        std::move(order_delta_rayleigh_scattering_texture);
+    delta_mie_scattering_copy = std::move(order_delta_mie_scattering_copy);
+    delta_mie_scattering_texture = delta_mie_scattering_copy ?
+        delta_mie_scattering_copy.get() : single_mie_scattering_texture_.get();
+    delta_scattering_density_texture.reset(
+        NewScatteringTexture<ScatteringDensityTexture>(order_resolution));
+    delta_multiple_scattering_texture =
+        std::move(order_delta_multiple_scattering_texture);
+    delta_atmosphere = order_atmosphere;
+    delta_texel_geometry = std::move(order_texel_geometry);
+    delta_geometry = delta_texel_geometry ? delta_texel_geometry.get() :
+        &geometry;
+  };
 
 /*
-<p>Since the computation phase takes several minutes, we show a progress bar to
-provide feedback to the user. The following constants roughly represent the
-relative duration of each computation phase, and are used to display a progress
-value which is roughly proportional to the elapsed time.
+<p>If checkpoints are enabled, the state of the computation is saved in the
+cache directory after each scattering order (in double precision and for all the
+wavelengths, whatever the cache format, to get the same results as without
+checkpoints). This state is made of the precomputed textures computed so far,
+and of the "delta" textures needed to compute the next order. The scattering
+density of each order, by far the most costly phase, is also saved as soon as it
+is computed. The parameters hash in these checkpoint files includes the
+scattering order of the saved state, so that an interrupted computation can
+resume from its last completed order (or phase), and so that increasing the
+number of scattering orders only computes the new orders. Since each checkpoint
+overwrites the previous one, the state is only kept for the last completed
+order.
+*/
+
+  auto checkpoint_cache = [&](unsigned int scattering_order) {
+    return TextureCache(cache_directory_, HashParameters(scattering_order));
+  };
+  auto load_checkpoint = [&](unsigned int scattering_order) {
+    const TextureCache checkpoint = checkpoint_cache(scattering_order);
+    return
+        checkpoint.Load("checkpoint_transmittance.dat",
+            transmittance_texture_.get()) &&
+        checkpoint.Load("checkpoint_scattering.dat",
+            scattering_texture_.get()) &&
+        checkpoint.Load("checkpoint_single_mie_scattering.dat",
+            single_mie_scattering_texture_.get()) &&
+        checkpoint.Load("checkpoint_irradiance.dat",
+            irradiance_texture_.get()) &&
+        checkpoint.Load("checkpoint_delta_irradiance.dat",
+            delta_irradiance_texture.get()) &&
+        checkpoint.Load("checkpoint_delta_rayleigh_scattering.dat",
+            delta_rayleigh_scattering_texture.get()) &&
+        checkpoint.Load("checkpoint_delta_multiple_scattering.dat",
+            delta_multiple_scattering_texture.get());
+  };
+  auto save_checkpoint = [&](unsigned int scattering_order) {
+    const TextureCache checkpoint = checkpoint_cache(scattering_order);
+    checkpoint.Save("checkpoint_transmittance.dat", *transmittance_texture_);
+    checkpoint.Save("checkpoint_scattering.dat", *scattering_texture_);
+    checkpoint.Save("checkpoint_single_mie_scattering.dat",
+        *single_mie_scattering_texture_);
+    checkpoint.Save("checkpoint_irradiance.dat", *irradiance_texture_);
+    checkpoint.Save("checkpoint_delta_irradiance.dat",
+        *delta_irradiance_texture);
+    checkpoint.Save("checkpoint_delta_rayleigh_scattering.dat",
+        *delta_rayleigh_scattering_texture);
+    checkpoint.Save("checkpoint_delta_multiple_scattering.dat",
+        *delta_multiple_scattering_texture);
+  };
+
+  // The first scattering order which remains to be computed.
+  unsigned int first_scattering_order = 1;
+  if (use_checkpoints) {
+    time_phase("checkpoint_load", 0, [&]() {
+      for (unsigned int scattering_order = num_scattering_orders;
+           scattering_order >= 1; --scattering_order) {
+        set_delta_resolution(scattering_order, false);
+        if (load_checkpoint(scattering_order)) {
+          first_scattering_order = scattering_order + 1;
+          return true;
+        }
+      }
+      return false;
+    });
+  }
+
+  // When only the ground albedo changed (see Update), the transmittance, the
+  // single Mie scattering, and the kept single Rayleigh scattering and direct
+  // irradiance are still valid, and the computation can start from the 2nd
+  // order, as after loading the checkpoint of the 1st order.
+  if (reuse_single_scattering) {
+    time_phase("single_scattering_copy", 1, [&]() {
+      delta_rayleigh_scattering_texture->CopyFrom(
+          *single_rayleigh_scattering_texture_);
+      scattering_texture_->CopyFrom(*single_rayleigh_scattering_texture_);
+      delta_irradiance_texture->CopyFrom(*direct_irradiance_texture_);
+      irradiance_texture_->Fill(
+          IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+      return true;
+    });
+    first_scattering_order = 2;
+  }
+
+/*
+<p>When the computation is stopped before its end, the partial results must be
+discarded, except if they contain all the contributions of the scattering orders
+completed so far (this is the case if the computation is stopped during any
+phase except the multiple scattering one, which is why stop requests are ignored
+during this phase). If the computation is stopped because the deadline expired,
+we then use the textures cached for the largest number of scattering orders, or
+the partial results, whichever has the most scattering orders. Partial results
+are also saved in the cache, since they are identical to those of a complete
+computation with fewer scattering orders.
+*/
+
+  auto save_cache = [&](const TextureCache& cache,
+      bool save_num_scattering_orders) {
+    time_phase("cache_save", 0, [&]() {
+      cache.Save("transmittance.dat", *transmittance_texture_);
+      cache.Save("scattering.dat", *scattering_texture_);
+      cache.Save("single_mie_scattering.dat", *single_mie_scattering_texture_);
+      cache.Save("irradiance.dat", *irradiance_texture_);
+      if (save_num_scattering_orders) {
+        cache.Save("scattering_orders.dat", num_scattering_orders_);
+      }
+      return true;
+    });
+  };
+  auto stop = [&](unsigned int num_completed_scattering_orders)
+      -> InitStatus {
+    if (handle->cancelled_) {
+      return CANCELLED;
+    }
+    for (unsigned int scattering_order = num_scattering_orders - 1;
+         scattering_order > num_completed_scattering_orders;
+         --scattering_order) {
+      const TextureCache fallback_cache(cache_directory_,
+          HashParameters(scattering_order), cache_format_);
+      if (time_phase("cache_load", scattering_order, [&]() {
+            return fallback_cache.Load("transmittance.dat",
+                    transmittance_texture_.get()) &&
+                fallback_cache.Load("scattering.dat",
+                    scattering_texture_.get()) &&
+                fallback_cache.Load("single_mie_scattering.dat",
+                    single_mie_scattering_texture_.get()) &&
+                fallback_cache.Load("irradiance.dat",
+                    irradiance_texture_.get());
+          })) {
+        num_scattering_orders_ = scattering_order;
+        return PARTIAL;
+      }
+    }
+    if (num_completed_scattering_orders == 0) {
+      return CANCELLED;
+    }
+    num_scattering_orders_ = num_completed_scattering_orders;
+    save_cache(TextureCache(cache_directory_,
+        HashParameters(num_completed_scattering_orders), cache_format_), false);
+    return PARTIAL;
+  };
+
+/*
+<p>Since the computation phase takes several minutes, we report its progress to
+provide feedback to the user (with a progress bar in the terminal by default,
+see <a href="progress.h.html">progress.h</a>). The following constants roughly
+represent the relative duration of each computation phase, and are used to
+report a progress value which is roughly proportional to the elapsed time (of
+the remaining phases, when resuming from a checkpoint).
 */
 
   constexpr unsigned int kTransmittanceProgress = 1;
@@ -116,132 +850,614 @@ value which is roughly proportional to the elapsed time.
   constexpr unsigned int kScatteringDensityProgress = 100;
   constexpr unsigned int kIndirectIrradianceProgress = 10;
   constexpr unsigned int kMultipleScatteringProgress = 10;
-  const unsigned int kTotalProgress =
-      TRANSMITTANCE_TEXTURE_WIDTH * TRANSMITTANCE_TEXTURE_HEIGHT *
-          kTransmittanceProgress +
-      IRRADIANCE_TEXTURE_WIDTH * IRRADIANCE_TEXTURE_HEIGHT * (
-          kDirectIrradianceProgress +
-          kIndirectIrradianceProgress * (num_scattering_orders - 1)) +
-      SCATTERING_TEXTURE_WIDTH * SCATTERING_TEXTURE_HEIGHT *
-          SCATTERING_TEXTURE_DEPTH * (
-              kSingleScatteringProgress +
-              (kScatteringDensityProgress + kMultipleScatteringProgress) *
-                  (num_scattering_orders - 1));
-
-  ProgressBar progress_bar(kTotalProgress);
+  constexpr unsigned int kUpsamplingProgress = 1;
+  constexpr unsigned int kMultipleScatteringLutProgress = 100;
+  constexpr unsigned int kMultipleScatteringLutDensityProgress = 1;
+  const unsigned int kTransmittanceTextureSize =
+      resolution.transmittance_width * resolution.transmittance_height;
+  const unsigned int kIrradianceTextureSize =
+      resolution.irradiance_width * resolution.irradiance_height;
+  const unsigned int kScatteringTextureSize = resolution.scattering_width() *
+      resolution.scattering_height() * resolution.scattering_depth();
+  uint64_t total_progress = first_scattering_order == 1 ?
+      kTransmittanceTextureSize * kTransmittanceProgress +
+      kIrradianceTextureSize * kDirectIrradianceProgress +
+      kScatteringTextureSize * kSingleScatteringProgress : 0;
+  for (unsigned int scattering_order = std::max(first_scattering_order, 2u);
+       scattering_order <= num_scattering_orders; ++scattering_order) {
+    const TextureResolution order_resolution =
+        GetScatteringOrderAtmosphere(scattering_order).texture_resolution;
+    const uint64_t order_scattering_texture_size =
+        order_resolution.scattering_width() *
+        order_resolution.scattering_height() *
+        order_resolution.scattering_depth();
+    const unsigned int order_irradiance_texture_size =
+        order_resolution.irradiance_width * order_resolution.irradiance_height;
+    if (use_multiple_scattering_lut_) {
+      total_progress += MULTIPLE_SCATTERING_LUT_WIDTH *
+          MULTIPLE_SCATTERING_LUT_HEIGHT * kMultipleScatteringLutProgress;
+      total_progress += order_scattering_texture_size *
+          (kMultipleScatteringLutDensityProgress + kMultipleScatteringProgress);
+      total_progress +=
+          2 * order_irradiance_texture_size * kIndirectIrradianceProgress;
+    } else {
+      total_progress += order_scattering_texture_size *
+          (kScatteringDensityProgress + kMultipleScatteringProgress);
+      total_progress +=
+          order_irradiance_texture_size * kIndirectIrradianceProgress;
+    }
+    if (!HaveSameScatteringSizes(order_resolution, resolution)) {
+      total_progress +=
+          static_cast<uint64_t>(kScatteringTextureSize) * kUpsamplingProgress;
+    }
+  }
+
+  std::shared_ptr<ProgressSink> progress_sink = progress_sink_;
+  if (handle != nullptr) {
+    progress_sink = std::make_shared<TeeProgressSink>(progress_sink,
+        std::make_shared<CallbackProgressSink>([&](uint64_t done,
+            uint64_t total) {
+          std::lock_guard<std::mutex> lock(handle->mutex_);
+          handle->progress_.fraction =
+              total > 0 ? static_cast<double>(done) / total : 1.0;
+        }));
+  }
+  Progress progress(total_progress, progress_sink);
 
 /*
 <p>The remaining code of this method implements Algorithm 4.1 of our paper,
-using several threads to speed up computations (by computing several texels of
-a texture in parallel).
+using several threads to speed up computations (by computing several tiles of
+texels of a texture in parallel, with the work-stealing scheduler defined in
+<a href="scheduler.h.html">scheduler.h</a>). The progress is reported once per
+tile instead of once per texel.
+
+<p>In addition, the phases which do not depend on each other are run
+concurrently, on the same thread pool, by expressing their dependencies with a
+<a href="pass_graph.h.html">pass graph</a>. This keeps all the threads busy
+at the end of a phase, when only a few tiles remain to be computed (the small
+irradiance phases, in particular, can then be computed entirely with the
+threads left idle by a concurrent scattering phase). The phases of the first
+scattering order, and then of each subsequent order, are run with their own
+graph, because each order depends on the results of the previous order (we also
+need to test the stop and convergence conditions between each order).
+
+<p>Finally, if <code>use_fast_functions</code> is true, the transmittance,
+direct irradiance, single scattering and multiple scattering phases use the
+functions of <a href="fast_functions.h.html">fast_functions.h</a> instead of
+those of <a href="functions.h.html">functions.h</a>. They read float copies of
+the transmittance and scattering density textures, made once these textures are
+computed, and their results are converted back to physical types before being
+stored. The scattering density keeps its vectorized implementation, and the
+indirect irradiance, which is cheap, its dimensional one.
 */
 
-  // Compute the transmittance, and store it in transmittance_texture_.
-  RunJobs([&](unsigned int j) {
-    for (unsigned int i = 0; i < TRANSMITTANCE_TEXTURE_WIDTH; ++i) {
-      transmittance_texture_->Set(i, j,
-          ComputeTransmittanceToTopAtmosphereBoundaryTexture(
-              atmosphere_, vec2(i + 0.5, j + 0.5)));
-      progress_bar.Increment(kTransmittanceProgress);
-    }
-  }, TRANSMITTANCE_TEXTURE_HEIGHT);
-
-  // Compute the direct irradiance, store it in delta_irradiance_texture, and
-  // initialize irradiance_texture_ with zeros (we don't want the direct
-  // irradiance in irradiance_texture_, but only the irradiance from the sky).
-  RunJobs([&](unsigned int j) {
-    for (unsigned int i = 0; i < IRRADIANCE_TEXTURE_WIDTH; ++i) {
-      delta_irradiance_texture->Set(i, j,
-          ComputeDirectIrradianceTexture(
-              atmosphere_, *transmittance_texture_, vec2(i + 0.5, j + 0.5)));
-      irradiance_texture_->Set(
-          i, j, IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
-      progress_bar.Increment(kDirectIrradianceProgress);
-    }
-  }, IRRADIANCE_TEXTURE_HEIGHT);
-
-  // Compute the rayleigh and mie single scattering, and store them in
-  // delta_rayleigh_scattering_texture and delta_mie_scattering_texture, as well
-  // as in scattering_texture.
-  RunJobs([&](unsigned int k) {
-    for (unsigned int j = 0; j < SCATTERING_TEXTURE_HEIGHT; ++j) {
-      for (unsigned int i = 0; i < SCATTERING_TEXTURE_WIDTH; ++i) {
-        IrradianceSpectrum rayleigh;
-        IrradianceSpectrum mie;
-        ComputeSingleScatteringTexture(atmosphere_, *transmittance_texture_,
-            vec3(i + 0.5, j + 0.5, k + 0.5), rayleigh, mie);
-        delta_rayleigh_scattering_texture->Set(i, j, k, rayleigh);
-        delta_mie_scattering_texture->Set(i, j, k, mie);
-        scattering_texture_->Set(i, j, k, rayleigh);
-        progress_bar.Increment(kSingleScatteringProgress);
+  ThreadPool* thread_pool = scheduler_.thread_pool().get();
+  std::unique_ptr<fast::TransmittanceTexture> fast_transmittance_texture;
+  if (first_scattering_order == 1) {
+    // Load the transmittance, direct irradiance and single scattering shared
+    // by other models, if possible (see set_share_precompute_stages). The
+    // corresponding phases are then skipped.
+    StageCache& stage_cache = StageCache::GetDefault();
+    const uint64_t transmittance_hash =
+        HashStageParameters(atmosphere_, TRANSMITTANCE_STAGE,
+            use_fast_functions);
+    const uint64_t direct_irradiance_hash =
+        HashStageParameters(atmosphere_, DIRECT_IRRADIANCE_STAGE,
+            use_fast_functions);
+    const uint64_t single_scattering_hash =
+        HashStageParameters(atmosphere_, SINGLE_SCATTERING_STAGE,
+            use_fast_functions);
+    bool has_transmittance = false;
+    bool has_direct_irradiance = false;
+    bool has_single_scattering = false;
+    if (share_precompute_stages_) {
+      time_phase("stage_load", 0, [&]() {
+        auto keep = [&](const StageCache::Handle& handle) {
+          if (handle) {
+            stage_handles_.push_back(handle);
+          }
+          return handle != nullptr;
+        };
+        has_transmittance = keep(stage_cache.Load(cache_directory_,
+            "transmittance", transmittance_hash,
+            transmittance_texture_.get()));
+        has_direct_irradiance = keep(stage_cache.Load(cache_directory_,
+            "direct_irradiance", direct_irradiance_hash,
+            delta_irradiance_texture.get()));
+        has_single_scattering = keep(stage_cache.Load(cache_directory_,
+            "single_rayleigh_scattering", single_scattering_hash,
+            delta_rayleigh_scattering_texture.get())) &&
+            keep(stage_cache.Load(cache_directory_, "single_mie_scattering",
+                single_scattering_hash, delta_mie_scattering_texture));
+        return true;
+      });
+      progress.Increment(
+          (has_transmittance ?
+              kTransmittanceTextureSize * kTransmittanceProgress : 0) +
+          (has_direct_irradiance ?
+              kIrradianceTextureSize * kDirectIrradianceProgress : 0) +
+          (has_single_scattering ?
+              kScatteringTextureSize * kSingleScatteringProgress : 0));
+    }
+
+    PassGraph graph;
+
+    // Compute the transmittance, and store it in transmittance_texture_.
+    const PassGraph::PassId transmittance = graph.AddPass([&]() {
+      if (!has_transmittance) {
+        run_phase("transmittance", 0, resolution.transmittance_width,
+            resolution.transmittance_height, 1, [&](const Tile& tile) {
+          for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+            for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+              const TransmittanceTexelGeometry& texel =
+                  geometry.transmittance(i, j);
+              transmittance_texture_->Set(i, j, use_fast_functions ?
+                  fast::ToDimensional<DimensionlessSpectrum>(
+                      fast::ComputeTransmittanceToTopAtmosphereBoundary(
+                          fast_atmosphere_, fast::FromDimensional(texel.r),
+                          fast::FromDimensional(texel.mu))) :
+                  reference::ComputeTransmittanceToTopAtmosphereBoundary(
+                      atmosphere_, texel.r, texel.mu));
+            }
+          }
+          progress.Increment(kTransmittanceProgress * tile.size());
+        });
+      }
+      if (use_fast_functions) {
+        fast_transmittance_texture.reset(
+            new fast::TransmittanceTexture(*transmittance_texture_));
+      }
+    });
+
+    // Compute the direct irradiance, store it in delta_irradiance_texture, and
+    // initialize irradiance_texture_ with zeros (we don't want the direct
+    // irradiance in irradiance_texture_, but only the irradiance from the sky).
+    graph.AddPass([&]() {
+      if (has_direct_irradiance) {
+        irradiance_texture_->Fill(
+            IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+        return;
       }
+      run_phase("direct_irradiance", 0, resolution.irradiance_width,
+          resolution.irradiance_height, 1, [&](const Tile& tile) {
+        for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+          for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+            const IrradianceTexelGeometry& texel = geometry.irradiance(i, j);
+            delta_irradiance_texture->Set(i, j, use_fast_functions ?
+                fast::ToDimensional<IrradianceSpectrum>(
+                    fast::ComputeDirectIrradiance(fast_atmosphere_,
+                        *fast_transmittance_texture,
+                        fast::FromDimensional(texel.r),
+                        fast::FromDimensional(texel.mu_s))) :
+                ComputeDirectIrradiance(atmosphere_, *transmittance_texture_,
+                    texel.r, texel.mu_s));
+            irradiance_texture_->Set(
+                i, j, IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm));
+          }
+        }
+        progress.Increment(kDirectIrradianceProgress * tile.size());
+      });
+    }, {transmittance});
+
+    // Compute the rayleigh and mie single scattering, and store them in
+    // delta_rayleigh_scattering_texture and delta_mie_scattering_texture, as
+    // well as in scattering_texture. This only depends on the transmittance,
+    // and is thus computed concurrently with the direct irradiance.
+    graph.AddPass([&]() {
+      if (has_single_scattering) {
+        scattering_texture_->CopyFrom(*delta_rayleigh_scattering_texture);
+        return;
+      }
+      run_phase("single_scattering", 1, resolution.scattering_width(),
+          resolution.scattering_height(), resolution.scattering_depth(),
+          [&](const Tile& tile) {
+        for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+          for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+            for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+              const ScatteringTexelGeometry& texel =
+                  geometry.scattering(i, j, k);
+              IrradianceSpectrum rayleigh;
+              IrradianceSpectrum mie;
+              if (use_fast_functions) {
+                fast::IrradianceSpectrum fast_rayleigh;
+                fast::IrradianceSpectrum fast_mie;
+                fast::ComputeSingleScattering(fast_atmosphere_,
+                    *fast_transmittance_texture,
+                    fast::FromDimensional(texel.r),
+                    fast::FromDimensional(texel.mu),
+                    fast::FromDimensional(texel.mu_s),
+                    fast::FromDimensional(texel.nu),
+                    texel.ray_r_mu_intersects_ground, fast_rayleigh,
+                    fast_mie);
+                rayleigh = fast::ToDimensional<IrradianceSpectrum>(
+                    fast_rayleigh);
+                mie = fast::ToDimensional<IrradianceSpectrum>(fast_mie);
+              } else {
+                ComputeSingleScattering(atmosphere_, *transmittance_texture_,
+                    texel.r, texel.mu, texel.mu_s, texel.nu,
+                    texel.ray_r_mu_intersects_ground, rayleigh, mie);
+              }
+              delta_rayleigh_scattering_texture->Set(i, j, k, rayleigh);
+              delta_mie_scattering_texture->Set(i, j, k, mie);
+              scattering_texture_->Set(i, j, k, rayleigh);
+            }
+          }
+        }
+        progress.Increment(kSingleScatteringProgress * tile.size());
+      });
+    }, {transmittance});
+
+    graph.Run(thread_pool);
+    if (stopped) {
+      return stop(0);
+    }
+    if (share_precompute_stages_) {
+      time_phase("stage_save", 1, [&]() {
+        if (!has_transmittance) {
+          stage_handles_.push_back(stage_cache.Save(cache_directory_,
+              "transmittance", transmittance_hash, *transmittance_texture_));
+        }
+        if (!has_direct_irradiance) {
+          stage_handles_.push_back(stage_cache.Save(cache_directory_,
+              "direct_irradiance", direct_irradiance_hash,
+              *delta_irradiance_texture));
+        }
+        if (!has_single_scattering) {
+          stage_handles_.push_back(stage_cache.Save(cache_directory_,
+              "single_rayleigh_scattering", single_scattering_hash,
+              *delta_rayleigh_scattering_texture));
+          stage_handles_.push_back(stage_cache.Save(cache_directory_,
+              "single_mie_scattering", single_scattering_hash,
+              *delta_mie_scattering_texture));
+        }
+        return true;
+      });
     }
-  }, SCATTERING_TEXTURE_DEPTH);
+    if (keep_single_scattering_) {
+      single_rayleigh_scattering_texture_.reset(
+          NewScatteringTexture<ReducedScatteringTexture>(resolution));
+      single_rayleigh_scattering_texture_->CopyFrom(
+          *delta_rayleigh_scattering_texture);
+      direct_irradiance_texture_.reset(NewIrradianceTexture(resolution));
+      direct_irradiance_texture_->CopyFrom(*delta_irradiance_texture);
+    }
+    if (use_checkpoints) {
+      time_phase("checkpoint_save", 1, [&]() {
+        save_checkpoint(1);
+        return true;
+      });
+    }
+  } else if (use_fast_functions) {
+    fast_transmittance_texture.reset(
+        new fast::TransmittanceTexture(*transmittance_texture_));
+  }
 
-  // Compute the 2nd, 3rd and 4th order of scattering, in sequence.
-  for (unsigned int scattering_order = 2;
+  // Compute the 2nd, 3rd and 4th order of scattering, in sequence (or, with a
+  // convergence tolerance, until an order adds a negligible energy - see
+  // below), each with its own resolution. With the multiple scattering LUT,
+  // the "2nd order" computed here includes all the higher orders.
+  const SimdInstructionSet instruction_set = GetBestSimdInstructionSet();
+  num_scattering_orders_ = std::max(first_scattering_order - 1, 1u);
+  for (unsigned int scattering_order = std::max(first_scattering_order, 2u);
        scattering_order <= num_scattering_orders;
        ++scattering_order) {
+    set_delta_resolution(scattering_order, true);
+    if (stopped) {
+      return stop(scattering_order - 1);
+    }
+    const TextureResolution& delta_resolution =
+        delta_atmosphere.texture_resolution;
+    const unsigned int delta_scattering_texture_size =
+        delta_resolution.scattering_width() *
+        delta_resolution.scattering_height() *
+        delta_resolution.scattering_depth();
+    const bool upsample = delta_geometry != &geometry;
+    const fast::AtmosphereParameters delta_fast_atmosphere =
+        upsample ? fast::FromDimensional(delta_atmosphere) : fast_atmosphere_;
+    PassGraph graph;
+
     // Compute the scattering density, and store it in
-    // delta_scattering_density_texture.
-    RunJobs([&](unsigned int k) {
-      for (unsigned int j = 0; j < SCATTERING_TEXTURE_HEIGHT; ++j) {
-        for (unsigned int i = 0; i < SCATTERING_TEXTURE_WIDTH; ++i) {
-          RadianceDensitySpectrum scattering_density;
-          scattering_density = ComputeScatteringDensityTexture(atmosphere_,
-              *transmittance_texture_, *delta_rayleigh_scattering_texture,
-              *delta_mie_scattering_texture,
-              *delta_multiple_scattering_texture, *delta_irradiance_texture,
-              vec3(i + 0.5, j + 0.5, k + 0.5), scattering_order);
-          delta_scattering_density_texture->Set(i, j, k, scattering_density);
-          progress_bar.Increment(kScatteringDensityProgress);
-        }
+    // delta_scattering_density_texture. This is by far the most costly
+    // computation, so we use the vectorized version of this function (and we
+    // don't recompute it if it is available in a checkpoint). With the multiple
+    // scattering LUT, we compute this LUT instead, and then the scattering
+    // density of all the orders from the 2nd one with a lookup in this LUT.
+    const PassGraph::PassId scattering_density = graph.AddPass([&]() {
+      if (use_checkpoints && checkpoint_cache(scattering_order).Load(
+              "checkpoint_scattering_density.dat",
+              delta_scattering_density_texture.get())) {
+        progress.Increment(use_multiple_scattering_lut_ ?
+            MULTIPLE_SCATTERING_LUT_WIDTH * MULTIPLE_SCATTERING_LUT_HEIGHT *
+                kMultipleScatteringLutProgress +
+            kMultipleScatteringLutDensityProgress *
+                delta_scattering_texture_size :
+            kScatteringDensityProgress * delta_scattering_texture_size);
+        return;
+      }
+      if (use_multiple_scattering_lut_) {
+        const std::vector<SphericalSample> directions =
+            GetMultipleScatteringLutDirections();
+        MultipleScatteringLutTexture multiple_scattering_lut_texture(
+            MULTIPLE_SCATTERING_LUT_WIDTH, MULTIPLE_SCATTERING_LUT_HEIGHT);
+        run_phase("multiple_scattering_lut", scattering_order,
+            MULTIPLE_SCATTERING_LUT_WIDTH, MULTIPLE_SCATTERING_LUT_HEIGHT, 1,
+            [&](const Tile& tile) {
+          for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+            for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+              multiple_scattering_lut_texture.Set(i, j,
+                  ComputeMultipleScatteringLutTexture(atmosphere_,
+                      *transmittance_texture_, directions,
+                      vec2(i + 0.5, j + 0.5)));
+            }
+          }
+          progress.Increment(kMultipleScatteringLutProgress * tile.size());
+        });
+        run_phase("scattering_density", scattering_order,
+            delta_resolution.scattering_width(),
+            delta_resolution.scattering_height(),
+            delta_resolution.scattering_depth(), [&](const Tile& tile) {
+          for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+            for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+              for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+                const ScatteringTexelGeometry& texel =
+                    delta_geometry->scattering(i, j, k);
+                delta_scattering_density_texture->Set(i, j, k,
+                    GetMultipleScatteringLutDensity(delta_atmosphere,
+                        multiple_scattering_lut_texture, texel.r,
+                        texel.mu_s));
+              }
+            }
+          }
+          progress.Increment(
+              kMultipleScatteringLutDensityProgress * tile.size());
+        });
+      } else {
+        run_phase("scattering_density", scattering_order,
+            delta_resolution.scattering_width(),
+            delta_resolution.scattering_height(),
+            delta_resolution.scattering_depth(), [&](const Tile& tile) {
+          for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+            for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+              for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+                const ScatteringTexelGeometry& texel =
+                    delta_geometry->scattering(i, j, k);
+                RadianceDensitySpectrum scattering_density;
+                scattering_density = ComputeScatteringDensitySimd(
+                    delta_atmosphere, *transmittance_texture_,
+                    *delta_rayleigh_scattering_texture,
+                    *delta_mie_scattering_texture,
+                    *delta_multiple_scattering_texture,
+                    *delta_irradiance_texture, *spherical_samples_texture,
+                    texel.r, texel.mu, texel.mu_s, texel.nu, scattering_order,
+                    instruction_set);
+                delta_scattering_density_texture->Set(
+                    i, j, k, scattering_density);
+              }
+            }
+          }
+          progress.Increment(kScatteringDensityProgress * tile.size());
+        });
       }
-    }, SCATTERING_TEXTURE_DEPTH);
-
-    // Compute the indirect irradiance, store it in delta_irradiance_texture and
-    // accumulate it in irradiance_texture_.
-    RunJobs([&](unsigned int j) {
-      for (unsigned int i = 0; i < IRRADIANCE_TEXTURE_WIDTH; ++i) {
-        IrradianceSpectrum delta_irradiance;
-        delta_irradiance = ComputeIndirectIrradianceTexture(
-            atmosphere_, *delta_rayleigh_scattering_texture,
-            *delta_mie_scattering_texture, *delta_multiple_scattering_texture,
-            vec2(i + 0.5, j + 0.5), scattering_order - 1);
-        delta_irradiance_texture->Set(i, j, delta_irradiance);
-        progress_bar.Increment(kIndirectIrradianceProgress);
+      if (!stopped && use_checkpoints) {
+        checkpoint_cache(scattering_order).Save(
+            "checkpoint_scattering_density.dat",
+            *delta_scattering_density_texture);
       }
-    }, IRRADIANCE_TEXTURE_HEIGHT);
-    (*irradiance_texture_) += *delta_irradiance_texture;
+    });
+
+    // Compute the indirect irradiance due to the given delta scattering order
+    // (see ComputeIndirectIrradiance), and store it in, or add it to,
+    // next_delta_irradiance_texture.
+    auto run_indirect_irradiance_phase = [&](unsigned int delta_order,
+        bool add) {
+      run_phase("indirect_irradiance", scattering_order,
+          delta_resolution.irradiance_width,
+          delta_resolution.irradiance_height, 1, [&](const Tile& tile) {
+        for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+          for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+            const IrradianceTexelGeometry& texel =
+                delta_geometry->irradiance(i, j);
+            IrradianceSpectrum delta_irradiance;
+            delta_irradiance = ComputeIndirectIrradiance(
+                delta_atmosphere, *delta_rayleigh_scattering_texture,
+                *delta_mie_scattering_texture,
+                *delta_multiple_scattering_texture,
+                *spherical_samples_texture, texel.r, texel.mu_s, delta_order);
+            if (add) {
+              delta_irradiance += next_delta_irradiance_texture->Get(i, j);
+            }
+            next_delta_irradiance_texture->Set(i, j, delta_irradiance);
+          }
+        }
+        progress.Increment(kIndirectIrradianceProgress * tile.size());
+      });
+    };
+
+    // Compute the indirect irradiance due to the previous order. This is
+    // computed concurrently with the scattering density.
+    const PassGraph::PassId indirect_irradiance = graph.AddPass([&]() {
+      run_indirect_irradiance_phase(scattering_order - 1, false);
+    });
 
     // Compute the multiple scattering, store it in
     // delta_multiple_scattering_texture, and accumulate it in
-    // scattering_texture_.
-    RunJobs([&](unsigned int k) {
-      for (unsigned int j = 0; j < SCATTERING_TEXTURE_HEIGHT; ++j) {
-        for (unsigned int i = 0; i < SCATTERING_TEXTURE_WIDTH; ++i) {
-          RadianceSpectrum delta_multiple_scattering;
-          Number nu;
-          delta_multiple_scattering = ComputeMultipleScatteringTexture(
-              atmosphere_, *transmittance_texture_,
-              *delta_scattering_density_texture,
-              vec3(i + 0.5, j + 0.5, k + 0.5), nu);
-          delta_multiple_scattering_texture->Set(
-              i, j, k, delta_multiple_scattering);
-          scattering_texture_->Set(i, j, k,
-              scattering_texture_->Get(i, j, k) +
-              delta_multiple_scattering * (1.0 / RayleighPhaseFunction(nu)));
-          progress_bar.Increment(kMultipleScatteringProgress);
+    // scattering_texture_ (as well as the sum of all these values, if needed),
+    // after upsampling it if this order has a lower resolution. This
+    // overwrites the previous order, and must thus wait for the indirect
+    // irradiance. It is skipped if the computation was stopped before, and
+    // stop requests are ignored while it is running (no other phase can run
+    // concurrently at this point, which makes it safe to change can_stop).
+    // With the multiple scattering LUT, the indirect irradiance due to all the
+    // orders from the 2nd one is then added to the one due to the 1st order
+    // (this is done in the same pass, to get consistent textures if a stop is
+    // requested).
+    std::mutex sums_mutex;
+    double delta_scattering_sum = 0.0;
+    double scattering_sum = 0.0;
+    graph.AddPass([&]() {
+      if (stopped) {
+        return;
+      }
+      can_stop = false;
+      std::unique_ptr<fast::ScatteringDensityTexture>
+          fast_delta_scattering_density_texture;
+      if (use_fast_functions) {
+        fast_delta_scattering_density_texture.reset(
+            new fast::ScatteringDensityTexture(
+                *delta_scattering_density_texture));
+      }
+      auto accumulate = [&](unsigned int i, unsigned int j, unsigned int k,
+          const RadianceSpectrum& delta_multiple_scattering, Number nu,
+          double* tile_delta_scattering_sum, double* tile_scattering_sum) {
+        IrradianceSpectrum delta_scattering =
+            delta_multiple_scattering * (1.0 / RayleighPhaseFunction(nu));
+        IrradianceSpectrum scattering =
+            scattering_texture_->Get(i, j, k) + delta_scattering;
+        scattering_texture_->Set(i, j, k, scattering);
+        if (convergence_tolerance > 0.0) {
+          *tile_delta_scattering_sum += GetSpectrumSum(delta_scattering);
+          *tile_scattering_sum += GetSpectrumSum(scattering);
+        }
+      };
+      auto add_sums = [&](double tile_delta_scattering_sum,
+          double tile_scattering_sum) {
+        if (convergence_tolerance > 0.0) {
+          std::lock_guard<std::mutex> lock(sums_mutex);
+          delta_scattering_sum += tile_delta_scattering_sum;
+          scattering_sum += tile_scattering_sum;
+        }
+      };
+      run_phase("multiple_scattering", scattering_order,
+          delta_resolution.scattering_width(),
+          delta_resolution.scattering_height(),
+          delta_resolution.scattering_depth(), [&](const Tile& tile) {
+        double tile_delta_scattering_sum = 0.0;
+        double tile_scattering_sum = 0.0;
+        for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+          for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+            for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+              const ScatteringTexelGeometry& texel =
+                  delta_geometry->scattering(i, j, k);
+              RadianceSpectrum delta_multiple_scattering;
+              if (use_fast_functions) {
+                delta_multiple_scattering =
+                    fast::ToDimensional<RadianceSpectrum>(
+                        fast::ComputeMultipleScattering(delta_fast_atmosphere,
+                            *fast_transmittance_texture,
+                            *fast_delta_scattering_density_texture,
+                            fast::FromDimensional(texel.r),
+                            fast::FromDimensional(texel.mu),
+                            fast::FromDimensional(texel.mu_s),
+                            fast::FromDimensional(texel.nu),
+                            texel.ray_r_mu_intersects_ground));
+              } else {
+                delta_multiple_scattering = ComputeMultipleScattering(
+                    delta_atmosphere, *transmittance_texture_,
+                    *delta_scattering_density_texture, texel.r, texel.mu,
+                    texel.mu_s, texel.nu, texel.ray_r_mu_intersects_ground);
+              }
+              delta_multiple_scattering_texture->Set(
+                  i, j, k, delta_multiple_scattering);
+              if (!upsample) {
+                accumulate(i, j, k, delta_multiple_scattering, texel.nu,
+                    &tile_delta_scattering_sum, &tile_scattering_sum);
+              }
+            }
+          }
+        }
+        add_sums(tile_delta_scattering_sum, tile_scattering_sum);
+        progress.Increment(kMultipleScatteringProgress * tile.size());
+      });
+      if (upsample) {
+        run_phase("upsampling", scattering_order,
+            resolution.scattering_width(), resolution.scattering_height(),
+            resolution.scattering_depth(), [&](const Tile& tile) {
+          double tile_delta_scattering_sum = 0.0;
+          double tile_scattering_sum = 0.0;
+          for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+            for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+              for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+                const ScatteringTexelGeometry& texel =
+                    geometry.scattering(i, j, k);
+                accumulate(i, j, k, GetScattering(delta_atmosphere,
+                        *delta_multiple_scattering_texture, texel.r, texel.mu,
+                        texel.mu_s, texel.nu,
+                        texel.ray_r_mu_intersects_ground),
+                    texel.nu, &tile_delta_scattering_sum,
+                    &tile_scattering_sum);
+              }
+            }
+          }
+          add_sums(tile_delta_scattering_sum, tile_scattering_sum);
+          progress.Increment(kUpsamplingProgress * tile.size());
+        });
+      }
+      if (use_multiple_scattering_lut_) {
+        run_indirect_irradiance_phase(scattering_order, true);
+      }
+      can_stop = handle != nullptr;
+    }, {scattering_density, indirect_irradiance});
+
+    graph.Run(thread_pool);
+    if (stopped) {
+      return stop(scattering_order - 1);
+    }
+
+    // The indirect irradiance of this order is now the input of the next one.
+    // Accumulate it in irradiance_texture_, after upsampling it if needed (as
+    // well as the sum of all these values, if needed).
+    std::swap(delta_irradiance_texture, next_delta_irradiance_texture);
+    auto get_delta_irradiance = [&](int i, int j) -> IrradianceSpectrum {
+      if (!upsample) {
+        return delta_irradiance_texture->Get(i, j);
+      }
+      const IrradianceTexelGeometry& texel = geometry.irradiance(i, j);
+      return GetIrradiance(delta_atmosphere, *delta_irradiance_texture,
+          texel.r, texel.mu_s);
+    };
+    if (upsample) {
+      for (int j = 0; j < resolution.irradiance_height; ++j) {
+        for (int i = 0; i < resolution.irradiance_width; ++i) {
+          irradiance_texture_->Set(i, j,
+              irradiance_texture_->Get(i, j) + get_delta_irradiance(i, j));
+        }
+      }
+    } else {
+      (*irradiance_texture_) += *delta_irradiance_texture;
+    }
+    double delta_irradiance_sum = 0.0;
+    double irradiance_sum = 0.0;
+    if (convergence_tolerance > 0.0) {
+      for (int j = 0; j < resolution.irradiance_height; ++j) {
+        for (int i = 0; i < resolution.irradiance_width; ++i) {
+          delta_irradiance_sum += GetSpectrumSum(get_delta_irradiance(i, j));
+          irradiance_sum += GetSpectrumSum(irradiance_texture_->Get(i, j));
         }
       }
-    }, SCATTERING_TEXTURE_DEPTH);
+    }
+    num_scattering_orders_ = scattering_order;
+    if (use_checkpoints) {
+      time_phase("checkpoint_save", scattering_order, [&]() {
+        save_checkpoint(scattering_order);
+        return true;
+      });
+    }
+
+    // Stop if the scattering added by this order, and the indirect irradiance
+    // added by the previous one, are negligible relatively to their total so
+    // far (the first indirect irradiance order, computed with the 2nd
+    // scattering order, is not tested since its relative contribution is
+    // always 1).
+    if (convergence_tolerance > 0.0 &&
+        delta_scattering_sum <= convergence_tolerance * scattering_sum &&
+        (scattering_order == 2 ||
+            delta_irradiance_sum <= convergence_tolerance * irradiance_sum)) {
+      break;
+    }
   }
 
-  transmittance_texture_->Save(cache_directory_ + "transmittance.dat");
-  scattering_texture_->Save(cache_directory_ + "scattering.dat");
-  single_mie_scattering_texture_->Save(
-      cache_directory_ + "single_mie_scattering.dat");
-  irradiance_texture_->Save(cache_directory_ + "irradiance.dat");
+  save_cache(cache, convergence_tolerance > 0.0);
+  return COMPLETED;
 }
 
 /*
@@ -261,6 +1477,19 @@ RadianceSpectrum Model::GetSolarRadiance() const {
 RadianceSpectrum Model::GetSkyRadiance(Position camera, Direction view_ray,
     Length shadow_length, Direction sun_direction,
     DimensionlessSpectrum* transmittance) const {
+  if (UseFastFunctions()) {
+    fast::DimensionlessSpectrum fast_transmittance;
+    RadianceSpectrum radiance = fast::ToDimensional<RadianceSpectrum>(
+        fast::GetSkyRadiance(fast_atmosphere_,
+            *fast_transmittance_texture_, *fast_scattering_texture_,
+            *fast_single_mie_scattering_texture_,
+            fast::FromDimensional(camera), fast::FromDimensional(view_ray),
+            fast::FromDimensional(shadow_length),
+            fast::FromDimensional(sun_direction), fast_transmittance));
+    *transmittance =
+        fast::ToDimensional<DimensionlessSpectrum>(fast_transmittance);
+    return radiance;
+  }
   return reference::GetSkyRadiance(atmosphere_, *transmittance_texture_,
       *scattering_texture_, *single_mie_scattering_texture_,
       camera, view_ray, shadow_length, sun_direction, *transmittance);
@@ -269,6 +1498,19 @@ RadianceSpectrum Model::GetSkyRadiance(Position camera, Direction view_ray,
 RadianceSpectrum Model::GetSkyRadianceToPoint(Position camera, Position point,
     Length shadow_length, Direction sun_direction,
     DimensionlessSpectrum* transmittance) const {
+  if (UseFastFunctions()) {
+    fast::DimensionlessSpectrum fast_transmittance;
+    RadianceSpectrum radiance = fast::ToDimensional<RadianceSpectrum>(
+        fast::GetSkyRadianceToPoint(fast_atmosphere_,
+            *fast_transmittance_texture_, *fast_scattering_texture_,
+            *fast_single_mie_scattering_texture_,
+            fast::FromDimensional(camera), fast::FromDimensional(point),
+            fast::FromDimensional(shadow_length),
+            fast::FromDimensional(sun_direction), fast_transmittance));
+    *transmittance =
+        fast::ToDimensional<DimensionlessSpectrum>(fast_transmittance);
+    return radiance;
+  }
   return reference::GetSkyRadianceToPoint(atmosphere_, *transmittance_texture_,
       *scattering_texture_, *single_mie_scattering_texture_,
       camera, point, shadow_length, sun_direction, *transmittance);
@@ -277,9 +1519,495 @@ RadianceSpectrum Model::GetSkyRadianceToPoint(Position camera, Position point,
 IrradianceSpectrum Model::GetSunAndSkyIrradiance(Position point,
     Direction normal, Direction sun_direction,
     IrradianceSpectrum* sky_irradiance) const {
+  if (UseFastFunctions()) {
+    fast::IrradianceSpectrum fast_sky_irradiance;
+    IrradianceSpectrum sun_irradiance = fast::ToDimensional<IrradianceSpectrum>(
+        fast::GetSunAndSkyIrradiance(fast_atmosphere_,
+            *fast_transmittance_texture_, *fast_irradiance_texture_,
+            fast::FromDimensional(point), fast::FromDimensional(normal),
+            fast::FromDimensional(sun_direction), fast_sky_irradiance));
+    *sky_irradiance =
+        fast::ToDimensional<IrradianceSpectrum>(fast_sky_irradiance);
+    return sun_irradiance;
+  }
   return reference::GetSunAndSkyIrradiance(atmosphere_, *transmittance_texture_,
       *irradiance_texture_, point, normal, sun_direction, *sky_irradiance);
 }
 
+/*
+<p>The transmittance can also be computed without the precomputed textures,
+with the functions used to precompute the transmittance texture. This is more
+precise than a texture lookup and, for the usual exponential density profiles,
+still quite fast, since the optical length is then computed analytically (see
+<code>ComputeOpticalLengthToTopAtmosphereBoundary</code> in
+<a href="../functions.glsl.html">functions.glsl</a>):
+*/
+
+DimensionlessSpectrum Model::ComputeTransmittanceToTopAtmosphereBoundary(
+    Position p, Direction direction) const {
+  Length r = length(p);
+  Length rmu = dot(p, direction);
+  Length distance_to_top_atmosphere_boundary = -rmu -
+      sqrt(rmu * rmu - r * r + atmosphere_.top_radius * atmosphere_.top_radius);
+  if (distance_to_top_atmosphere_boundary > 0.0 * m) {
+    r = atmosphere_.top_radius;
+    rmu += distance_to_top_atmosphere_boundary;
+  } else if (r > atmosphere_.top_radius) {
+    return DimensionlessSpectrum(1.0);
+  }
+  Number mu = ClampCosine(rmu / r);
+  r = ClampRadius(atmosphere_, r);
+  if (RayIntersectsGround(atmosphere_, r, mu)) {
+    return DimensionlessSpectrum(0.0);
+  }
+  return reference::ComputeTransmittanceToTopAtmosphereBoundary(
+      atmosphere_, r, mu);
+}
+
+DimensionlessSpectrum Model::ComputeTransmittance(Position p,
+    Position q) const {
+  if (length(q - p) == 0.0 * m) {
+    return DimensionlessSpectrum(1.0);
+  }
+  // As in the GetTransmittance function, use the ray from q to p if the ray
+  // from p to q intersects the ground.
+  Direction direction = normalize(q - p);
+  Number mu = ClampCosine(dot(p, direction) / length(p));
+  if (RayIntersectsGround(atmosphere_, ClampRadius(atmosphere_, length(p)),
+          mu)) {
+    return min(ComputeTransmittanceToTopAtmosphereBoundary(q, -direction) /
+        ComputeTransmittanceToTopAtmosphereBoundary(p, -direction),
+        DimensionlessSpectrum(1.0));
+  }
+  return min(ComputeTransmittanceToTopAtmosphereBoundary(p, direction) /
+      ComputeTransmittanceToTopAtmosphereBoundary(q, direction),
+      DimensionlessSpectrum(1.0));
+}
+
+/*
+<p>The above methods compute the full spectrum, even when only a few wavelengths
+are needed (e.g. for RGB rendering). For this case, the following methods use
+a wavelength-major copy of the precomputed textures, which is created by
+<code>InitSpectralTextures</code> (see
+<a href="spectral_texture.h.html">spectral_texture.h</a>). Each spectral value
+is identified by its index in the precomputed spectra, which can be computed
+with the following method:
+*/
+
+int Model::GetWavelengthIndex(Wavelength lambda) {
+  double x = (lambda.to(nm) - kLambdaMin) / (kLambdaMax - kLambdaMin) *
+      (kNumWavelengths - 1);
+  int index = static_cast<int>(std::floor(x + 0.5));
+  return std::max(0, std::min(index, kNumWavelengths - 1));
+}
+
+void Model::InitSpectralTextures() {
+  const TextureResolution& resolution = atmosphere_.texture_resolution;
+  spectral_transmittance_texture_.reset(new SpectralTexture(
+      resolution.transmittance_width, resolution.transmittance_height, 1,
+      kNumWavelengths));
+  spectral_transmittance_texture_->CopyFrom(*transmittance_texture_);
+  spectral_scattering_texture_.reset(new SpectralTexture(
+      resolution.scattering_width(), resolution.scattering_height(),
+      resolution.scattering_depth(), kNumWavelengths));
+  spectral_scattering_texture_->CopyFrom(*scattering_texture_);
+  spectral_single_mie_scattering_texture_.reset(new SpectralTexture(
+      resolution.scattering_width(), resolution.scattering_height(),
+      resolution.scattering_depth(), kNumWavelengths));
+  spectral_single_mie_scattering_texture_->CopyFrom(
+      *single_mie_scattering_texture_);
+  spectral_irradiance_texture_.reset(new SpectralTexture(
+      resolution.irradiance_width, resolution.irradiance_height, 1,
+      kNumWavelengths));
+  spectral_irradiance_texture_->CopyFrom(*irradiance_texture_);
+}
+
+/*
+<p>The following functions are the counterparts, for wavelength-major textures
+and for a subset of the wavelengths, of the GLSL functions with the same name in
+<a href="../functions.glsl.html">functions.glsl</a>. They store their results in
+the given arrays, as values in the base unit of their physical type.
+*/
+
+namespace {
+
+void GetTransmittanceToTopAtmosphereBoundary(
+    const AtmosphereParameters& atmosphere,
+    const SpectralTexture& transmittance_texture,
+    Length r, Number mu, const std::vector<int>& wavelengths,
+    double* transmittance) {
+  assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
+  vec2 uv = GetTransmittanceTextureUvFromRMu(atmosphere, r, mu);
+  transmittance_texture.Lookup(
+      uv, wavelengths.data(), wavelengths.size(), transmittance);
+}
+
+void GetTransmittance(
+    const AtmosphereParameters& atmosphere,
+    const SpectralTexture& transmittance_texture,
+    Length r, Number mu, Length d, bool ray_r_mu_intersects_ground,
+    const std::vector<int>& wavelengths, double* transmittance) {
+  Length r_d = clamp(sqrt(d * d + 2.0 * r * mu * d + r * r),
+      atmosphere.bottom_radius, atmosphere.top_radius);
+  Number mu_d = clamp((r * mu + d) / r_d, Number(-1.0), Number(1.0));
+  double numerator[kNumWavelengths];
+  double denominator[kNumWavelengths];
+  if (ray_r_mu_intersects_ground) {
+    GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture,
+        r_d, -mu_d, wavelengths, numerator);
+    GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture,
+        r, -mu, wavelengths, denominator);
+  } else {
+    GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture,
+        r, mu, wavelengths, numerator);
+    GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture,
+        r_d, mu_d, wavelengths, denominator);
+  }
+  for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+    transmittance[l] = std::min(numerator[l] / denominator[l], 1.0);
+  }
+}
+
+void GetTransmittanceToSun(
+    const AtmosphereParameters& atmosphere,
+    const SpectralTexture& transmittance_texture,
+    Length r, Number mu_s, const std::vector<int>& wavelengths,
+    double* transmittance) {
+  Number sin_theta_h = atmosphere.bottom_radius / r;
+  Number cos_theta_h =
+      -sqrt(max(Number(1.0) - sin_theta_h * sin_theta_h, Number(0.0)));
+  Number visible_sun_fraction =
+      smoothstep(-sin_theta_h * atmosphere.sun_angular_radius / rad,
+                 sin_theta_h * atmosphere.sun_angular_radius / rad,
+                 mu_s - cos_theta_h);
+  GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture,
+      r, mu_s, wavelengths, transmittance);
+  for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+    transmittance[l] *= visible_sun_fraction();
+  }
+}
+
+void GetCombinedScattering(
+    const AtmosphereParameters& atmosphere,
+    const SpectralTexture& scattering_texture,
+    const SpectralTexture& single_mie_scattering_texture,
+    Length r, Number mu, Number mu_s, Number nu,
+    bool ray_r_mu_intersects_ground, const std::vector<int>& wavelengths,
+    double* scattering, double* single_mie_scattering) {
+  vec4 uvwz = GetScatteringTextureUvwzFromRMuMuSNu(
+      atmosphere, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+  Number nu_size(atmosphere.texture_resolution.scattering_nu_size);
+  Number tex_coord_x = uvwz.x * (nu_size - Number(1.0));
+  Number tex_x = floor(tex_coord_x);
+  double lerp = (tex_coord_x - tex_x)();
+  vec3 uvw0 = vec3((tex_x + uvwz.y) / nu_size, uvwz.z, uvwz.w);
+  vec3 uvw1 = vec3((tex_x + Number(1.0) + uvwz.y) / nu_size, uvwz.z, uvwz.w);
+  const int num_wavelengths = wavelengths.size();
+  double values0[kNumWavelengths];
+  double values1[kNumWavelengths];
+  scattering_texture.Lookup(
+      uvw0, wavelengths.data(), num_wavelengths, values0);
+  scattering_texture.Lookup(
+      uvw1, wavelengths.data(), num_wavelengths, values1);
+  for (int l = 0; l < num_wavelengths; ++l) {
+    scattering[l] = values0[l] * (1.0 - lerp) + values1[l] * lerp;
+  }
+  single_mie_scattering_texture.Lookup(
+      uvw0, wavelengths.data(), num_wavelengths, values0);
+  single_mie_scattering_texture.Lookup(
+      uvw1, wavelengths.data(), num_wavelengths, values1);
+  for (int l = 0; l < num_wavelengths; ++l) {
+    single_mie_scattering[l] = values0[l] * (1.0 - lerp) + values1[l] * lerp;
+  }
+}
+
+}  // anonymous namespace
+
+/*
+<p>With these functions, the wavelength subset variants of the rendering methods
+are direct ports of the corresponding GLSL functions:
+*/
+
+void Model::GetSkyRadiance(Position camera, Direction view_ray,
+    Length shadow_length, Direction sun_direction,
+    const std::vector<int>& wavelengths, SpectralRadiance* radiance,
+    Number* transmittance) const {
+  assert(spectral_transmittance_texture_ != nullptr);
+  assert(wavelengths.size() <= static_cast<unsigned int>(kNumWavelengths));
+  const unsigned int num_wavelengths = wavelengths.size();
+  Length r = length(camera);
+  Length rmu = dot(camera, view_ray);
+  Length distance_to_top_atmosphere_boundary = -rmu -
+      sqrt(rmu * rmu - r * r + atmosphere_.top_radius * atmosphere_.top_radius);
+  if (distance_to_top_atmosphere_boundary > 0.0 * m) {
+    camera = camera + view_ray * distance_to_top_atmosphere_boundary;
+    r = atmosphere_.top_radius;
+    rmu += distance_to_top_atmosphere_boundary;
+  } else if (r > atmosphere_.top_radius) {
+    for (unsigned int l = 0; l < num_wavelengths; ++l) {
+      radiance[l] = 0.0 * watt_per_square_meter_per_sr_per_nm;
+      transmittance[l] = Number(1.0);
+    }
+    return;
+  }
+  Number mu = rmu / r;
+  Number mu_s = dot(camera, sun_direction) / r;
+  Number nu = dot(view_ray, sun_direction);
+  bool ray_r_mu_intersects_ground = RayIntersectsGround(atmosphere_, r, mu);
+
+  double transmittance_values[kNumWavelengths];
+  if (ray_r_mu_intersects_ground) {
+    std::fill(
+        transmittance_values, transmittance_values + num_wavelengths, 0.0);
+  } else {
+    GetTransmittanceToTopAtmosphereBoundary(atmosphere_,
+        *spectral_transmittance_texture_, r, mu, wavelengths,
+        transmittance_values);
+  }
+  double scattering[kNumWavelengths];
+  double single_mie_scattering[kNumWavelengths];
+  if (shadow_length == 0.0 * m) {
+    GetCombinedScattering(atmosphere_, *spectral_scattering_texture_,
+        *spectral_single_mie_scattering_texture_, r, mu, mu_s, nu,
+        ray_r_mu_intersects_ground, wavelengths, scattering,
+        single_mie_scattering);
+  } else {
+    Length d = shadow_length;
+    Length r_p = clamp(sqrt(d * d + 2.0 * r * mu * d + r * r),
+        atmosphere_.bottom_radius, atmosphere_.top_radius);
+    Number mu_p = (r * mu + d) / r_p;
+    Number mu_s_p = (r * mu_s + d * nu) / r_p;
+    GetCombinedScattering(atmosphere_, *spectral_scattering_texture_,
+        *spectral_single_mie_scattering_texture_, r_p, mu_p, mu_s_p, nu,
+        ray_r_mu_intersects_ground, wavelengths, scattering,
+        single_mie_scattering);
+    double shadow_transmittance[kNumWavelengths];
+    GetTransmittance(atmosphere_, *spectral_transmittance_texture_,
+        r, mu, shadow_length, ray_r_mu_intersects_ground, wavelengths,
+        shadow_transmittance);
+    for (unsigned int l = 0; l < num_wavelengths; ++l) {
+      scattering[l] *= shadow_transmittance[l];
+      single_mie_scattering[l] *= shadow_transmittance[l];
+    }
+  }
+  const double rayleigh_phase =
+      RayleighPhaseFunction(nu).to(InverseSolidAngle::Unit());
+  const double mie_phase =
+      MiePhaseFunction(atmosphere_.mie_phase_function_g, nu).to(
+          InverseSolidAngle::Unit());
+  for (unsigned int l = 0; l < num_wavelengths; ++l) {
+    radiance[l] = (scattering[l] * rayleigh_phase +
+        single_mie_scattering[l] * mie_phase) * SpectralRadiance::Unit();
+    transmittance[l] = Number(transmittance_values[l]);
+  }
+}
+
+void Model::GetSkyRadianceToPoint(Position camera, Position point,
+    Length shadow_length, Direction sun_direction,
+    const std::vector<int>& wavelengths, SpectralRadiance* radiance,
+    Number* transmittance) const {
+  assert(spectral_transmittance_texture_ != nullptr);
+  assert(wavelengths.size() <= static_cast<unsigned int>(kNumWavelengths));
+  const unsigned int num_wavelengths = wavelengths.size();
+  Direction view_ray = normalize(point - camera);
+  Length r = length(camera);
+  Length rmu = dot(camera, view_ray);
+  Length distance_to_top_atmosphere_boundary = -rmu -
+      sqrt(rmu * rmu - r * r + atmosphere_.top_radius * atmosphere_.top_radius);
+  if (distance_to_top_atmosphere_boundary > 0.0 * m) {
+    camera = camera + view_ray * distance_to_top_atmosphere_boundary;
+    r = atmosphere_.top_radius;
+    rmu += distance_to_top_atmosphere_boundary;
+  }
+
+  Number mu = rmu / r;
+  Number mu_s = dot(camera, sun_direction) / r;
+  Number nu = dot(view_ray, sun_direction);
+  Length d = length(point - camera);
+  bool ray_r_mu_intersects_ground = RayIntersectsGround(atmosphere_, r, mu);
+
+  double transmittance_values[kNumWavelengths];
+  GetTransmittance(atmosphere_, *spectral_transmittance_texture_,
+      r, mu, d, ray_r_mu_intersects_ground, wavelengths, transmittance_values);
+
+  double scattering[kNumWavelengths];
+  double single_mie_scattering[kNumWavelengths];
+  GetCombinedScattering(atmosphere_, *spectral_scattering_texture_,
+      *spectral_single_mie_scattering_texture_, r, mu, mu_s, nu,
+      ray_r_mu_intersects_ground, wavelengths, scattering,
+      single_mie_scattering);
+
+  d = max(d - shadow_length, 0.0 * m);
+  Length r_p = clamp(sqrt(d * d + 2.0 * r * mu * d + r * r),
+      atmosphere_.bottom_radius, atmosphere_.top_radius);
+  Number mu_p = (r * mu + d) / r_p;
+  Number mu_s_p = (r * mu_s + d * nu) / r_p;
+
+  double scattering_p[kNumWavelengths];
+  double single_mie_scattering_p[kNumWavelengths];
+  GetCombinedScattering(atmosphere_, *spectral_scattering_texture_,
+      *spectral_single_mie_scattering_texture_, r_p, mu_p, mu_s_p, nu,
+      ray_r_mu_intersects_ground, wavelengths, scattering_p,
+      single_mie_scattering_p);
+
+  double shadow_transmittance[kNumWavelengths];
+  if (shadow_length > 0.0 * m) {
+    GetTransmittance(atmosphere_, *spectral_transmittance_texture_,
+        r, mu, d, ray_r_mu_intersects_ground, wavelengths,
+        shadow_transmittance);
+  } else {
+    std::copy(transmittance_values, transmittance_values + num_wavelengths,
+        shadow_transmittance);
+  }
+
+  // Hack to avoid rendering artifacts when the sun is below the horizon.
+  const double single_mie_scattering_factor =
+      smoothstep(Number(0.0), Number(0.01), mu_s)();
+  const double rayleigh_phase =
+      RayleighPhaseFunction(nu).to(InverseSolidAngle::Unit());
+  const double mie_phase =
+      MiePhaseFunction(atmosphere_.mie_phase_function_g, nu).to(
+          InverseSolidAngle::Unit());
+  for (unsigned int l = 0; l < num_wavelengths; ++l) {
+    double rayleigh =
+        scattering[l] - shadow_transmittance[l] * scattering_p[l];
+    double mie = (single_mie_scattering[l] -
+        shadow_transmittance[l] * single_mie_scattering_p[l]) *
+            single_mie_scattering_factor;
+    radiance[l] = (rayleigh * rayleigh_phase + mie * mie_phase) *
+        SpectralRadiance::Unit();
+    transmittance[l] = Number(transmittance_values[l]);
+  }
+}
+
+void Model::GetSunAndSkyIrradiance(Position point, Direction normal,
+    Direction sun_direction, const std::vector<int>& wavelengths,
+    SpectralIrradiance* sun_irradiance,
+    SpectralIrradiance* sky_irradiance) const {
+  assert(spectral_irradiance_texture_ != nullptr);
+  assert(wavelengths.size() <= static_cast<unsigned int>(kNumWavelengths));
+  const unsigned int num_wavelengths = wavelengths.size();
+  Length r = length(point);
+  Number mu_s = dot(point, sun_direction) / r;
+
+  // Indirect irradiance (approximated if the surface is not horizontal).
+  double irradiance[kNumWavelengths];
+  spectral_irradiance_texture_->Lookup(
+      GetIrradianceTextureUvFromRMuS(atmosphere_, r, mu_s),
+      wavelengths.data(), num_wavelengths, irradiance);
+  const double sky_factor = ((1.0 + dot(normal, point) / r) * 0.5)();
+  for (unsigned int l = 0; l < num_wavelengths; ++l) {
+    sky_irradiance[l] = irradiance[l] * sky_factor * SpectralIrradiance::Unit();
+  }
+
+  // Direct irradiance.
+  double transmittance[kNumWavelengths];
+  GetTransmittanceToSun(atmosphere_, *spectral_transmittance_texture_,
+      r, mu_s, wavelengths, transmittance);
+  const double sun_factor = max(dot(normal, sun_direction), Number(0.0))();
+  for (unsigned int l = 0; l < num_wavelengths; ++l) {
+    sun_irradiance[l] = atmosphere_.solar_irradiance[wavelengths[l]] *
+        (transmittance[l] * sun_factor);
+  }
+}
+
+/*
+<p>Finally, the batch methods simply call the above methods for each query, with
+several queries processed in parallel. They do not allocate any memory per
+query, and write their results directly in the output arrays:
+*/
+
+void Model::GetSkyRadiance(unsigned int num_rays, const Position* cameras,
+    const Direction* view_rays, const Length* shadow_lengths,
+    const Direction* sun_directions, RadianceSpectrum* radiance,
+    DimensionlessSpectrum* transmittance) const {
+  batch_scheduler_.Run(num_rays, 1, 1, [&](const Tile& tile) {
+    DimensionlessSpectrum ray_transmittance;
+    for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+      radiance[i] = GetSkyRadiance(cameras[i], view_rays[i],
+          shadow_lengths == nullptr ? 0.0 * m : shadow_lengths[i],
+          sun_directions[i],
+          transmittance == nullptr ? &ray_transmittance : &transmittance[i]);
+    }
+  });
+}
+
+void Model::GetSkyRadiance(unsigned int num_rays, const Position* cameras,
+    const Direction* view_rays, const Length* shadow_lengths,
+    const Direction* sun_directions, const std::vector<int>& wavelengths,
+    SpectralRadiance* radiance, Number* transmittance) const {
+  const unsigned int num_wavelengths = wavelengths.size();
+  batch_scheduler_.Run(num_rays, 1, 1, [&](const Tile& tile) {
+    Number ray_transmittance[kNumWavelengths];
+    for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+      GetSkyRadiance(cameras[i], view_rays[i],
+          shadow_lengths == nullptr ? 0.0 * m : shadow_lengths[i],
+          sun_directions[i], wavelengths, radiance + i * num_wavelengths,
+          transmittance == nullptr ?
+              ray_transmittance : transmittance + i * num_wavelengths);
+    }
+  });
+}
+
+void Model::GetSkyRadianceToPoint(unsigned int num_rays,
+    const Position* cameras, const Position* points,
+    const Length* shadow_lengths, const Direction* sun_directions,
+    RadianceSpectrum* radiance, DimensionlessSpectrum* transmittance) const {
+  batch_scheduler_.Run(num_rays, 1, 1, [&](const Tile& tile) {
+    DimensionlessSpectrum ray_transmittance;
+    for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+      radiance[i] = GetSkyRadianceToPoint(cameras[i], points[i],
+          shadow_lengths == nullptr ? 0.0 * m : shadow_lengths[i],
+          sun_directions[i],
+          transmittance == nullptr ? &ray_transmittance : &transmittance[i]);
+    }
+  });
+}
+
+void Model::GetSkyRadianceToPoint(unsigned int num_rays,
+    const Position* cameras, const Position* points,
+    const Length* shadow_lengths, const Direction* sun_directions,
+    const std::vector<int>& wavelengths, SpectralRadiance* radiance,
+    Number* transmittance) const {
+  const unsigned int num_wavelengths = wavelengths.size();
+  batch_scheduler_.Run(num_rays, 1, 1, [&](const Tile& tile) {
+    Number ray_transmittance[kNumWavelengths];
+    for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+      GetSkyRadianceToPoint(cameras[i], points[i],
+          shadow_lengths == nullptr ? 0.0 * m : shadow_lengths[i],
+          sun_directions[i], wavelengths, radiance + i * num_wavelengths,
+          transmittance == nullptr ?
+              ray_transmittance : transmittance + i * num_wavelengths);
+    }
+  });
+}
+
+void Model::GetSunAndSkyIrradiance(unsigned int num_points,
+    const Position* points, const Direction* normals,
+    const Direction* sun_directions, IrradianceSpectrum* sun_irradiance,
+    IrradianceSpectrum* sky_irradiance) const {
+  batch_scheduler_.Run(num_points, 1, 1, [&](const Tile& tile) {
+    for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+      sun_irradiance[i] = GetSunAndSkyIrradiance(points[i], normals[i],
+          sun_directions[i], &sky_irradiance[i]);
+    }
+  });
+}
+
+void Model::GetSunAndSkyIrradiance(unsigned int num_points,
+    const Position* points, const Direction* normals,
+    const Direction* sun_directions, const std::vector<int>& wavelengths,
+    SpectralIrradiance* sun_irradiance,
+    SpectralIrradiance* sky_irradiance) const {
+  const unsigned int num_wavelengths = wavelengths.size();
+  batch_scheduler_.Run(num_points, 1, 1, [&](const Tile& tile) {
+    for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+      GetSunAndSkyIrradiance(points[i], normals[i], sun_directions[i],
+          wavelengths, sun_irradiance + i * num_wavelengths,
+          sky_irradiance + i * num_wavelengths);
+    }
+  });
+}
+
 }  // namespace reference
 }  // namespace atmosphere
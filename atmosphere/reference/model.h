@@ -33,12 +33,36 @@
 To use it:
 <ul>
 <li>create a <code>Model</code> instance with the desired atmosphere
-parameters, and a directory where the precomputed textures can be cached,</li>
+parameters, and a directory where the precomputed textures can be cached
+(optionally, with the number of threads and the size of the tiles of texels
+which are used to precompute these textures in parallel - see
+<a href="scheduler.h.html">scheduler.h</a> - and with a more compact format for
+the cache files - see <a href="texture_cache.h.html">texture_cache.h</a>. Note
+that if this format only stores some wavelengths, the textures loaded from the
+cache are 0 for the other wavelengths, which must then not be used),</li>
 <li>call <code>Init</code> to precompute the atmosphere textures (or read
-them from the cache directory if they have already been precomputed),</li>
+them from the cache directory if they have already been precomputed with the
+same parameters - see <a href="texture_cache.h.html">texture_cache.h</a>), or
+<code>InitAsync</code> to do this in the background, with a cancellable handle
+and an optional deadline,</li>
 <li>call <code>GetSolarRadiance</code>, <code>GetSkyRadiance</code>,
 <code>GetSkyRadianceToPoint</code> and <code>GetSunAndSkyIrradiance</code> as
-desired,</li>
+desired (as well as <code>ComputeTransmittanceToTopAtmosphereBoundary</code>
+and <code>ComputeTransmittance</code>, which do not use the precomputed
+textures, and can thus be called before <code>Init</code>),</li>
+<li>optionally, call <code>Update</code> to change the atmosphere parameters
+after <code>Init</code> (this is much faster than creating a new model if only
+the solar irradiance and/or the ground albedo change),</li>
+<li>optionally, call <code>InitSpectralTextures</code> to create a
+wavelength-major copy of the precomputed textures (see
+<a href="spectral_texture.h.html">spectral_texture.h</a>), and then call the
+<code>GetSkyRadiance</code>, <code>GetSkyRadianceToPoint</code> and
+<code>GetSunAndSkyIrradiance</code> variants which take a list of wavelength
+indices (see <code>GetWavelengthIndex</code>), to compute these values only for
+a few wavelengths (e.g. for RGB rendering) at a lower cost,</li>
+<li>to compute these values for many rays or points at once (e.g. to bake
+lighting data), call the variants which take arrays of inputs and of outputs,
+which process the queries in parallel,</li>
 <li>delete your <code>Model</code> when you no longer need it (the destructor
 deletes the precomputed textures from memory).</li>
 </ul>
@@ -47,21 +71,244 @@ deletes the precomputed textures from memory).</li>
 #ifndef ATMOSPHERE_REFERENCE_MODEL_H_
 #define ATMOSPHERE_REFERENCE_MODEL_H_
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "atmosphere/precompute_profile.h"
 #include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/fast_definitions.h"
+#include "atmosphere/reference/progress.h"
+#include "atmosphere/reference/scheduler.h"
+#include "atmosphere/reference/spectral_texture.h"
+#include "atmosphere/reference/stage_cache.h"
+#include "atmosphere/reference/texel_geometry.h"
+#include "atmosphere/reference/texture_cache.h"
 
 namespace atmosphere {
 namespace reference {
 
 class Model {
  public:
+  enum InitStatus {
+    // The textures have been loaded or computed as requested.
+    COMPLETED,
+    // The deadline expired, and the textures have been loaded or computed with
+    // fewer scattering orders than requested (see num_scattering_orders()).
+    PARTIAL,
+    // The initialization was cancelled, or the deadline expired without any
+    // fallback. The textures must not be used.
+    CANCELLED
+  };
+
+  // The kind of change between two sets of atmosphere parameters, which
+  // determines the textures which must be recomputed (see Update).
+  enum ParameterChange {
+    // The textures are unchanged.
+    NO_CHANGE,
+    // Only the solar irradiance changed. All the textures except the
+    // transmittance are proportional to the solar irradiance, at each
+    // wavelength, and can thus simply be rescaled.
+    SOLAR_IRRADIANCE_CHANGE,
+    // Only the ground albedo, and possibly the solar irradiance, changed. The
+    // transmittance and the single scattering do not depend on the ground
+    // albedo, and only the scattering orders from the 2nd one must be
+    // recomputed.
+    GROUND_ALBEDO_CHANGE,
+    // All the textures must be recomputed.
+    OTHER_CHANGE
+  };
+
+  struct InitProgress {
+    InitProgress() : scattering_order(0), fraction(0.0) {}
+    // The current precomputation phase (see PrecomputeProfile).
+    std::string phase;
+    unsigned int scattering_order;
+    // The fraction of the total work done so far.
+    double fraction;
+  };
+
+  // The state of an asynchronous initialization (see InitAsync).
+  class InitHandle {
+   public:
+    explicit InitHandle(std::chrono::steady_clock::time_point deadline);
+
+    // Requests the cancellation of the initialization, which stops as soon as
+    // possible (see InitAsync).
+    void Cancel() { cancelled_ = true; }
+
+    InitProgress GetProgress() const;
+
+    // Waits until the initialization ends, and returns its status.
+    InitStatus Wait() const { return status_.get(); }
+
+    // Waits until the initialization ends or the timeout expires, and returns
+    // whether the initialization has ended.
+    bool WaitFor(std::chrono::milliseconds timeout) const {
+      return status_.wait_for(timeout) == std::future_status::ready;
+    }
+
+   private:
+    friend class Model;
+
+    bool IsStopRequested() const {
+      return cancelled_ || std::chrono::steady_clock::now() >= deadline_;
+    }
+
+    const std::chrono::steady_clock::time_point deadline_;
+    std::atomic<bool> cancelled_;
+    mutable std::mutex mutex_;
+    InitProgress progress_;
+    std::promise<InitStatus> promise_;
+    std::shared_future<InitStatus> status_;
+  };
+
+  // A num_threads value of 0 means using the default thread pool, shared by
+  // all the models (see ThreadPool::GetDefault).
   Model(const AtmosphereParameters& atmosphere,
-        const std::string& cache_directory);
+        const std::string& cache_directory,
+        unsigned int num_threads = 0,
+        const TileSize& tile_size = TileSize(),
+        const TextureCacheFormat& cache_format = TextureCacheFormat());
+  Model(const AtmosphereParameters& atmosphere,
+        const std::string& cache_directory,
+        std::shared_ptr<ThreadPool> thread_pool,
+        const TileSize& tile_size = TileSize(),
+        const TextureCacheFormat& cache_format = TextureCacheFormat());
+  Model(const Model&) = delete;
+  Model& operator=(const Model&) = delete;
+  // Cancels the asynchronous initialization, if any, and waits for its end.
+  ~Model();
+
+  // If 'use_checkpoints' is true, the intermediate results are saved in the
+  // cache directory, and an interrupted or extended precomputation (with more
+  // scattering orders) resumes from the last saved results. If
+  // 'convergence_tolerance' is positive, 'num_scattering_orders' is a maximum,
+  // and the precomputation stops as soon as the energy added by a scattering
+  // order, relatively to the total energy, is less than this tolerance.
+  void Init(unsigned int num_scattering_orders = 4,
+      bool use_checkpoints = false, double convergence_tolerance = 0.0);
+
+  // Same as Init, but in a new thread, and with a deadline. The returned handle
+  // can be used to follow the progress of the initialization, to cancel it,
+  // and to wait for its end. Cancellation requests and the deadline are checked
+  // before each tile of texels, and are honored as soon as possible, except
+  // while the multiple scattering of an order is accumulated in the final
+  // textures. If the deadline expires, the textures are loaded from the cache
+  // for the highest possible number of scattering orders, or computed for the
+  // scattering orders already completed. The model must not be used until the
+  // initialization ends, and only one initialization can run at a time (this
+  // method waits for the end of the previous one, if any).
+  std::shared_ptr<InitHandle> InitAsync(unsigned int num_scattering_orders = 4,
+      bool use_checkpoints = false, double convergence_tolerance = 0.0,
+      std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::time_point::max());
+
+  // Returns the kind of change from 'old_atmosphere' to 'new_atmosphere'. A
+  // solar irradiance change is considered as an OTHER_CHANGE if it changes a
+  // zero value, since the textures can't be rescaled in this case.
+  static ParameterChange ClassifyParameterChange(
+      const AtmosphereParameters& old_atmosphere,
+      const AtmosphereParameters& new_atmosphere);
+
+  // Changes the atmosphere parameters, and updates the textures accordingly,
+  // with the minimal amount of work for the kind of change (returned by this
+  // method): the textures are rescaled for a SOLAR_IRRADIANCE_CHANGE, only the
+  // scattering orders from the 2nd one are recomputed for a
+  // GROUND_ALBEDO_CHANGE, and everything is recomputed for an OTHER_CHANGE. A
+  // ground albedo change is handled, and returned, as an OTHER_CHANGE if the
+  // single scattering has not been kept (see set_keep_single_scattering). The
+  // textures are recomputed (or loaded from the cache) as in Init, with the
+  // number of scattering orders and the convergence tolerance of the last call
+  // to Init, but without checkpoints. The rescaled textures are not saved in
+  // the cache. The float and spectral textures, if any, are updated too. Must
+  // be called after Init, and after the end of InitAsync, if used.
+  ParameterChange Update(const AtmosphereParameters& atmosphere);
+
+  // Whether Init keeps a copy of the single Rayleigh scattering and of the
+  // direct irradiance, to recompute only the scattering orders from the 2nd
+  // one when the ground albedo changes (see Update). This copy is not made if
+  // the textures are loaded from the cache or from a checkpoint. Must be
+  // called before Init.
+  void set_keep_single_scattering(bool keep_single_scattering) {
+    keep_single_scattering_ = keep_single_scattering;
+  }
+
+  // The number of scattering orders used by the last call to Init.
+  unsigned int num_scattering_orders() const { return num_scattering_orders_; }
+
+  // The duration of each phase of the last call to Init.
+  const PrecomputeProfile& profile() const { return profile_; }
+
+  // The sink used to report the progress of Init. The default sink displays a
+  // progress bar in the terminal, and a null sink disables progress reports.
+  void set_progress_sink(std::shared_ptr<ProgressSink> progress_sink) {
+    progress_sink_ = progress_sink;
+  }
+
+  // Whether to use the functions compiled with plain floating point types (see
+  // fast_definitions.h), instead of the physical types of definitions.h, to
+  // precompute the textures (except the scattering density, which has its own
+  // vectorized implementation, and the indirect irradiance) and to compute the
+  // single query methods below. This is faster, but less precise (the relative
+  // difference is bounded in fast_functions_test.cc), and Init then keeps a
+  // float copy of the precomputed textures, for the queries. The textures are
+  // cached with a different parameters hash in each case. Must be called before
+  // Init.
+  void set_use_fast_functions(bool use_fast_functions) {
+    use_fast_functions_ = use_fast_functions;
+    use_fast_functions_set_ = true;
+  }
 
-  void Init(unsigned int num_scattering_orders = 4);
+  // The resolutions of the scattering and irradiance textures used to compute
+  // the scattering orders from the 2nd one: the i-th resolution is used for
+  // the (i+2)-th order, and the last one for all the subsequent orders (their
+  // transmittance sizes are ignored). Since the higher orders are very smooth,
+  // they can be computed with a lower resolution, which is much faster, and
+  // then upsampled in the final textures with a small error (see
+  // mixed_resolution_benchmark_main.cc). The transmittance, the single
+  // scattering and the final textures always use the resolution of the
+  // atmosphere parameters, which is also the default for all the orders. The
+  // textures are cached with a different parameters hash if some orders use a
+  // different resolution. Must be called before Init.
+  void set_scattering_order_resolutions(
+      const std::vector<TextureResolution>& resolutions);
+
+  // Whether to approximate all the scattering orders from the 2nd one with
+  // the isotropic multiple scattering LUT of multiple_scattering_lut.h, instead
+  // of computing each order in sequence. This is much faster, but less precise
+  // (see multiple_scattering_lut_benchmark_main.cc). The results are stored in
+  // the same textures, and the rendering functions are unchanged. With this
+  // option, Init computes at most 2 "scattering orders" (the 2nd one including
+  // all the higher orders), and ignores the convergence tolerance. The textures
+  // are cached with a different parameters hash in this case. Since the
+  // approximation error is much larger than the one of the fast functions and
+  // of a lower resolution 2nd order, this mode uses by default the fast
+  // functions, unless set_use_fast_functions is called, and a half resolution
+  // for the 2nd order, unless set_scattering_order_resolutions is called (the
+  // single scattering then takes most of the precomputation time). These
+  // defaults do not depend on the order of these calls, and are not used if
+  // this option is disabled. Must be called before Init.
+  void set_use_multiple_scattering_lut(bool use_multiple_scattering_lut) {
+    use_multiple_scattering_lut_ = use_multiple_scattering_lut;
+  }
+
+  // Whether to share the transmittance, direct irradiance and single
+  // scattering textures with the other models which need the same ones (i.e.
+  // which only differ by parameters these textures don't depend on, such as the
+  // ground albedo or the Mie phase function - see stage_cache.h). If true, Init
+  // loads these textures from the models of the same process, or from the
+  // cache directory, if possible, instead of computing them, and otherwise
+  // saves them for the other models, both in memory (as long as this model
+  // exists) and in the cache directory. Must be called before Init.
+  void set_share_precompute_stages(bool share_precompute_stages) {
+    share_precompute_stages_ = share_precompute_stages;
+  }
 
   RadianceSpectrum GetSolarRadiance() const;
 
@@ -76,13 +323,147 @@ class Model {
   IrradianceSpectrum GetSunAndSkyIrradiance(Position p, Direction normal,
       Direction sun_direction, IrradianceSpectrum* sky_irradiance) const;
 
+  // Returns the transmittance between 'p' and the top atmosphere boundary, in
+  // the given direction (or 0 if this ray intersects the ground), computed
+  // directly from the atmosphere parameters, without the precomputed textures.
+  // This method can thus be called before Init.
+  DimensionlessSpectrum ComputeTransmittanceToTopAtmosphereBoundary(
+      Position p, Direction direction) const;
+
+  // Returns the transmittance between two points in the atmosphere (assuming
+  // that the segment between them does not intersect the ground), computed
+  // without the precomputed textures, as above.
+  DimensionlessSpectrum ComputeTransmittance(Position p, Position q) const;
+
+  // Returns the index of the precomputed wavelength nearest to 'lambda'.
+  static int GetWavelengthIndex(Wavelength lambda);
+
+  // Must be called after Init, before the methods below.
+  void InitSpectralTextures();
+
+  // Same as the above methods, but only for the given wavelength indices. The
+  // output arrays must have the same size as 'wavelengths'.
+  void GetSkyRadiance(Position camera, Direction view_ray,
+      Length shadow_length, Direction sun_direction,
+      const std::vector<int>& wavelengths, SpectralRadiance* radiance,
+      Number* transmittance) const;
+
+  void GetSkyRadianceToPoint(Position camera, Position point,
+      Length shadow_length, Direction sun_direction,
+      const std::vector<int>& wavelengths, SpectralRadiance* radiance,
+      Number* transmittance) const;
+
+  void GetSunAndSkyIrradiance(Position p, Direction normal,
+      Direction sun_direction, const std::vector<int>& wavelengths,
+      SpectralIrradiance* sun_irradiance,
+      SpectralIrradiance* sky_irradiance) const;
+
+  // Batch versions of the above methods. The i-th query uses the i-th element
+  // of each input array, and stores its results in the i-th element of each
+  // output array (or, for the methods with wavelength indices, in the elements
+  // i * wavelengths.size() to (i + 1) * wavelengths.size() - 1). The
+  // shadow_lengths and transmittance arrays can be null (a null shadow_lengths
+  // array means no light shafts).
+  void GetSkyRadiance(unsigned int num_rays, const Position* cameras,
+      const Direction* view_rays, const Length* shadow_lengths,
+      const Direction* sun_directions, RadianceSpectrum* radiance,
+      DimensionlessSpectrum* transmittance) const;
+
+  void GetSkyRadiance(unsigned int num_rays, const Position* cameras,
+      const Direction* view_rays, const Length* shadow_lengths,
+      const Direction* sun_directions, const std::vector<int>& wavelengths,
+      SpectralRadiance* radiance, Number* transmittance) const;
+
+  void GetSkyRadianceToPoint(unsigned int num_rays, const Position* cameras,
+      const Position* points, const Length* shadow_lengths,
+      const Direction* sun_directions, RadianceSpectrum* radiance,
+      DimensionlessSpectrum* transmittance) const;
+
+  void GetSkyRadianceToPoint(unsigned int num_rays, const Position* cameras,
+      const Position* points, const Length* shadow_lengths,
+      const Direction* sun_directions, const std::vector<int>& wavelengths,
+      SpectralRadiance* radiance, Number* transmittance) const;
+
+  void GetSunAndSkyIrradiance(unsigned int num_points, const Position* points,
+      const Direction* normals, const Direction* sun_directions,
+      IrradianceSpectrum* sun_irradiance,
+      IrradianceSpectrum* sky_irradiance) const;
+
+  void GetSunAndSkyIrradiance(unsigned int num_points, const Position* points,
+      const Direction* normals, const Direction* sun_directions,
+      const std::vector<int>& wavelengths, SpectralIrradiance* sun_irradiance,
+      SpectralIrradiance* sky_irradiance) const;
+
  private:
-  const AtmosphereParameters atmosphere_;
+  // Implements Init and InitAsync, with an optional handle.
+  // If 'reuse_single_scattering' is true, the computation starts from the 2nd
+  // scattering order, with the transmittance, the single Mie scattering and
+  // the kept single Rayleigh scattering and direct irradiance (see Update).
+  InitStatus DoInit(unsigned int num_scattering_orders, bool use_checkpoints,
+      double convergence_tolerance, InitHandle* handle,
+      bool reuse_single_scattering = false);
+  // Creates the float copies of the precomputed textures, if
+  // UseFastFunctions() is true.
+  void InitFastTextures();
+  // Returns whether the textures are computed with the fast functions, either
+  // because this was requested with set_use_fast_functions, or by default in
+  // the multiple scattering LUT mode.
+  bool UseFastFunctions() const {
+    return use_fast_functions_set_ ?
+        use_fast_functions_ : use_multiple_scattering_lut_;
+  }
+  // Returns the atmosphere parameters with the scattering and irradiance
+  // texture sizes used to compute the given scattering order.
+  AtmosphereParameters GetScatteringOrderAtmosphere(
+      unsigned int scattering_order) const;
+  // Returns the hash of the parameters used to compute the given number of
+  // scattering orders (see HashModelParameters).
+  uint64_t HashParameters(unsigned int num_scattering_orders,
+      double convergence_tolerance = 0.0) const;
+
+  AtmosphereParameters atmosphere_;
+  fast::AtmosphereParameters fast_atmosphere_;
   const std::string cache_directory_;
+  const TextureCacheFormat cache_format_;
+  unsigned int num_scattering_orders_;
+  // The arguments of the last call to Init (see Update).
+  unsigned int requested_num_scattering_orders_;
+  double requested_convergence_tolerance_;
+  PrecomputeProfile profile_;
+  std::shared_ptr<ProgressSink> progress_sink_;
+  bool use_fast_functions_;
+  std::vector<TextureResolution> scattering_order_resolutions_;
+  // Whether set_use_fast_functions and set_scattering_order_resolutions have
+  // been called, i.e. whether the defaults of the multiple scattering LUT mode
+  // must be ignored.
+  bool use_fast_functions_set_;
+  bool scattering_order_resolutions_set_;
+  bool use_multiple_scattering_lut_;
+  bool keep_single_scattering_;
+  bool share_precompute_stages_;
+  // The shared stage results used by the last call to Init.
+  std::vector<StageCache::Handle> stage_handles_;
+  const TileScheduler scheduler_;
+  const TileScheduler batch_scheduler_;
   std::unique_ptr<TransmittanceTexture> transmittance_texture_;
   std::unique_ptr<ReducedScatteringTexture> scattering_texture_;
   std::unique_ptr<ReducedScatteringTexture> single_mie_scattering_texture_;
   std::unique_ptr<IrradianceTexture> irradiance_texture_;
+  // The copies made if keep_single_scattering_ is true, or null.
+  std::unique_ptr<ReducedScatteringTexture> single_rayleigh_scattering_texture_;
+  std::unique_ptr<IrradianceTexture> direct_irradiance_texture_;
+  std::unique_ptr<SpectralTexture> spectral_transmittance_texture_;
+  std::unique_ptr<SpectralTexture> spectral_scattering_texture_;
+  std::unique_ptr<SpectralTexture> spectral_single_mie_scattering_texture_;
+  std::unique_ptr<SpectralTexture> spectral_irradiance_texture_;
+  std::unique_ptr<fast::TransmittanceTexture> fast_transmittance_texture_;
+  std::unique_ptr<fast::ReducedScatteringTexture> fast_scattering_texture_;
+  std::unique_ptr<fast::ReducedScatteringTexture>
+      fast_single_mie_scattering_texture_;
+  std::unique_ptr<fast::IrradianceTexture> fast_irradiance_texture_;
+  std::unique_ptr<TexelGeometry> texel_geometry_;
+  std::shared_ptr<InitHandle> init_handle_;
+  std::thread init_thread_;
 };
 
 }  // namespace reference
@@ -61,15 +61,21 @@ model definitions:
 
 #include "atmosphere/reference/model.h"
 
+#include <dirent.h>
 #include <glad/glad.h>
 #include <GL/freeglut.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <fstream>
 #include <memory>
 
 #include "atmosphere/model.h"
 #include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/progress.h"
 #include "minpng/minpng.h"
 #include "test/test_case.h"
 #include "util/progress_bar.h"
@@ -99,6 +105,16 @@ constexpr Wavelength kLambdaR = atmosphere::Model::kLambdaR * nm;
 constexpr Wavelength kLambdaG = atmosphere::Model::kLambdaG * nm;
 constexpr Wavelength kLambdaB = atmosphere::Model::kLambdaB * nm;
 
+// The maximum relative difference between the results of the CPU model with
+// the full spectrum and with only a few wavelengths (these results should only
+// differ because of rounding errors).
+constexpr double kBatchTolerance = 1e-9;
+
+// The maximum error of the CPU model with the 3rd scattering order computed
+// with a lower resolution, relatively to the contribution of this order (see
+// TestCpuModelMixedResolution).
+constexpr double kMixedResolutionTolerance = 0.1;
+
 /*
 <p>The test scene is rendered on GPU by the following shaders. The vertex shader
 simply renders a full screen quad, and outputs the view ray direction in model
@@ -184,6 +200,43 @@ void WritePngArgb(const std::string& name, void* pixels) {
   write_png((std::string(kOutputDir) + name).c_str(), pixels, kWidth, kHeight);
 }
 
+/*
+<p>Some tests of the CPU model compare several models precomputed from scratch.
+For this they use a new cache directory, which is created and removed with the
+following class:
+*/
+
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    char directory[] = "/tmp/atmosphere_model_test.XXXXXX";
+    if (mkdtemp(directory) != nullptr) {
+      path_ = std::string(directory) + "/";
+    }
+  }
+
+  ~TemporaryDirectory() {
+    DIR* dir = opendir(path_.c_str());
+    if (dir != nullptr) {
+      while (struct dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+          std::remove((path_ + name).c_str());
+        }
+      }
+      closedir(dir);
+      rmdir(path_.c_str());
+    }
+  }
+
+  // The directory path, with a trailing slash, or an empty string if the
+  // directory could not be created.
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
 }  // anonymous namespace
 
 /*
@@ -683,7 +736,8 @@ sample the radiance spectrum at the 3 predefined wavelengths):
     const auto cie_z_bar = DimensionlessSpectrum(wavelengths, z_values);
 
     Image pixels(new unsigned int[kWidth * kHeight]);
-    ProgressBar progress_bar(kWidth * kHeight);
+    Progress progress(kWidth * kHeight,
+        std::make_shared<TerminalProgressSink>());
     RunJobs([&](unsigned int j) {
       double y = 1.0 - 2.0 * (j + 0.5) / kHeight;
       double dy = -2.0 / kHeight;
@@ -731,8 +785,8 @@ sample the radiance spectrum at the 3 predefined wavelengths):
         unsigned int blue = static_cast<unsigned int>(b * 255.0);
         pixels[i + j * kWidth] =
             (255 << 24) | (red << 16) | (green << 8) | blue;
-        progress_bar.Increment(1);
       }
+      progress.Increment(kWidth);
     }, kHeight);
     return pixels;
   }
@@ -1063,7 +1117,7 @@ XYZ and then to sRGB only at the very end).
   }
 
 /*
-<p>The last test case compares the sRGB luminance computations, done on GPU
+<p>The following test case compares the sRGB luminance computations, done on GPU
 vs CPU, in a "worst case" situation: combined textures on GPU and a sunset scene
 (leading to large differences in the single Mie component), and wavelength
 dependent albedo values (see the previous test case):
@@ -1082,6 +1136,536 @@ dependent albedo values (see the previous test case):
         40.0, Compare(RenderGpuImage(), RenderCpuImage(), kCaption, true));
   }
 
+/*
+<p>The last test cases do not use the GPU model. The first one checks that the
+batch query methods of the CPU model, with the full spectrum or with only 3
+wavelengths, return the same results as the single query methods:
+*/
+
+  void TestCpuModelBatchQueries() {
+    InitCpuModel();
+    reference_model_->InitSpectralTextures();
+    const std::vector<int> wavelengths = {
+      reference::Model::GetWavelengthIndex(kLambdaR),
+      reference::Model::GetWavelengthIndex(kLambdaG),
+      reference::Model::GetWavelengthIndex(kLambdaB)
+    };
+    constexpr unsigned int kNumQueries = 1000;
+    std::vector<Position> cameras;
+    std::vector<Position> points;
+    std::vector<Direction> directions;
+    std::vector<Direction> sun_directions;
+    std::vector<Length> shadow_lengths;
+    for (unsigned int i = 0; i < kNumQueries; ++i) {
+      const double theta = PI * i / kNumQueries;
+      const double phi = 2.0 * PI * ((7 * i) % kNumQueries) / kNumQueries;
+      const Direction direction(std::sin(theta) * std::cos(phi),
+          std::sin(theta) * std::sin(phi), std::cos(theta));
+      const Position camera(0.0 * m, 0.0 * m,
+          atmosphere_parameters_.bottom_radius + (i % 10) * 1.0 * km);
+      cameras.push_back(camera);
+      points.push_back(camera + direction * (10.0 * km));
+      directions.push_back(direction);
+      sun_directions.push_back(Direction(std::sin(phi), 0.0, std::cos(phi)));
+      shadow_lengths.push_back((i % 3) * 1.0 * km);
+    }
+
+    std::vector<RadianceSpectrum> radiance(kNumQueries);
+    std::vector<DimensionlessSpectrum> transmittance(kNumQueries);
+    std::vector<SpectralRadiance> rgb_radiance(3 * kNumQueries);
+    std::vector<Number> rgb_transmittance(3 * kNumQueries);
+    reference_model_->GetSkyRadiance(kNumQueries, cameras.data(),
+        directions.data(), shadow_lengths.data(), sun_directions.data(),
+        radiance.data(), transmittance.data());
+    reference_model_->GetSkyRadiance(kNumQueries, cameras.data(),
+        directions.data(), shadow_lengths.data(), sun_directions.data(),
+        wavelengths, rgb_radiance.data(), rgb_transmittance.data());
+    for (unsigned int i = 0; i < kNumQueries; ++i) {
+      DimensionlessSpectrum expected_transmittance;
+      RadianceSpectrum expected_radiance = reference_model_->GetSkyRadiance(
+          cameras[i], directions[i], shadow_lengths[i], sun_directions[i],
+          &expected_transmittance);
+      ExpectSameSpectra(expected_radiance, expected_transmittance,
+          radiance[i], transmittance[i], wavelengths, &rgb_radiance[3 * i],
+          &rgb_transmittance[3 * i]);
+    }
+
+    reference_model_->GetSkyRadianceToPoint(kNumQueries, cameras.data(),
+        points.data(), shadow_lengths.data(), sun_directions.data(),
+        radiance.data(), transmittance.data());
+    reference_model_->GetSkyRadianceToPoint(kNumQueries, cameras.data(),
+        points.data(), shadow_lengths.data(), sun_directions.data(),
+        wavelengths, rgb_radiance.data(), rgb_transmittance.data());
+    for (unsigned int i = 0; i < kNumQueries; ++i) {
+      DimensionlessSpectrum expected_transmittance;
+      RadianceSpectrum expected_radiance =
+          reference_model_->GetSkyRadianceToPoint(cameras[i], points[i],
+              shadow_lengths[i], sun_directions[i], &expected_transmittance);
+      ExpectSameSpectra(expected_radiance, expected_transmittance,
+          radiance[i], transmittance[i], wavelengths, &rgb_radiance[3 * i],
+          &rgb_transmittance[3 * i]);
+    }
+
+    std::vector<IrradianceSpectrum> sun_irradiance(kNumQueries);
+    std::vector<IrradianceSpectrum> sky_irradiance(kNumQueries);
+    std::vector<SpectralIrradiance> rgb_sun_irradiance(3 * kNumQueries);
+    std::vector<SpectralIrradiance> rgb_sky_irradiance(3 * kNumQueries);
+    reference_model_->GetSunAndSkyIrradiance(kNumQueries, cameras.data(),
+        directions.data(), sun_directions.data(), sun_irradiance.data(),
+        sky_irradiance.data());
+    reference_model_->GetSunAndSkyIrradiance(kNumQueries, cameras.data(),
+        directions.data(), sun_directions.data(), wavelengths,
+        rgb_sun_irradiance.data(), rgb_sky_irradiance.data());
+    for (unsigned int i = 0; i < kNumQueries; ++i) {
+      IrradianceSpectrum expected_sky_irradiance;
+      IrradianceSpectrum expected_sun_irradiance =
+          reference_model_->GetSunAndSkyIrradiance(cameras[i], directions[i],
+              sun_directions[i], &expected_sky_irradiance);
+      for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+        const int w = wavelengths[l];
+        ExpectEquals(
+            expected_sun_irradiance[w].to(watt_per_square_meter_per_nm),
+            sun_irradiance[i][w].to(watt_per_square_meter_per_nm));
+        ExpectEquals(
+            expected_sky_irradiance[w].to(watt_per_square_meter_per_nm),
+            sky_irradiance[i][w].to(watt_per_square_meter_per_nm));
+        ExpectNearRelative(
+            expected_sun_irradiance[w].to(watt_per_square_meter_per_nm),
+            rgb_sun_irradiance[3 * i + l].to(watt_per_square_meter_per_nm));
+        ExpectNearRelative(
+            expected_sky_irradiance[w].to(watt_per_square_meter_per_nm),
+            rgb_sky_irradiance[3 * i + l].to(watt_per_square_meter_per_nm));
+      }
+    }
+  }
+
+  void ExpectSameSpectra(const RadianceSpectrum& expected_radiance,
+      const DimensionlessSpectrum& expected_transmittance,
+      const RadianceSpectrum& radiance,
+      const DimensionlessSpectrum& transmittance,
+      const std::vector<int>& wavelengths, const SpectralRadiance* rgb_radiance,
+      const Number* rgb_transmittance) {
+    for (unsigned int l = 0; l < expected_radiance.size(); ++l) {
+      ExpectEquals(
+          expected_radiance[l].to(watt_per_square_meter_per_sr_per_nm),
+          radiance[l].to(watt_per_square_meter_per_sr_per_nm));
+      ExpectEquals(expected_transmittance[l](), transmittance[l]());
+    }
+    for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+      const int w = wavelengths[l];
+      ExpectNearRelative(
+          expected_radiance[w].to(watt_per_square_meter_per_sr_per_nm),
+          rgb_radiance[l].to(watt_per_square_meter_per_sr_per_nm));
+      ExpectNearRelative(expected_transmittance[w](), rgb_transmittance[l]());
+    }
+  }
+
+  void ExpectNearRelative(double expected, double actual,
+      double relative_tolerance = kBatchTolerance) {
+    ExpectNear(expected, actual, std::abs(expected) * relative_tolerance);
+  }
+
+/*
+<p>We then check that a precomputation with checkpoints, extended from 2 to 3
+scattering orders by a new model using the same cache directory, only computes
+the 3rd order, and gets the same results as a direct precomputation of the 3
+orders, done in another cache directory (to make sure that its results are not
+loaded from the cache). For this we use very small textures (see
+<code>GetSmallAtmosphereParameters</code> below), so that each model is
+precomputed in a short time:
+*/
+
+  void TestCpuModelCheckpoints() {
+    typedef reference::Model Model;
+    TemporaryDirectory directory;
+    TemporaryDirectory direct_directory;
+    ExpectFalse(directory.path().empty());
+    ExpectFalse(direct_directory.path().empty());
+    const AtmosphereParameters atmosphere = GetSmallAtmosphereParameters();
+
+    Model double_scattering_model(atmosphere, directory.path());
+    double_scattering_model.set_progress_sink(nullptr);
+    double_scattering_model.Init(2, true);
+    ExpectTrue(HasPhase(double_scattering_model, "checkpoint_save"));
+
+    Model model(atmosphere, directory.path());
+    model.set_progress_sink(nullptr);
+    model.Init(3, true);
+    ExpectEquals(3u, model.num_scattering_orders());
+    ExpectTrue(HasPhase(model, "checkpoint_load"));
+    ExpectFalse(HasPhase(model, "transmittance"));
+    ExpectFalse(HasPhase(model, "direct_irradiance"));
+    ExpectFalse(HasPhase(model, "single_scattering"));
+    ExpectTrue(HasPhase(model, "multiple_scattering"));
+    for (const PrecomputePhase& phase : model.profile().phases()) {
+      if (phase.name == "scattering_density" ||
+          phase.name == "indirect_irradiance" ||
+          phase.name == "multiple_scattering") {
+        ExpectEquals(3u, phase.scattering_order);
+      }
+    }
+
+    Model direct_model(atmosphere, direct_directory.path());
+    direct_model.set_progress_sink(nullptr);
+    direct_model.Init(3);
+    ExpectSameCpuModelResults(direct_model, model, kBatchTolerance);
+  }
+
+/*
+<p>We also check that an asynchronous initialization of the CPU model can be
+cancelled, and that it stops without any result if its deadline expires before
+the first scattering order is computed, and if there is no cached result to
+fall back to (we use a cache directory prefix which is not used by the other
+tests for this). Both cases stop before the first tile of texels, and are thus
+fast:
+*/
+
+  void TestCpuModelAsyncInit() {
+    reference::Model model(atmosphere_parameters_, "output/async_init_");
+    model.set_progress_sink(nullptr);
+
+    auto handle = model.InitAsync(4, false, 0.0,
+        std::chrono::steady_clock::now());
+    ExpectTrue(handle->Wait() == reference::Model::CANCELLED);
+    ExpectEquals(0, handle->GetProgress().scattering_order);
+
+    handle = model.InitAsync();
+    handle->Cancel();
+    ExpectTrue(handle->Wait() == reference::Model::CANCELLED);
+    ExpectTrue(handle->WaitFor(std::chrono::milliseconds(0)));
+  }
+
+/*
+<p>We also check that computing the 3rd scattering order with a lower resolution
+(see <code>set_scattering_order_resolutions</code>) gives results close to a
+full resolution precomputation, and that the 2nd order, computed with the full
+resolution, is not resampled:
+*/
+
+  void TestCpuModelMixedResolution() {
+    typedef reference::Model Model;
+    TemporaryDirectory directory;
+    TemporaryDirectory mixed_resolution_directory;
+    ExpectFalse(directory.path().empty());
+    ExpectFalse(mixed_resolution_directory.path().empty());
+    AtmosphereParameters atmosphere = GetSmallAtmosphereParameters();
+    TextureResolution& resolution = atmosphere.texture_resolution;
+    resolution.scattering_r_size = 8;
+    resolution.scattering_mu_size = 32;
+    resolution.scattering_mu_s_size = 16;
+    resolution.scattering_nu_size = 4;
+    resolution.irradiance_width = 32;
+    resolution.irradiance_height = 8;
+    // The coarse resolution of the 3rd order halves all the sizes, except
+    // those which are already very small.
+    TextureResolution coarse_resolution = resolution;
+    coarse_resolution.scattering_r_size /= 2;
+    coarse_resolution.scattering_mu_size /= 2;
+    coarse_resolution.scattering_mu_s_size /= 2;
+    coarse_resolution.irradiance_width /= 2;
+
+    Model double_scattering_model(atmosphere, directory.path());
+    double_scattering_model.set_progress_sink(nullptr);
+    double_scattering_model.Init(2);
+    Model model(atmosphere, directory.path());
+    model.set_progress_sink(nullptr);
+    model.Init(3);
+    Model mixed_resolution_model(atmosphere, mixed_resolution_directory.path());
+    mixed_resolution_model.set_progress_sink(nullptr);
+    mixed_resolution_model.set_scattering_order_resolutions(
+        {resolution, coarse_resolution});
+    mixed_resolution_model.Init(3);
+    ExpectFalse(HasPhase(model, "upsampling"));
+    ExpectTrue(HasPhase(mixed_resolution_model, "upsampling"));
+    for (const PrecomputePhase& phase :
+         mixed_resolution_model.profile().phases()) {
+      if (phase.name == "resampling" || phase.name == "upsampling") {
+        ExpectEquals(3u, phase.scattering_order);
+      }
+    }
+
+    // The results of the full resolution models with 2 and 3 orders differ by
+    // the 3rd order contribution. The error of the mixed resolution model must
+    // be a small fraction of this contribution (the relative error of each
+    // result is not tested, because it can be large for the very small values,
+    // e.g. when the Sun is below the horizon).
+    const std::vector<double> double_scattering_results =
+        GetCpuModelResults(double_scattering_model);
+    const std::vector<double> results = GetCpuModelResults(model);
+    const std::vector<double> mixed_resolution_results =
+        GetCpuModelResults(mixed_resolution_model);
+    double third_order_contribution = 0.0;
+    double mixed_resolution_error = 0.0;
+    for (unsigned int i = 0; i < results.size(); ++i) {
+      third_order_contribution +=
+          std::abs(results[i] - double_scattering_results[i]);
+      mixed_resolution_error +=
+          std::abs(mixed_resolution_results[i] - results[i]);
+    }
+    ExpectTrue(mixed_resolution_error <
+        kMixedResolutionTolerance * third_order_contribution);
+  }
+
+/*
+<p>We also check that the parameter changes are correctly classified by the
+CPU model, since this determines which textures are recomputed by
+<code>Update</code> (the updated textures are compared with those of new models
+below):
+*/
+
+  void TestCpuModelParameterChanges() {
+    typedef reference::Model Model;
+    AtmosphereParameters atmosphere = atmosphere_parameters_;
+    ExpectTrue(Model::ClassifyParameterChange(atmosphere_parameters_,
+        atmosphere) == Model::NO_CHANGE);
+    atmosphere.solar_irradiance = atmosphere.solar_irradiance * 2.0;
+    ExpectTrue(Model::ClassifyParameterChange(atmosphere_parameters_,
+        atmosphere) == Model::SOLAR_IRRADIANCE_CHANGE);
+    atmosphere.ground_albedo = GetGrassAlbedo();
+    ExpectTrue(Model::ClassifyParameterChange(atmosphere_parameters_,
+        atmosphere) == Model::GROUND_ALBEDO_CHANGE);
+    atmosphere.solar_irradiance = atmosphere_parameters_.solar_irradiance;
+    ExpectTrue(Model::ClassifyParameterChange(atmosphere_parameters_,
+        atmosphere) == Model::GROUND_ALBEDO_CHANGE);
+    atmosphere.mie_phase_function_g = 0.7;
+    ExpectTrue(Model::ClassifyParameterChange(atmosphere_parameters_,
+        atmosphere) == Model::OTHER_CHANGE);
+
+    // A zero solar irradiance can't be rescaled to a non-zero value.
+    atmosphere = atmosphere_parameters_;
+    atmosphere.solar_irradiance[0] = 0.0 * watt_per_square_meter_per_nm;
+    ExpectTrue(Model::ClassifyParameterChange(atmosphere,
+        atmosphere_parameters_) == Model::OTHER_CHANGE);
+  }
+
+/*
+<p>We then check that the textures updated after a change of the solar
+irradiance, of the ground albedo, or of both, give the same results as new
+models, and that a ground albedo change recomputes all the orders if the single
+scattering has not been kept. The new models use another cache directory, to
+avoid loading the textures saved by <code>Update</code>:
+*/
+
+  void TestCpuModelUpdate() {
+    typedef reference::Model Model;
+    TemporaryDirectory directory;
+    TemporaryDirectory new_model_directory;
+    ExpectFalse(directory.path().empty());
+    ExpectFalse(new_model_directory.path().empty());
+    const AtmosphereParameters atmosphere = GetSmallAtmosphereParameters();
+    AtmosphereParameters solar_atmosphere = atmosphere;
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      solar_atmosphere.solar_irradiance[l] =
+          solar_atmosphere.solar_irradiance[l] * (1.0 + 0.01 * l);
+    }
+    AtmosphereParameters albedo_atmosphere = atmosphere;
+    albedo_atmosphere.ground_albedo = GetGrassAlbedo();
+    AtmosphereParameters other_albedo_atmosphere = atmosphere;
+    other_albedo_atmosphere.ground_albedo = DimensionlessSpectrum(0.3);
+
+    Model model(atmosphere, directory.path());
+    model.set_progress_sink(nullptr);
+    model.set_keep_single_scattering(true);
+    model.Init(3);
+    const struct {
+      const AtmosphereParameters& atmosphere;
+      Model::ParameterChange change;
+    } updates[] = {
+      {solar_atmosphere, Model::SOLAR_IRRADIANCE_CHANGE},
+      {albedo_atmosphere, Model::GROUND_ALBEDO_CHANGE},
+      {other_albedo_atmosphere, Model::GROUND_ALBEDO_CHANGE}
+    };
+    for (const auto& update : updates) {
+      ExpectTrue(model.Update(update.atmosphere) == update.change);
+      ExpectFalse(HasPhase(model, "single_scattering"));
+      Model new_model(update.atmosphere, new_model_directory.path());
+      new_model.set_progress_sink(nullptr);
+      new_model.Init(3);
+      ExpectSameCpuModelResults(new_model, model, kBatchTolerance);
+    }
+
+    Model other_model(atmosphere, directory.path());
+    other_model.set_progress_sink(nullptr);
+    other_model.Init(3);
+    ExpectTrue(other_model.Update(albedo_atmosphere) == Model::OTHER_CHANGE);
+  }
+
+/*
+<p>We also check that models sharing their first precomputation stages (see
+<code>set_share_precompute_stages</code>) get the same results as a model
+computing all its stages, and that a model using the fast functions does not
+share the stages computed with the double ones:
+*/
+
+  void TestCpuModelStageSharing() {
+    typedef reference::Model Model;
+    TemporaryDirectory directory;
+    ExpectFalse(directory.path().empty());
+    const AtmosphereParameters atmosphere = GetSmallAtmosphereParameters();
+    AtmosphereParameters grass_atmosphere = atmosphere;
+    grass_atmosphere.ground_albedo = GetGrassAlbedo();
+
+    Model model(atmosphere, directory.path());
+    model.set_progress_sink(nullptr);
+    model.set_share_precompute_stages(true);
+    model.Init(3);
+    ExpectTrue(HasPhase(model, "transmittance"));
+
+    Model shared_model(grass_atmosphere, directory.path());
+    shared_model.set_progress_sink(nullptr);
+    shared_model.set_share_precompute_stages(true);
+    shared_model.Init(3);
+    ExpectFalse(HasPhase(shared_model, "transmittance"));
+    ExpectFalse(HasPhase(shared_model, "direct_irradiance"));
+    ExpectFalse(HasPhase(shared_model, "single_scattering"));
+
+    // Use another cache directory, to avoid loading the final textures saved by
+    // the shared model.
+    TemporaryDirectory other_directory;
+    Model unshared_model(grass_atmosphere, other_directory.path());
+    unshared_model.set_progress_sink(nullptr);
+    unshared_model.Init(3);
+    ExpectTrue(HasPhase(unshared_model, "single_scattering"));
+    ExpectSameCpuModelResults(unshared_model, shared_model, kBatchTolerance);
+
+    Model fast_model(atmosphere, directory.path());
+    fast_model.set_progress_sink(nullptr);
+    fast_model.set_share_precompute_stages(true);
+    fast_model.set_use_fast_functions(true);
+    fast_model.Init(3);
+    ExpectTrue(HasPhase(fast_model, "transmittance"));
+    ExpectTrue(HasPhase(fast_model, "direct_irradiance"));
+    ExpectTrue(HasPhase(fast_model, "single_scattering"));
+  }
+
+/*
+<p>Finally, we check that the defaults of the multiple scattering LUT mode (see
+<code>set_use_multiple_scattering_lut</code>) are not used when this mode is
+disabled, and do not depend on the order in which the options are set. For this
+we use the fact that a model loads its textures from the cache directory, and
+thus does not compute the transmittance, if and only if they were saved by a
+model with the same parameters hash:
+*/
+
+  void TestCpuModelMultipleScatteringLutDefaults() {
+    typedef reference::Model Model;
+    TemporaryDirectory directory;
+    ExpectFalse(directory.path().empty());
+    const AtmosphereParameters atmosphere = GetSmallAtmosphereParameters();
+
+    Model model(atmosphere, directory.path());
+    model.set_progress_sink(nullptr);
+    model.Init(2);
+    Model disabled_lut_model(atmosphere, directory.path());
+    disabled_lut_model.set_progress_sink(nullptr);
+    disabled_lut_model.set_use_multiple_scattering_lut(true);
+    disabled_lut_model.set_use_multiple_scattering_lut(false);
+    disabled_lut_model.Init(2);
+    ExpectFalse(HasPhase(disabled_lut_model, "transmittance"));
+
+    Model lut_model(atmosphere, directory.path());
+    lut_model.set_progress_sink(nullptr);
+    lut_model.set_use_multiple_scattering_lut(true);
+    lut_model.Init(2);
+    ExpectTrue(HasPhase(lut_model, "transmittance"));
+    ExpectTrue(HasPhase(lut_model, "upsampling"));
+
+    Model exact_lut_model(atmosphere, directory.path());
+    exact_lut_model.set_progress_sink(nullptr);
+    exact_lut_model.set_use_fast_functions(false);
+    exact_lut_model.set_scattering_order_resolutions({});
+    exact_lut_model.set_use_multiple_scattering_lut(true);
+    exact_lut_model.Init(2);
+    ExpectTrue(HasPhase(exact_lut_model, "transmittance"));
+    ExpectFalse(HasPhase(exact_lut_model, "upsampling"));
+    Model other_exact_lut_model(atmosphere, directory.path());
+    other_exact_lut_model.set_progress_sink(nullptr);
+    other_exact_lut_model.set_use_multiple_scattering_lut(true);
+    other_exact_lut_model.set_use_fast_functions(false);
+    other_exact_lut_model.set_scattering_order_resolutions({});
+    other_exact_lut_model.Init(2);
+    ExpectFalse(HasPhase(other_exact_lut_model, "transmittance"));
+  }
+
+  // Returns the atmosphere parameters of the test scene, with very small
+  // textures and few samples. The results of a CPU model are then not
+  // accurate, but this does not matter to compare precomputation options.
+  AtmosphereParameters GetSmallAtmosphereParameters() const {
+    AtmosphereParameters atmosphere = atmosphere_parameters_;
+    TextureResolution& resolution = atmosphere.texture_resolution;
+    resolution.transmittance_width = 16;
+    resolution.transmittance_height = 8;
+    resolution.scattering_r_size = 4;
+    resolution.scattering_mu_size = 8;
+    resolution.scattering_mu_s_size = 4;
+    resolution.scattering_nu_size = 2;
+    resolution.irradiance_width = 8;
+    resolution.irradiance_height = 4;
+    Quadrature& quadrature = atmosphere.quadrature;
+    quadrature.scattering_density_sample_count = 128;
+    quadrature.indirect_irradiance_sample_count = 128;
+    return atmosphere;
+  }
+
+  // Returns whether the last precomputation of the given model has a phase
+  // with the given name (for any scattering order).
+  static bool HasPhase(const reference::Model& model,
+      const std::string& name) {
+    for (const PrecomputePhase& phase : model.profile().phases()) {
+      if (phase.name == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns the sky radiance, transmittance, sun irradiance and sky irradiance
+  // of a CPU model (in this order for each wavelength, in SI units), for all
+  // the wavelengths and for a few view and sun directions.
+  std::vector<double> GetCpuModelResults(const reference::Model& model) const {
+    constexpr unsigned int kNumQueries = 16;
+    std::vector<double> results;
+    for (unsigned int i = 0; i < kNumQueries; ++i) {
+      const double theta = PI * (i + 0.5) / kNumQueries;
+      const double sun_theta =
+          0.6 * PI * ((5 * i) % kNumQueries) / kNumQueries;
+      const Position camera(0.0 * m, 0.0 * m,
+          atmosphere_parameters_.bottom_radius + (i % 4) * 5.0 * km);
+      const Direction view_ray(std::sin(theta), 0.0, std::cos(theta));
+      const Direction normal(0.0, 0.0, 1.0);
+      const Direction sun_direction(std::sin(sun_theta) * std::cos(theta),
+          std::sin(sun_theta) * std::sin(theta), std::cos(sun_theta));
+      DimensionlessSpectrum transmittance;
+      const RadianceSpectrum radiance = model.GetSkyRadiance(
+          camera, view_ray, 0.0 * m, sun_direction, &transmittance);
+      IrradianceSpectrum sky_irradiance;
+      const IrradianceSpectrum sun_irradiance = model.GetSunAndSkyIrradiance(
+          camera, normal, sun_direction, &sky_irradiance);
+      for (unsigned int l = 0; l < radiance.size(); ++l) {
+        results.push_back(
+            radiance[l].to(watt_per_square_meter_per_sr_per_nm));
+        results.push_back(transmittance[l]());
+        results.push_back(
+            sun_irradiance[l].to(watt_per_square_meter_per_nm));
+        results.push_back(
+            sky_irradiance[l].to(watt_per_square_meter_per_nm));
+      }
+    }
+    return results;
+  }
+
+  // Checks that the results of two CPU models (see GetCpuModelResults) are the
+  // same, up to the given relative tolerance.
+  void ExpectSameCpuModelResults(const reference::Model& expected_model,
+      const reference::Model& model, double relative_tolerance) {
+    const std::vector<double> expected_results =
+        GetCpuModelResults(expected_model);
+    const std::vector<double> results = GetCpuModelResults(model);
+    for (unsigned int i = 0; i < expected_results.size(); ++i) {
+      ExpectNearRelative(expected_results[i], results[i], relative_tolerance);
+    }
+  }
+
 /*
 <p> The rest of the code simply declares the fields of our test fixture class,
 and registers the test cases in the test framework:
@@ -1147,6 +1731,30 @@ ModelTest precomputed_luminance4(
 ModelTest precomputed_luminance5(
     "PrecomputedLuminanceCombineTexturesSpectralAlbedoSunSet",
     &ModelTest::TestPrecomputedLuminanceCombineTexturesSpectralAlbedoSunSet);
+ModelTest cpu_model_batch_queries(
+    "CpuModelBatchQueries",
+    &ModelTest::TestCpuModelBatchQueries);
+ModelTest cpu_model_checkpoints(
+    "CpuModelCheckpoints",
+    &ModelTest::TestCpuModelCheckpoints);
+ModelTest cpu_model_async_init(
+    "CpuModelAsyncInit",
+    &ModelTest::TestCpuModelAsyncInit);
+ModelTest cpu_model_mixed_resolution(
+    "CpuModelMixedResolution",
+    &ModelTest::TestCpuModelMixedResolution);
+ModelTest cpu_model_parameter_changes(
+    "CpuModelParameterChanges",
+    &ModelTest::TestCpuModelParameterChanges);
+ModelTest cpu_model_update(
+    "CpuModelUpdate",
+    &ModelTest::TestCpuModelUpdate);
+ModelTest cpu_model_stage_sharing(
+    "CpuModelStageSharing",
+    &ModelTest::TestCpuModelStageSharing);
+ModelTest cpu_model_multiple_scattering_lut_defaults(
+    "CpuModelMultipleScatteringLutDefaults",
+    &ModelTest::TestCpuModelMultipleScatteringLutDefaults);
 
 }  // anonymous namespace
 
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*<h2>atmosphere/reference/multiple_scattering_lut.cc</h2>
+
+<p>This file implements the <a href="multiple_scattering_lut.h.html">multiple
+scattering LUT</a>, with the functions of <a href="functions.h.html">
+functions.h</a>.
+*/
+
+#include "atmosphere/reference/multiple_scattering_lut.h"
+
+#include <cassert>
+
+#include "atmosphere/reference/functions.h"
+
+namespace atmosphere {
+namespace reference {
+
+/*
+<p>The directions are given by the Fibonacci rule, whatever the spherical
+quadrature rule of the atmosphere parameters. Indeed, with the small number of
+directions used here, the latitude-longitude rule would put a whole row of
+directions on the horizon, where the integrands are discontinuous (the length of
+the rays, in particular, is maximal just above the horizon). This overestimates
+$f_{ms}$, and thus $\Psi_{ms}$, by a large amount. The Fibonacci directions, on
+the other hand, are almost uniformly distributed, and are never exactly on the
+horizon:
+*/
+
+std::vector<SphericalSample> GetMultipleScatteringLutDirections() {
+  return ComputeSphericalSamples(FIBONACCI_RULE,
+      MULTIPLE_SCATTERING_LUT_DIRECTION_COUNT, false /* hemisphere */, 0.0);
+}
+
+/*
+<p>For each direction $\omega$ around the point at radius $r$, we compute the
+radiance $L'$ arriving from this direction after exactly one scattering event
+with an isotropic phase function, or after one reflection of the direct sun
+light on the ground, as well as the transfer factor $\int T\sigma_s$ along the
+ray. $L_2$ and $f_{ms}$ are then the integrals of $L'p_u$ and of this factor
+times $p_u$ over all the directions, and $\Psi_{ms}$ is computed separately for
+each wavelength:
+*/
+
+RadianceSpectrum ComputeMultipleScatteringLut(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const std::vector<SphericalSample>& directions, Length r, Number mu_s) {
+  assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
+  assert(mu_s >= -1.0 && mu_s <= 1.0);
+  const InverseSolidAngle isotropic_phase_function = 1.0 / (4.0 * PI * sr);
+  const Number sin_theta_s = sqrt(1.0 - mu_s * mu_s);
+  const int rule = atmosphere.quadrature.rule;
+  const int sample_count = MULTIPLE_SCATTERING_LUT_SAMPLE_COUNT;
+  const int quadrature_sample_count =
+      GetQuadratureSampleCount(rule, sample_count);
+
+  RadianceSpectrum second_order =
+      RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm);
+  DimensionlessSpectrum transfer = DimensionlessSpectrum(0.0);
+  for (const SphericalSample& direction : directions) {
+    if (direction.weight == 0.0) {
+      continue;
+    }
+    const Number mu = direction.z;
+    const Number nu = ClampCosine(direction.x * sin_theta_s + mu * mu_s);
+    const bool ray_r_mu_intersects_ground =
+        RayIntersectsGround(atmosphere, r, mu);
+    const Length length = DistanceToNearestAtmosphereBoundary(
+        atmosphere, r, mu, ray_r_mu_intersects_ground);
+
+    // Integration loop along the ray.
+    DimensionlessSpectrum rayleigh_sum = DimensionlessSpectrum(0.0);
+    DimensionlessSpectrum mie_sum = DimensionlessSpectrum(0.0);
+    ScatteringSpectrum transfer_sum = ScatteringSpectrum(0.0 / m);
+    for (int i = 0; i < quadrature_sample_count; ++i) {
+      Number x_i;
+      Number weight_i;
+      GetQuadratureSample(rule, sample_count, i, x_i, weight_i);
+      const Length d_i = x_i * length;
+      DimensionlessSpectrum rayleigh_i;
+      DimensionlessSpectrum mie_i;
+      ComputeSingleScatteringIntegrand(atmosphere, transmittance_texture,
+          r, mu, mu_s, nu, d_i, ray_r_mu_intersects_ground, rayleigh_i, mie_i);
+      rayleigh_sum += rayleigh_i * weight_i;
+      mie_sum += mie_i * weight_i;
+
+      const Length r_i =
+          ClampRadius(atmosphere, sqrt(d_i * d_i + 2.0 * r * mu * d_i + r * r));
+      const Length altitude_i = r_i - atmosphere.bottom_radius;
+      transfer_sum += GetTransmittance(atmosphere, transmittance_texture, r,
+          mu, d_i, ray_r_mu_intersects_ground) *
+          (atmosphere.rayleigh_scattering *
+              GetProfileDensity(atmosphere.rayleigh_density, altitude_i) +
+           atmosphere.mie_scattering *
+              GetProfileDensity(atmosphere.mie_density, altitude_i)) *
+          weight_i;
+    }
+    RadianceSpectrum radiance = (rayleigh_sum * atmosphere.rayleigh_scattering +
+        mie_sum * atmosphere.mie_scattering) * length *
+        atmosphere.solar_irradiance * isotropic_phase_function;
+
+    // The direct sun light reflected on the ground, if the ray hits it.
+    if (ray_r_mu_intersects_ground) {
+      const Number mu_s_ground =
+          ClampCosine((r * mu_s + length * nu) / atmosphere.bottom_radius);
+      radiance += GetTransmittance(atmosphere, transmittance_texture, r, mu,
+          length, true) * atmosphere.ground_albedo * (1.0 / (PI * sr)) *
+          ComputeDirectIrradiance(atmosphere, transmittance_texture,
+              atmosphere.bottom_radius, mu_s_ground);
+    }
+
+    const SolidAngle weight = direction.weight * sr;
+    second_order += radiance * isotropic_phase_function * weight;
+    transfer += transfer_sum * length * isotropic_phase_function * weight;
+  }
+
+  RadianceSpectrum multiple_scattering;
+  for (unsigned int l = 0; l < multiple_scattering.size(); ++l) {
+    multiple_scattering[l] = second_order[l] / (1.0 - transfer[l]);
+  }
+  return multiple_scattering;
+}
+
+RadianceSpectrum ComputeMultipleScatteringLutTexture(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const std::vector<SphericalSample>& directions,
+    const dimensional::vec2& frag_coord) {
+  const Number x_mu_s = GetUnitRangeFromTextureCoord(
+      frag_coord.x / MULTIPLE_SCATTERING_LUT_WIDTH,
+      MULTIPLE_SCATTERING_LUT_WIDTH);
+  const Number x_r = GetUnitRangeFromTextureCoord(
+      frag_coord.y / MULTIPLE_SCATTERING_LUT_HEIGHT,
+      MULTIPLE_SCATTERING_LUT_HEIGHT);
+  const Length r = atmosphere.bottom_radius +
+      x_r * (atmosphere.top_radius - atmosphere.bottom_radius);
+  return ComputeMultipleScatteringLut(atmosphere, transmittance_texture,
+      directions, r, ClampCosine(2.0 * x_mu_s - 1.0));
+}
+
+RadianceDensitySpectrum GetMultipleScatteringLutDensity(
+    const AtmosphereParameters& atmosphere,
+    const MultipleScatteringLutTexture& multiple_scattering_lut_texture,
+    Length r, Number mu_s) {
+  const Length altitude = r - atmosphere.bottom_radius;
+  const dimensional::vec2 uv(
+      GetTextureCoordFromUnitRange(0.5 + 0.5 * mu_s,
+          MULTIPLE_SCATTERING_LUT_WIDTH),
+      GetTextureCoordFromUnitRange(
+          altitude / (atmosphere.top_radius - atmosphere.bottom_radius),
+          MULTIPLE_SCATTERING_LUT_HEIGHT));
+  return texture(multiple_scattering_lut_texture, uv) *
+      (atmosphere.rayleigh_scattering *
+          GetProfileDensity(atmosphere.rayleigh_density, altitude) +
+       atmosphere.mie_scattering *
+          GetProfileDensity(atmosphere.mie_density, altitude));
+}
+
+}  // namespace reference
+}  // namespace atmosphere
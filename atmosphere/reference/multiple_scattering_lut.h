@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/multiple_scattering_lut.h</h2>
+
+<p>This file defines an approximation of the multiple scattering, i.e. of the
+sum of all the scattering orders from the 2nd one, which the
+<a href="model.h.html">CPU model</a> can use instead of computing each order in
+sequence (see <code>Model::set_use_multiple_scattering_lut</code>). It is based
+on <a href="https://sebh.github.io/publications/egsr2020.pdf">A Scalable and
+Production Ready Sky and Atmosphere Rendering Technique</a> (Hillaire 2020),
+which assumes that the light scattered at least twice is isotropic, and that,
+around a given point, it depends on the altitude and on the sun zenith angle
+of this point, but not on the precise location. With these assumptions, and
+noting $L_2(r,\mu_s)$ the radiance scattered twice at a point, with an isotropic
+phase function $p_u=1/4\pi$ (for the light arriving from all directions after
+one scattering event, or after one reflection on the ground), and $f_{ms}(r,
+\mu_s)$ the fraction of the light scattered isotropically around this point
+which is scattered back to it, the radiance scattered at least twice is
+$\Psi_{ms}=L_2(1+f_{ms}+f_{ms}^2+...)=L_2/(1-f_{ms})$. The scattering density
+of all the orders from the 2nd one, i.e. the radiance scattered at least twice
+at a point, per unit length, is then $\sigma_s(r)\Psi_{ms}(r,\mu_s)$, where
+$\sigma_s$ is the Rayleigh and Mie scattering coefficient.
+
+<p>$\Psi_{ms}$ is precomputed in a small 2D texture, with a linear mapping from
+$\mu_s$ and $r$ to the $u$ and $v$ texture coordinates. Each texel requires an
+integral over all the directions, computed with the Fibonacci rule (see
+<a href="../spherical_quadrature.h.html">spherical_quadrature.h</a>), with a
+small number of directions, and, in each direction, an integral along the ray,
+computed with the quadrature rule of the atmosphere parameters, with a small
+number of samples.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_MULTIPLE_SCATTERING_LUT_H_
+#define ATMOSPHERE_REFERENCE_MULTIPLE_SCATTERING_LUT_H_
+
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/spherical_quadrature.h"
+
+namespace atmosphere {
+namespace reference {
+
+constexpr int MULTIPLE_SCATTERING_LUT_WIDTH = 32;
+constexpr int MULTIPLE_SCATTERING_LUT_HEIGHT = 32;
+constexpr int MULTIPLE_SCATTERING_LUT_DIRECTION_COUNT = 64;
+constexpr int MULTIPLE_SCATTERING_LUT_SAMPLE_COUNT = 20;
+
+typedef Texture2d<RadianceSpectrum> MultipleScatteringLutTexture;
+
+// Returns the directions used to compute the multiple scattering LUT.
+std::vector<SphericalSample> GetMultipleScatteringLutDirections();
+
+// Returns Psi_ms for the given altitude and sun zenith angle, using the given
+// directions (see GetMultipleScatteringLutDirections).
+RadianceSpectrum ComputeMultipleScatteringLut(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const std::vector<SphericalSample>& directions, Length r, Number mu_s);
+
+// Returns Psi_ms for the r and mu_s values corresponding to the given fragment
+// coordinates of the multiple scattering LUT texture.
+RadianceSpectrum ComputeMultipleScatteringLutTexture(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const std::vector<SphericalSample>& directions,
+    const dimensional::vec2& frag_coord);
+
+// Returns the scattering density of all the scattering orders from the 2nd
+// one, sigma_s(r) * Psi_ms(r, mu_s), using the multiple scattering LUT.
+RadianceDensitySpectrum GetMultipleScatteringLutDensity(
+    const AtmosphereParameters& atmosphere,
+    const MultipleScatteringLutTexture& multiple_scattering_lut_texture,
+    Length r, Number mu_s);
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_MULTIPLE_SCATTERING_LUT_H_
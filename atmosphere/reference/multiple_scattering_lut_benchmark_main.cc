@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*<h2>atmosphere/reference/multiple_scattering_lut_benchmark_main.cc</h2>
+
+<p>This file provides a small benchmark comparing the
+<a href="model.h.html">CPU model</a> computing each scattering order in
+sequence, with the same model approximating all the orders from the 2nd one with
+the <a href="multiple_scattering_lut.h.html">multiple scattering LUT</a> (see
+<code>Model::set_use_multiple_scattering_lut</code>). For the default atmosphere
+of the <a href="atmosphere_config.h.html">config files</a>, it reports
+<ul>
+<li>the wall time of each precomputation phase (summed over the scattering
+orders), and of the whole precomputation, with the two models, and the
+corresponding speedup,</li>
+<li>the maximum difference between the sky radiance values computed with the
+two models, for random cameras, view rays and sun directions, relatively to the
+maximum sky radiance value, as well as the root mean square of this relative
+difference,</li>
+<li>the same differences for the sky irradiance values, for random points,
+normals and sun directions.</li>
+</ul>
+The second model uses the defaults of the LUT mode, namely the fast functions
+and a half resolution 2nd order. Its precomputation time is then dominated by
+the single scattering, which is the same as with the first model (the sum of
+all the other phases is about 2 s, versus about 430 s for the first model with
+4 orders). The number of scattering orders of the first model is 4 by default.
+Usage:
+<pre>
+atmosphere_multiple_scattering_lut_benchmark [num_scattering_orders]
+</pre>
+*/
+
+#include <stdlib.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/atmosphere_config.h"
+#include "atmosphere/reference/benchmark_util.h"
+#include "atmosphere/reference/model.h"
+
+namespace {
+
+using atmosphere::reference::AtmosphereConfig;
+using atmosphere::reference::AtmosphereParameters;
+using atmosphere::reference::DimensionlessSpectrum;
+using atmosphere::reference::Direction;
+using atmosphere::reference::GetAtmosphereParameters;
+using atmosphere::reference::IrradianceSpectrum;
+using atmosphere::reference::Length;
+using atmosphere::reference::Model;
+using atmosphere::reference::Position;
+using atmosphere::reference::Precompute;
+using atmosphere::reference::PrintDifference;
+using atmosphere::reference::RadianceSpectrum;
+using atmosphere::reference::RandomDirection;
+using atmosphere::reference::RemoveDirectory;
+using atmosphere::reference::m;
+using atmosphere::reference::watt_per_square_meter_per_nm;
+using atmosphere::reference::watt_per_square_meter_per_sr_per_nm;
+
+constexpr int kNumQueries = 1 << 14;
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  const unsigned int num_scattering_orders =
+      argc > 1 ? std::atoi(argv[1]) : 4;
+  if (argc > 2 || num_scattering_orders < 2) {
+    std::cerr << "Usage: " << argv[0] << " [num_scattering_orders]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Use a separate, new cache directory for each model, to make sure that the
+  // textures are computed.
+  char exact_directory[] =
+      "/tmp/atmosphere_multiple_scattering_lut_benchmark.XXXXXX";
+  char lut_directory[] =
+      "/tmp/atmosphere_multiple_scattering_lut_benchmark.XXXXXX";
+  if (mkdtemp(exact_directory) == nullptr ||
+      mkdtemp(lut_directory) == nullptr) {
+    std::cerr << "Cannot create a temporary directory" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const AtmosphereParameters atmosphere =
+      GetAtmosphereParameters(AtmosphereConfig());
+  Model exact_model(atmosphere, std::string(exact_directory) + "/");
+  Model lut_model(atmosphere, std::string(lut_directory) + "/");
+  lut_model.set_use_multiple_scattering_lut(true);
+
+  std::map<std::string, double> exact_times;
+  std::map<std::string, double> lut_times;
+  Precompute(&exact_model, num_scattering_orders, &exact_times);
+  Precompute(&lut_model, num_scattering_orders, &lut_times);
+  RemoveDirectory(std::string(exact_directory) + "/");
+  RemoveDirectory(std::string(lut_directory) + "/");
+  for (const auto& phase : lut_times) {
+    exact_times[phase.first];
+  }
+  for (const auto& phase : exact_times) {
+    const double lut_time = lut_times[phase.first];
+    std::cout << (phase.first.empty() ? "total" : phase.first) << ": exact "
+              << phase.second << " s, lut " << lut_time << " s, speedup "
+              << phase.second / lut_time << std::endl;
+  }
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  std::vector<double> exact_radiance;
+  std::vector<double> lut_radiance;
+  std::vector<double> exact_irradiance;
+  std::vector<double> lut_irradiance;
+  for (int i = 0; i < kNumQueries; ++i) {
+    const Length r = atmosphere.bottom_radius + distribution(generator) *
+        (atmosphere.top_radius - atmosphere.bottom_radius);
+    const Position camera(0.0 * m, 0.0 * m, r);
+    const Direction view_ray = RandomDirection(&generator);
+    const Direction sun_direction = RandomDirection(&generator);
+    DimensionlessSpectrum transmittance;
+    const RadianceSpectrum exact = exact_model.GetSkyRadiance(camera, view_ray,
+        0.0 * m, sun_direction, &transmittance);
+    const RadianceSpectrum lut = lut_model.GetSkyRadiance(camera, view_ray,
+        0.0 * m, sun_direction, &transmittance);
+    IrradianceSpectrum exact_sky_irradiance;
+    IrradianceSpectrum lut_sky_irradiance;
+    exact_model.GetSunAndSkyIrradiance(camera, view_ray, sun_direction,
+        &exact_sky_irradiance);
+    lut_model.GetSunAndSkyIrradiance(camera, view_ray, sun_direction,
+        &lut_sky_irradiance);
+    for (unsigned int l = 0; l < exact.size(); ++l) {
+      exact_radiance.push_back(
+          exact[l].to(watt_per_square_meter_per_sr_per_nm));
+      lut_radiance.push_back(lut[l].to(watt_per_square_meter_per_sr_per_nm));
+      exact_irradiance.push_back(
+          exact_sky_irradiance[l].to(watt_per_square_meter_per_nm));
+      lut_irradiance.push_back(
+          lut_sky_irradiance[l].to(watt_per_square_meter_per_nm));
+    }
+  }
+  PrintDifference("Sky radiance", exact_radiance, lut_radiance);
+  PrintDifference("Sky irradiance", exact_irradiance, lut_irradiance);
+  return EXIT_SUCCESS;
+}
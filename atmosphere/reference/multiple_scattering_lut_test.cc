@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*<h2>atmosphere/reference/multiple_scattering_lut_test.cc</h2>
+
+<p>This file provides unit tests for the
+<a href="multiple_scattering_lut.h.html">multiple scattering LUT</a>. They
+check that it is null without scattering, that it increases with the ground
+albedo, and that the scattering density is the product of the scattering
+coefficient and of the LUT values, at the texel centers.
+*/
+
+#include "atmosphere/reference/multiple_scattering_lut.h"
+
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/functions.h"
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+constexpr SpectralIrradiance kSolarIrradiance =
+    123.0 * watt_per_square_meter_per_nm;
+constexpr Length kBottomRadius = 1000.0 * km;
+constexpr Length kTopRadius = 1500.0 * km;
+constexpr Length kRayleighScaleHeight = 60.0 * km;
+constexpr ScatteringCoefficient kRayleighScattering = 0.001 / km;
+constexpr Number kGroundAlbedo = 0.5;
+
+}  // anonymous namespace
+
+class MultipleScatteringLutTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  MultipleScatteringLutTest(const std::string& name, T test)
+      : TestCase("MultipleScatteringLutTest " + name,
+            static_cast<Test>(test)) {
+    atmosphere_parameters_.solar_irradiance[0] = kSolarIrradiance;
+    atmosphere_parameters_.bottom_radius = kBottomRadius;
+    atmosphere_parameters_.top_radius = kTopRadius;
+    atmosphere_parameters_.rayleigh_density.layers[1] = DensityProfileLayer(
+        0.0 * m, 1.0, -1.0 / kRayleighScaleHeight, 0.0 / m, 0.0);
+    atmosphere_parameters_.mu_s_min = -0.5;
+    TextureResolution& resolution = atmosphere_parameters_.texture_resolution;
+    resolution.transmittance_width = 16;
+    resolution.transmittance_height = 8;
+  }
+
+  void TestZeroScattering() {
+    const TransmittanceTexture transmittance_texture(16, 8,
+        DimensionlessSpectrum(0.5));
+    const std::vector<SphericalSample> directions =
+        GetMultipleScatteringLutDirections();
+    for (Number mu_s : {-1.0, -0.1, 0.3, 1.0}) {
+      for (Length r : {kBottomRadius, 1200.0 * km, kTopRadius}) {
+        ExpectEquals(0.0, ComputeMultipleScatteringLut(atmosphere_parameters_,
+            transmittance_texture, directions, r, mu_s)[0].to(
+                watt_per_square_meter_per_sr_per_nm));
+      }
+    }
+  }
+
+  void TestGroundAlbedo() {
+    atmosphere_parameters_.rayleigh_scattering[0] = kRayleighScattering;
+    const TransmittanceTexture transmittance_texture(16, 8,
+        DimensionlessSpectrum(0.5));
+    const std::vector<SphericalSample> directions =
+        GetMultipleScatteringLutDirections();
+    for (Number mu_s : {0.1, 0.5, 1.0}) {
+      for (Length r : {kBottomRadius, 1200.0 * km}) {
+        atmosphere_parameters_.ground_albedo[0] = 0.0;
+        const double black_ground = ComputeMultipleScatteringLut(
+            atmosphere_parameters_, transmittance_texture, directions, r,
+            mu_s)[0].to(watt_per_square_meter_per_sr_per_nm);
+        atmosphere_parameters_.ground_albedo[0] = kGroundAlbedo;
+        const double white_ground = ComputeMultipleScatteringLut(
+            atmosphere_parameters_, transmittance_texture, directions, r,
+            mu_s)[0].to(watt_per_square_meter_per_sr_per_nm);
+        ExpectLess(0.0, black_ground);
+        ExpectLess(black_ground, white_ground);
+      }
+    }
+  }
+
+  void TestScatteringDensity() {
+    atmosphere_parameters_.rayleigh_scattering[0] = kRayleighScattering;
+    MultipleScatteringLutTexture multiple_scattering_lut_texture(
+        MULTIPLE_SCATTERING_LUT_WIDTH, MULTIPLE_SCATTERING_LUT_HEIGHT);
+    for (int j = 0; j < MULTIPLE_SCATTERING_LUT_HEIGHT; ++j) {
+      for (int i = 0; i < MULTIPLE_SCATTERING_LUT_WIDTH; ++i) {
+        RadianceSpectrum value;
+        value[0] = (i + 2.0 * j + 1.0) * watt_per_square_meter_per_sr_per_nm;
+        multiple_scattering_lut_texture.Set(i, j, value);
+      }
+    }
+    for (int j = 0; j < MULTIPLE_SCATTERING_LUT_HEIGHT; ++j) {
+      for (int i = 0; i < MULTIPLE_SCATTERING_LUT_WIDTH; ++i) {
+        const Length r = kBottomRadius + (kTopRadius - kBottomRadius) *
+            (j / (MULTIPLE_SCATTERING_LUT_HEIGHT - 1.0));
+        const Number mu_s = 2.0 * i / (MULTIPLE_SCATTERING_LUT_WIDTH - 1.0) -
+            1.0;
+        const ScatteringCoefficient scattering = kRayleighScattering *
+            exp(-(r - kBottomRadius) / kRayleighScaleHeight);
+        ExpectNear(
+            (i + 2.0 * j + 1.0) * scattering.to(1.0 / km),
+            GetMultipleScatteringLutDensity(atmosphere_parameters_,
+                multiple_scattering_lut_texture, r, mu_s)[0].to(
+                    watt_per_square_meter_per_sr_per_nm / km),
+            1e-9);
+      }
+    }
+  }
+
+ private:
+  AtmosphereParameters atmosphere_parameters_;
+};
+
+namespace {
+
+MultipleScatteringLutTest zero_scattering(
+    "ZeroScattering",
+    &MultipleScatteringLutTest::TestZeroScattering);
+MultipleScatteringLutTest ground_albedo(
+    "GroundAlbedo",
+    &MultipleScatteringLutTest::TestGroundAlbedo);
+MultipleScatteringLutTest scattering_density(
+    "ScatteringDensity",
+    &MultipleScatteringLutTest::TestScatteringDensity);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/pass_graph.cc</h2>
+
+<p>This file implements the pass graph defined in
+<a href="pass_graph.h.html">pass_graph.h</a>. The passes without dependencies
+are run in parallel on the thread pool. Then, each time a pass is done, the
+thread which ran it runs the passes which no longer have any pending dependency
+(in parallel, with a nested call to <code>ThreadPool::Run</code>). No thread is
+thus ever blocked waiting for a dependency.
+*/
+
+#include "atmosphere/reference/pass_graph.h"
+
+#include <cassert>
+
+namespace atmosphere {
+namespace reference {
+
+PassGraph::PassId PassGraph::AddPass(const std::function<void()>& pass,
+    const std::vector<PassId>& dependencies) {
+  const PassId id = passes_.size();
+  for (PassId dependency : dependencies) {
+    assert(dependency < id);
+    passes_[dependency].dependents.push_back(id);
+  }
+  Pass new_pass;
+  new_pass.function = pass;
+  new_pass.num_dependencies = dependencies.size();
+  new_pass.num_remaining_dependencies = dependencies.size();
+  passes_.push_back(new_pass);
+  return id;
+}
+
+void PassGraph::Run(ThreadPool* thread_pool) {
+  std::vector<PassId> ready_passes;
+  for (PassId id = 0; id < passes_.size(); ++id) {
+    passes_[id].num_remaining_dependencies = passes_[id].num_dependencies;
+    if (passes_[id].num_dependencies == 0) {
+      ready_passes.push_back(id);
+    }
+  }
+  RunPasses(ready_passes, thread_pool);
+}
+
+void PassGraph::RunPasses(const std::vector<PassId>& pass_ids,
+    ThreadPool* thread_pool) {
+  thread_pool->Run(pass_ids.size(), [&](unsigned int i) {
+    Pass& pass = passes_[pass_ids[i]];
+    pass.function();
+    std::vector<PassId> ready_passes;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (PassId dependent : pass.dependents) {
+        if (--passes_[dependent].num_remaining_dependencies == 0) {
+          ready_passes.push_back(dependent);
+        }
+      }
+    }
+    if (!ready_passes.empty()) {
+      RunPasses(ready_passes, thread_pool);
+    }
+  });
+}
+
+}  // namespace reference
+}  // namespace atmosphere
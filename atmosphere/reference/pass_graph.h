@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/pass_graph.h</h2>
+
+<p>This file defines a simple dependency graph of precomputation passes, used by
+the <a href="model.h.html">CPU model</a> to run independent passes concurrently
+(e.g. the direct irradiance and the single scattering passes, which only depend
+on the transmittance). Each pass is run as soon as all its dependencies are
+done, on a <a href="thread_pool.h.html">thread pool</a>. A pass typically
+computes a texture with a <a href="scheduler.h.html">tile scheduler</a> using
+the same pool, so that the worker threads which complete the tiles of a pass can
+immediately help with the tiles of a concurrent pass. This raises the core
+utilization at the end of each pass, where a single pass would leave some cores
+idle.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_PASS_GRAPH_H_
+#define ATMOSPHERE_REFERENCE_PASS_GRAPH_H_
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "atmosphere/reference/thread_pool.h"
+
+namespace atmosphere {
+namespace reference {
+
+class PassGraph {
+ public:
+  typedef unsigned int PassId;
+
+  // Adds a pass which must be run after the given passes, which must have been
+  // added before (this ensures that the graph has no cycle).
+  PassId AddPass(const std::function<void()>& pass,
+      const std::vector<PassId>& dependencies = std::vector<PassId>());
+
+  // Runs all the passes, and returns when they are all done.
+  void Run(ThreadPool* thread_pool);
+
+ private:
+  struct Pass {
+    std::function<void()> function;
+    std::vector<PassId> dependents;
+    unsigned int num_dependencies;
+    unsigned int num_remaining_dependencies;
+  };
+
+  void RunPasses(const std::vector<PassId>& pass_ids, ThreadPool* thread_pool);
+
+  std::vector<Pass> passes_;
+  std::mutex mutex_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_PASS_GRAPH_H_
@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/pass_graph_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="pass_graph.h.html">pass
+graph</a> used by the CPU model. They check that each pass is run exactly once,
+after all its dependencies, and that independent passes are run concurrently.
+*/
+
+#include "atmosphere/reference/pass_graph.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+class PassGraphTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  PassGraphTest(const std::string& name, T test)
+      : TestCase("PassGraphTest " + name, static_cast<Test>(test)) {}
+
+  void TestDependencies() {
+    ThreadPool thread_pool{ThreadPoolOptions(4)};
+    // The passes of the CPU model for the first scattering order, followed by
+    // two scattering orders.
+    PassGraph graph;
+    const PassGraph::PassId transmittance = AddPass(&graph, {});
+    const PassGraph::PassId direct_irradiance =
+        AddPass(&graph, {transmittance});
+    const PassGraph::PassId single_scattering =
+        AddPass(&graph, {transmittance});
+    PassGraph::PassId multiple_scattering = AddPass(&graph,
+        {direct_irradiance, single_scattering});
+    for (unsigned int scattering_order = 2; scattering_order <= 3;
+         ++scattering_order) {
+      const PassGraph::PassId scattering_density =
+          AddPass(&graph, {multiple_scattering});
+      const PassGraph::PassId indirect_irradiance =
+          AddPass(&graph, {multiple_scattering});
+      multiple_scattering =
+          AddPass(&graph, {scattering_density, indirect_irradiance});
+    }
+    // The same graph can be run several times.
+    for (unsigned int i = 0; i < 3; ++i) {
+      CheckDependencies(&graph, &thread_pool);
+    }
+  }
+
+  void TestIndependentPasses() {
+    ThreadPool thread_pool{ThreadPoolOptions(2)};
+    std::atomic<unsigned int> num_started_passes(0);
+    std::atomic<bool> concurrent(false);
+    auto pass = [&]() {
+      ++num_started_passes;
+      // Wait until the other pass has started (or until a timeout, if the
+      // passes are not run concurrently).
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (std::chrono::steady_clock::now() < deadline) {
+        if (num_started_passes == 2) {
+          concurrent = true;
+          return;
+        }
+        std::this_thread::yield();
+      }
+    };
+    PassGraph graph;
+    graph.AddPass(pass);
+    graph.AddPass(pass);
+    graph.Run(&thread_pool);
+    ExpectEquals(2, num_started_passes);
+    ExpectTrue(concurrent);
+  }
+
+  void TestEmptyGraph() {
+    ThreadPool thread_pool{ThreadPoolOptions(2)};
+    PassGraph graph;
+    graph.Run(&thread_pool);
+  }
+
+ private:
+  PassGraph::PassId AddPass(PassGraph* graph,
+      const std::vector<PassGraph::PassId>& dependencies) {
+    const PassGraph::PassId id = dependencies_.size();
+    dependencies_.push_back(dependencies);
+    return graph->AddPass([this, id]() {
+      start_index_[id] = next_index_++;
+      end_index_[id] = next_index_++;
+      ++num_runs_[id];
+    }, dependencies);
+  }
+
+  void CheckDependencies(PassGraph* graph, ThreadPool* thread_pool) {
+    const unsigned int num_passes = dependencies_.size();
+    start_index_.reset(new std::atomic<unsigned int>[num_passes]);
+    end_index_.reset(new std::atomic<unsigned int>[num_passes]);
+    num_runs_.reset(new std::atomic<unsigned int>[num_passes]);
+    for (unsigned int i = 0; i < num_passes; ++i) {
+      num_runs_[i] = 0;
+    }
+    next_index_ = 0;
+    graph->Run(thread_pool);
+    for (unsigned int i = 0; i < num_passes; ++i) {
+      ExpectEquals(1, num_runs_[i]);
+      for (PassGraph::PassId dependency : dependencies_[i]) {
+        ExpectTrue(end_index_[dependency] < start_index_[i]);
+      }
+    }
+  }
+
+  std::vector<std::vector<PassGraph::PassId>> dependencies_;
+  std::unique_ptr<std::atomic<unsigned int>[]> start_index_;
+  std::unique_ptr<std::atomic<unsigned int>[]> end_index_;
+  std::unique_ptr<std::atomic<unsigned int>[]> num_runs_;
+  std::atomic<unsigned int> next_index_;
+};
+
+namespace {
+
+PassGraphTest dependencies(
+    "Dependencies",
+    &PassGraphTest::TestDependencies);
+PassGraphTest independent_passes(
+    "IndependentPasses",
+    &PassGraphTest::TestIndependentPasses);
+PassGraphTest empty_graph(
+    "EmptyGraph",
+    &PassGraphTest::TestEmptyGraph);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/precompute_main.cc</h2>
+
+<p>This file provides a command line tool which precomputes the atmosphere
+textures with the <a href="model.h.html">CPU model</a>, without any OpenGL or
+windowing dependency (e.g. to precompute them on build servers without a GPU).
+Its arguments are one or more <a href="atmosphere_config.h.html">config
+files</a>, each specifying a set of atmosphere parameters, an output directory,
+and an output format:
+<pre>
+atmosphere_precompute [--jobs=N] [--threads=N] [--checkpoints] [--profile]
+    config_file...
+</pre>
+For each config file, the transmittance, scattering, single Mie scattering and
+irradiance textures are saved in the output directory, in the headered
+<a href="texture_cache.h.html">cache format</a> of the CPU model (the textures
+are not recomputed if this directory already contains them, for the same
+parameters and format). Several config files are processed in parallel, with
+<code>--jobs</code> models at the same time (by default, as many as possible),
+and a <a href="thread_pool.h.html">thread pool</a> of <code>--threads</code>
+threads (by default, the number of hardware threads), shared by all the models.
+With <code>--checkpoints</code>, the intermediate results are saved in the
+output directories, so that an interrupted precomputation, or a precomputation
+with more scattering orders, resumes from the last saved results (see
+<code>Model::Init</code>). With <code>--profile</code>, the duration of each
+precomputation phase is saved in a <code>profile.json</code> file in each output
+directory (see <a href="../precompute_profile.h.html">precompute_profile.h</a>).
+*/
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atmosphere/reference/atmosphere_config.h"
+#include "atmosphere/reference/model.h"
+#include "atmosphere/reference/thread_pool.h"
+
+namespace {
+
+using atmosphere::reference::AtmosphereConfig;
+using atmosphere::reference::GetAtmosphereParameters;
+using atmosphere::reference::Model;
+using atmosphere::reference::ReadAtmosphereConfig;
+using atmosphere::reference::ThreadPool;
+using atmosphere::reference::ThreadPoolOptions;
+
+void PrintUsage() {
+  std::cerr << "Usage: atmosphere_precompute [--jobs=N] [--threads=N] "
+            << "[--checkpoints] [--profile] config_file..." << std::endl;
+}
+
+bool ParseOption(const std::string& arg, const std::string& name,
+    unsigned int* value) {
+  if (arg.compare(0, name.size(), name) != 0) {
+    return false;
+  }
+  *value = std::max(0, std::atoi(arg.c_str() + name.size()));
+  return true;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  unsigned int num_jobs = 0;
+  unsigned int num_threads = 0;
+  bool use_checkpoints = false;
+  bool save_profile = false;
+  std::vector<std::string> config_files;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if (arg == "--checkpoints") {
+      use_checkpoints = true;
+    } else if (arg == "--profile") {
+      save_profile = true;
+    } else if (!ParseOption(arg, "--jobs=", &num_jobs) &&
+        !ParseOption(arg, "--threads=", &num_threads)) {
+      if (arg.compare(0, 2, "--") == 0) {
+        PrintUsage();
+        return EXIT_FAILURE;
+      }
+      config_files.push_back(arg);
+    }
+  }
+  if (config_files.empty()) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  // Read all the config files first, to report errors before any computation.
+  std::vector<AtmosphereConfig> configs(config_files.size());
+  for (unsigned int i = 0; i < config_files.size(); ++i) {
+    std::string error;
+    if (!ReadAtmosphereConfig(config_files[i], &configs[i], &error)) {
+      std::cerr << error << std::endl;
+      return EXIT_FAILURE;
+    }
+    const std::string& directory = configs[i].output_directory;
+    for (unsigned int j = 0; j < i; ++j) {
+      if (configs[j].output_directory == directory) {
+        std::cerr << config_files[i] << ": same output directory as "
+                  << config_files[j] << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    if (!directory.empty() && mkdir(directory.c_str(), 0755) != 0 &&
+        errno != EEXIST) {
+      std::cerr << directory << ": " << std::strerror(errno) << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (num_jobs == 0) {
+    num_jobs = num_threads;
+  }
+  num_jobs = std::min<unsigned int>(num_jobs, configs.size());
+  ThreadPoolOptions thread_pool_options(num_threads);
+  thread_pool_options.name = "precompute";
+  std::shared_ptr<ThreadPool> thread_pool =
+      std::make_shared<ThreadPool>(thread_pool_options);
+
+  // Each job precomputes the textures for the next unprocessed config, until
+  // all the configs have been processed.
+  std::atomic<unsigned int> next_config(0);
+  std::mutex output_mutex;
+  auto job = [&]() {
+    for (unsigned int i = next_config++; i < configs.size();
+         i = next_config++) {
+      const AtmosphereConfig& config = configs[i];
+      Model model(GetAtmosphereParameters(config), config.output_directory,
+          thread_pool, atmosphere::reference::TileSize(),
+          config.output_format);
+      // Progress bars of concurrent jobs would be interleaved.
+      if (num_jobs > 1) {
+        model.set_progress_sink(nullptr);
+      }
+      model.Init(config.num_scattering_orders, use_checkpoints,
+          config.convergence_tolerance);
+      if (save_profile) {
+        std::ofstream(config.output_directory + "profile.json")
+            << model.profile().ToJson();
+      }
+      std::lock_guard<std::mutex> lock(output_mutex);
+      std::cout << config_files[i] << " -> " << config.output_directory
+                << " (" << model.num_scattering_orders()
+                << " scattering orders)" << std::endl;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < num_jobs; ++i) {
+    threads.emplace_back(job);
+  }
+  job();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return EXIT_SUCCESS;
+}
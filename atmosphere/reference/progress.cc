@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/progress.cc</h2>
+
+<p>This file implements the progress reporting classes defined in
+<a href="progress.h.html">progress.h</a>. The terminal progress bar is provided
+by the <a href="https://github.com/ebruneton/progress_bar">progress_bar</a>
+library, which takes work increments instead of absolute values.
+*/
+
+#include "atmosphere/reference/progress.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "util/progress_bar.h"
+
+namespace atmosphere {
+namespace reference {
+
+TerminalProgressSink::TerminalProgressSink() : total_(0), done_(0) {}
+
+TerminalProgressSink::~TerminalProgressSink() {}
+
+void TerminalProgressSink::Begin(uint64_t total) {
+  // The progress bar uses 32 bits counters.
+  total_ = std::min<uint64_t>(total, std::numeric_limits<unsigned int>::max());
+  done_ = 0;
+  progress_bar_.reset(new ProgressBar(total_));
+}
+
+void TerminalProgressSink::Update(uint64_t done) {
+  done = std::min(done, total_);
+  if (progress_bar_ != nullptr && done > done_) {
+    progress_bar_->Increment(done - done_);
+    done_ = done;
+  }
+}
+
+void TerminalProgressSink::End() {
+  progress_bar_.reset();
+}
+
+void TeeProgressSink::Begin(uint64_t total) {
+  if (first_ != nullptr) {
+    first_->Begin(total);
+  }
+  if (second_ != nullptr) {
+    second_->Begin(total);
+  }
+}
+
+void TeeProgressSink::Update(uint64_t done) {
+  if (first_ != nullptr) {
+    first_->Update(done);
+  }
+  if (second_ != nullptr) {
+    second_->Update(done);
+  }
+}
+
+void TeeProgressSink::End() {
+  if (first_ != nullptr) {
+    first_->End();
+  }
+  if (second_ != nullptr) {
+    second_->End();
+  }
+}
+
+Progress::Progress(uint64_t total, std::shared_ptr<ProgressSink> sink,
+    std::chrono::milliseconds period)
+    : sink_(sink != nullptr ? sink : std::make_shared<SilentProgressSink>()),
+      stopping_(false) {
+  for (unsigned int i = 0; i < kNumSlots; ++i) {
+    slots_[i].value = 0;
+  }
+  sink_->Begin(total);
+  aggregator_ = std::thread(&Progress::RunAggregator, this, period);
+}
+
+Progress::~Progress() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_requested_.notify_one();
+  aggregator_.join();
+  sink_->Update(GetDone());
+  sink_->End();
+}
+
+uint64_t Progress::GetDone() const {
+  uint64_t done = 0;
+  for (unsigned int i = 0; i < kNumSlots; ++i) {
+    done += slots_[i].value.load(std::memory_order_relaxed);
+  }
+  return done;
+}
+
+unsigned int Progress::GetThreadSlot() {
+  static std::atomic<unsigned int> next_slot(0);
+  thread_local unsigned int slot = next_slot++ % kNumSlots;
+  return slot;
+}
+
+void Progress::RunAggregator(std::chrono::milliseconds period) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t last_done = 0;
+  while (!stop_requested_.wait_for(lock, period, [this]() {
+    return stopping_;
+  })) {
+    uint64_t done = GetDone();
+    if (done != last_done) {
+      sink_->Update(done);
+      last_done = done;
+    }
+  }
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/progress.h</h2>
+
+<p>This file defines how the <a href="model.h.html">CPU model</a> reports the
+progress of its precomputations. The worker threads report the work they have
+done with <code>Progress::Increment</code>, which only updates a per-thread
+counter (in its own cache line, to avoid any contention between threads). These
+counters are periodically summed by an aggregator thread, which reports the
+total to a pluggable <code>ProgressSink</code>: a progress bar in the terminal,
+a user callback, or nothing at all. The cost of progress reporting is thus
+negligible, even with very frequent increments.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_PROGRESS_H_
+#define ATMOSPHERE_REFERENCE_PROGRESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class ProgressBar;
+
+namespace atmosphere {
+namespace reference {
+
+// Receives the progress of a task. All the methods are called from the same
+// thread, in this order: Begin, Update (zero or more times), End.
+class ProgressSink {
+ public:
+  virtual ~ProgressSink() {}
+
+  // Called when a task starts, with its total amount of work.
+  virtual void Begin(uint64_t total) = 0;
+  // Called periodically with the amount of work done so far, which never
+  // decreases, and once more when the task ends.
+  virtual void Update(uint64_t done) = 0;
+  // Called when the task ends.
+  virtual void End() = 0;
+};
+
+class SilentProgressSink : public ProgressSink {
+ public:
+  void Begin(uint64_t total) override {}
+  void Update(uint64_t done) override {}
+  void End() override {}
+};
+
+// Displays a progress bar in the terminal.
+class TerminalProgressSink : public ProgressSink {
+ public:
+  TerminalProgressSink();
+  ~TerminalProgressSink() override;
+
+  void Begin(uint64_t total) override;
+  void Update(uint64_t done) override;
+  void End() override;
+
+ private:
+  std::unique_ptr<ProgressBar> progress_bar_;
+  uint64_t total_;
+  uint64_t done_;
+};
+
+// Calls a function with the amount of work done so far, and the total amount
+// of work.
+class CallbackProgressSink : public ProgressSink {
+ public:
+  typedef std::function<void(uint64_t done, uint64_t total)> Callback;
+
+  explicit CallbackProgressSink(const Callback& callback)
+      : callback_(callback), total_(0) {}
+
+  void Begin(uint64_t total) override { total_ = total; }
+  void Update(uint64_t done) override { callback_(done, total_); }
+  void End() override {}
+
+ private:
+  Callback callback_;
+  uint64_t total_;
+};
+
+// Reports the progress to two sinks (which can be null).
+class TeeProgressSink : public ProgressSink {
+ public:
+  TeeProgressSink(std::shared_ptr<ProgressSink> first,
+      std::shared_ptr<ProgressSink> second) : first_(first), second_(second) {}
+
+  void Begin(uint64_t total) override;
+  void Update(uint64_t done) override;
+  void End() override;
+
+ private:
+  std::shared_ptr<ProgressSink> first_;
+  std::shared_ptr<ProgressSink> second_;
+};
+
+// Accumulates the work done by several threads, and periodically reports it to
+// a sink. The sink's Begin method is called by the constructor, and its End
+// method by the destructor (after a last call to Update).
+class Progress {
+ public:
+  Progress(uint64_t total, std::shared_ptr<ProgressSink> sink,
+      std::chrono::milliseconds period = std::chrono::milliseconds(100));
+  Progress(const Progress&) = delete;
+  Progress& operator=(const Progress&) = delete;
+  ~Progress();
+
+  // Can be called concurrently from any thread.
+  void Increment(uint64_t amount) {
+    slots_[GetThreadSlot()].value.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  // Returns the amount of work done so far, by all the threads.
+  uint64_t GetDone() const;
+
+ private:
+  // The number of per-thread counters. Threads are assigned to counters in a
+  // round-robin way, so that counters are shared only with more threads than
+  // this number.
+  static constexpr unsigned int kNumSlots = 32;
+
+  // A counter padded to a typical cache line size, to avoid false sharing.
+  struct Slot {
+    std::atomic<uint64_t> value;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  static unsigned int GetThreadSlot();
+  void RunAggregator(std::chrono::milliseconds period);
+
+  const std::shared_ptr<ProgressSink> sink_;
+  Slot slots_[kNumSlots];
+  std::mutex mutex_;
+  std::condition_variable stop_requested_;
+  bool stopping_;
+  std::thread aggregator_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_PROGRESS_H_
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/progress_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="progress.h.html">progress
+reporting</a> classes of the CPU model.
+*/
+
+#include "atmosphere/reference/progress.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+class ProgressTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  ProgressTest(const std::string& name, T test)
+      : TestCase("ProgressTest " + name, static_cast<Test>(test)) {}
+
+  void TestConcurrentIncrements() {
+    std::vector<uint64_t> updates;
+    uint64_t reported_total = 0;
+    auto sink = std::make_shared<CallbackProgressSink>(
+        [&](uint64_t done, uint64_t total) {
+          updates.push_back(done);
+          reported_total = total;
+        });
+    {
+      Progress progress(8 * 10000, sink, std::chrono::milliseconds(1));
+      std::vector<std::thread> threads;
+      for (unsigned int i = 0; i < 8; ++i) {
+        threads.emplace_back([&]() {
+          for (unsigned int j = 0; j < 10000; ++j) {
+            progress.Increment(1);
+          }
+        });
+      }
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+      ExpectEquals(8 * 10000, progress.GetDone());
+    }
+    // The destructor reports the final progress.
+    ExpectTrue(!updates.empty());
+    ExpectEquals(8 * 10000, updates.back());
+    ExpectEquals(8 * 10000, reported_total);
+    for (unsigned int i = 1; i < updates.size(); ++i) {
+      ExpectTrue(updates[i - 1] <= updates[i]);
+    }
+  }
+
+  void TestSinkCallOrder() {
+    class RecordingSink : public ProgressSink {
+     public:
+      explicit RecordingSink(std::string* calls) : calls_(calls) {}
+      void Begin(uint64_t total) override { *calls_ += "B"; }
+      void Update(uint64_t done) override {
+        if (calls_->back() != 'U') {
+          *calls_ += "U";
+        }
+      }
+      void End() override { *calls_ += "E"; }
+     private:
+      std::string* calls_;
+    };
+    std::string calls;
+    {
+      Progress progress(10, std::make_shared<RecordingSink>(&calls));
+      progress.Increment(10);
+    }
+    ExpectTrue(calls == "BUE");
+  }
+
+  void TestNullSink() {
+    Progress progress(10, nullptr);
+    progress.Increment(3);
+    ExpectEquals(3, progress.GetDone());
+  }
+};
+
+namespace {
+
+ProgressTest concurrent_increments(
+    "ConcurrentIncrements",
+    &ProgressTest::TestConcurrentIncrements);
+ProgressTest sink_call_order(
+    "SinkCallOrder",
+    &ProgressTest::TestSinkCallOrder);
+ProgressTest null_sink(
+    "NullSink",
+    &ProgressTest::TestNullSink);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
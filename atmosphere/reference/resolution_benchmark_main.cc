@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/resolution_benchmark_main.cc</h2>
+
+<p>This file provides a small benchmark measuring the cost of the precomputed
+textures of the <a href="model.h.html">CPU model</a> as a function of their
+resolution (see <code>TextureResolution</code> in
+<a href="../constants.h.html">constants.h</a>). For each resolution it
+precomputes the textures (for the default atmosphere of the
+<a href="atmosphere_config.h.html">config files</a>, with 2 scattering orders by
+default), and reports
+<ul>
+<li>the precomputation time (excluding the time needed to save the textures in
+the <a href="texture_cache.h.html">cache</a>),</li>
+<li>the memory used by the precomputed textures, and by the temporary textures
+needed during the precomputation,</li>
+<li>the size of the cache files,</li>
+<li>the maximum resident set size of the process so far (since this size can
+only increase, the resolutions should be specified in increasing order).</li>
+</ul>
+Each resolution is specified with its scattering texture sizes, as
+<code>r_size</code>x<code>mu_size</code>x<code>mu_s_size</code>x<code>nu_size
+</code> (e.g. 16x64x16x4). The transmittance and irradiance textures are scaled
+by the same factor as the r size, relatively to the default resolution. Usage:
+<pre>
+atmosphere_resolution_benchmark [num_scattering_orders [resolution...]]
+</pre>
+*/
+
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "atmosphere/reference/atmosphere_config.h"
+#include "atmosphere/reference/benchmark_util.h"
+#include "atmosphere/reference/model.h"
+
+namespace {
+
+using atmosphere::TextureResolution;
+using atmosphere::reference::AtmosphereConfig;
+using atmosphere::reference::DimensionlessSpectrum;
+using atmosphere::reference::GetAtmosphereParameters;
+using atmosphere::reference::IrradianceSpectrum;
+using atmosphere::reference::Model;
+using atmosphere::reference::ParseResolution;
+using atmosphere::reference::RadianceDensitySpectrum;
+using atmosphere::reference::RadianceSpectrum;
+using atmosphere::reference::RemoveDirectory;
+
+const char* kDefaultResolutions[] = {"8x32x8x2", "16x64x16x4", "32x128x32x8"};
+
+double ToMegaBytes(double size) { return size / (1024.0 * 1024.0); }
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  const unsigned int num_scattering_orders =
+      argc > 1 ? std::atoi(argv[1]) : 2;
+  std::vector<std::string> resolutions;
+  for (int i = 2; i < argc; ++i) {
+    resolutions.push_back(argv[i]);
+  }
+  if (resolutions.empty()) {
+    resolutions.assign(std::begin(kDefaultResolutions),
+        std::end(kDefaultResolutions));
+  }
+  if (num_scattering_orders < 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [num_scattering_orders [resolution...]]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (const std::string& resolution_name : resolutions) {
+    TextureResolution resolution;
+    if (!ParseResolution(resolution_name, true, &resolution)) {
+      std::cerr << "Invalid resolution " << resolution_name << std::endl;
+      return EXIT_FAILURE;
+    }
+    const double transmittance_size =
+        resolution.transmittance_width * resolution.transmittance_height;
+    const double scattering_size = static_cast<double>(
+        resolution.scattering_width()) * resolution.scattering_height() *
+            resolution.scattering_depth();
+    const double irradiance_size =
+        resolution.irradiance_width * resolution.irradiance_height;
+    const double texture_bytes =
+        transmittance_size * sizeof(DimensionlessSpectrum) +
+        2.0 * scattering_size * sizeof(IrradianceSpectrum) +
+        irradiance_size * sizeof(IrradianceSpectrum);
+    const double temporary_texture_bytes =
+        2.0 * irradiance_size * sizeof(IrradianceSpectrum) +
+        scattering_size * (sizeof(IrradianceSpectrum) +
+            sizeof(RadianceDensitySpectrum) + sizeof(RadianceSpectrum));
+
+    // Use a new cache directory, to make sure that the textures are computed.
+    char cache_directory[] = "/tmp/atmosphere_resolution_benchmark.XXXXXX";
+    if (mkdtemp(cache_directory) == nullptr) {
+      std::cerr << "Cannot create a temporary directory" << std::endl;
+      return EXIT_FAILURE;
+    }
+    AtmosphereConfig config;
+    config.texture_resolution = resolution;
+    double precompute_time;
+    {
+      Model model(GetAtmosphereParameters(config),
+          std::string(cache_directory) + "/");
+      model.set_progress_sink(nullptr);
+      atmosphere::Stopwatch stopwatch;
+      model.Init(num_scattering_orders);
+      precompute_time = stopwatch.GetElapsedTime();
+      for (const auto& phase : model.profile().phases()) {
+        if (phase.name.compare(0, 6, "cache_") == 0) {
+          precompute_time -= phase.wall_time;
+        }
+      }
+    }
+    const double cache_bytes =
+        RemoveDirectory(std::string(cache_directory) + "/");
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << resolution_name << ": precompute " << precompute_time
+              << " s, textures " << ToMegaBytes(texture_bytes)
+              << " MB (+" << ToMegaBytes(temporary_texture_bytes)
+              << " MB temporary), cache " << ToMegaBytes(cache_bytes)
+              << " MB, max RSS " << usage.ru_maxrss / 1024.0 << " MB"
+              << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
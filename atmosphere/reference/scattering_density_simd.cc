@@ -0,0 +1,549 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/scattering_density_simd.cc</h2>
+
+<p>This file implements the vectorized scattering density function defined in
+<a href="scattering_density_simd.h.html">scattering_density_simd.h</a>. The
+SIMD versions are compiled with function specific target attributes, so that
+the rest of the code does not require any special compiler flag, and are only
+available with GCC or Clang on x86 CPUs.
+*/
+
+#include "atmosphere/reference/scattering_density_simd.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define ATMOSPHERE_REFERENCE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+/*
+<p>The SIMD code works directly on the spectral values stored in the textures,
+seen as arrays of <code>double</code> (in SI units, the internal unit of the
+dimensional types):
+*/
+
+static_assert(sizeof(IrradianceSpectrum) == kNumWavelengths * sizeof(double),
+    "Unexpected spectrum memory layout");
+static_assert(sizeof(RadianceSpectrum) == kNumWavelengths * sizeof(double),
+    "Unexpected spectrum memory layout");
+
+template<class T>
+const double* GetData(const T& spectrum) {
+  return reinterpret_cast<const double*>(&spectrum[0]);
+}
+
+/*
+<p>A texture lookup is then represented as a list of taps, i.e. of texels and
+associated weights, whose weighted sum gives the lookup result. This is done
+with the following functions, which emulate the <code>texture</code> function of
+the dimensional types, namely a linear interpolation with "clamp to edge"
+wrapping. Taps with a zero weight are skipped.
+*/
+
+struct Tap {
+  const double* texel;
+  double weight;
+};
+
+void GetLinearInterpolation(double u, int size, int& i0, int& i1,
+    double& w0, double& w1) {
+  double x = u * size - 0.5;
+  double floor_x = std::floor(x);
+  int i = static_cast<int>(floor_x);
+  w1 = x - floor_x;
+  w0 = 1.0 - w1;
+  i0 = std::max(0, std::min(i, size - 1));
+  i1 = std::max(0, std::min(i + 1, size - 1));
+}
+
+template<class T>
+Tap* AddTrilinearTaps(const AbstractScatteringTexture<T>& texture,
+    double u, double v, double w, double weight, Tap* taps) {
+  int i[2], j[2], k[2];
+  double wi[2], wj[2], wk[2];
+  GetLinearInterpolation(u, texture.size_x(), i[0], i[1], wi[0], wi[1]);
+  GetLinearInterpolation(v, texture.size_y(), j[0], j[1], wj[0], wj[1]);
+  GetLinearInterpolation(w, texture.size_z(), k[0], k[1], wk[0], wk[1]);
+  for (int c = 0; c < 8; ++c) {
+    double tap_weight =
+        weight * wi[c & 1] * wj[(c >> 1) & 1] * wk[(c >> 2) & 1];
+    if (tap_weight != 0.0) {
+      taps->texel = GetData(
+          texture.Get(i[c & 1], j[(c >> 1) & 1], k[(c >> 2) & 1]));
+      taps->weight = tap_weight;
+      ++taps;
+    }
+  }
+  return taps;
+}
+
+Tap* AddBilinearTaps(const IrradianceTexture& texture, const vec2& uv,
+    Tap* taps) {
+  int i[2], j[2];
+  double wi[2], wj[2];
+  GetLinearInterpolation(uv.x(), texture.size_x(), i[0], i[1], wi[0], wi[1]);
+  GetLinearInterpolation(uv.y(), texture.size_y(), j[0], j[1], wj[0], wj[1]);
+  for (int c = 0; c < 4; ++c) {
+    double tap_weight = wi[c & 1] * wj[(c >> 1) & 1];
+    if (tap_weight != 0.0) {
+      taps->texel = GetData(texture.Get(i[c & 1], j[(c >> 1) & 1]));
+      taps->weight = tap_weight;
+      ++taps;
+    }
+  }
+  return taps;
+}
+
+// Same as the GetScattering template function, but returns taps.
+template<class T>
+Tap* AddScatteringTaps(const AtmosphereParameters& atmosphere,
+    const AbstractScatteringTexture<T>& scattering_texture,
+    Length r, Number mu, Number mu_s, Number nu,
+    bool ray_r_mu_intersects_ground, double weight, Tap* taps) {
+  vec4 uvwz = GetScatteringTextureUvwzFromRMuMuSNu(
+      atmosphere, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+  const double nu_size = atmosphere.texture_resolution.scattering_nu_size;
+  double tex_coord_x = uvwz.x() * (nu_size - 1.0);
+  double tex_x = std::floor(tex_coord_x);
+  double lerp = tex_coord_x - tex_x;
+  taps = AddTrilinearTaps(scattering_texture,
+      (tex_x + uvwz.y()) / nu_size, uvwz.z(), uvwz.w(),
+      weight * (1.0 - lerp), taps);
+  return AddTrilinearTaps(scattering_texture,
+      (tex_x + 1.0 + uvwz.y()) / nu_size, uvwz.z(), uvwz.w(),
+      weight * lerp, taps);
+}
+
+/*
+<p>The contribution of each sample direction $\bw_i$ to the scattering density
+is then computed with the following functions, one per instruction set. They
+first compute the incident radiance as the weighted sum of the scattering taps,
+plus the weighted sum of the ground irradiance taps times a ground factor (the
+transmittance to the ground times the ground albedo divided by $\pi$). They then
+accumulate the incident radiance times the Rayleigh and Mie scattering
+coefficients and phase function terms in <code>result</code>.
+*/
+
+struct Sample {
+  const Tap* taps;
+  int num_taps;
+  const Tap* ground_taps;
+  int num_ground_taps;
+  const double* ground_factor;
+  const double* rayleigh_factor;
+  const double* mie_factor;
+  double rayleigh_weight;
+  double mie_weight;
+};
+
+void AccumulateScalar(const Sample& sample, double* result) {
+  double radiance[kNumWavelengths] = {0.0};
+  for (int t = 0; t < sample.num_taps; ++t) {
+    const Tap& tap = sample.taps[t];
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      radiance[l] += tap.weight * tap.texel[l];
+    }
+  }
+  if (sample.num_ground_taps > 0) {
+    double irradiance[kNumWavelengths] = {0.0};
+    for (int t = 0; t < sample.num_ground_taps; ++t) {
+      const Tap& tap = sample.ground_taps[t];
+      for (int l = 0; l < kNumWavelengths; ++l) {
+        irradiance[l] += tap.weight * tap.texel[l];
+      }
+    }
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      radiance[l] += sample.ground_factor[l] * irradiance[l];
+    }
+  }
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    result[l] += radiance[l] * (
+        sample.rayleigh_factor[l] * sample.rayleigh_weight +
+        sample.mie_factor[l] * sample.mie_weight);
+  }
+}
+
+#ifdef ATMOSPHERE_REFERENCE_X86_SIMD
+
+// The number of wavelengths processed with SSE2 and AVX2 instructions. The
+// remaining ones are processed with scalar code.
+constexpr int kNumSse2Wavelengths = kNumWavelengths / 2 * 2;
+constexpr int kNumAvx2Wavelengths = kNumWavelengths / 4 * 4;
+
+__attribute__((target("sse2")))
+void AccumulateSse2(const Sample& sample, double* result) {
+  double radiance[kNumWavelengths] = {0.0};
+  for (int t = 0; t < sample.num_taps; ++t) {
+    const Tap& tap = sample.taps[t];
+    const __m128d weight = _mm_set1_pd(tap.weight);
+    int l = 0;
+    for (; l < kNumSse2Wavelengths; l += 2) {
+      _mm_storeu_pd(radiance + l, _mm_add_pd(_mm_loadu_pd(radiance + l),
+          _mm_mul_pd(weight, _mm_loadu_pd(tap.texel + l))));
+    }
+    for (; l < kNumWavelengths; ++l) {
+      radiance[l] += tap.weight * tap.texel[l];
+    }
+  }
+  if (sample.num_ground_taps > 0) {
+    double irradiance[kNumWavelengths] = {0.0};
+    for (int t = 0; t < sample.num_ground_taps; ++t) {
+      const Tap& tap = sample.ground_taps[t];
+      const __m128d weight = _mm_set1_pd(tap.weight);
+      int l = 0;
+      for (; l < kNumSse2Wavelengths; l += 2) {
+        _mm_storeu_pd(irradiance + l, _mm_add_pd(_mm_loadu_pd(irradiance + l),
+            _mm_mul_pd(weight, _mm_loadu_pd(tap.texel + l))));
+      }
+      for (; l < kNumWavelengths; ++l) {
+        irradiance[l] += tap.weight * tap.texel[l];
+      }
+    }
+    int l = 0;
+    for (; l < kNumSse2Wavelengths; l += 2) {
+      _mm_storeu_pd(radiance + l, _mm_add_pd(_mm_loadu_pd(radiance + l),
+          _mm_mul_pd(_mm_loadu_pd(sample.ground_factor + l),
+                     _mm_loadu_pd(irradiance + l))));
+    }
+    for (; l < kNumWavelengths; ++l) {
+      radiance[l] += sample.ground_factor[l] * irradiance[l];
+    }
+  }
+  const __m128d rayleigh_weight = _mm_set1_pd(sample.rayleigh_weight);
+  const __m128d mie_weight = _mm_set1_pd(sample.mie_weight);
+  int l = 0;
+  for (; l < kNumSse2Wavelengths; l += 2) {
+    __m128d scattering = _mm_add_pd(
+        _mm_mul_pd(_mm_loadu_pd(sample.rayleigh_factor + l), rayleigh_weight),
+        _mm_mul_pd(_mm_loadu_pd(sample.mie_factor + l), mie_weight));
+    _mm_storeu_pd(result + l, _mm_add_pd(_mm_loadu_pd(result + l),
+        _mm_mul_pd(_mm_loadu_pd(radiance + l), scattering)));
+  }
+  for (; l < kNumWavelengths; ++l) {
+    result[l] += radiance[l] * (
+        sample.rayleigh_factor[l] * sample.rayleigh_weight +
+        sample.mie_factor[l] * sample.mie_weight);
+  }
+}
+
+__attribute__((target("avx2,fma")))
+void AccumulateAvx2(const Sample& sample, double* result) {
+  double radiance[kNumWavelengths] = {0.0};
+  for (int t = 0; t < sample.num_taps; ++t) {
+    const Tap& tap = sample.taps[t];
+    const __m256d weight = _mm256_set1_pd(tap.weight);
+    int l = 0;
+    for (; l < kNumAvx2Wavelengths; l += 4) {
+      _mm256_storeu_pd(radiance + l, _mm256_fmadd_pd(weight,
+          _mm256_loadu_pd(tap.texel + l), _mm256_loadu_pd(radiance + l)));
+    }
+    for (; l < kNumWavelengths; ++l) {
+      radiance[l] += tap.weight * tap.texel[l];
+    }
+  }
+  if (sample.num_ground_taps > 0) {
+    double irradiance[kNumWavelengths] = {0.0};
+    for (int t = 0; t < sample.num_ground_taps; ++t) {
+      const Tap& tap = sample.ground_taps[t];
+      const __m256d weight = _mm256_set1_pd(tap.weight);
+      int l = 0;
+      for (; l < kNumAvx2Wavelengths; l += 4) {
+        _mm256_storeu_pd(irradiance + l, _mm256_fmadd_pd(weight,
+            _mm256_loadu_pd(tap.texel + l), _mm256_loadu_pd(irradiance + l)));
+      }
+      for (; l < kNumWavelengths; ++l) {
+        irradiance[l] += tap.weight * tap.texel[l];
+      }
+    }
+    int l = 0;
+    for (; l < kNumAvx2Wavelengths; l += 4) {
+      _mm256_storeu_pd(radiance + l, _mm256_fmadd_pd(
+          _mm256_loadu_pd(sample.ground_factor + l),
+          _mm256_loadu_pd(irradiance + l), _mm256_loadu_pd(radiance + l)));
+    }
+    for (; l < kNumWavelengths; ++l) {
+      radiance[l] += sample.ground_factor[l] * irradiance[l];
+    }
+  }
+  const __m256d rayleigh_weight = _mm256_set1_pd(sample.rayleigh_weight);
+  const __m256d mie_weight = _mm256_set1_pd(sample.mie_weight);
+  int l = 0;
+  for (; l < kNumAvx2Wavelengths; l += 4) {
+    __m256d scattering = _mm256_fmadd_pd(
+        _mm256_loadu_pd(sample.rayleigh_factor + l), rayleigh_weight,
+        _mm256_mul_pd(_mm256_loadu_pd(sample.mie_factor + l), mie_weight));
+    _mm256_storeu_pd(result + l, _mm256_fmadd_pd(_mm256_loadu_pd(radiance + l),
+        scattering, _mm256_loadu_pd(result + l)));
+  }
+  for (; l < kNumWavelengths; ++l) {
+    result[l] += radiance[l] * (
+        sample.rayleigh_factor[l] * sample.rayleigh_weight +
+        sample.mie_factor[l] * sample.mie_weight);
+  }
+}
+
+#endif  // ATMOSPHERE_REFERENCE_X86_SIMD
+
+}  // anonymous namespace
+
+bool IsSimdInstructionSetSupported(SimdInstructionSet instruction_set) {
+  switch (instruction_set) {
+    case SCALAR:
+      return true;
+#ifdef ATMOSPHERE_REFERENCE_X86_SIMD
+    case SSE2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse2");
+    case AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    default:
+      return false;
+  }
+}
+
+SimdInstructionSet GetBestSimdInstructionSet() {
+  if (IsSimdInstructionSetSupported(AVX2)) {
+    return AVX2;
+  } else if (IsSimdInstructionSetSupported(SSE2)) {
+    return SSE2;
+  }
+  return SCALAR;
+}
+
+/*
+<p>The main function follows exactly the same steps as the GLSL
+<code>ComputeScatteringDensity</code> function (see its documentation for more
+details), except that the spectral computations are delegated to one of the
+above functions:
+*/
+
+RadianceDensitySpectrum ComputeScatteringDensitySimd(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
+    Length r, Number mu, Number mu_s, Number nu,
+    int scattering_order, SimdInstructionSet instruction_set) {
+  assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
+  assert(mu >= -1.0 && mu <= 1.0);
+  assert(mu_s >= -1.0 && mu_s <= 1.0);
+  assert(nu >= -1.0 && nu <= 1.0);
+  assert(scattering_order >= 2);
+
+  void (*accumulate)(const Sample&, double*) = AccumulateScalar;
+#ifdef ATMOSPHERE_REFERENCE_X86_SIMD
+  if (IsSimdInstructionSetSupported(instruction_set)) {
+    if (instruction_set == AVX2) {
+      accumulate = AccumulateAvx2;
+    } else if (instruction_set == SSE2) {
+      accumulate = AccumulateSse2;
+    }
+  }
+#endif
+
+  Direction omega(sqrt(1.0 - mu * mu), 0.0, mu);
+  Number sun_dir_x = omega.x == 0.0 ? 0.0 : (nu - mu * mu_s) / omega.x;
+  Number sun_dir_y = sqrt(max(1.0 - sun_dir_x * sun_dir_x - mu_s * mu_s, 0.0));
+  Direction omega_s(sun_dir_x, sun_dir_y, mu_s);
+
+  // The Rayleigh and Mie scattering coefficients only depend on r.
+  Number rayleigh_density = GetProfileDensity(
+      atmosphere.rayleigh_density, r - atmosphere.bottom_radius);
+  Number mie_density = GetProfileDensity(
+      atmosphere.mie_density, r - atmosphere.bottom_radius);
+  double rayleigh_factor[kNumWavelengths];
+  double mie_factor[kNumWavelengths];
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    rayleigh_factor[l] =
+        atmosphere.rayleigh_scattering[l].to(1.0 / m) * rayleigh_density();
+    mie_factor[l] = atmosphere.mie_scattering[l].to(1.0 / m) * mie_density();
+  }
+
+  double rayleigh_mie[kNumWavelengths] = {0.0};
+
+  // The maximum number of taps: 2 textures for single scattering, times 2
+  // lookups in the 4D scattering function, times 8 texels per lookup.
+  Tap taps[32];
+  Tap ground_taps[4];
+  double ground_factor[kNumWavelengths];
+  Sample sample;
+  sample.taps = taps;
+  sample.ground_taps = ground_taps;
+  sample.ground_factor = ground_factor;
+  sample.rayleigh_factor = rayleigh_factor;
+  sample.mie_factor = mie_factor;
+
+  // The distance and transmittance to the ground only depend on cos_theta. The
+  // ground contribution is null if the ray does not intersect the ground.
+  bool ray_r_theta_intersects_ground = false;
+  Length distance_to_ground = 0.0 * m;
+  auto set_ground_factor = [&](Number cos_theta) {
+    ray_r_theta_intersects_ground =
+        RayIntersectsGround(atmosphere, r, cos_theta);
+    distance_to_ground = 0.0 * m;
+    if (ray_r_theta_intersects_ground) {
+      distance_to_ground =
+          DistanceToBottomAtmosphereBoundary(atmosphere, r, cos_theta);
+      DimensionlessSpectrum transmittance_to_ground =
+          GetTransmittance(atmosphere, transmittance_texture, r, cos_theta,
+              distance_to_ground, true /* ray_intersects_ground */);
+      for (int i = 0; i < kNumWavelengths; ++i) {
+        ground_factor[i] = transmittance_to_ground[i]() *
+            atmosphere.ground_albedo[i]() / PI;
+      }
+    }
+  };
+
+  // Accumulates the contribution of the direction omega_i, of solid angle
+  // domega_i (in steradians), in rayleigh_mie.
+  auto add_sample = [&](const Direction& omega_i, Number domega_i) {
+    Number mu_i = ClampCosine(omega_i.z);
+    Number nu1 = ClampCosine(dot(omega_s, omega_i));
+    Tap* taps_end = taps;
+    if (scattering_order - 1 == 1) {
+      taps_end = AddScatteringTaps(atmosphere,
+          single_rayleigh_scattering_texture, r, mu_i, mu_s, nu1,
+          ray_r_theta_intersects_ground,
+          RayleighPhaseFunction(nu1).to(1.0 / sr), taps_end);
+      taps_end = AddScatteringTaps(atmosphere,
+          single_mie_scattering_texture, r, mu_i, mu_s, nu1,
+          ray_r_theta_intersects_ground,
+          MiePhaseFunction(atmosphere.mie_phase_function_g, nu1).to(
+              1.0 / sr), taps_end);
+    } else {
+      taps_end = AddScatteringTaps(atmosphere, multiple_scattering_texture,
+          r, mu_i, mu_s, nu1, ray_r_theta_intersects_ground, 1.0,
+          taps_end);
+    }
+    sample.num_taps = taps_end - taps;
+
+    sample.num_ground_taps = 0;
+    if (ray_r_theta_intersects_ground) {
+      Direction ground_normal = normalize(
+          Direction(0.0, 0.0, 1.0) * r + omega_i * distance_to_ground);
+      vec2 uv = GetIrradianceTextureUvFromRMuS(atmosphere,
+          atmosphere.bottom_radius, clamp(dot(ground_normal, omega_s),
+              Number(-1.0), Number(1.0)));
+      sample.num_ground_taps =
+          AddBilinearTaps(irradiance_texture, uv, ground_taps) - ground_taps;
+    }
+
+    Number nu2 = dot(omega, omega_i);
+    sample.rayleigh_weight =
+        RayleighPhaseFunction(nu2).to(1.0 / sr) * domega_i();
+    sample.mie_weight =
+        MiePhaseFunction(atmosphere.mie_phase_function_g, nu2).to(1.0 / sr) *
+            domega_i();
+    accumulate(sample, rayleigh_mie);
+  };
+
+  const int sample_count =
+      atmosphere.quadrature.scattering_density_sample_count;
+  if (atmosphere.quadrature.spherical_rule == LATITUDE_LONGITUDE_RULE) {
+    const int row_count = GetLatitudeLongitudeRowCount(sample_count, 2);
+    const Angle dphi = pi / Number(row_count);
+    const Angle dtheta = pi / Number(row_count);
+    for (int l = 0; l < row_count; ++l) {
+      Angle theta = (Number(l) + 0.5) * dtheta;
+      Number cos_theta = cos(theta);
+      Number sin_theta = sin(theta);
+      set_ground_factor(cos_theta);
+      for (int k = 0; k < 2 * row_count; ++k) {
+        Angle phi = (Number(k) + 0.5) * dphi;
+        add_sample(
+            Direction(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta),
+            (dtheta / rad) * (dphi / rad) * sin(theta));
+      }
+    }
+  } else {
+    // The table directions are defined in a frame whose z axis is omega.
+    const Direction omega_x(mu, 0.0, -omega.x);
+    const Direction omega_y(0.0, 1.0, 0.0);
+    for (int i = 0; i < sample_count; ++i) {
+      const vec4& table_sample =
+          spherical_samples_texture.Get(i, SCATTERING_DENSITY_SAMPLES_ROW);
+      if (table_sample.w == 0.0) {
+        continue;
+      }
+      Direction omega_i = omega_x * table_sample.x +
+          omega_y * table_sample.y + omega * table_sample.z;
+      set_ground_factor(ClampCosine(omega_i.z));
+      add_sample(omega_i, table_sample.w);
+    }
+  }
+
+  RadianceDensitySpectrum result;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    result[l] = rayleigh_mie[l] * watt_per_cubic_meter_per_sr_per_nm;
+  }
+  return result;
+}
+
+RadianceDensitySpectrum ComputeScatteringDensityTextureSimd(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
+    const vec3& gl_frag_coord, int scattering_order,
+    SimdInstructionSet instruction_set) {
+  Length r;
+  Number mu;
+  Number mu_s;
+  Number nu;
+  bool ray_r_mu_intersects_ground;
+  GetRMuMuSNuFromScatteringTextureFragCoord(atmosphere, gl_frag_coord,
+      r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+  return ComputeScatteringDensitySimd(atmosphere, transmittance_texture,
+      single_rayleigh_scattering_texture, single_mie_scattering_texture,
+      multiple_scattering_texture, irradiance_texture,
+      spherical_samples_texture, r, mu, mu_s, nu, scattering_order,
+      instruction_set);
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/scattering_density_simd.h</h2>
+
+<p>This file provides a faster, vectorized version of the
+<code>ComputeScatteringDensity</code> <a href="../functions.glsl.html">GLSL
+function</a>, which dominates the precomputation time of the
+<a href="model.cc.html">CPU model</a>. The computations which depend only on
+the sample directions are the same as in the GLSL function, but the texture
+lookups and the accumulation of the spectral values are done with SIMD
+instructions, several wavelengths per instruction (the texture lookups are
+written as weighted sums of texels, instead of using the dimensional types).
+
+<p>The instruction set is selected at runtime, with
+<code>GetBestSimdInstructionSet</code>. All the instruction sets give the same
+result as <code>ComputeScatteringDensity</code>, up to floating point rounding
+errors, i.e. with a relative difference less than
+<code>kScatteringDensitySimdTolerance</code>.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_SCATTERING_DENSITY_SIMD_H_
+#define ATMOSPHERE_REFERENCE_SCATTERING_DENSITY_SIMD_H_
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/functions.h"
+
+namespace atmosphere {
+namespace reference {
+
+enum SimdInstructionSet {
+  // Plain C++ code, which the compiler may or may not vectorize.
+  SCALAR,
+  // 2 wavelengths per instruction.
+  SSE2,
+  // 4 wavelengths per instruction, with fused multiply-add.
+  AVX2
+};
+
+constexpr double kScatteringDensitySimdTolerance = 1e-9;
+
+bool IsSimdInstructionSetSupported(SimdInstructionSet instruction_set);
+
+SimdInstructionSet GetBestSimdInstructionSet();
+
+// Same as ComputeScatteringDensity. If 'instruction_set' is not supported by
+// the CPU, the SCALAR version is used instead.
+RadianceDensitySpectrum ComputeScatteringDensitySimd(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
+    Length r, Number mu, Number mu_s, Number nu,
+    int scattering_order, SimdInstructionSet instruction_set);
+
+// Same as ComputeScatteringDensityTexture.
+RadianceDensitySpectrum ComputeScatteringDensityTextureSimd(
+    const AtmosphereParameters& atmosphere,
+    const TransmittanceTexture& transmittance_texture,
+    const ReducedScatteringTexture& single_rayleigh_scattering_texture,
+    const ReducedScatteringTexture& single_mie_scattering_texture,
+    const ScatteringTexture& multiple_scattering_texture,
+    const IrradianceTexture& irradiance_texture,
+    const SphericalSamplesTexture& spherical_samples_texture,
+    const vec3& gl_frag_coord, int scattering_order,
+    SimdInstructionSet instruction_set);
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_SCATTERING_DENSITY_SIMD_H_
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/scheduler.cc</h2>
+
+<p>This file implements the work-stealing scheduler defined in
+<a href="scheduler.h.html">scheduler.h</a>.
+*/
+
+#include "atmosphere/reference/scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+// The tiles which remain to be processed by a worker thread, namely the
+// [begin, end) range of the list of all tiles. The owner of the queue takes its
+// tiles from the beginning, while thieves take them from the end.
+struct TileQueue {
+  std::mutex mutex;
+  unsigned int begin;
+  unsigned int end;
+};
+
+}  // anonymous namespace
+
+TileScheduler::TileScheduler(unsigned int num_threads,
+                             const TileSize& tile_size)
+    : TileScheduler(num_threads == 0 ? ThreadPool::GetDefault() :
+          std::make_shared<ThreadPool>(ThreadPoolOptions(num_threads)),
+          tile_size) {}
+
+TileScheduler::TileScheduler(std::shared_ptr<ThreadPool> thread_pool,
+                             const TileSize& tile_size)
+    : thread_pool_(thread_pool),
+      tile_size_(tile_size) {
+  assert(thread_pool_ != nullptr);
+  assert(tile_size.width > 0 && tile_size.height > 0 && tile_size.depth > 0);
+}
+
+void TileScheduler::Run(unsigned int width, unsigned int height,
+    unsigned int depth, const std::function<void(const Tile&)>& job,
+    std::vector<double>* thread_busy_times) const {
+  std::vector<Tile> tiles;
+  for (unsigned int z = 0; z < depth; z += tile_size_.depth) {
+    for (unsigned int y = 0; y < height; y += tile_size_.height) {
+      for (unsigned int x = 0; x < width; x += tile_size_.width) {
+        Tile tile;
+        tile.x_begin = x;
+        tile.x_end = std::min(x + tile_size_.width, width);
+        tile.y_begin = y;
+        tile.y_end = std::min(y + tile_size_.height, height);
+        tile.z_begin = z;
+        tile.z_end = std::min(z + tile_size_.depth, depth);
+        tiles.push_back(tile);
+      }
+    }
+  }
+  if (thread_busy_times != nullptr) {
+    thread_busy_times->assign(std::min<size_t>(num_threads(), tiles.size()),
+        0.0);
+  }
+  if (tiles.empty()) {
+    return;
+  }
+
+  // Each worker initially gets a contiguous block of tiles, to preserve the
+  // memory locality of the texture accesses.
+  const unsigned int num_tiles = tiles.size();
+  const unsigned int num_workers = std::min(num_threads(), num_tiles);
+  std::vector<TileQueue> queues(num_workers);
+  for (unsigned int i = 0; i < num_workers; ++i) {
+    queues[i].begin = num_tiles * i / num_workers;
+    queues[i].end = num_tiles * (i + 1) / num_workers;
+  }
+
+  auto worker = [&](unsigned int id) {
+    TileQueue& own_queue = queues[id];
+    while (true) {
+      unsigned int index = num_tiles;
+      {
+        std::lock_guard<std::mutex> lock(own_queue.mutex);
+        if (own_queue.begin < own_queue.end) {
+          index = own_queue.begin++;
+        }
+      }
+      if (index < num_tiles) {
+        if (thread_busy_times == nullptr) {
+          job(tiles[index]);
+        } else {
+          auto start = std::chrono::steady_clock::now();
+          job(tiles[index]);
+          (*thread_busy_times)[id] += std::chrono::duration<double>(
+              std::chrono::steady_clock::now() - start).count();
+        }
+        continue;
+      }
+      // Our own queue is empty, try to steal half of the remaining tiles of
+      // another worker. We never hold two locks at the same time, to avoid
+      // deadlocks between concurrent thieves.
+      unsigned int stolen_begin = 0;
+      unsigned int stolen_end = 0;
+      for (unsigned int i = 1; i < num_workers && stolen_begin == stolen_end;
+           ++i) {
+        TileQueue& victim_queue = queues[(id + i) % num_workers];
+        std::lock_guard<std::mutex> lock(victim_queue.mutex);
+        unsigned int remaining = victim_queue.end - victim_queue.begin;
+        if (remaining > 0) {
+          stolen_end = victim_queue.end;
+          stolen_begin = stolen_end - (remaining + 1) / 2;
+          victim_queue.end = stolen_begin;
+        }
+      }
+      if (stolen_begin == stolen_end) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(own_queue.mutex);
+        own_queue.begin = stolen_begin;
+        own_queue.end = stolen_end;
+      }
+    }
+  };
+
+  thread_pool_->Run(num_workers, worker);
+}
+
+}  // namespace reference
+}  // namespace atmosphere
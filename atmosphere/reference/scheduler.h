@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/scheduler.h</h2>
+
+<p>This file defines a simple work-stealing scheduler, used by the
+<a href="model.cc.html">CPU model</a> to precompute its textures in parallel.
+Each precomputation pass is split into 3D tiles of texels (2D textures simply
+use a depth of 1). The tiles are distributed in contiguous blocks to a set of
+worker threads and, when a worker runs out of tiles, it steals half of the
+remaining tiles of another worker. This keeps all the cores busy even when the
+cost per texel varies a lot, which is the case for texels near the horizon. The
+workers are run on a persistent <a href="thread_pool.h.html">thread pool</a>,
+which can be shared with other schedulers.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_SCHEDULER_H_
+#define ATMOSPHERE_REFERENCE_SCHEDULER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "atmosphere/reference/thread_pool.h"
+
+namespace atmosphere {
+namespace reference {
+
+// The size of the tiles, in texels. The default value gives enough tiles to
+// keep many cores busy, even for the small 2D textures.
+struct TileSize {
+  TileSize() : width(8), height(8), depth(1) {}
+  TileSize(unsigned int width, unsigned int height, unsigned int depth)
+      : width(width), height(height), depth(depth) {}
+  unsigned int width;
+  unsigned int height;
+  unsigned int depth;
+};
+
+// A tile of texels, covering the [x_begin, x_end) x [y_begin, y_end) x
+// [z_begin, z_end) range of a texture.
+struct Tile {
+  unsigned int x_begin;
+  unsigned int x_end;
+  unsigned int y_begin;
+  unsigned int y_end;
+  unsigned int z_begin;
+  unsigned int z_end;
+
+  unsigned int size() const {
+    return (x_end - x_begin) * (y_end - y_begin) * (z_end - z_begin);
+  }
+};
+
+class TileScheduler {
+ public:
+  // A num_threads value of 0 means using the default thread pool, with one
+  // thread per hardware thread. Otherwise a new pool is created.
+  explicit TileScheduler(unsigned int num_threads = 0,
+                         const TileSize& tile_size = TileSize());
+  explicit TileScheduler(std::shared_ptr<ThreadPool> thread_pool,
+                         const TileSize& tile_size = TileSize());
+
+  unsigned int num_threads() const { return thread_pool_->num_threads(); }
+  const std::shared_ptr<ThreadPool>& thread_pool() const {
+    return thread_pool_;
+  }
+  const TileSize& tile_size() const { return tile_size_; }
+
+  // Calls 'job' once for each tile of a width x height x depth texture, in
+  // parallel, and returns when all the tiles have been processed. If
+  // 'thread_busy_times' is not null, it is set to the time spent in 'job' by
+  // each worker thread, in seconds.
+  void Run(unsigned int width, unsigned int height, unsigned int depth,
+      const std::function<void(const Tile&)>& job,
+      std::vector<double>* thread_busy_times = nullptr) const;
+
+ private:
+  std::shared_ptr<ThreadPool> thread_pool_;
+  TileSize tile_size_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_SCHEDULER_H_
@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/scheduler_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="scheduler.h.html">tile
+scheduler</a> used to precompute the textures of the CPU model. They check that
+each texel of a texture is processed exactly once, whatever the number of
+threads and the tile size.
+*/
+
+#include "atmosphere/reference/scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+class SchedulerTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  SchedulerTest(const std::string& name, T test)
+      : TestCase("SchedulerTest " + name, static_cast<Test>(test)) {}
+
+  void TestEachTexelProcessedOnce() {
+    // The texture size is deliberately not a multiple of the tile size.
+    CheckEachTexelProcessedOnce(1, TileSize(), 13, 7, 5);
+    CheckEachTexelProcessedOnce(4, TileSize(), 13, 7, 5);
+    CheckEachTexelProcessedOnce(4, TileSize(3, 2, 2), 13, 7, 5);
+    CheckEachTexelProcessedOnce(16, TileSize(1, 1, 1), 13, 7, 5);
+    // More threads than tiles.
+    CheckEachTexelProcessedOnce(64, TileSize(16, 16, 16), 13, 7, 5);
+    // 2D texture.
+    CheckEachTexelProcessedOnce(8, TileSize(4, 4, 1), 64, 16, 1);
+  }
+
+  void TestEmptyTexture() {
+    TileScheduler scheduler(4);
+    unsigned int num_calls = 0;
+    scheduler.Run(0, 16, 1, [&](const Tile& tile) { ++num_calls; });
+    ExpectEquals(0, num_calls);
+  }
+
+  void TestThreadBusyTimes() {
+    TileScheduler scheduler(4, TileSize(1, 1, 1));
+    std::vector<double> thread_busy_times;
+    scheduler.Run(16, 1, 1, [&](const Tile& tile) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }, &thread_busy_times);
+    ExpectEquals(4, thread_busy_times.size());
+    double total_busy_time = 0.0;
+    for (double busy_time : thread_busy_times) {
+      total_busy_time += busy_time;
+    }
+    // 16 tiles of at least 1ms each.
+    ExpectTrue(total_busy_time >= 0.016);
+  }
+
+ private:
+  void CheckEachTexelProcessedOnce(unsigned int num_threads,
+      const TileSize& tile_size, unsigned int width, unsigned int height,
+      unsigned int depth) {
+    const unsigned int size = width * height * depth;
+    std::unique_ptr<std::atomic<unsigned int>[]> count(
+        new std::atomic<unsigned int>[size]);
+    for (unsigned int i = 0; i < size; ++i) {
+      count[i] = 0;
+    }
+    TileScheduler scheduler(num_threads, tile_size);
+    scheduler.Run(width, height, depth, [&](const Tile& tile) {
+      for (unsigned int k = tile.z_begin; k < tile.z_end; ++k) {
+        for (unsigned int j = tile.y_begin; j < tile.y_end; ++j) {
+          for (unsigned int i = tile.x_begin; i < tile.x_end; ++i) {
+            ++count[i + width * (j + height * k)];
+          }
+        }
+      }
+    });
+    for (unsigned int i = 0; i < size; ++i) {
+      ExpectEquals(1, count[i]);
+    }
+  }
+};
+
+namespace {
+
+SchedulerTest each_texel_processed_once(
+    "EachTexelProcessedOnce",
+    &SchedulerTest::TestEachTexelProcessedOnce);
+SchedulerTest empty_texture(
+    "EmptyTexture",
+    &SchedulerTest::TestEmptyTexture);
+SchedulerTest thread_busy_times(
+    "ThreadBusyTimes",
+    &SchedulerTest::TestThreadBusyTimes);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
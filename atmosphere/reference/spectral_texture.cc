@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/spectral_texture.cc</h2>
+
+<p>This file implements the wavelength-major texture defined in
+<a href="spectral_texture.h.html">spectral_texture.h</a>.
+*/
+
+#include "atmosphere/reference/spectral_texture.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+// Computes the two texel indices and weights of a linear interpolation at 'u',
+// in a texture of the given size, with "clamp to edge" wrapping.
+void GetLinearInterpolation(double u, int size, int i[2], double w[2]) {
+  double x = u * size - 0.5;
+  double floor_x = std::floor(x);
+  int i0 = static_cast<int>(floor_x);
+  w[1] = x - floor_x;
+  w[0] = 1.0 - w[1];
+  i[0] = std::max(0, std::min(i0, size - 1));
+  i[1] = std::max(0, std::min(i0 + 1, size - 1));
+}
+
+}  // anonymous namespace
+
+SpectralTexture::SpectralTexture(int width, int height, int depth,
+    int num_wavelengths)
+    : width_(width),
+      height_(height),
+      depth_(depth),
+      num_wavelengths_(num_wavelengths),
+      data_(width * height * depth * num_wavelengths) {}
+
+void SpectralTexture::Lookup(const dimensional::vec2& uv,
+    const int* wavelengths, int num_wavelengths, double* values) const {
+  int i[2], j[2];
+  double wi[2], wj[2];
+  GetLinearInterpolation(uv.x(), width_, i, wi);
+  GetLinearInterpolation(uv.y(), height_, j, wj);
+  const int offset[4] = {
+    i[0] + width_ * j[0], i[1] + width_ * j[0],
+    i[0] + width_ * j[1], i[1] + width_ * j[1]
+  };
+  const double weight[4] = {
+    wi[0] * wj[0], wi[1] * wj[0], wi[0] * wj[1], wi[1] * wj[1]
+  };
+  const int channel_size = width_ * height_ * depth_;
+  for (int l = 0; l < num_wavelengths; ++l) {
+    const double* channel = data_.data() + channel_size * wavelengths[l];
+    values[l] =
+        weight[0] * channel[offset[0]] + weight[1] * channel[offset[1]] +
+        weight[2] * channel[offset[2]] + weight[3] * channel[offset[3]];
+  }
+}
+
+void SpectralTexture::Lookup(const dimensional::vec3& uvw,
+    const int* wavelengths, int num_wavelengths, double* values) const {
+  int i[2], j[2], k[2];
+  double wi[2], wj[2], wk[2];
+  GetLinearInterpolation(uvw.x(), width_, i, wi);
+  GetLinearInterpolation(uvw.y(), height_, j, wj);
+  GetLinearInterpolation(uvw.z(), depth_, k, wk);
+  int offset[8];
+  double weight[8];
+  for (int c = 0; c < 8; ++c) {
+    const int ci = c & 1;
+    const int cj = (c >> 1) & 1;
+    const int ck = (c >> 2) & 1;
+    offset[c] = i[ci] + width_ * (j[cj] + height_ * k[ck]);
+    weight[c] = wi[ci] * wj[cj] * wk[ck];
+  }
+  const int channel_size = width_ * height_ * depth_;
+  for (int l = 0; l < num_wavelengths; ++l) {
+    const double* channel = data_.data() + channel_size * wavelengths[l];
+    double value = 0.0;
+    for (int c = 0; c < 8; ++c) {
+      value += weight[c] * channel[offset[c]];
+    }
+    values[l] = value;
+  }
+}
+
+}  // namespace reference
+}  // namespace atmosphere
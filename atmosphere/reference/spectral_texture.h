@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/spectral_texture.h</h2>
+
+<p>This file defines an alternative storage for the precomputed textures of the
+<a href="model.h.html">CPU model</a>. The textures defined in
+<a href="definitions.h.html">definitions.h</a> store one spectrum per texel,
+i.e. all the spectral values of a texel are contiguous in memory (an "array of
+structures"). A texture lookup must then read all the spectral values of a
+texel (47 by default), even when only one or three wavelengths are needed. The
+<code>SpectralTexture</code> class below stores instead all the values for the
+first wavelength, then all the values for the second wavelength, etc (a
+"structure of arrays"), so that a lookup for a few wavelengths only reads the
+data it needs.
+
+<p>The texture size is specified at runtime, and 2D textures are represented
+with a depth of 1. The texel values are stored without their physical unit, i.e.
+as multiples of the <code>Unit()</code> of their type.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_SPECTRAL_TEXTURE_H_
+#define ATMOSPHERE_REFERENCE_SPECTRAL_TEXTURE_H_
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+
+namespace atmosphere {
+namespace reference {
+
+class SpectralTexture {
+ public:
+  SpectralTexture(int width, int height, int depth, int num_wavelengths);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int depth() const { return depth_; }
+  int num_wavelengths() const { return num_wavelengths_; }
+
+  double Get(int i, int j, int k, int wavelength) const {
+    return data_[Index(i, j, k, wavelength)];
+  }
+
+  void Set(int i, int j, int k, int wavelength, double value) {
+    data_[Index(i, j, k, wavelength)] = value;
+  }
+
+  // Copies the values of a texture defined in definitions.h, which must have
+  // the same size as this texture.
+  template<class T>
+  void CopyFrom(const Texture2d<T>& texture) {
+    for (unsigned int j = 0; j < texture.size_y(); ++j) {
+      for (unsigned int i = 0; i < texture.size_x(); ++i) {
+        CopyTexel(texture.Get(i, j), i, j, 0);
+      }
+    }
+  }
+
+  template<class T>
+  void CopyFrom(const Texture3d<T>& texture) {
+    for (unsigned int k = 0; k < texture.size_z(); ++k) {
+      for (unsigned int j = 0; j < texture.size_y(); ++j) {
+        for (unsigned int i = 0; i < texture.size_x(); ++i) {
+          CopyTexel(texture.Get(i, j, k), i, j, k);
+        }
+      }
+    }
+  }
+
+  // Computes the values at 'uv' (for 2D textures) or 'uvw' (for 3D textures)
+  // of the 'num_wavelengths' wavelengths whose indices are given in
+  // 'wavelengths', and stores them in 'values'. The interpolation and wrapping
+  // modes are the same as with the 'texture' function of the dimensional types
+  // (linear interpolation, and clamp to edge).
+  void Lookup(const dimensional::vec2& uv, const int* wavelengths,
+      int num_wavelengths, double* values) const;
+  void Lookup(const dimensional::vec3& uvw, const int* wavelengths,
+      int num_wavelengths, double* values) const;
+
+ private:
+  int Index(int i, int j, int k, int wavelength) const {
+    return i + width_ * (j + height_ * (k + depth_ * wavelength));
+  }
+
+  template<class T>
+  void CopyTexel(const T& spectrum, int i, int j, int k) {
+    typedef typename std::decay<decltype(std::declval<T>()[0])>::type Value;
+    for (int l = 0; l < num_wavelengths_; ++l) {
+      Set(i, j, k, l, spectrum[l].to(Value::Unit()));
+    }
+  }
+
+  int width_;
+  int height_;
+  int depth_;
+  int num_wavelengths_;
+  std::vector<double> data_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_SPECTRAL_TEXTURE_H_
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/spectral_texture_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="spectral_texture.h.html">
+wavelength-major textures</a> of the CPU model. They check that a lookup in such
+a texture, for any subset of the wavelengths, gives the same results as a lookup
+in the corresponding texture defined in <a href="definitions.h.html">
+definitions.h</a>.
+*/
+
+#include "atmosphere/reference/spectral_texture.h"
+
+#include <string>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+constexpr double kEpsilon = 1e-12;
+
+}  // anonymous namespace
+
+class SpectralTextureTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  SpectralTextureTest(const std::string& name, T test)
+      : TestCase("SpectralTextureTest " + name, static_cast<Test>(test)) {}
+
+  void TestLookup2d() {
+    Texture2d<IrradianceSpectrum> texture(5, 3);
+    for (unsigned int j = 0; j < texture.size_y(); ++j) {
+      for (unsigned int i = 0; i < texture.size_x(); ++i) {
+        IrradianceSpectrum spectrum;
+        for (unsigned int l = 0; l < spectrum.size(); ++l) {
+          spectrum[l] =
+              GetTestValue(i, j, 0, l) * watt_per_square_meter_per_nm;
+        }
+        texture.Set(i, j, spectrum);
+      }
+    }
+    SpectralTexture spectral_texture(5, 3, 1, kNumWavelengths);
+    spectral_texture.CopyFrom(texture);
+
+    const std::vector<int> wavelengths = GetTestWavelengths();
+    for (const vec2& uv : {vec2(0.5, 0.5), vec2(0.1, 0.9), vec2(0.37, 0.21),
+                           vec2(-0.2, 0.4), vec2(1.3, 1.1)}) {
+      std::vector<double> values(wavelengths.size());
+      spectral_texture.Lookup(
+          uv, wavelengths.data(), wavelengths.size(), values.data());
+      IrradianceSpectrum expected = reference::texture(texture, uv);
+      for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+        ExpectNear(expected[wavelengths[l]].to(watt_per_square_meter_per_nm),
+            values[l], kEpsilon);
+      }
+    }
+  }
+
+  void TestLookup3d() {
+    Texture3d<DimensionlessSpectrum> texture(4, 3, 2);
+    for (unsigned int k = 0; k < texture.size_z(); ++k) {
+      for (unsigned int j = 0; j < texture.size_y(); ++j) {
+        for (unsigned int i = 0; i < texture.size_x(); ++i) {
+          DimensionlessSpectrum spectrum;
+          for (unsigned int l = 0; l < spectrum.size(); ++l) {
+            spectrum[l] = GetTestValue(i, j, k, l);
+          }
+          texture.Set(i, j, k, spectrum);
+        }
+      }
+    }
+    SpectralTexture spectral_texture(4, 3, 2, kNumWavelengths);
+    spectral_texture.CopyFrom(texture);
+
+    const std::vector<int> wavelengths = GetTestWavelengths();
+    for (const vec3& uvw : {vec3(0.5, 0.5, 0.5), vec3(0.1, 0.9, 0.3),
+                            vec3(0.37, 0.21, 0.77), vec3(-0.2, 0.4, 1.5)}) {
+      std::vector<double> values(wavelengths.size());
+      spectral_texture.Lookup(
+          uvw, wavelengths.data(), wavelengths.size(), values.data());
+      DimensionlessSpectrum expected = reference::texture(texture, uvw);
+      for (unsigned int l = 0; l < wavelengths.size(); ++l) {
+        ExpectNear(expected[wavelengths[l]](), values[l], kEpsilon);
+      }
+    }
+  }
+
+ private:
+  typedef dimensional::vec2 vec2;
+  typedef dimensional::vec3 vec3;
+
+  static double GetTestValue(int i, int j, int k, int l) {
+    return 1.0 + i + 10.0 * j + 100.0 * k + 0.01 * l * l;
+  }
+
+  // A single wavelength, the RGB wavelengths, and all the wavelengths.
+  static std::vector<int> GetTestWavelengths() {
+    std::vector<int> wavelengths = {0, GetNearestWavelengthIndex(680.0),
+        GetNearestWavelengthIndex(550.0), GetNearestWavelengthIndex(440.0)};
+    for (int l = 0; l < kNumWavelengths; ++l) {
+      wavelengths.push_back(l);
+    }
+    return wavelengths;
+  }
+};
+
+namespace {
+
+SpectralTextureTest lookup_2d(
+    "Lookup2d",
+    &SpectralTextureTest::TestLookup2d);
+SpectralTextureTest lookup_3d(
+    "Lookup3d",
+    &SpectralTextureTest::TestLookup3d);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
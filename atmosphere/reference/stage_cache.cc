@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/stage_cache.cc</h2>
+
+<p>This file implements the <a href="stage_cache.h.html">cache</a> of the
+results of the first precomputation stages of the CPU model. The results are
+stored in memory with weak pointers, so that they are deleted as soon as no
+model uses them, and the expired pointers are removed each time a new result is
+stored.
+*/
+
+#include "atmosphere/reference/stage_cache.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace atmosphere {
+namespace reference {
+
+StageCache& StageCache::GetDefault() {
+  static StageCache default_cache;
+  return default_cache;
+}
+
+std::string StageCache::GetFileName(const std::string& name, uint64_t hash) {
+  std::ostringstream file_name;
+  file_name << "stage_" << name << "_" << std::hex << std::setw(16)
+      << std::setfill('0') << hash << ".dat";
+  return file_name.str();
+}
+
+StageCache::Handle StageCache::Find(const std::string& name,
+    uint64_t hash) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = results_.find(std::make_pair(name, hash));
+  return it == results_.end() ? nullptr : it->second.lock();
+}
+
+StageCache::Handle StageCache::Insert(const std::string& name, uint64_t hash,
+    Handle result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = results_.begin(); it != results_.end();) {
+    if (it->second.expired()) {
+      it = results_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  std::weak_ptr<const void>& stored_result =
+      results_[std::make_pair(name, hash)];
+  Handle handle = stored_result.lock();
+  if (!handle) {
+    stored_result = result;
+    handle = result;
+  }
+  return handle;
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/stage_cache.h</h2>
+
+<p>This file defines a content-addressed cache for the results of the first
+precomputation stages of the <a href="model.h.html">CPU model</a> (the
+transmittance, the direct irradiance and the single scattering). These results
+only depend on a subset of the atmosphere parameters (see
+<code>HashStageParameters</code> in <a href="texture_cache.h.html">
+texture_cache.h</a>), and models which only differ by other parameters (e.g. the
+ground albedo or the Mie phase function) can thus share them, instead of
+recomputing them. Each result is identified by a name and by the hash of the
+parameters it depends on, and is stored:
+<ul>
+<li>in memory, as long as a handle to it exists (each model keeps a handle to
+the results it uses), so that the models of a process can share it,</li>
+<li>optionally, in a cache directory, in a file whose name contains this hash,
+so that the models using this directory, in this process or in others, can also
+share it, and store it only once. These files use the format of the <a
+href="texture_cache.h.html">texture cache</a>, in double precision and for all
+the wavelengths (as the checkpoints, since they are used to compute the next
+stages).</li>
+</ul>
+<p>A cache can be used concurrently by several threads.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_STAGE_CACHE_H_
+#define ATMOSPHERE_REFERENCE_STAGE_CACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "atmosphere/reference/definitions.h"
+#include "atmosphere/reference/texture_cache.h"
+
+namespace atmosphere {
+namespace reference {
+
+class StageCache {
+ public:
+  // Keeps a result in memory as long as it exists.
+  typedef std::shared_ptr<const void> Handle;
+
+  StageCache() {}
+  StageCache(const StageCache&) = delete;
+  StageCache& operator=(const StageCache&) = delete;
+
+  // Returns the cache shared by all the models of this process.
+  static StageCache& GetDefault();
+
+  // Loads the result with the given name and parameters hash, from memory or,
+  // if it is not found and if 'directory' is not empty, from this directory
+  // (the loaded result is then also kept in memory). Returns a handle to this
+  // result, or null, and leaves the texture unchanged, if it is not found.
+  template<class T>
+  Handle Load(const std::string& directory, const std::string& name,
+      uint64_t hash, Texture2d<T>* texture) {
+    return DoLoad(directory, name, hash, texture, [&]() {
+      return new Texture2d<T>(texture->size_x(), texture->size_y());
+    });
+  }
+
+  template<class T>
+  Handle Load(const std::string& directory, const std::string& name,
+      uint64_t hash, Texture3d<T>* texture) {
+    return DoLoad(directory, name, hash, texture, [&]() {
+      return new Texture3d<T>(
+          texture->size_x(), texture->size_y(), texture->size_z());
+    });
+  }
+
+  // Saves a copy of the given texture in memory and, if 'directory' is not
+  // empty, in this directory. Returns a handle to this copy.
+  template<class T>
+  Handle Save(const std::string& directory, const std::string& name,
+      uint64_t hash, const Texture2d<T>& texture) {
+    return DoSave(directory, name, hash, texture, [&]() {
+      return new Texture2d<T>(texture.size_x(), texture.size_y());
+    });
+  }
+
+  template<class T>
+  Handle Save(const std::string& directory, const std::string& name,
+      uint64_t hash, const Texture3d<T>& texture) {
+    return DoSave(directory, name, hash, texture, [&]() {
+      return new Texture3d<T>(
+          texture.size_x(), texture.size_y(), texture.size_z());
+    });
+  }
+
+  // Returns the name of the file used to store the given result in a cache
+  // directory.
+  static std::string GetFileName(const std::string& name, uint64_t hash);
+
+ private:
+  template<class Texture, class NewTexture>
+  Handle DoLoad(const std::string& directory, const std::string& name,
+      uint64_t hash, Texture* texture, NewTexture new_texture) {
+    Handle handle = Find(name, hash);
+    if (handle) {
+      texture->CopyFrom(*static_cast<const Texture*>(handle.get()));
+      return handle;
+    }
+    if (directory.empty() || !TextureCache(directory, hash).Load(
+            GetFileName(name, hash), texture)) {
+      return nullptr;
+    }
+    return Insert(name, hash, *texture, new_texture);
+  }
+
+  template<class Texture, class NewTexture>
+  Handle DoSave(const std::string& directory, const std::string& name,
+      uint64_t hash, const Texture& texture, NewTexture new_texture) {
+    if (!directory.empty()) {
+      TextureCache(directory, hash).Save(GetFileName(name, hash), texture);
+    }
+    return Insert(name, hash, texture, new_texture);
+  }
+
+  template<class Texture, class NewTexture>
+  Handle Insert(const std::string& name, uint64_t hash,
+      const Texture& texture, NewTexture new_texture) {
+    std::shared_ptr<Texture> copy(new_texture());
+    copy->CopyFrom(texture);
+    return Insert(name, hash, copy);
+  }
+
+  // Returns the result with the given name and hash, or null if there is none.
+  Handle Find(const std::string& name, uint64_t hash) const;
+
+  // Stores the given result, unless there is already one with the same name
+  // and hash, and returns the stored result.
+  Handle Insert(const std::string& name, uint64_t hash, Handle result);
+
+  mutable std::mutex mutex_;
+  std::map<std::pair<std::string, uint64_t>, std::weak_ptr<const void>>
+      results_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_STAGE_CACHE_H_
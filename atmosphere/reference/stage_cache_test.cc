@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/stage_cache_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="stage_cache.h.html">cache</a>
+of the results of the first precomputation stages of the CPU model. They check
+that a result is shared in memory as long as a handle to it exists, and via the
+cache directory otherwise, even if several threads save it at the same time.
+*/
+
+#include "atmosphere/reference/stage_cache.h"
+
+#include <dirent.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+// The Makefile runs the tests from the root directory, and puts the test
+// binary in this directory.
+const char kCacheDirectory[] = "output/Debug/";
+
+class TestTexture : public Texture3d<DimensionlessSpectrum> {
+ public:
+  TestTexture() : Texture3d(4, 3, 2, DimensionlessSpectrum(0.0)) {}
+};
+
+}  // anonymous namespace
+
+class StageCacheTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  StageCacheTest(const std::string& name, T test)
+      : TestCase("StageCacheTest " + name, static_cast<Test>(test)) {}
+
+  void TestMemorySharing() {
+    StageCache cache;
+    TestTexture texture;
+    texture.Set(1, 2, 1, DimensionlessSpectrum(0.5));
+    StageCache::Handle handle = cache.Save("", "test", 123, texture);
+    ExpectTrue(handle != nullptr);
+    texture.Set(1, 2, 1, DimensionlessSpectrum(0.25));
+
+    // The saved result is a copy of the texture.
+    TestTexture loaded_texture;
+    ExpectTrue(cache.Load("", "test", 123, &loaded_texture) == handle);
+    ExpectEquals(0.5, loaded_texture.Get(1, 2, 1)[0]());
+    // Saving the same result again returns the existing one.
+    ExpectTrue(cache.Save("", "test", 123, texture) == handle);
+    // Different name or hash.
+    ExpectTrue(cache.Load("", "other", 123, &loaded_texture) == nullptr);
+    ExpectTrue(cache.Load("", "test", 456, &loaded_texture) == nullptr);
+
+    // The result is deleted when there is no handle to it.
+    handle.reset();
+    ExpectTrue(cache.Load("", "test", 123, &loaded_texture) == nullptr);
+  }
+
+  void TestDirectorySharing() {
+    TestTexture texture;
+    texture.Set(3, 0, 1, DimensionlessSpectrum(0.75));
+    StageCache().Save(kCacheDirectory, "test", 123, texture);
+
+    // A result saved by another cache (e.g. in another process) is loaded
+    // from the directory, and is then kept in memory.
+    StageCache cache;
+    TestTexture loaded_texture;
+    StageCache::Handle handle =
+        cache.Load(kCacheDirectory, "test", 123, &loaded_texture);
+    ExpectTrue(handle != nullptr);
+    ExpectEquals(0.75, loaded_texture.Get(3, 0, 1)[0]());
+    ExpectTrue(cache.Load("", "test", 123, &loaded_texture) == handle);
+    ExpectTrue(
+        cache.Load(kCacheDirectory, "test", 456, &loaded_texture) == nullptr);
+    std::remove((std::string(kCacheDirectory) +
+        StageCache::GetFileName("test", 123)).c_str());
+  }
+
+  void TestConcurrentSaves() {
+    constexpr int kNumSaves = 20;
+    StageCache cache;
+    // The two threads save different values, to detect a cache file mixing
+    // the data of two saves.
+    auto save = [&](double value) {
+      Texture3d<DimensionlessSpectrum> texture(
+          32, 32, 16, DimensionlessSpectrum(value));
+      for (int i = 0; i < kNumSaves; ++i) {
+        cache.Save(kCacheDirectory, "concurrent", 123, texture);
+      }
+    };
+    std::thread first_thread(save, 0.25);
+    std::thread second_thread(save, 0.5);
+    first_thread.join();
+    second_thread.join();
+
+    // The cache file contains the values of a single save, and no temporary
+    // file remains in the cache directory.
+    Texture3d<DimensionlessSpectrum> loaded_texture(32, 32, 16);
+    ExpectTrue(StageCache().Load(
+        kCacheDirectory, "concurrent", 123, &loaded_texture) != nullptr);
+    const double value = loaded_texture.Get(0, 0, 0)[0]();
+    ExpectTrue(value == 0.25 || value == 0.5);
+    int num_different_values = 0;
+    for (unsigned int k = 0; k < 16; ++k) {
+      for (unsigned int j = 0; j < 32; ++j) {
+        for (unsigned int i = 0; i < 32; ++i) {
+          for (int l = 0; l < kNumWavelengths; ++l) {
+            num_different_values +=
+                loaded_texture.Get(i, j, k)[l]() != value ? 1 : 0;
+          }
+        }
+      }
+    }
+    ExpectEquals(0, num_different_values);
+    DIR* dir = opendir(kCacheDirectory);
+    ExpectTrue(dir != nullptr);
+    while (struct dirent* entry = readdir(dir)) {
+      ExpectTrue(std::string(entry->d_name).find(".tmp") == std::string::npos);
+    }
+    closedir(dir);
+    std::remove((std::string(kCacheDirectory) +
+        StageCache::GetFileName("concurrent", 123)).c_str());
+  }
+};
+
+namespace {
+
+StageCacheTest memory_sharing(
+    "MemorySharing",
+    &StageCacheTest::TestMemorySharing);
+StageCacheTest directory_sharing(
+    "DirectorySharing",
+    &StageCacheTest::TestDirectorySharing);
+StageCacheTest concurrent_saves(
+    "ConcurrentSaves",
+    &StageCacheTest::TestConcurrentSaves);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
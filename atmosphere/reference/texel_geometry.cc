@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texel_geometry.cc</h2>
+
+<p>This file implements the table of texel parameters defined in
+<a href="texel_geometry.h.html">texel_geometry.h</a>, with the GLSL functions
+which compute these parameters from the texel coordinates.
+*/
+
+#include "atmosphere/reference/texel_geometry.h"
+
+#include "atmosphere/reference/functions.h"
+
+namespace atmosphere {
+namespace reference {
+
+TexelGeometry::TexelGeometry(const AtmosphereParameters& atmosphere)
+    : resolution_(atmosphere.texture_resolution) {
+  const vec2 transmittance_size(resolution_.transmittance_width,
+      resolution_.transmittance_height);
+  transmittance_.resize(
+      resolution_.transmittance_width * resolution_.transmittance_height);
+  for (int j = 0; j < resolution_.transmittance_height; ++j) {
+    for (int i = 0; i < resolution_.transmittance_width; ++i) {
+      TransmittanceTexelGeometry& texel =
+          transmittance_[i + resolution_.transmittance_width * j];
+      GetRMuFromTransmittanceTextureUv(atmosphere,
+          vec2(i + 0.5, j + 0.5) / transmittance_size, texel.r, texel.mu);
+    }
+  }
+
+  const vec2 irradiance_size(
+      resolution_.irradiance_width, resolution_.irradiance_height);
+  irradiance_.resize(
+      resolution_.irradiance_width * resolution_.irradiance_height);
+  for (int j = 0; j < resolution_.irradiance_height; ++j) {
+    for (int i = 0; i < resolution_.irradiance_width; ++i) {
+      IrradianceTexelGeometry& texel =
+          irradiance_[i + resolution_.irradiance_width * j];
+      GetRMuSFromIrradianceTextureUv(atmosphere,
+          vec2(i + 0.5, j + 0.5) / irradiance_size, texel.r, texel.mu_s);
+    }
+  }
+
+  const int width = resolution_.scattering_width();
+  const int height = resolution_.scattering_height();
+  const int depth = resolution_.scattering_depth();
+  scattering_.resize(width * height * depth);
+  for (int k = 0; k < depth; ++k) {
+    for (int j = 0; j < height; ++j) {
+      for (int i = 0; i < width; ++i) {
+        ScatteringTexelGeometry& texel =
+            scattering_[i + width * (j + height * k)];
+        GetRMuMuSNuFromScatteringTextureFragCoord(atmosphere,
+            vec3(i + 0.5, j + 0.5, k + 0.5), texel.r, texel.mu, texel.mu_s,
+            texel.nu, texel.ray_r_mu_intersects_ground);
+      }
+    }
+  }
+}
+
+}  // namespace reference
+}  // namespace atmosphere
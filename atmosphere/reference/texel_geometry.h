@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texel_geometry.h</h2>
+
+<p>This file defines a table of the parameters associated with each texel of the
+precomputed textures of the <a href="model.h.html">CPU model</a>, i.e. the
+$(r,\mu)$ parameters of the transmittance texels, the $(r,\mu_s)$ parameters of
+the irradiance texels, and the $(r,\mu,\mu_s,\nu)$ parameters of the scattering
+texels (see the texture mappings in
+<a href="../functions.glsl.html">functions.glsl</a>). These parameters only
+depend on the atmosphere radii, on $\mu_{s,min}$ and on the texture resolution,
+but the <code>Compute*Texture</code> functions recompute them, with several
+square roots and divisions, each time a texel is computed, i.e. in each phase
+and for each scattering order. The CPU model instead computes them once, with
+the same functions, and then uses the functions which take these parameters as
+input.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_TEXEL_GEOMETRY_H_
+#define ATMOSPHERE_REFERENCE_TEXEL_GEOMETRY_H_
+
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+
+namespace atmosphere {
+namespace reference {
+
+struct TransmittanceTexelGeometry {
+  Length r;
+  Number mu;
+};
+
+struct IrradianceTexelGeometry {
+  Length r;
+  Number mu_s;
+};
+
+struct ScatteringTexelGeometry {
+  Length r;
+  Number mu;
+  Number mu_s;
+  Number nu;
+  bool ray_r_mu_intersects_ground;
+};
+
+class TexelGeometry {
+ public:
+  explicit TexelGeometry(const AtmosphereParameters& atmosphere);
+
+  const TransmittanceTexelGeometry& transmittance(int i, int j) const {
+    return transmittance_[i + resolution_.transmittance_width * j];
+  }
+
+  const IrradianceTexelGeometry& irradiance(int i, int j) const {
+    return irradiance_[i + resolution_.irradiance_width * j];
+  }
+
+  const ScatteringTexelGeometry& scattering(int i, int j, int k) const {
+    return scattering_[i + resolution_.scattering_width() *
+        (j + resolution_.scattering_height() * k)];
+  }
+
+ private:
+  const TextureResolution resolution_;
+  std::vector<TransmittanceTexelGeometry> transmittance_;
+  std::vector<IrradianceTexelGeometry> irradiance_;
+  std::vector<ScatteringTexelGeometry> scattering_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_TEXEL_GEOMETRY_H_
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texel_geometry_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="texel_geometry.h.html">texel
+parameters table</a> of the CPU model. They check that computing a texel from
+its tabulated parameters gives exactly the same result as computing it from its
+texture coordinates, with the <code>Compute*Texture</code> functions.
+*/
+
+#include "atmosphere/reference/texel_geometry.h"
+
+#include <string>
+
+#include "atmosphere/reference/functions.h"
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+constexpr SpectralIrradiance kSolarIrradiance =
+    123.0 * watt_per_square_meter_per_nm;
+constexpr Length kBottomRadius = 1000.0 * km;
+constexpr Length kTopRadius = 1500.0 * km;
+constexpr Length kRayleighScaleHeight = 60.0 * km;
+constexpr ScatteringCoefficient kRayleighScattering = 0.001 / km;
+
+}  // anonymous namespace
+
+class TexelGeometryTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TexelGeometryTest(const std::string& name, T test)
+      : TestCase("TexelGeometryTest " + name, static_cast<Test>(test)) {
+    atmosphere_parameters_.solar_irradiance[0] = kSolarIrradiance;
+    atmosphere_parameters_.bottom_radius = kBottomRadius;
+    atmosphere_parameters_.top_radius = kTopRadius;
+    atmosphere_parameters_.rayleigh_density.layers[1] = DensityProfileLayer(
+        0.0 * m, 1.0, -1.0 / kRayleighScaleHeight, 0.0 / m, 0.0);
+    atmosphere_parameters_.rayleigh_scattering[0] = kRayleighScattering;
+    atmosphere_parameters_.mu_s_min = -0.5;
+    TextureResolution& resolution = atmosphere_parameters_.texture_resolution;
+    resolution.transmittance_width = 16;
+    resolution.transmittance_height = 8;
+    resolution.scattering_r_size = 4;
+    resolution.scattering_mu_size = 8;
+    resolution.scattering_mu_s_size = 4;
+    resolution.scattering_nu_size = 3;
+    resolution.irradiance_width = 8;
+    resolution.irradiance_height = 4;
+  }
+
+  void TestTransmittance() {
+    const TexelGeometry geometry(atmosphere_parameters_);
+    const TextureResolution& resolution =
+        atmosphere_parameters_.texture_resolution;
+    for (int j = 0; j < resolution.transmittance_height; ++j) {
+      for (int i = 0; i < resolution.transmittance_width; ++i) {
+        const TransmittanceTexelGeometry& texel = geometry.transmittance(i, j);
+        ExpectEquals(
+            ComputeTransmittanceToTopAtmosphereBoundaryTexture(
+                atmosphere_parameters_, vec2(i + 0.5, j + 0.5))[0](),
+            ComputeTransmittanceToTopAtmosphereBoundary(
+                atmosphere_parameters_, texel.r, texel.mu)[0]());
+      }
+    }
+  }
+
+  void TestIrradiance() {
+    const TexelGeometry geometry(atmosphere_parameters_);
+    const TextureResolution& resolution =
+        atmosphere_parameters_.texture_resolution;
+    const TransmittanceTexture transmittance_texture(
+        resolution.transmittance_width, resolution.transmittance_height,
+        DimensionlessSpectrum(0.5));
+    for (int j = 0; j < resolution.irradiance_height; ++j) {
+      for (int i = 0; i < resolution.irradiance_width; ++i) {
+        const IrradianceTexelGeometry& texel = geometry.irradiance(i, j);
+        ExpectEquals(
+            ComputeDirectIrradianceTexture(atmosphere_parameters_,
+                transmittance_texture, vec2(i + 0.5, j + 0.5))[0].to(
+                    watt_per_square_meter_per_nm),
+            ComputeDirectIrradiance(atmosphere_parameters_,
+                transmittance_texture, texel.r, texel.mu_s)[0].to(
+                    watt_per_square_meter_per_nm));
+      }
+    }
+  }
+
+  void TestScattering() {
+    const TexelGeometry geometry(atmosphere_parameters_);
+    const TextureResolution& resolution =
+        atmosphere_parameters_.texture_resolution;
+    for (int k = 0; k < resolution.scattering_depth(); ++k) {
+      for (int j = 0; j < resolution.scattering_height(); ++j) {
+        for (int i = 0; i < resolution.scattering_width(); ++i) {
+          Length r;
+          Number mu;
+          Number mu_s;
+          Number nu;
+          bool ray_r_mu_intersects_ground;
+          GetRMuMuSNuFromScatteringTextureFragCoord(atmosphere_parameters_,
+              vec3(i + 0.5, j + 0.5, k + 0.5), r, mu, mu_s, nu,
+              ray_r_mu_intersects_ground);
+          const ScatteringTexelGeometry& texel = geometry.scattering(i, j, k);
+          ExpectEquals(r.to(m), texel.r.to(m));
+          ExpectEquals(mu(), texel.mu());
+          ExpectEquals(mu_s(), texel.mu_s());
+          ExpectEquals(nu(), texel.nu());
+          ExpectTrue(ray_r_mu_intersects_ground ==
+              texel.ray_r_mu_intersects_ground);
+        }
+      }
+    }
+  }
+
+ private:
+  AtmosphereParameters atmosphere_parameters_;
+};
+
+namespace {
+
+TexelGeometryTest transmittance(
+    "Transmittance",
+    &TexelGeometryTest::TestTransmittance);
+TexelGeometryTest irradiance(
+    "Irradiance",
+    &TexelGeometryTest::TestIrradiance);
+TexelGeometryTest scattering(
+    "Scattering",
+    &TexelGeometryTest::TestScattering);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texture.h</h2>
+
+<p>This file defines the 2D and 3D textures used to store the precomputed
+textures of the <a href="model.h.html">CPU model</a>. They provide the same API
+as the <code>BinaryFunction</code> and <code>TernaryFunction</code> classes of
+the dimensional types library (one value per texel, and a
+<code>texture</code> function doing a linear interpolation with "clamp to edge"
+wrapping), but their size is specified at runtime instead of with template
+arguments. This makes it possible to precompute textures of different sizes
+with the same binary (see <code>TextureResolution</code> in
+<a href="../constants.h.html">constants.h</a>).
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_TEXTURE_H_
+#define ATMOSPHERE_REFERENCE_TEXTURE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <memory>
+
+#include "math/vector.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace internal {
+
+// Computes the two texels and their weights to linearly interpolate a texture
+// of the given size at the given texture coordinate, with "clamp to edge"
+// wrapping.
+inline void GetLinearInterpolation(double u, unsigned int size, int* i0,
+    int* i1, double* w0, double* w1) {
+  const double x = u * size - 0.5;
+  const double floor_x = std::floor(x);
+  const int i = static_cast<int>(floor_x);
+  const int max_i = static_cast<int>(size) - 1;
+  *w1 = x - floor_x;
+  *w0 = 1.0 - *w1;
+  *i0 = std::max(0, std::min(i, max_i));
+  *i1 = std::max(0, std::min(i + 1, max_i));
+}
+
+}  // namespace internal
+
+template<class T>
+class Texture2d {
+ public:
+  Texture2d(unsigned int size_x, unsigned int size_y)
+      : size_x_(size_x), size_y_(size_y), value_(new T[size_x * size_y]) {}
+  Texture2d(unsigned int size_x, unsigned int size_y, const T& value)
+      : Texture2d(size_x, size_y) {
+    std::fill(value_.get(), value_.get() + size_x * size_y, value);
+  }
+  Texture2d(const Texture2d&) = delete;
+  Texture2d& operator=(const Texture2d&) = delete;
+  virtual ~Texture2d() {}
+
+  unsigned int size_x() const { return size_x_; }
+  unsigned int size_y() const { return size_y_; }
+
+  virtual const T& Get(int i, int j) const {
+    return value_[i + size_x_ * j];
+  }
+
+  void Set(int i, int j, const T& value) {
+    value_[i + size_x_ * j] = value;
+  }
+
+  T operator()(const dimensional::vec2& uv) const {
+    int i[2], j[2];
+    double wi[2], wj[2];
+    internal::GetLinearInterpolation(uv.x(), size_x_, &i[0], &i[1], &wi[0],
+        &wi[1]);
+    internal::GetLinearInterpolation(uv.y(), size_y_, &j[0], &j[1], &wj[0],
+        &wj[1]);
+    return Get(i[0], j[0]) * (wi[0] * wj[0]) +
+        Get(i[1], j[0]) * (wi[1] * wj[0]) +
+        Get(i[0], j[1]) * (wi[0] * wj[1]) +
+        Get(i[1], j[1]) * (wi[1] * wj[1]);
+  }
+
+  Texture2d& operator+=(const Texture2d& other) {
+    assert(other.size_x_ == size_x_ && other.size_y_ == size_y_);
+    for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
+      value_[i] = value_[i] + other.value_[i];
+    }
+    return *this;
+  }
+
+  template<class S>
+  Texture2d& operator*=(const S& scale) {
+    for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
+      value_[i] = value_[i] * scale;
+    }
+    return *this;
+  }
+
+  void Fill(const T& value) {
+    std::fill(value_.get(), value_.get() + size_x_ * size_y_, value);
+  }
+
+  void CopyFrom(const Texture2d& other) {
+    assert(other.size_x_ == size_x_ && other.size_y_ == size_y_);
+    std::copy(other.value_.get(), other.value_.get() + size_x_ * size_y_,
+        value_.get());
+  }
+
+ protected:
+  const unsigned int size_x_;
+  const unsigned int size_y_;
+  std::unique_ptr<T[]> value_;
+};
+
+template<class T>
+class Texture3d {
+ public:
+  Texture3d(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+      : size_x_(size_x), size_y_(size_y), size_z_(size_z),
+        value_(new T[size_x * size_y * size_z]) {}
+  Texture3d(unsigned int size_x, unsigned int size_y, unsigned int size_z,
+      const T& value) : Texture3d(size_x, size_y, size_z) {
+    std::fill(value_.get(), value_.get() + size_x * size_y * size_z, value);
+  }
+  Texture3d(const Texture3d&) = delete;
+  Texture3d& operator=(const Texture3d&) = delete;
+  virtual ~Texture3d() {}
+
+  unsigned int size_x() const { return size_x_; }
+  unsigned int size_y() const { return size_y_; }
+  unsigned int size_z() const { return size_z_; }
+
+  virtual const T& Get(int i, int j, int k) const {
+    return value_[i + size_x_ * (j + size_y_ * k)];
+  }
+
+  void Set(int i, int j, int k, const T& value) {
+    value_[i + size_x_ * (j + size_y_ * k)] = value;
+  }
+
+  T operator()(const dimensional::vec3& uvw) const {
+    int i[2], j[2], k[2];
+    double wi[2], wj[2], wk[2];
+    internal::GetLinearInterpolation(uvw.x(), size_x_, &i[0], &i[1], &wi[0],
+        &wi[1]);
+    internal::GetLinearInterpolation(uvw.y(), size_y_, &j[0], &j[1], &wj[0],
+        &wj[1]);
+    internal::GetLinearInterpolation(uvw.z(), size_z_, &k[0], &k[1], &wk[0],
+        &wk[1]);
+    T result = Get(i[0], j[0], k[0]) * (wi[0] * wj[0] * wk[0]);
+    for (int c = 1; c < 8; ++c) {
+      result = result + Get(i[c & 1], j[(c >> 1) & 1], k[c >> 2]) *
+          (wi[c & 1] * wj[(c >> 1) & 1] * wk[c >> 2]);
+    }
+    return result;
+  }
+
+  Texture3d& operator+=(const Texture3d& other) {
+    assert(other.size_x_ == size_x_ && other.size_y_ == size_y_ &&
+        other.size_z_ == size_z_);
+    for (unsigned int i = 0; i < size_x_ * size_y_ * size_z_; ++i) {
+      value_[i] = value_[i] + other.value_[i];
+    }
+    return *this;
+  }
+
+  template<class S>
+  Texture3d& operator*=(const S& scale) {
+    for (unsigned int i = 0; i < size_x_ * size_y_ * size_z_; ++i) {
+      value_[i] = value_[i] * scale;
+    }
+    return *this;
+  }
+
+  void Fill(const T& value) {
+    std::fill(value_.get(), value_.get() + size_x_ * size_y_ * size_z_, value);
+  }
+
+  void CopyFrom(const Texture3d& other) {
+    assert(other.size_x_ == size_x_ && other.size_y_ == size_y_ &&
+        other.size_z_ == size_z_);
+    std::copy(other.value_.get(),
+        other.value_.get() + size_x_ * size_y_ * size_z_, value_.get());
+  }
+
+ protected:
+  const unsigned int size_x_;
+  const unsigned int size_y_;
+  const unsigned int size_z_;
+  std::unique_ptr<T[]> value_;
+};
+
+// The equivalent of the GLSL texture function.
+template<class T>
+T texture(const Texture2d<T>& texture_2d, const dimensional::vec2& uv) {
+  return texture_2d(uv);
+}
+
+template<class T>
+T texture(const Texture3d<T>& texture_3d, const dimensional::vec3& uvw) {
+  return texture_3d(uvw);
+}
+
+// Tables of vec4 values (e.g. SphericalSamplesTexture) must not be
+// interpolated, and are thus read with a nearest texel lookup (the GPU model
+// uses GL_NEAREST filtering for them).
+inline dimensional::vec4 texture(const Texture2d<dimensional::vec4>& texture_2d,
+    const dimensional::vec2& uv) {
+  const int max_i = static_cast<int>(texture_2d.size_x()) - 1;
+  const int max_j = static_cast<int>(texture_2d.size_y()) - 1;
+  const int i = static_cast<int>(std::floor(uv.x() * texture_2d.size_x()));
+  const int j = static_cast<int>(std::floor(uv.y() * texture_2d.size_y()));
+  return texture_2d.Get(std::max(0, std::min(i, max_i)),
+      std::max(0, std::min(j, max_j)));
+}
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_TEXTURE_H_
@@ -0,0 +1,465 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texture_cache.cc</h2>
+
+<p>This file implements the precomputed texture cache defined in
+<a href="texture_cache.h.html">texture_cache.h</a>.
+*/
+
+#include "atmosphere/reference/texture_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "atmosphere/reference/multiple_scattering_lut.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'T', 'M', 'O', 'T', 'E', 'X', '\0'};
+
+// The number of cache files written so far by this process. It is used to give
+// a unique name to the temporary file of each write, even if several threads
+// write the same cache file at the same time.
+std::atomic<unsigned int> num_written_files(0);
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t precision;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t num_values;
+  uint64_t parameters_hash;
+  uint64_t wavelengths_mask;
+};
+static_assert(sizeof(Header) % sizeof(double) == 0,
+    "The texel values must be aligned in the cache files");
+static_assert(kNumWavelengths <= 64,
+    "The stored wavelengths must fit in the header bit mask");
+
+unsigned int GetBytesPerValue(TexturePrecision precision) {
+  switch (precision) {
+    case FLOAT32:
+      return sizeof(float);
+    case FLOAT16:
+      return sizeof(uint16_t);
+    default:
+      return sizeof(double);
+  }
+}
+
+// Returns a bit mask of the stored values, among the given number of values
+// per texel. The wavelength subset only applies to spectra, i.e. if there is
+// one value per wavelength.
+uint64_t GetValuesMask(const TextureCacheFormat& format,
+    unsigned int num_values) {
+  uint64_t mask = 0;
+  if (format.wavelengths.empty() || num_values != kNumWavelengths) {
+    for (unsigned int l = 0; l < num_values && l < 64; ++l) {
+      mask |= uint64_t(1) << l;
+    }
+  } else {
+    for (int l : format.wavelengths) {
+      assert(l >= 0 && l < static_cast<int>(num_values));
+      mask |= uint64_t(1) << l;
+    }
+  }
+  return mask;
+}
+
+Header MakeHeader(unsigned int width, unsigned int height, unsigned int depth,
+    unsigned int num_values, uint64_t parameters_hash,
+    const TextureCacheFormat& format) {
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kTextureCacheVersion;
+  header.precision = GetBytesPerValue(format.precision);
+  header.width = width;
+  header.height = height;
+  header.depth = depth;
+  header.num_values = num_values;
+  header.parameters_hash = parameters_hash;
+  header.wavelengths_mask = GetValuesMask(format, num_values);
+  return header;
+}
+
+// Conversions between double and IEEE 754 half precision values, with round to
+// nearest even, and support for subnormal, infinite and NaN values.
+uint16_t DoubleToHalf(double value) {
+  float f = static_cast<float>(value);
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t abs_bits = bits & 0x7FFFFFFF;
+  if (abs_bits >= 0x7F800000) {
+    // Infinite or NaN.
+    return sign | 0x7C00 | (abs_bits > 0x7F800000 ? 0x200 : 0);
+  }
+  if (abs_bits >= 0x477FF000) {
+    // Too large (rounds to a value larger than 65504).
+    return sign | 0x7C00;
+  }
+  if (abs_bits < 0x38800000) {
+    // Subnormal half value (or zero): the result is abs(f) / 2^-24, rounded.
+    if (abs_bits < 0x33000000) {
+      return sign;
+    }
+    const uint32_t mantissa = (abs_bits & 0x7FFFFF) | 0x800000;
+    const int shift = 126 - (abs_bits >> 23);
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      ++half;
+    }
+    return sign | half;
+  }
+  // Normal half value: rebias the exponent, and round the mantissa (a carry
+  // correctly increments the exponent).
+  uint32_t half = (abs_bits - 0x38000000) >> 13;
+  const uint32_t remainder = abs_bits & 0x1FFF;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | half;
+}
+
+double HalfToDouble(uint16_t half) {
+  const uint32_t sign = uint32_t(half & 0x8000) << 16;
+  const uint32_t abs_half = half & 0x7FFF;
+  if (abs_half < 0x400) {
+    // Subnormal half value (or zero).
+    const double value = abs_half * (1.0 / (1 << 24));
+    return sign ? -value : value;
+  }
+  // Normal, infinite or NaN value: rebias the exponent (to the maximum single
+  // precision exponent for infinite and NaN values).
+  const uint32_t bits = sign | (abs_half >= 0x7C00 ?
+      0x7F800000 | ((abs_half & 0x3FF) << 13) :
+      (abs_half << 13) + 0x38000000);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// A 64 bits FNV-1a hash (see http://www.isthe.com/chongo/tech/comp/fnv/).
+class Hasher {
+ public:
+  Hasher() : hash_(14695981039346656037ull) {}
+
+  uint64_t hash() const { return hash_; }
+
+  void Add(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * 1099511628211ull;
+    }
+  }
+
+  void Add(double value) { Add(&value, sizeof(value)); }
+
+  template<class T>
+  void AddSpectrum(const T& spectrum) {
+    typedef typename std::decay<decltype(spectrum[0])>::type Value;
+    for (unsigned int l = 0; l < spectrum.size(); ++l) {
+      Add(spectrum[l].to(Value::Unit()));
+    }
+  }
+
+  void Add(const DensityProfile& profile) {
+    for (const DensityProfileLayer& layer : profile.layers) {
+      Add(layer.width.to(m));
+      Add(layer.exp_term());
+      Add(layer.exp_scale.to(1.0 / m));
+      Add(layer.linear_term.to(1.0 / m));
+      Add(layer.constant_term());
+    }
+  }
+
+ private:
+  uint64_t hash_;
+};
+
+}  // anonymous namespace
+
+uint64_t HashModelParameters(const AtmosphereParameters& atmosphere,
+    unsigned int num_scattering_orders, double convergence_tolerance,
+    const std::vector<TextureResolution>& scattering_order_resolutions,
+    bool fast_functions, bool multiple_scattering_lut) {
+  Hasher hasher;
+  hasher.AddSpectrum(atmosphere.solar_irradiance);
+  hasher.Add(atmosphere.sun_angular_radius.to(rad));
+  hasher.Add(atmosphere.bottom_radius.to(m));
+  hasher.Add(atmosphere.top_radius.to(m));
+  hasher.Add(atmosphere.rayleigh_density);
+  hasher.AddSpectrum(atmosphere.rayleigh_scattering);
+  hasher.Add(atmosphere.mie_density);
+  hasher.AddSpectrum(atmosphere.mie_scattering);
+  hasher.AddSpectrum(atmosphere.mie_extinction);
+  hasher.Add(atmosphere.mie_phase_function_g());
+  hasher.Add(atmosphere.absorption_density);
+  hasher.AddSpectrum(atmosphere.absorption_extinction);
+  hasher.AddSpectrum(atmosphere.ground_albedo);
+  hasher.Add(atmosphere.mu_s_min());
+  // The texture sizes are also stored in the header of each cache file, but
+  // the 4D scattering resolution can't be recovered from the 3D texture size.
+  const TextureResolution& resolution = atmosphere.texture_resolution;
+  const int sizes[] = {
+    resolution.transmittance_width, resolution.transmittance_height,
+    resolution.scattering_r_size, resolution.scattering_mu_size,
+    resolution.scattering_mu_s_size, resolution.scattering_nu_size,
+    resolution.irradiance_width, resolution.irradiance_height
+  };
+  hasher.Add(sizes, sizeof(sizes));
+  const Quadrature& quadrature = atmosphere.quadrature;
+  const int quadrature_parameters[] = {
+    quadrature.rule, quadrature.transmittance_sample_count,
+    quadrature.single_scattering_sample_count,
+    quadrature.multiple_scattering_sample_count, quadrature.spherical_rule,
+    quadrature.scattering_density_sample_count,
+    quadrature.indirect_irradiance_sample_count
+  };
+  hasher.Add(quadrature_parameters, sizeof(quadrature_parameters));
+  hasher.Add(&num_scattering_orders, sizeof(num_scattering_orders));
+  if (convergence_tolerance > 0.0) {
+    hasher.Add(convergence_tolerance);
+  }
+  // The transmittance is always computed with the full resolution.
+  for (const TextureResolution& order_resolution :
+       scattering_order_resolutions) {
+    const int order_sizes[] = {
+      order_resolution.scattering_r_size, order_resolution.scattering_mu_size,
+      order_resolution.scattering_mu_s_size,
+      order_resolution.scattering_nu_size, order_resolution.irradiance_width,
+      order_resolution.irradiance_height
+    };
+    hasher.Add(order_sizes, sizeof(order_sizes));
+  }
+  if (fast_functions) {
+    const char kFastFunctions[] = "fast_functions";
+    hasher.Add(kFastFunctions, sizeof(kFastFunctions));
+  }
+  if (multiple_scattering_lut) {
+    const int lut_parameters[] = {
+      MULTIPLE_SCATTERING_LUT_WIDTH, MULTIPLE_SCATTERING_LUT_HEIGHT,
+      MULTIPLE_SCATTERING_LUT_DIRECTION_COUNT,
+      MULTIPLE_SCATTERING_LUT_SAMPLE_COUNT
+    };
+    hasher.Add(lut_parameters, sizeof(lut_parameters));
+  }
+  return hasher.hash();
+}
+
+uint64_t HashStageParameters(const AtmosphereParameters& atmosphere,
+    PrecomputeStage stage, bool fast_functions) {
+  Hasher hasher;
+  const int stage_id = stage;
+  hasher.Add(&stage_id, sizeof(stage_id));
+  if (fast_functions) {
+    const char kFastFunctions[] = "fast_functions";
+    hasher.Add(kFastFunctions, sizeof(kFastFunctions));
+  }
+  const TextureResolution& resolution = atmosphere.texture_resolution;
+  const Quadrature& quadrature = atmosphere.quadrature;
+  hasher.Add(atmosphere.bottom_radius.to(m));
+  hasher.Add(atmosphere.top_radius.to(m));
+  hasher.Add(atmosphere.rayleigh_density);
+  hasher.AddSpectrum(atmosphere.rayleigh_scattering);
+  hasher.Add(atmosphere.mie_density);
+  hasher.AddSpectrum(atmosphere.mie_extinction);
+  hasher.Add(atmosphere.absorption_density);
+  hasher.AddSpectrum(atmosphere.absorption_extinction);
+  const int transmittance_parameters[] = {
+    resolution.transmittance_width, resolution.transmittance_height,
+    quadrature.rule, quadrature.transmittance_sample_count
+  };
+  hasher.Add(transmittance_parameters, sizeof(transmittance_parameters));
+  if (stage == DIRECT_IRRADIANCE_STAGE) {
+    hasher.AddSpectrum(atmosphere.solar_irradiance);
+    hasher.Add(atmosphere.sun_angular_radius.to(rad));
+    const int irradiance_parameters[] = {
+      resolution.irradiance_width, resolution.irradiance_height
+    };
+    hasher.Add(irradiance_parameters, sizeof(irradiance_parameters));
+  } else if (stage == SINGLE_SCATTERING_STAGE) {
+    hasher.AddSpectrum(atmosphere.solar_irradiance);
+    hasher.AddSpectrum(atmosphere.mie_scattering);
+    hasher.Add(atmosphere.mu_s_min());
+    const int scattering_parameters[] = {
+      resolution.scattering_r_size, resolution.scattering_mu_size,
+      resolution.scattering_mu_s_size, resolution.scattering_nu_size,
+      quadrature.single_scattering_sample_count
+    };
+    hasher.Add(scattering_parameters, sizeof(scattering_parameters));
+  }
+  return hasher.hash();
+}
+
+MappedFile::MappedFile(const std::string& filename)
+    : data_(nullptr), size_(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(data);
+      size_ = file_stat.st_size;
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+TextureCache::TextureCache(const std::string& directory,
+    uint64_t parameters_hash, const TextureCacheFormat& format)
+    : directory_(directory), parameters_hash_(parameters_hash),
+      format_(format) {}
+
+bool TextureCache::Read(const std::string& name, unsigned int width,
+    unsigned int height, unsigned int depth, unsigned int num_values,
+    const TexelReader& reader) const {
+  MappedFile file(directory_ + name);
+  if (file.data() == nullptr || file.size() < sizeof(Header)) {
+    return false;
+  }
+  const Header expected_header = MakeHeader(
+      width, height, depth, num_values, parameters_hash_, format_);
+  const unsigned int num_stored_values =
+      __builtin_popcountll(expected_header.wavelengths_mask);
+  const size_t expected_size = sizeof(Header) + size_t(width) * height *
+      depth * num_stored_values * expected_header.precision;
+  if (std::memcmp(file.data(), &expected_header, sizeof(Header)) != 0 ||
+      file.size() != expected_size) {
+    return false;
+  }
+  const char* data = file.data() + sizeof(Header);
+  std::vector<double> values(num_values, 0.0);
+  for (unsigned int k = 0; k < depth; ++k) {
+    for (unsigned int j = 0; j < height; ++j) {
+      for (unsigned int i = 0; i < width; ++i) {
+        if (format_.precision == FLOAT64 && num_stored_values == num_values) {
+          reader(i, j, k, reinterpret_cast<const double*>(data));
+          data += sizeof(double) * num_values;
+          continue;
+        }
+        for (unsigned int l = 0; l < num_values; ++l) {
+          if ((expected_header.wavelengths_mask & (uint64_t(1) << l)) == 0) {
+            continue;
+          }
+          if (format_.precision == FLOAT64) {
+            std::memcpy(&values[l], data, sizeof(double));
+          } else if (format_.precision == FLOAT32) {
+            float value;
+            std::memcpy(&value, data, sizeof(float));
+            values[l] = value;
+          } else {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(uint16_t));
+            values[l] = HalfToDouble(value);
+          }
+          data += expected_header.precision;
+        }
+        reader(i, j, k, values.data());
+      }
+    }
+  }
+  return true;
+}
+
+void TextureCache::Write(const std::string& name, unsigned int width,
+    unsigned int height, unsigned int depth, unsigned int num_values,
+    const TexelWriter& writer) const {
+  const std::string filename = directory_ + name;
+  const std::string temp_filename = filename + "." +
+      std::to_string(getpid()) + "." + std::to_string(num_written_files++) +
+      ".tmp";
+  std::ofstream file(temp_filename, std::ofstream::binary);
+  const Header header = MakeHeader(
+      width, height, depth, num_values, parameters_hash_, format_);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  std::vector<double> values(num_values);
+  std::vector<char> texel(num_values * header.precision);
+  for (unsigned int k = 0; k < depth; ++k) {
+    for (unsigned int j = 0; j < height; ++j) {
+      for (unsigned int i = 0; i < width; ++i) {
+        writer(i, j, k, values.data());
+        char* data = texel.data();
+        for (unsigned int l = 0; l < num_values; ++l) {
+          if ((header.wavelengths_mask & (uint64_t(1) << l)) == 0) {
+            continue;
+          }
+          if (format_.precision == FLOAT64) {
+            std::memcpy(data, &values[l], sizeof(double));
+          } else if (format_.precision == FLOAT32) {
+            const float value = static_cast<float>(values[l]);
+            std::memcpy(data, &value, sizeof(float));
+          } else {
+            const uint16_t value = DoubleToHalf(values[l]);
+            std::memcpy(data, &value, sizeof(uint16_t));
+          }
+          data += header.precision;
+        }
+        file.write(texel.data(), data - texel.data());
+      }
+    }
+  }
+  file.close();
+  if (file.good()) {
+    std::rename(temp_filename.c_str(), filename.c_str());
+  } else {
+    std::remove(temp_filename.c_str());
+  }
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,250 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texture_cache.h</h2>
+
+<p>This file defines the on-disk cache used by the <a href="model.h.html">CPU
+model</a> to store its precomputed textures. Each texture is stored in its own
+file, made of a header followed by the texel values. The header contains:
+<ul>
+<li>a magic string and a format version number,</li>
+<li>the precision of the stored values (8, 4 or 2 bytes per value, for double,
+single or half precision floating point values),</li>
+<li>the texture width, height and depth, and the number of values per texel,
+</li>
+<li>a hash of the parameters used to compute the textures (the atmosphere
+parameters and the number of scattering orders),</li>
+<li>a bit mask of the wavelengths which are stored in the file.</li>
+</ul>
+The texel values follow the header, in the same order as in memory, and are
+stored as multiples of the <code>Unit()</code> of their physical type. For each
+texel, only the values for the wavelengths in the bit mask are stored, in
+increasing wavelength order.
+
+<p>By default all the values are stored in double precision. A more compact
+format, with a lower precision and/or only the wavelengths needed for rendering
+(e.g. RGB), can be selected with a <code>TextureCacheFormat</code>. The
+wavelengths which are not stored are set to 0 when a cache file is loaded.
+
+<p>A cache file is used only if its header matches the current parameters and
+format, so that changing them cannot silently load stale data. Cache files are
+read with <code>mmap</code>, which avoids any intermediate buffer, and lets
+concurrent processes share the same copy of the file in the operating system
+page cache. They are written to a temporary file, unique to each write, which
+is then renamed, so that a process never sees a partially written cache file
+(even if several threads or processes write the same cache file at the same
+time).
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_TEXTURE_CACHE_H_
+#define ATMOSPHERE_REFERENCE_TEXTURE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "atmosphere/reference/definitions.h"
+
+namespace atmosphere {
+namespace reference {
+
+// The version of the cache file format. It must be incremented each time the
+// format, or the way the textures are computed, changes.
+constexpr uint32_t kTextureCacheVersion = 3;
+
+enum TexturePrecision {
+  FLOAT64,
+  FLOAT32,
+  FLOAT16
+};
+
+struct TextureCacheFormat {
+  TextureCacheFormat() : precision(FLOAT64) {}
+  explicit TextureCacheFormat(TexturePrecision precision,
+      const std::vector<int>& wavelengths = std::vector<int>())
+      : precision(precision), wavelengths(wavelengths) {}
+  TexturePrecision precision;
+  // The indices of the stored wavelengths (see Model::GetWavelengthIndex), or
+  // an empty vector to store all the wavelengths.
+  std::vector<int> wavelengths;
+};
+
+// Returns a hash of all the parameters which are needed to precompute the
+// textures of the CPU model. The convergence tolerance is only taken into
+// account if it is positive (see Model::Init). The 4th argument contains the
+// resolutions used to compute each scattering order, from the 2nd one, if
+// some of them differ from the resolution of the atmosphere parameters (see
+// Model::set_scattering_order_resolutions), or is empty otherwise. The 5th
+// argument is true if the textures are computed with the float functions (see
+// Model::set_use_fast_functions), whose results differ slightly from the
+// double ones. The last argument is true if the scattering orders from the 2nd
+// one are approximated with the multiple scattering LUT (see
+// Model::set_use_multiple_scattering_lut).
+uint64_t HashModelParameters(const AtmosphereParameters& atmosphere,
+    unsigned int num_scattering_orders, double convergence_tolerance = 0.0,
+    const std::vector<TextureResolution>& scattering_order_resolutions =
+        std::vector<TextureResolution>(),
+    bool fast_functions = false, bool multiple_scattering_lut = false);
+
+// The precomputation stages whose results only depend on a subset of the
+// atmosphere parameters, and can thus be shared between models (see
+// stage_cache.h). The single scattering stage computes both the Rayleigh and
+// the Mie single scattering.
+enum PrecomputeStage {
+  TRANSMITTANCE_STAGE,
+  DIRECT_IRRADIANCE_STAGE,
+  SINGLE_SCATTERING_STAGE
+};
+
+// Returns a hash of the parameters which are needed to compute the given stage
+// (including the parameters of the transmittance, which is an input of the
+// other stages). In particular, none of these hashes depends on the ground
+// albedo or on the Mie phase function. The last argument is true if the stage
+// is computed with the float functions (see Model::set_use_fast_functions).
+uint64_t HashStageParameters(const AtmosphereParameters& atmosphere,
+    PrecomputeStage stage, bool fast_functions = false);
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  // If the file can't be opened or mapped, data() returns nullptr.
+  explicit MappedFile(const std::string& filename);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+class TextureCache {
+ public:
+  TextureCache(const std::string& directory, uint64_t parameters_hash,
+      const TextureCacheFormat& format = TextureCacheFormat());
+
+  // Loads the texture stored in the given file of the cache directory. Returns
+  // false, and leaves the texture unchanged, if the file does not exist, or if
+  // its header does not match the texture, the parameters hash or the format.
+  template<class T>
+  bool Load(const std::string& name, Texture2d<T>* texture) const {
+    return Read(name, texture->size_x(), texture->size_y(), 1, T().size(),
+        [&](int i, int j, int k, const double* values) {
+      texture->Set(i, j, ToSpectrum<T>(values));
+    });
+  }
+
+  template<class T>
+  bool Load(const std::string& name, Texture3d<T>* texture) const {
+    return Read(name, texture->size_x(), texture->size_y(), texture->size_z(),
+        T().size(), [&](int i, int j, int k, const double* values) {
+      texture->Set(i, j, k, ToSpectrum<T>(values));
+    });
+  }
+
+  // Loads a single value, saved with the following method.
+  bool Load(const std::string& name, double* value) const {
+    return Read(name, 1, 1, 1, 1, [&](int i, int j, int k,
+        const double* values) {
+      *value = values[0];
+    });
+  }
+
+  // Saves a single value (e.g. a number of scattering orders). Note that with
+  // a compact format, the value is saved with a lower precision.
+  void Save(const std::string& name, double value) const {
+    Write(name, 1, 1, 1, 1, [&](int i, int j, int k, double* values) {
+      values[0] = value;
+    });
+  }
+
+  // Saves the given texture in the given file of the cache directory.
+  template<class T>
+  void Save(const std::string& name, const Texture2d<T>& texture) const {
+    Write(name, texture.size_x(), texture.size_y(), 1, T().size(),
+        [&](int i, int j, int k, double* values) {
+      FromSpectrum(texture.Get(i, j), values);
+    });
+  }
+
+  template<class T>
+  void Save(const std::string& name, const Texture3d<T>& texture) const {
+    Write(name, texture.size_x(), texture.size_y(), texture.size_z(),
+        T().size(), [&](int i, int j, int k, double* values) {
+      FromSpectrum(texture.Get(i, j, k), values);
+    });
+  }
+
+ private:
+  typedef std::function<void(int, int, int, const double*)> TexelReader;
+  typedef std::function<void(int, int, int, double*)> TexelWriter;
+
+  template<class T>
+  using ValueType =
+      typename std::decay<decltype(std::declval<T>()[0])>::type;
+
+  template<class T>
+  static T ToSpectrum(const double* values) {
+    T spectrum;
+    for (unsigned int l = 0; l < spectrum.size(); ++l) {
+      spectrum[l] = values[l] * ValueType<T>::Unit();
+    }
+    return spectrum;
+  }
+
+  template<class T>
+  static void FromSpectrum(const T& spectrum, double* values) {
+    for (unsigned int l = 0; l < spectrum.size(); ++l) {
+      values[l] = spectrum[l].to(ValueType<T>::Unit());
+    }
+  }
+
+  bool Read(const std::string& name, unsigned int width, unsigned int height,
+      unsigned int depth, unsigned int num_values,
+      const TexelReader& reader) const;
+  void Write(const std::string& name, unsigned int width,
+      unsigned int height, unsigned int depth, unsigned int num_values,
+      const TexelWriter& writer) const;
+
+  const std::string directory_;
+  const uint64_t parameters_hash_;
+  const TextureCacheFormat format_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_TEXTURE_CACHE_H_
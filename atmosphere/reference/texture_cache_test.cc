@@ -0,0 +1,353 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/texture_cache_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="texture_cache.h.html">cache
+</a> of precomputed textures of the CPU model. They check that textures are
+loaded exactly as they were saved (or with the expected precision, with the
+compact formats), and that a cache file is not used if the texture size, the
+model parameters or the format have changed.
+*/
+
+#include "atmosphere/reference/texture_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+namespace {
+
+// The Makefile runs the tests from the root directory, and puts the test
+// binary in this directory.
+const char kCacheDirectory[] = "output/Debug/";
+
+class TestTexture2d : public Texture2d<IrradianceSpectrum> {
+ public:
+  TestTexture2d() : Texture2d(5, 3) {}
+};
+
+class TestTexture3d : public Texture3d<DimensionlessSpectrum> {
+ public:
+  TestTexture3d() : Texture3d(4, 3, 2) {}
+};
+
+}  // anonymous namespace
+
+class TextureCacheTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TextureCacheTest(const std::string& name, T test)
+      : TestCase("TextureCacheTest " + name, static_cast<Test>(test)) {}
+
+  void TestSaveAndLoad() {
+    TestTexture2d texture_2d;
+    TestTexture3d texture_3d;
+    InitTestTextures(&texture_2d, &texture_3d);
+    const TextureCache cache(kCacheDirectory, 123);
+    cache.Save("texture_cache_test_2d.dat", texture_2d);
+    cache.Save("texture_cache_test_3d.dat", texture_3d);
+
+    TestTexture2d loaded_texture_2d;
+    TestTexture3d loaded_texture_3d;
+    ExpectTrue(cache.Load("texture_cache_test_2d.dat", &loaded_texture_2d));
+    ExpectTrue(cache.Load("texture_cache_test_3d.dat", &loaded_texture_3d));
+    for (unsigned int j = 0; j < texture_2d.size_y(); ++j) {
+      for (unsigned int i = 0; i < texture_2d.size_x(); ++i) {
+        for (int l = 0; l < kNumWavelengths; ++l) {
+          ExpectEquals(
+              texture_2d.Get(i, j)[l].to(watt_per_square_meter_per_nm),
+              loaded_texture_2d.Get(i, j)[l].to(watt_per_square_meter_per_nm));
+        }
+      }
+    }
+    for (unsigned int k = 0; k < texture_3d.size_z(); ++k) {
+      for (unsigned int j = 0; j < texture_3d.size_y(); ++j) {
+        for (unsigned int i = 0; i < texture_3d.size_x(); ++i) {
+          for (int l = 0; l < kNumWavelengths; ++l) {
+            ExpectEquals(texture_3d.Get(i, j, k)[l](),
+                loaded_texture_3d.Get(i, j, k)[l]());
+          }
+        }
+      }
+    }
+
+    double value = 0.0;
+    cache.Save("texture_cache_test_value.dat", 6.0);
+    ExpectTrue(cache.Load("texture_cache_test_value.dat", &value));
+    ExpectEquals(6.0, value);
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_2d.dat").c_str());
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_3d.dat").c_str());
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_value.dat").c_str());
+  }
+
+  void TestCompactFormats() {
+    // The relative precision of single and half precision values is 2^-24 and
+    // 2^-11, respectively (with round to nearest).
+    ExpectRoundTrip(TextureCacheFormat(FLOAT64), 0.0);
+    ExpectRoundTrip(TextureCacheFormat(FLOAT32), std::ldexp(1.0, -24));
+    ExpectRoundTrip(TextureCacheFormat(FLOAT16), std::ldexp(1.0, -11));
+  }
+
+  void TestWavelengthSubset() {
+    const std::vector<int> wavelengths = GetRgbWavelengths();
+    TestTexture2d texture_2d;
+    TestTexture3d texture_3d;
+    InitTestTextures(&texture_2d, &texture_3d);
+    const TextureCache cache(
+        kCacheDirectory, 123, TextureCacheFormat(FLOAT32, wavelengths));
+    cache.Save("texture_cache_test_3d.dat", texture_3d);
+
+    TestTexture3d loaded_texture_3d;
+    ExpectTrue(cache.Load("texture_cache_test_3d.dat", &loaded_texture_3d));
+    for (unsigned int k = 0; k < texture_3d.size_z(); ++k) {
+      for (unsigned int j = 0; j < texture_3d.size_y(); ++j) {
+        for (unsigned int i = 0; i < texture_3d.size_x(); ++i) {
+          for (int l = 0; l < kNumWavelengths; ++l) {
+            const double value = loaded_texture_3d.Get(i, j, k)[l]();
+            if (std::find(wavelengths.begin(), wavelengths.end(), l) !=
+                wavelengths.end()) {
+              const double expected = texture_3d.Get(i, j, k)[l]();
+              ExpectNear(expected, value, expected * std::ldexp(1.0, -24));
+            } else {
+              ExpectEquals(0.0, value);
+            }
+          }
+        }
+      }
+    }
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_3d.dat").c_str());
+  }
+
+  void TestStaleCacheNotLoaded() {
+    TestTexture2d texture_2d;
+    TestTexture3d texture_3d;
+    InitTestTextures(&texture_2d, &texture_3d);
+    TextureCache(kCacheDirectory, 123).Save(
+        "texture_cache_test_2d.dat", texture_2d);
+
+    // Different parameters.
+    TestTexture2d loaded_texture_2d;
+    ExpectFalse(TextureCache(kCacheDirectory, 456).Load(
+        "texture_cache_test_2d.dat", &loaded_texture_2d));
+    // Different texture size.
+    Texture2d<IrradianceSpectrum> transposed_texture(3, 5);
+    ExpectFalse(TextureCache(kCacheDirectory, 123).Load(
+        "texture_cache_test_2d.dat", &transposed_texture));
+    // Different format.
+    ExpectFalse(TextureCache(kCacheDirectory, 123, TextureCacheFormat(FLOAT32))
+        .Load("texture_cache_test_2d.dat", &loaded_texture_2d));
+    ExpectFalse(TextureCache(kCacheDirectory, 123,
+        TextureCacheFormat(FLOAT64, {0})).Load(
+            "texture_cache_test_2d.dat", &loaded_texture_2d));
+    // Missing file.
+    ExpectFalse(TextureCache(kCacheDirectory, 123).Load(
+        "texture_cache_test_3d.dat", &texture_3d));
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_2d.dat").c_str());
+  }
+
+  void TestHashModelParameters() {
+    AtmosphereParameters atmosphere;
+    atmosphere.bottom_radius = 6360.0 * km;
+    atmosphere.top_radius = 6420.0 * km;
+    const uint64_t hash = HashModelParameters(atmosphere, 4);
+    ExpectTrue(hash == HashModelParameters(atmosphere, 4));
+    ExpectFalse(hash == HashModelParameters(atmosphere, 5));
+    ExpectTrue(hash == HashModelParameters(atmosphere, 4, 0.0));
+    ExpectFalse(hash == HashModelParameters(atmosphere, 4, 1e-3));
+    ExpectFalse(HashModelParameters(atmosphere, 4, 1e-3) ==
+        HashModelParameters(atmosphere, 4, 1e-4));
+    TextureResolution coarse_resolution;
+    coarse_resolution.scattering_mu_s_size /= 2;
+    const uint64_t mixed_hash = HashModelParameters(atmosphere, 4, 0.0,
+        {atmosphere.texture_resolution, coarse_resolution, coarse_resolution});
+    ExpectFalse(hash == mixed_hash);
+    coarse_resolution.scattering_nu_size /= 2;
+    ExpectFalse(mixed_hash == HashModelParameters(atmosphere, 4, 0.0,
+        {atmosphere.texture_resolution, coarse_resolution, coarse_resolution}));
+    ExpectFalse(HashModelParameters(atmosphere, 2) ==
+        HashModelParameters(atmosphere, 2, 0.0, {}, true));
+    ExpectFalse(HashModelParameters(atmosphere, 2) ==
+        HashModelParameters(atmosphere, 2, 0.0, {}, false, true));
+    ExpectFalse(HashModelParameters(atmosphere, 2, 0.0, {}, true) ==
+        HashModelParameters(atmosphere, 2, 0.0, {}, false, true));
+    atmosphere.ground_albedo[kNumWavelengths / 2] = 0.1;
+    ExpectFalse(hash == HashModelParameters(atmosphere, 4));
+    atmosphere.ground_albedo[kNumWavelengths / 2] = 0.0;
+    atmosphere.mie_density.layers[1].exp_scale = -1.0 / (1.2 * km);
+    ExpectFalse(hash == HashModelParameters(atmosphere, 4));
+  }
+
+  void TestHashStageParameters() {
+    const PrecomputeStage stages[] = {
+      TRANSMITTANCE_STAGE, DIRECT_IRRADIANCE_STAGE, SINGLE_SCATTERING_STAGE
+    };
+    AtmosphereParameters atmosphere;
+    atmosphere.bottom_radius = 6360.0 * km;
+    atmosphere.top_radius = 6420.0 * km;
+    AtmosphereParameters other_atmosphere = atmosphere;
+    other_atmosphere.ground_albedo[kNumWavelengths / 2] = 0.1;
+    other_atmosphere.mie_phase_function_g = 0.7;
+    for (PrecomputeStage stage : stages) {
+      ExpectTrue(HashStageParameters(atmosphere, stage) ==
+          HashStageParameters(other_atmosphere, stage));
+    }
+    ExpectFalse(HashStageParameters(atmosphere, TRANSMITTANCE_STAGE) ==
+        HashStageParameters(atmosphere, DIRECT_IRRADIANCE_STAGE));
+    for (PrecomputeStage stage : stages) {
+      ExpectFalse(HashStageParameters(atmosphere, stage) ==
+          HashStageParameters(atmosphere, stage, true));
+    }
+
+    other_atmosphere.solar_irradiance[kNumWavelengths / 2] =
+        1.0 * watt_per_square_meter_per_nm;
+    ExpectTrue(HashStageParameters(atmosphere, TRANSMITTANCE_STAGE) ==
+        HashStageParameters(other_atmosphere, TRANSMITTANCE_STAGE));
+    ExpectFalse(HashStageParameters(atmosphere, DIRECT_IRRADIANCE_STAGE) ==
+        HashStageParameters(other_atmosphere, DIRECT_IRRADIANCE_STAGE));
+    ExpectFalse(HashStageParameters(atmosphere, SINGLE_SCATTERING_STAGE) ==
+        HashStageParameters(other_atmosphere, SINGLE_SCATTERING_STAGE));
+
+    other_atmosphere = atmosphere;
+    other_atmosphere.absorption_extinction[kNumWavelengths / 2] = 1e-6 / m;
+    for (PrecomputeStage stage : stages) {
+      ExpectFalse(HashStageParameters(atmosphere, stage) ==
+          HashStageParameters(other_atmosphere, stage));
+    }
+  }
+
+ private:
+  static std::vector<int> GetRgbWavelengths() {
+    return {GetNearestWavelengthIndex(440.0), GetNearestWavelengthIndex(550.0),
+        GetNearestWavelengthIndex(680.0)};
+  }
+
+  void ExpectRoundTrip(const TextureCacheFormat& format,
+      double relative_tolerance) {
+    TestTexture2d texture_2d;
+    TestTexture3d texture_3d;
+    InitTestTextures(&texture_2d, &texture_3d);
+    const TextureCache cache(kCacheDirectory, 123, format);
+    cache.Save("texture_cache_test_2d.dat", texture_2d);
+    cache.Save("texture_cache_test_3d.dat", texture_3d);
+
+    TestTexture2d loaded_texture_2d;
+    TestTexture3d loaded_texture_3d;
+    ExpectTrue(cache.Load("texture_cache_test_2d.dat", &loaded_texture_2d));
+    ExpectTrue(cache.Load("texture_cache_test_3d.dat", &loaded_texture_3d));
+    for (unsigned int j = 0; j < texture_2d.size_y(); ++j) {
+      for (unsigned int i = 0; i < texture_2d.size_x(); ++i) {
+        for (int l = 0; l < kNumWavelengths; ++l) {
+          const double expected =
+              texture_2d.Get(i, j)[l].to(watt_per_square_meter_per_nm);
+          ExpectNear(expected,
+              loaded_texture_2d.Get(i, j)[l].to(watt_per_square_meter_per_nm),
+              expected * relative_tolerance);
+        }
+      }
+    }
+    for (unsigned int k = 0; k < texture_3d.size_z(); ++k) {
+      for (unsigned int j = 0; j < texture_3d.size_y(); ++j) {
+        for (unsigned int i = 0; i < texture_3d.size_x(); ++i) {
+          for (int l = 0; l < kNumWavelengths; ++l) {
+            const double expected = texture_3d.Get(i, j, k)[l]();
+            ExpectNear(expected, loaded_texture_3d.Get(i, j, k)[l](),
+                expected * relative_tolerance);
+          }
+        }
+      }
+    }
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_2d.dat").c_str());
+    std::remove((std::string(kCacheDirectory) +
+        "texture_cache_test_3d.dat").c_str());
+  }
+
+  void InitTestTextures(TestTexture2d* texture_2d, TestTexture3d* texture_3d) {
+    for (unsigned int k = 0; k < texture_3d->size_z(); ++k) {
+      for (unsigned int j = 0; j < texture_3d->size_y(); ++j) {
+        for (unsigned int i = 0; i < texture_3d->size_x(); ++i) {
+          DimensionlessSpectrum spectrum;
+          for (unsigned int l = 0; l < spectrum.size(); ++l) {
+            spectrum[l] = 1.0 / (1.0 + i + 10.0 * j + 100.0 * k + l);
+          }
+          texture_3d->Set(i, j, k, spectrum);
+        }
+      }
+    }
+    for (unsigned int j = 0; j < texture_2d->size_y(); ++j) {
+      for (unsigned int i = 0; i < texture_2d->size_x(); ++i) {
+        IrradianceSpectrum spectrum;
+        for (unsigned int l = 0; l < spectrum.size(); ++l) {
+          spectrum[l] =
+              (i + 0.1 * j + 0.001 * l) * watt_per_square_meter_per_nm;
+        }
+        texture_2d->Set(i, j, spectrum);
+      }
+    }
+  }
+};
+
+namespace {
+
+TextureCacheTest save_and_load(
+    "SaveAndLoad",
+    &TextureCacheTest::TestSaveAndLoad);
+TextureCacheTest compact_formats(
+    "CompactFormats",
+    &TextureCacheTest::TestCompactFormats);
+TextureCacheTest wavelength_subset(
+    "WavelengthSubset",
+    &TextureCacheTest::TestWavelengthSubset);
+TextureCacheTest stale_cache_not_loaded(
+    "StaleCacheNotLoaded",
+    &TextureCacheTest::TestStaleCacheNotLoaded);
+TextureCacheTest hash_model_parameters(
+    "HashModelParameters",
+    &TextureCacheTest::TestHashModelParameters);
+TextureCacheTest hash_stage_parameters(
+    "HashStageParameters",
+    &TextureCacheTest::TestHashStageParameters);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/thread_pool.cc</h2>
+
+<p>This file implements the thread pool defined in
+<a href="thread_pool.h.html">thread_pool.h</a>. The tasks of the scheduler are
+coarse grained (each task processes many tiles), so that a single mutex,
+protecting the list of pending batches, is sufficient.
+*/
+
+#include "atmosphere/reference/thread_pool.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+
+namespace atmosphere {
+namespace reference {
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options)
+    : name_(options.name), stopping_(false) {
+  unsigned int num_threads = options.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i + 1 < num_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::RunWorker, this, i, options);
+  }
+  startup_time_ = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::GetDefault() {
+  static std::shared_ptr<ThreadPool> default_pool =
+      std::make_shared<ThreadPool>();
+  return default_pool;
+}
+
+void ThreadPool::Run(unsigned int num_tasks,
+    const std::function<void(unsigned int)>& task) {
+  if (num_tasks == 0) {
+    return;
+  }
+  Batch batch(task, num_tasks);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (num_tasks > 1 && !threads_.empty()) {
+    pending_batches_.push_back(&batch);
+    work_available_.notify_all();
+  }
+  // Execute the tasks of this batch which are not taken by the worker threads,
+  // then wait until those taken by the worker threads are finished.
+  while (batch.next_task < num_tasks) {
+    unsigned int index = TakeTask(&batch);
+    lock.unlock();
+    task(index);
+    lock.lock();
+    ++batch.num_finished_tasks;
+  }
+  batch.finished.wait(lock, [&batch]() {
+    return batch.num_finished_tasks == batch.num_tasks;
+  });
+}
+
+unsigned int ThreadPool::TakeTask(Batch* batch) {
+  unsigned int index = batch->next_task++;
+  if (batch->next_task == batch->num_tasks) {
+    auto it = std::find(pending_batches_.begin(), pending_batches_.end(),
+        batch);
+    if (it != pending_batches_.end()) {
+      pending_batches_.erase(it);
+    }
+  }
+  return index;
+}
+
+void ThreadPool::RunWorker(unsigned int index,
+    const ThreadPoolOptions& options) {
+#if defined(__linux__)
+  // Thread names are limited to 16 characters, including the final '\0'.
+  const std::string name =
+      (options.name + "/" + std::to_string(index)).substr(0, 15);
+  pthread_setname_np(pthread_self(), name.c_str());
+  if (!options.cpu_affinity.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(options.cpu_affinity[index % options.cpu_affinity.size()],
+        &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  }
+#endif
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_available_.wait(lock, [this]() {
+      return stopping_ || !pending_batches_.empty();
+    });
+    if (pending_batches_.empty()) {
+      return;
+    }
+    Batch* batch = pending_batches_.front();
+    unsigned int task_index = TakeTask(batch);
+    lock.unlock();
+    batch->task(task_index);
+    lock.lock();
+    // The batch is destroyed as soon as Run returns, so we must notify its
+    // caller before releasing the lock.
+    if (++batch->num_finished_tasks == batch->num_tasks) {
+      batch->finished.notify_all();
+    }
+  }
+}
+
+}  // namespace reference
+}  // namespace atmosphere
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/thread_pool.h</h2>
+
+<p>This file defines a persistent pool of worker threads, used by the
+<a href="scheduler.h.html">tile scheduler</a> of the <a href="model.h.html">CPU
+model</a>. Creating threads for each precomputation phase, and for each batch of
+queries, has a significant cost for small textures and small batches. Instead,
+the worker threads of a pool are created once, and are then reused by all the
+phases and all the queries. A pool can also be shared between several models
+(by default, all the models share a single pool with one thread per hardware
+thread).
+
+<p>A pool can be used concurrently by several threads (e.g. to precompute
+several models in parallel). The thread calling <code>Run</code> executes tasks
+too, so that a pool of N threads has N - 1 worker threads, and so that
+<code>Run</code> can be called from a task without any risk of deadlock.
+*/
+
+#ifndef ATMOSPHERE_REFERENCE_THREAD_POOL_H_
+#define ATMOSPHERE_REFERENCE_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace atmosphere {
+namespace reference {
+
+struct ThreadPoolOptions {
+  ThreadPoolOptions() : num_threads(0), name("atmosphere") {}
+  explicit ThreadPoolOptions(unsigned int num_threads)
+      : num_threads(num_threads), name("atmosphere") {}
+  // The total number of threads, including the thread calling Run. A value of
+  // 0 means one thread per hardware thread.
+  unsigned int num_threads;
+  // The worker threads are named "<name>/<index>" (on Linux, this name is
+  // truncated to 15 characters).
+  std::string name;
+  // If not empty, the i-th worker thread only runs on the CPU cpu_affinity[i %
+  // cpu_affinity.size()] (on Linux only, ignored on other platforms).
+  std::vector<int> cpu_affinity;
+};
+
+class ThreadPool {
+ public:
+  explicit ThreadPool(const ThreadPoolOptions& options = ThreadPoolOptions());
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  // Returns the pool shared by default by all the models, with one thread per
+  // hardware thread. This pool is created on first use.
+  static std::shared_ptr<ThreadPool> GetDefault();
+
+  unsigned int num_threads() const { return threads_.size() + 1; }
+  const std::string& name() const { return name_; }
+  // The time needed to start the worker threads, in seconds.
+  double startup_time() const { return startup_time_; }
+
+  // Calls 'task' once for each index in [0, num_tasks), in parallel on the
+  // worker threads and on the calling thread, and returns when all the calls
+  // have returned.
+  void Run(unsigned int num_tasks,
+      const std::function<void(unsigned int)>& task);
+
+ private:
+  // A call to Run, whose tasks are not all finished.
+  struct Batch {
+    Batch(const std::function<void(unsigned int)>& task,
+        unsigned int num_tasks)
+        : task(task), num_tasks(num_tasks), next_task(0),
+          num_finished_tasks(0) {}
+    const std::function<void(unsigned int)>& task;
+    const unsigned int num_tasks;
+    unsigned int next_task;
+    unsigned int num_finished_tasks;
+    std::condition_variable finished;
+  };
+
+  void RunWorker(unsigned int index, const ThreadPoolOptions& options);
+  // Returns the index of the next task of 'batch', and removes it from the
+  // pending batches if this is its last task. Must be called with mutex_
+  // locked.
+  unsigned int TakeTask(Batch* batch);
+
+  const std::string name_;
+  double startup_time_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  // The batches with tasks which are not yet started, in FIFO order.
+  std::deque<Batch*> pending_batches_;
+  bool stopping_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace reference
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_REFERENCE_THREAD_POOL_H_
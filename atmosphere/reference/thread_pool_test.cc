@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/reference/thread_pool_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="thread_pool.h.html">thread
+pool</a> used by the tile scheduler of the CPU model. They check that each task
+is run exactly once, including when a pool is used concurrently by several
+threads, or recursively from one of its tasks.
+*/
+
+#include "atmosphere/reference/thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+namespace reference {
+
+class ThreadPoolTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  ThreadPoolTest(const std::string& name, T test)
+      : TestCase("ThreadPoolTest " + name, static_cast<Test>(test)) {}
+
+  void TestEachTaskRunOnce() {
+    for (unsigned int num_threads : {1, 2, 8}) {
+      ThreadPool thread_pool{ThreadPoolOptions(num_threads)};
+      ExpectEquals(num_threads, thread_pool.num_threads());
+      // The same pool is reused for several calls.
+      for (unsigned int num_tasks : {0, 1, 3, 8, 100}) {
+        CheckEachTaskRunOnce(&thread_pool, num_tasks);
+      }
+    }
+  }
+
+  void TestConcurrentRuns() {
+    ThreadPool thread_pool{ThreadPoolOptions(4)};
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < 4; ++i) {
+      threads.emplace_back([&]() {
+        for (unsigned int j = 0; j < 50; ++j) {
+          CheckEachTaskRunOnce(&thread_pool, 7);
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  void TestNestedRuns() {
+    ThreadPool thread_pool{ThreadPoolOptions(2)};
+    std::atomic<unsigned int> num_calls(0);
+    thread_pool.Run(4, [&](unsigned int i) {
+      thread_pool.Run(4, [&](unsigned int j) { ++num_calls; });
+    });
+    ExpectEquals(16, num_calls);
+  }
+
+  void TestOptions() {
+    ThreadPoolOptions options(3);
+    options.name = "test_pool";
+    options.cpu_affinity = {0};
+    ThreadPool thread_pool(options);
+    ExpectEquals(3, thread_pool.num_threads());
+    ExpectTrue(thread_pool.name() == "test_pool");
+    ExpectTrue(thread_pool.startup_time() >= 0.0);
+    CheckEachTaskRunOnce(&thread_pool, 10);
+  }
+
+  void TestDefaultPool() {
+    std::shared_ptr<ThreadPool> thread_pool = ThreadPool::GetDefault();
+    ExpectTrue(thread_pool != nullptr);
+    ExpectTrue(thread_pool == ThreadPool::GetDefault());
+    ExpectTrue(thread_pool->num_threads() >= 1);
+  }
+
+ private:
+  void CheckEachTaskRunOnce(ThreadPool* thread_pool, unsigned int num_tasks) {
+    std::unique_ptr<std::atomic<unsigned int>[]> count(
+        new std::atomic<unsigned int>[num_tasks]);
+    for (unsigned int i = 0; i < num_tasks; ++i) {
+      count[i] = 0;
+    }
+    thread_pool->Run(num_tasks, [&](unsigned int i) { ++count[i]; });
+    for (unsigned int i = 0; i < num_tasks; ++i) {
+      ExpectEquals(1, count[i]);
+    }
+  }
+};
+
+namespace {
+
+ThreadPoolTest each_task_run_once(
+    "EachTaskRunOnce",
+    &ThreadPoolTest::TestEachTaskRunOnce);
+ThreadPoolTest concurrent_runs(
+    "ConcurrentRuns",
+    &ThreadPoolTest::TestConcurrentRuns);
+ThreadPoolTest nested_runs(
+    "NestedRuns",
+    &ThreadPoolTest::TestNestedRuns);
+ThreadPoolTest options(
+    "Options",
+    &ThreadPoolTest::TestOptions);
+ThreadPoolTest default_pool(
+    "DefaultPool",
+    &ThreadPoolTest::TestDefaultPool);
+
+}  // anonymous namespace
+
+}  // namespace reference
+}  // namespace atmosphere
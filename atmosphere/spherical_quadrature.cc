@@ -0,0 +1,341 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/spherical_quadrature.cc</h2>
+
+<p>This file implements the spherical quadrature rules defined in
+<a href="spherical_quadrature.h.html">spherical_quadrature.h</a>.
+*/
+
+#include "atmosphere/spherical_quadrature.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace atmosphere {
+
+namespace {
+
+constexpr double kPi = 3.1415926535897932;
+// The angle between two consecutive points of a Fibonacci spiral.
+constexpr double kGoldenAngle = 2.3999632297286533;
+
+SphericalSample MakeSample(double cos_theta, double phi, double weight) {
+  double sin_theta = std::sqrt(std::max(1.0 - cos_theta * cos_theta, 0.0));
+  return {std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta,
+      weight};
+}
+
+/*
+<p>The latitude-longitude rule is the midpoint rule used in the original
+implementation, which the GLSL functions still evaluate procedurally with this
+rule. Its table is only provided for completeness (e.g. to compare it with the
+other rules). The sphere uses $s$ rows and $2s$ columns, and the hemisphere $s$
+rows and $4s$ columns, with square cells in both cases:
+*/
+
+void AddLatitudeLongitudeSamples(int sample_count, bool hemisphere,
+    std::vector<SphericalSample>* samples) {
+  const int columns_per_row = hemisphere ? 4 : 2;
+  int row_count = 1;
+  while (columns_per_row * (row_count + 1) * (row_count + 1) <= sample_count) {
+    ++row_count;
+  }
+  const int column_count = columns_per_row * row_count;
+  const double dtheta = (hemisphere ? 0.5 : 1.0) * kPi / row_count;
+  const double dphi = 2.0 * kPi / column_count;
+  for (int j = 0; j < row_count; ++j) {
+    double theta = (j + 0.5) * dtheta;
+    for (int i = 0; i < column_count; ++i) {
+      samples->push_back(MakeSample(std::cos(theta), (i + 0.5) * dphi,
+          dtheta * dphi * std::sin(theta)));
+    }
+  }
+}
+
+/*
+<p>The Fibonacci rule uses points equally spaced in $\cos\theta$, with
+successive azimuths separated by the golden angle. This gives an almost uniform
+distribution of points, without the pole clustering of the latitude-longitude
+grid:
+*/
+
+void AddFibonacciSamples(int sample_count, bool hemisphere, double weight,
+    std::vector<SphericalSample>* samples) {
+  for (int i = 0; i < sample_count; ++i) {
+    double cos_theta = hemisphere ?
+        1.0 - (i + 0.5) / sample_count :
+        1.0 - (2.0 * i + 1.0) / sample_count;
+    samples->push_back(MakeSample(cos_theta, i * kGoldenAngle, weight));
+  }
+}
+
+/*
+<p>The Lebedev rules are invariant under the octahedral rotation and reflection
+group. Each rule is thus defined by a few orbits of this group, i.e. by a
+generator point and a weight, from which all the points of the orbit are
+obtained by permuting and changing the signs of the generator coordinates. We
+use the following orbit types (following the notations of V.I. Lebedev and
+D.N. Laikov, "A quadrature formula for the sphere of the 131st algebraic order
+of accuracy", Doklady Mathematics, 1999):
+*/
+
+enum LebedevOrbitType {
+  // The 6 points (1,0,0).
+  A1,
+  // The 12 points (0,a,a), with a = 1/sqrt(2).
+  A2,
+  // The 8 points (a,a,a), with a = 1/sqrt(3).
+  A3,
+  // The 24 points (l,l,m), with m = sqrt(1 - 2l^2).
+  B,
+  // The 24 points (p,q,0), with q = sqrt(1 - p^2).
+  C
+};
+
+struct LebedevOrbit {
+  LebedevOrbitType type;
+  double parameter;
+  double weight;
+};
+
+struct LebedevRule {
+  int sample_count;
+  std::vector<LebedevOrbit> orbits;
+};
+
+/*
+<p>The orbits of the rules with 6 to 110 points (i.e. exact for the polynomials
+of degree up to 3 to 17) are then the following (the weights are normalized so
+that their sum is 1):
+*/
+
+const std::vector<LebedevRule>& GetLebedevRules() {
+  static const std::vector<LebedevRule> rules = {
+    {6, {{A1, 0.0, 0.1666666666666667}}},
+    {14, {{A1, 0.0, 0.06666666666666667}, {A3, 0.0, 0.075}}},
+    {26, {{A1, 0.0, 0.04761904761904762}, {A2, 0.0, 0.0380952380952381},
+        {A3, 0.0, 0.03214285714285714}}},
+    {38, {{A1, 0.0, 0.009523809523809524}, {A3, 0.0, 0.03214285714285714},
+        {C, 0.4597008433809831, 0.02857142857142857}}},
+    {50, {{A1, 0.0, 0.0126984126984127}, {A2, 0.0, 0.02257495590828924},
+        {A3, 0.0, 0.02109375}, {B, 0.3015113445777636, 0.02017333553791887}}},
+    {74, {{A1, 0.0, 0.0005130671797338464},
+        {A2, 0.0, 0.01660406956574204}, {A3, 0.0, -0.02958603896103896},
+        {B, 0.4803844614152614, 0.02657620708215946},
+        {C, 0.3207726489807764, 0.01652217099371571}}},
+    {86, {{A1, 0.0, 0.01154401154401154}, {A3, 0.0, 0.01194390908585628},
+        {B, 0.3696028464541502, 0.01111055571060340},
+        {B, 0.6943540066026664, 0.01187650129453714},
+        {C, 0.3742430390903412, 0.01181230374959540}}},
+    {110, {{A1, 0.0, 0.003828270494937162}, {A3, 0.0, 0.009793737512487512},
+        {B, 0.1851156353447362, 0.008211737283191111},
+        {B, 0.6904210483822922, 0.009942814891178103},
+        {B, 0.3956894730559419, 0.009595471336070963},
+        {C, 0.4783690288121502, 0.009694996361663028}}}
+  };
+  return rules;
+}
+
+/*
+<p>The points of an orbit are computed by applying the 6 permutations and 8 sign
+changes to its generator, and by removing the duplicates (e.g. the 48 images of
+(1,0,0) only contain 6 distinct points):
+*/
+
+void AddLebedevOrbitSamples(const LebedevOrbit& orbit,
+    std::vector<SphericalSample>* samples) {
+  double generator[3] = {0.0, 0.0, 0.0};
+  switch (orbit.type) {
+    case A1:
+      generator[0] = 1.0;
+      generator[1] = 0.0;
+      generator[2] = 0.0;
+      break;
+    case A2:
+      generator[0] = 0.0;
+      generator[1] = std::sqrt(0.5);
+      generator[2] = std::sqrt(0.5);
+      break;
+    case A3:
+      generator[0] = std::sqrt(1.0 / 3.0);
+      generator[1] = std::sqrt(1.0 / 3.0);
+      generator[2] = std::sqrt(1.0 / 3.0);
+      break;
+    case B:
+      generator[0] = orbit.parameter;
+      generator[1] = orbit.parameter;
+      generator[2] = std::sqrt(1.0 - 2.0 * orbit.parameter * orbit.parameter);
+      break;
+    case C:
+      generator[0] = orbit.parameter;
+      generator[1] = std::sqrt(1.0 - orbit.parameter * orbit.parameter);
+      generator[2] = 0.0;
+      break;
+  }
+  const int permutations[6][3] =
+      {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  const size_t orbit_begin = samples->size();
+  for (const auto& permutation : permutations) {
+    for (int signs = 0; signs < 8; ++signs) {
+      SphericalSample sample;
+      sample.x = (signs & 1 ? -1.0 : 1.0) * generator[permutation[0]];
+      sample.y = (signs & 2 ? -1.0 : 1.0) * generator[permutation[1]];
+      sample.z = (signs & 4 ? -1.0 : 1.0) * generator[permutation[2]];
+      sample.weight = 4.0 * kPi * orbit.weight;
+      bool is_duplicate = false;
+      for (size_t i = orbit_begin; i < samples->size(); ++i) {
+        const SphericalSample& other = (*samples)[i];
+        if (other.x == sample.x && other.y == sample.y &&
+            other.z == sample.z) {
+          is_duplicate = true;
+          break;
+        }
+      }
+      if (!is_duplicate) {
+        samples->push_back(sample);
+      }
+    }
+  }
+}
+
+/*
+<p>For the hemisphere, we use the fact that the integral over the upper
+hemisphere of a function $f$ is half the integral over the whole sphere of
+$f(x,y,|z|)$. Since the Lebedev rules are symmetric with respect to the $z=0$
+plane, this gives the points with $z>0$, with their original weight, and the
+points with $z=0$, with half their original weight (the other points get a zero
+weight):
+*/
+
+void AddLebedevSamples(int sample_count, bool hemisphere,
+    std::vector<SphericalSample>* samples) {
+  for (const LebedevRule& rule : GetLebedevRules()) {
+    if (rule.sample_count != sample_count) {
+      continue;
+    }
+    for (const LebedevOrbit& orbit : rule.orbits) {
+      AddLebedevOrbitSamples(orbit, samples);
+    }
+    assert(static_cast<int>(samples->size()) == sample_count);
+    if (hemisphere) {
+      for (SphericalSample& sample : *samples) {
+        sample.weight *= sample.z > 0.0 ? 1.0 : (sample.z == 0.0 ? 0.5 : 0.0);
+      }
+    }
+  }
+}
+
+/*
+<p>Finally, the importance sampling rules distribute the samples like the
+functions which dominate the integrands. For the scattering density, this is the
+Mie phase function, which has a strong forward peak. We approximate it with the
+<a href="https://doi.org/10.1086/144246">Henyey-Greenstein</a> phase function,
+whose cumulative distribution function can be inverted analytically, and we
+sample it with half of the samples (the other half being Fibonacci samples, for
+the Rayleigh phase function and for the rest of the sphere). The two sets are
+combined with the <a href="https://graphics.stanford.edu/papers/combine/">
+balance heuristic</a>, i.e. each sample is weighted with the inverse of the sum
+of the two sample densities. For the indirect irradiance, the integrand is
+dominated by the cosine factor, which we sample exactly:
+*/
+
+double HenyeyGreensteinPhaseFunction(double g, double cos_theta) {
+  double k = 1.0 + g * g - 2.0 * g * cos_theta;
+  return (1.0 - g * g) / (4.0 * kPi * k * std::sqrt(k));
+}
+
+double SampleHenyeyGreensteinPhaseFunction(double g, double xi) {
+  if (std::abs(g) < 1e-3) {
+    return 1.0 - 2.0 * xi;
+  }
+  double s = (1.0 - g * g) / (1.0 - g + 2.0 * g * xi);
+  return std::max(-1.0, std::min((1.0 + g * g - s * s) / (2.0 * g), 1.0));
+}
+
+void AddImportanceSamples(int sample_count, bool hemisphere, double g,
+    std::vector<SphericalSample>* samples) {
+  if (hemisphere) {
+    for (int i = 0; i < sample_count; ++i) {
+      double cos_theta = std::sqrt(1.0 - (i + 0.5) / sample_count);
+      samples->push_back(MakeSample(cos_theta, i * kGoldenAngle,
+          kPi / (sample_count * cos_theta)));
+    }
+    return;
+  }
+  const int phase_function_sample_count = sample_count / 2;
+  const int uniform_sample_count = sample_count - phase_function_sample_count;
+  AddFibonacciSamples(uniform_sample_count, false /* hemisphere */, 0.0,
+      samples);
+  for (int i = 0; i < phase_function_sample_count; ++i) {
+    double cos_theta = SampleHenyeyGreensteinPhaseFunction(g,
+        (i + 0.5) / phase_function_sample_count);
+    samples->push_back(MakeSample(cos_theta, i * kGoldenAngle, 0.0));
+  }
+  for (SphericalSample& sample : *samples) {
+    double phase_function = std::abs(g) < 1e-3 ?
+        1.0 / (4.0 * kPi) : HenyeyGreensteinPhaseFunction(g, sample.z);
+    sample.weight = 1.0 / (uniform_sample_count / (4.0 * kPi) +
+        phase_function_sample_count * phase_function);
+  }
+}
+
+}  // anonymous namespace
+
+std::vector<SphericalSample> ComputeSphericalSamples(int rule,
+    int sample_count, bool hemisphere, double mie_phase_function_g) {
+  std::vector<SphericalSample> samples;
+  switch (rule) {
+    case LATITUDE_LONGITUDE_RULE:
+      AddLatitudeLongitudeSamples(sample_count, hemisphere, &samples);
+      break;
+    case FIBONACCI_RULE:
+      AddFibonacciSamples(sample_count, hemisphere,
+          (hemisphere ? 2.0 : 4.0) * kPi / sample_count, &samples);
+      break;
+    case LEBEDEV_RULE:
+      AddLebedevSamples(sample_count, hemisphere, &samples);
+      break;
+    case IMPORTANCE_SAMPLING_RULE:
+      AddImportanceSamples(sample_count, hemisphere, mie_phase_function_g,
+          &samples);
+      break;
+  }
+  const SphericalSample unused_sample = {0.0, 0.0, 1.0, 0.0};
+  samples.resize(std::max(sample_count, 0), unused_sample);
+  return samples;
+}
+
+int GetSphericalSamplesTextureWidth(const Quadrature& quadrature) {
+  return std::max(quadrature.scattering_density_sample_count,
+      quadrature.indirect_irradiance_sample_count);
+}
+
+}  // namespace atmosphere
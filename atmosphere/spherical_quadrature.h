@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/spherical_quadrature.h</h2>
+
+<p>This file defines the tables of sample directions and weights which are used
+to compute the integrals over the incident directions in the
+<code>ComputeScatteringDensity</code> and <code>ComputeIndirectIrradiance</code>
+<a href="functions.glsl.html">GLSL functions</a>, for the spherical quadrature
+rules defined in <a href="constants.h.html">constants.h</a>. These tables are
+computed once on CPU, and are then stored in a small texture by the
+<a href="model.h.html">GPU model</a> and by the
+<a href="reference/model.h.html">CPU model</a>, with one row per function (see
+<code>GetSphericalSample</code> in <a href="functions.glsl.html">
+functions.glsl</a>).
+*/
+
+#ifndef ATMOSPHERE_SPHERICAL_QUADRATURE_H_
+#define ATMOSPHERE_SPHERICAL_QUADRATURE_H_
+
+#include <vector>
+
+#include "atmosphere/constants.h"
+
+namespace atmosphere {
+
+// A unit sample direction, and its weight, i.e. the solid angle it represents,
+// in steradians.
+struct SphericalSample {
+  double x;
+  double y;
+  double z;
+  double weight;
+};
+
+// Returns 'sample_count' samples of the given SphericalQuadratureRule. If
+// 'hemisphere' is false, the samples cover the whole sphere, and the
+// importance sampling rule samples the Henyey-Greenstein phase function with
+// the given asymmetry parameter, around the +z axis (ComputeScatteringDensity
+// maps this axis to the view direction). Otherwise the samples cover the upper
+// hemisphere (z >= 0), and the importance sampling rule samples the cosine of
+// the zenith angle. Unused samples (e.g. with the Lebedev rule, for the
+// directions below the horizon) have a zero weight.
+std::vector<SphericalSample> ComputeSphericalSamples(int rule,
+    int sample_count, bool hemisphere, double mie_phase_function_g);
+
+// Returns the width of the sample texture, i.e. the maximum number of samples
+// per row.
+int GetSphericalSamplesTextureWidth(const Quadrature& quadrature);
+
+}  // namespace atmosphere
+
+#endif  // ATMOSPHERE_SPHERICAL_QUADRATURE_H_
@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*<h2>atmosphere/spherical_quadrature_test.cc</h2>
+
+<p>This file provides unit tests for the <a href="spherical_quadrature.h.html">
+spherical quadrature rules</a> used to integrate over the incident directions.
+*/
+
+#include "atmosphere/spherical_quadrature.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace atmosphere {
+
+namespace {
+
+constexpr double kPi = 3.1415926535897932;
+
+// The exact integral over the unit sphere of x^a y^b z^c.
+double GetMonomialIntegral(int a, int b, int c) {
+  if (a % 2 != 0 || b % 2 != 0 || c % 2 != 0) {
+    return 0.0;
+  }
+  return 2.0 * std::tgamma((a + 1) / 2.0) * std::tgamma((b + 1) / 2.0) *
+      std::tgamma((c + 1) / 2.0) / std::tgamma((a + b + c + 3) / 2.0);
+}
+
+// The integral of the Henyey-Greenstein phase function over the unit sphere is
+// 1, and most of it comes from the directions close to the +z axis for g close
+// to 1.
+double HenyeyGreensteinPhaseFunction(double g, double cos_theta) {
+  double k = 1.0 + g * g - 2.0 * g * cos_theta;
+  return (1.0 - g * g) / (4.0 * kPi * k * std::sqrt(k));
+}
+
+}  // anonymous namespace
+
+class SphericalQuadratureTest : public dimensional::TestCase {
+ public:
+  template<typename T>
+  SphericalQuadratureTest(const std::string& name, T test)
+      : TestCase("SphericalQuadratureTest " + name, static_cast<Test>(test)) {}
+
+  // Checks that each rule returns the requested number of samples, with unit
+  // directions (in the upper hemisphere, for the hemisphere rules).
+  void TestSampleDirections() {
+    for (int rule = LATITUDE_LONGITUDE_RULE; rule <= IMPORTANCE_SAMPLING_RULE;
+         ++rule) {
+      const int sample_count = rule == LEBEDEV_RULE ? 110 : 512;
+      for (bool hemisphere : {false, true}) {
+        std::vector<SphericalSample> samples =
+            ComputeSphericalSamples(rule, sample_count, hemisphere, 0.8);
+        ExpectEquals(sample_count, samples.size());
+        for (const SphericalSample& sample : samples) {
+          ExpectNear(1.0, sample.x * sample.x + sample.y * sample.y +
+              sample.z * sample.z, 1e-12);
+          if (hemisphere && sample.weight != 0.0) {
+            ExpectTrue(sample.z >= 0.0);
+          }
+        }
+      }
+    }
+  }
+
+  // Checks that the weights sum to the solid angle of the sphere (4 pi), or of
+  // the hemisphere (2 pi). With the importance sampling rule, this holds only
+  // approximately for the sphere, and is replaced with the integral of the
+  // cosine factor (pi) for the hemisphere, which is exact.
+  void TestSolidAngles() {
+    ExpectNear(4.0 * kPi, GetSum(FIBONACCI_RULE, 512, false, 0), 1e-9);
+    ExpectNear(2.0 * kPi, GetSum(FIBONACCI_RULE, 1024, true, 0), 1e-9);
+    ExpectNear(4.0 * kPi, GetSum(LATITUDE_LONGITUDE_RULE, 512, false, 0),
+        2e-3 * 4.0 * kPi);
+    ExpectNear(2.0 * kPi, GetSum(LATITUDE_LONGITUDE_RULE, 1024, true, 0),
+        1e-3 * 2.0 * kPi);
+    for (int sample_count : LEBEDEV_SAMPLE_COUNTS) {
+      ExpectNear(4.0 * kPi, GetSum(LEBEDEV_RULE, sample_count, false, 0),
+          1e-9);
+      ExpectNear(2.0 * kPi, GetSum(LEBEDEV_RULE, sample_count, true, 0), 1e-9);
+    }
+    ExpectNear(4.0 * kPi, GetSum(IMPORTANCE_SAMPLING_RULE, 512, false, 0),
+        1e-5 * 4.0 * kPi);
+    ExpectNear(kPi, GetSum(IMPORTANCE_SAMPLING_RULE, 1024, true, 1), 1e-9);
+  }
+
+  // Checks that the Lebedev rules integrate exactly all the polynomials up to
+  // their algebraic order.
+  void TestLebedevRules() {
+    const int kDegrees[] = {3, 5, 7, 9, 11, 13, 15, 17};
+    int k = 0;
+    for (int sample_count : LEBEDEV_SAMPLE_COUNTS) {
+      std::vector<SphericalSample> samples =
+          ComputeSphericalSamples(LEBEDEV_RULE, sample_count, false, 0.0);
+      const int degree = kDegrees[k++];
+      for (int a = 0; a <= degree; ++a) {
+        for (int b = 0; a + b <= degree; ++b) {
+          for (int c = 0; a + b + c <= degree; ++c) {
+            double integral = 0.0;
+            for (const SphericalSample& sample : samples) {
+              integral += sample.weight * std::pow(sample.x, a) *
+                  std::pow(sample.y, b) * std::pow(sample.z, c);
+            }
+            ExpectNear(GetMonomialIntegral(a, b, c), integral, 1e-9);
+          }
+        }
+      }
+    }
+  }
+
+  // Checks that the importance sampling rule integrates a strongly forward
+  // peaked phase function much more precisely than the other rules, with the
+  // same number of samples.
+  void TestImportanceSampling() {
+    const double g = 0.8;
+    auto get_error = [g](int rule) {
+      double integral = 0.0;
+      for (const SphericalSample& sample :
+           ComputeSphericalSamples(rule, 110, false, g)) {
+        integral += sample.weight * HenyeyGreensteinPhaseFunction(g, sample.z);
+      }
+      return std::abs(integral - 1.0);
+    };
+    ExpectTrue(get_error(IMPORTANCE_SAMPLING_RULE) < 1e-4);
+    ExpectTrue(get_error(FIBONACCI_RULE) > 1e-2);
+    ExpectTrue(get_error(LATITUDE_LONGITUDE_RULE) > 1e-2);
+  }
+
+ private:
+  // Returns the sum of the sample weights times z^power.
+  double GetSum(int rule, int sample_count, bool hemisphere, int power) {
+    double sum = 0.0;
+    for (const SphericalSample& sample :
+         ComputeSphericalSamples(rule, sample_count, hemisphere, 0.8)) {
+      sum += sample.weight * std::pow(sample.z, power);
+    }
+    return sum;
+  }
+};
+
+namespace {
+
+SphericalQuadratureTest sample_directions(
+    "SampleDirections",
+    &SphericalQuadratureTest::TestSampleDirections);
+SphericalQuadratureTest solid_angles(
+    "SolidAngles",
+    &SphericalQuadratureTest::TestSolidAngles);
+SphericalQuadratureTest lebedev_rules(
+    "LebedevRules",
+    &SphericalQuadratureTest::TestLebedevRules);
+SphericalQuadratureTest importance_sampling(
+    "ImportanceSampling",
+    &SphericalQuadratureTest::TestImportanceSampling);
+
+}  // anonymous namespace
+
+}  // namespace atmosphere